@@ -0,0 +1,129 @@
+/*
+ *  Copyright (C) 2019 RidgeRun, LLC (http://www.ridgerun.com)
+ *  All Rights Reserved.
+ *
+ *  The contents of this software are proprietary and confidential to RidgeRun,
+ *  LLC.  No part of this program may be photocopied, reproduced or translated
+ *  into another programming language without prior written consent of
+ *  RidgeRun, LLC.  The user is free to modify the source code after obtaining
+ *  a software license from RidgeRun.  All source code changes must be provided
+ *  back to RidgeRun without any encumbrance.
+ */
+
+/*
+ * Micro-benchmark of the ST0601 validation, the same path misbparser
+ * runs for every packet. A typical UAS packet is built once and then
+ * validated in a loop, the throughput is reported in packets per second
+ * for a single core.
+ *
+ * Usage: klv-benchmark [packets] [tags]
+ *        (defaults to 10000000 packets with 40 tags each)
+ */
+
+#include <gst/gst.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "klv.h"
+#include "klvutils.h"
+#include "misbparser.h"
+#include "st0601dictionary.h"
+
+static const guchar uas_key[MISB_KEY_SIZE] = {
+  0x06, 0x0E, 0x2B, 0x34, 0x02, 0x0B, 0x01, 0x01,
+  0x0E, 0x01, 0x03, 0x01, 0x01, 0x00, 0x00, 0x00
+};
+
+/* Key, BER long length, timestamp, tags with 4 byte values, checksum */
+static guchar *
+make_packet (guint tags, guint * size)
+{
+  guint length = 10 + tags * 6 + 4;
+  guchar *data, *p;
+  guint64 timestamp;
+  guint16 checksum;
+  guint i;
+
+  *size = MISB_KEY_SIZE + 3 + length;
+  data = g_malloc (*size);
+  p = data;
+
+  memcpy (p, uas_key, MISB_KEY_SIZE);
+  p += MISB_KEY_SIZE;
+  *p++ = 0x82;
+  *p++ = length >> 8;
+  *p++ = length & 0xFF;
+
+  *p++ = UAS_TAG_TIMESTAMP;
+  *p++ = 8;
+  timestamp = klv_utils_get_current_timestamp ();
+  for (i = 0; i < 8; i++)
+    *p++ = timestamp >> (56 - 8 * i);
+
+  for (i = 0; i < tags; i++) {
+    *p++ = UAS_TAG_MISSION_ID + i % 90;
+    *p++ = 4;
+    *p++ = g_random_int_range (0, 256);
+    *p++ = g_random_int_range (0, 256);
+    *p++ = g_random_int_range (0, 256);
+    *p++ = g_random_int_range (0, 256);
+  }
+
+  *p++ = UAS_TAG_CHECKSUM;
+  *p++ = 2;
+  checksum = klv_utils_calculate_checksum (data, *size - 2);
+  *p++ = checksum >> 8;
+  *p++ = checksum & 0xFF;
+
+  return data;
+}
+
+int
+main (gint argc, gchar * argv[])
+{
+  MisbParser *parser;
+  Klv *klv, *new_klv = NULL;
+  guchar *data;
+  guint size;
+  guint packets = 10000000;
+  guint tags = 40;
+  guint valid = 0;
+  gint64 start, elapsed;
+  guint i;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    packets = atoi (argv[1]);
+  if (argc > 2)
+    tags = atoi (argv[2]);
+
+  parser = misb_parser_alloc ();
+  misb_parser_add_std (parser, MISB_STD_0601);
+
+  data = make_packet (tags, &size);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < packets; i++) {
+    if (!klv_get (data, &klv))
+      break;
+    if (misb_parser_validate_packet (parser, klv, &new_klv,
+            FALSE) == MISB_RET_OK)
+      valid++;
+    klv_release (klv);
+    if (new_klv) {
+      klv_release (new_klv);
+      new_klv = NULL;
+    }
+  }
+  elapsed = g_get_monotonic_time () - start;
+
+  g_print ("%u packets of %u bytes (%u valid) in %.3f s: %.2f Mpackets/s, "
+      "%.1f MB/s\n", i, size, valid, elapsed / 1e6,
+      (gdouble) i / elapsed, (gdouble) i * size / elapsed);
+
+  g_free (data);
+  misb_parser_release (parser);
+
+  return valid == packets ? 0 : 1;
+}
@@ -57,6 +57,16 @@ GST_DEBUG_CATEGORY_STATIC (gst_misb_parser_debug_category);
 
 #define DEFAULT_PROP_DUMP TRUE
 
+/* All SMPTE universal labels start with these bytes */
+static const guint8 klv_ul_prefix[] = { 0x06, 0x0E, 0x2B, 0x34 };
+
+/* Key plus the shortest BER length */
+#define KLV_MIN_SIZE (MISB_KEY_SIZE + 1)
+/* BER long form with up to 4 length bytes */
+#define KLV_MAX_BER_SIZE 5
+/* Anything bigger than this is most likely a false key match */
+#define KLV_MAX_PACKET_SIZE (1 << 20)
+
 /* prototypes */
 
 
@@ -68,6 +78,7 @@ static GstFlowReturn gst_misb_parser_pre_push_frame (GstBaseParse * parse,
     GstBaseParseFrame * frame);
 static GstFlowReturn gst_misb_parser_handle_frame (GstBaseParse * parse,
     GstBaseParseFrame * frame, gint * skipsize);
+static gboolean gst_misb_parser_start (GstBaseParse * parse);
 static void gst_misb_parser_finalize (GObject * object);
 
 enum
@@ -140,6 +151,7 @@ gst_misb_parser_class_init (GstMisbParserClass * klass)
       GST_DEBUG_FUNCPTR (gst_misb_parser_pre_push_frame);
   base_parse_class->handle_frame =
       GST_DEBUG_FUNCPTR (gst_misb_parser_handle_frame);
+  base_parse_class->start = GST_DEBUG_FUNCPTR (gst_misb_parser_start);
 
   g_object_class_install_property (gobject_class, PROP_DUMP,
       g_param_spec_boolean ("dump", "Dump",
@@ -278,15 +290,128 @@ release_resources:
   return ret;
 }
 
+static gboolean
+gst_misb_parser_start (GstBaseParse * parse)
+{
+  gst_base_parse_set_min_frame_size (parse, KLV_MIN_SIZE);
+
+  return TRUE;
+}
+
+/* Looks for the beginning of a universal label, returns the offset of the
+ * first candidate or -1 if there is none. A partial match at the end is
+ * also reported, so that it's kept for the next round.
+ */
+static gint
+gst_misb_parser_find_key (const guint8 * data, gsize size)
+{
+  gsize i, j;
+
+  for (i = 0; i < size; i++) {
+    for (j = 0; j < sizeof (klv_ul_prefix) && i + j < size; j++) {
+      if (data[i + j] != klv_ul_prefix[j])
+        break;
+    }
+    if (j == sizeof (klv_ul_prefix) || i + j == size)
+      return i;
+  }
+
+  return -1;
+}
+
+/* Decodes the BER length after the key. Returns FALSE if more data is
+ * needed, and sets *valid to FALSE if the length can't be right.
+ */
+static gboolean
+gst_misb_parser_get_length (const guint8 * data, gsize size, guint * length,
+    guint * ber_size, gboolean * valid)
+{
+  guint bytes, i;
+
+  *valid = TRUE;
+
+  if (size < 1)
+    return FALSE;
+
+  /* BER short */
+  if ((data[0] & 0x80) == 0) {
+    *length = data[0];
+    *ber_size = 1;
+    return TRUE;
+  }
+
+  /* BER long */
+  bytes = data[0] & 0x7F;
+  if (bytes == 0 || bytes + 1 > KLV_MAX_BER_SIZE) {
+    *valid = FALSE;
+    return TRUE;
+  }
+
+  if (size < bytes + 1)
+    return FALSE;
+
+  *length = 0;
+  for (i = 1; i <= bytes; i++)
+    *length = (*length << 8) | data[i];
+  *ber_size = bytes + 1;
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_misb_parser_handle_frame (GstBaseParse * parse,
     GstBaseParseFrame * frame, gint * skipsize)
 {
   GstMisbParser *misbparser = GST_MISB_PARSER (parse);
-  gsize insize = gst_buffer_get_size (frame->buffer);
+  GstMapInfo map;
+  gint offset;
+  guint length, ber_size, framesize;
+  gboolean valid;
 
   GST_LOG_OBJECT (misbparser, "handle_frame");
 
+  gst_buffer_map (frame->buffer, &map, GST_MAP_READ);
+
+  /* Resync on whatever precedes the next key */
+  offset = gst_misb_parser_find_key (map.data, map.size);
+  if (offset != 0) {
+    *skipsize = offset < 0 ? map.size : offset;
+    GST_DEBUG_OBJECT (misbparser, "Skipping %d bytes to the next key",
+        *skipsize);
+    goto skip;
+  }
+
+  /* The whole key is needed before the length can be read */
+  if (map.size < KLV_MIN_SIZE) {
+    gst_base_parse_set_min_frame_size (parse, KLV_MIN_SIZE);
+    goto more;
+  }
+
+  if (!gst_misb_parser_get_length (map.data + MISB_KEY_SIZE,
+          map.size - MISB_KEY_SIZE, &length, &ber_size, &valid)) {
+    gst_base_parse_set_min_frame_size (parse, MISB_KEY_SIZE +
+        KLV_MAX_BER_SIZE);
+    goto more;
+  }
+
+  if (!valid || length > KLV_MAX_PACKET_SIZE) {
+    GST_DEBUG_OBJECT (misbparser, "Invalid length, not a key");
+    *skipsize = 1;
+    goto skip;
+  }
+
+  /* Wait for the packet to be complete */
+  framesize = MISB_KEY_SIZE + ber_size + length;
+  if (map.size < framesize) {
+    GST_LOG_OBJECT (misbparser, "Need %u bytes, have %" G_GSIZE_FORMAT,
+        framesize, map.size);
+    gst_base_parse_set_min_frame_size (parse, framesize);
+    goto more;
+  }
+
+  gst_buffer_unmap (frame->buffer, &map);
+  gst_base_parse_set_min_frame_size (parse, KLV_MIN_SIZE);
+
   if (!gst_pad_has_current_caps (GST_BASE_PARSE_SRC_PAD (parse))) {
     GstCaps *caps;
 
@@ -295,5 +420,17 @@ gst_misb_parser_handle_frame (GstBaseParse * parse,
     gst_caps_unref (caps);
   }
 
-  return gst_base_parse_finish_frame (parse, frame, insize);
+  return gst_base_parse_finish_frame (parse, frame, framesize);
+
+skip:
+  {
+    gst_buffer_unmap (frame->buffer, &map);
+    return GST_FLOW_OK;
+  }
+more:
+  {
+    gst_buffer_unmap (frame->buffer, &map);
+    *skipsize = 0;
+    return GST_FLOW_OK;
+  }
 }
@@ -13,6 +13,7 @@
 #include "klvutils.h"
 
 #include <gst/gst.h>
+#include <string.h>
 #include <sys/time.h>
 
 #define BER_OID_CONTINUATION_BIT_MASK 0x80
@@ -22,6 +23,7 @@
 #define BYTE_MASK 0xFF
 #define BER_MAX_VALUE 0xFFFFFF
 #define BER_OID_MAX_VALUE 0xFFFFFFF
+#define SUM_LANE_MASK G_GUINT64_CONSTANT (0x00FF00FF00FF00FF)
 
 guint
 klv_utils_ber_oid_decode (guchar * data, guint * length)
@@ -174,18 +176,41 @@ klv_utils_ber_oid_encode (guint indata, guint * outdata)
 guint16
 klv_utils_calculate_checksum (guchar * data, guint length)
 {
-  guint16 bcc;
-  guint i;
+  guint64 word, even, odd;
+  guint32 bcc;
+  guint i, n;
 
   g_return_val_if_fail (data != NULL, -1);
 
   bcc = 0;
-  for (i = 0; i < length; i++)
+  i = 0;
+
+  /* Add up 8 bytes at a time. Even bytes are the high half of each 16 bit
+     word, odd bytes the low half, so they are summed in separate 16 bit
+     lanes. A lane can take 256 additions of 0xFF before overflowing */
+  while (length - i >= 8) {
+    even = 0;
+    odd = 0;
+    for (n = 0; n < 256 && length - i >= 8; n++, i += 8) {
+      memcpy (&word, &data[i], sizeof (word));
+      word = GUINT64_FROM_LE (word);
+      even += word & SUM_LANE_MASK;
+      odd += (word >> 8) & SUM_LANE_MASK;
+    }
+
+    even = (even & 0xFFFF) + ((even >> 16) & 0xFFFF) +
+        ((even >> 32) & 0xFFFF) + (even >> 48);
+    odd = (odd & 0xFFFF) + ((odd >> 16) & 0xFFFF) +
+        ((odd >> 32) & 0xFFFF) + (odd >> 48);
+    bcc += (guint32) ((even << 8) + odd);
+  }
+
+  for (; i < length; i++)
     bcc += data[i] << (8 * ((i + 1) % 2));
 
-  GST_LOG ("bcc: 0x%04X", bcc);
+  GST_LOG ("bcc: 0x%04X", (guint16) bcc);
 
-  return bcc;
+  return (guint16) bcc;
 }
 
 guint64
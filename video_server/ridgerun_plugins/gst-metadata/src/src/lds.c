@@ -29,13 +29,6 @@ struct _Lde
 };
 typedef struct _Lde Lde;
 
-typedef enum
-{
-  STATE_TAG,
-  STATE_LENGTH,
-  STATE_VALUE
-} states;
-
 static void
 _lde_set_allocated (Lde * lde, gboolean allocated)
 {
@@ -44,64 +37,227 @@ _lde_set_allocated (Lde * lde, gboolean allocated)
   lde->value_is_allocated = allocated;
 }
 
+/* Same as klv_utils_ber_oid_decode but never reads past avail */
+static gboolean
+_lds_decode_tag (const guchar * data, guint avail, guint * tag, guint * size)
+{
+  guint i;
+  guint val;
+
+  val = 0;
+  for (i = 0; i < avail && i < 4; i++) {
+    val = (val << 7) | (data[i] & 0x7F);
+    if ((data[i] & 0x80) == 0) {
+      *tag = val;
+      *size = i + 1;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/* Same as klv_utils_ber_decode but never reads past avail */
+static gboolean
+_lds_decode_length (const guchar * data, guint avail, guint * length,
+    guint * size)
+{
+  guint bytes;
+  guint i;
+  guint val;
+
+  if (avail < 1)
+    return FALSE;
+
+  /* BER short */
+  if ((data[0] & 0x80) == 0) {
+    *length = data[0];
+    *size = 1;
+    return TRUE;
+  }
+
+  /* BER long */
+  bytes = data[0] & 0x7F;
+  if (bytes > 4 || bytes + 1 > avail)
+    return FALSE;
+
+  val = 0;
+  for (i = 1; i <= bytes; i++)
+    val = (val << 8) | data[i];
+
+  *length = val;
+  *size = bytes + 1;
+  return TRUE;
+}
+
+/* Decodes the element starting at *pos and moves *pos past it */
+static gboolean
+_lds_decode_element (const guchar * data, guint length, guint * pos,
+    LdsElement * element)
+{
+  guint i;
+  guint size;
+
+  i = *pos;
+
+  if (!_lds_decode_tag (&data[i], length - i, &element->tag, &size)
+      || element->tag == 0)
+    return FALSE;
+  i += size;
+
+  if (!_lds_decode_length (&data[i], length - i, &element->length, &size))
+    return FALSE;
+  i += size;
+
+  if (element->length > length - i)
+    return FALSE;
+  element->offset = i;
+
+  *pos = i + element->length;
+  return TRUE;
+}
+
+/* Moves the elements to the heap, doubling the room for them. Only
+   unusually large sets get here */
+static void
+_lds_view_grow (LdsView * view)
+{
+  view->max_elements *= 2;
+  if (view->elements == view->prealloc) {
+    view->elements = g_new (LdsElement, view->max_elements);
+    memcpy (view->elements, view->prealloc,
+        view->n_elements * sizeof (LdsElement));
+  } else {
+    view->elements = g_renew (LdsElement, view->elements, view->max_elements);
+  }
+}
+
 gboolean
-lds_get (guchar * data, guint length, Lds ** lds)
+lds_view_parse (LdsView * view, const guchar * data, guint length)
 {
+  LdsElement *element;
   guint i;
-  guint length_size;
-  guint tags;
-  states state;
-  Lds *my_lds;
-  Lde *element;
 
-  g_return_val_if_fail (data != NULL, 0);
-  g_return_val_if_fail (lds != NULL, 0);
+  g_return_val_if_fail (view != NULL, FALSE);
+  g_return_val_if_fail (data != NULL, FALSE);
 
-  state = STATE_TAG;
-  my_lds = *lds;
+  view->data = data;
+  view->size = length;
+  view->n_elements = 0;
+  view->elements = view->prealloc;
+  view->max_elements = LDS_PREALLOC_ELEMENTS;
 
   i = 0;
-  tags = 0;
+  while (i < length) {
+    if (view->n_elements == view->max_elements)
+      _lds_view_grow (view);
+    element = &view->elements[view->n_elements];
+
+    if (!_lds_decode_element (data, length, &i, element))
+      return FALSE;
 
+    view->n_elements++;
+  }
+
+  return TRUE;
+}
+
+gboolean
+lds_walk (const guchar * data, guint length, guint * last)
+{
+  LdsElement element;
+  guint i;
+
+  g_return_val_if_fail (data != NULL, FALSE);
+  g_return_val_if_fail (last != NULL, FALSE);
+
+  if (length == 0)
+    return FALSE;
+
+  i = 0;
   while (i < length) {
+    *last = i;
+    if (!_lds_decode_element (data, length, &i, &element))
+      return FALSE;
+  }
 
-    switch (state) {
-      case STATE_TAG:
-        element = g_malloc(sizeof(Lde));
-        element->tag = klv_utils_ber_oid_decode (&data[i], &length_size);
+  return TRUE;
+}
 
-        if (element->tag == 0)
-          return FALSE;
+void
+lds_view_clear (LdsView * view)
+{
+  g_return_if_fail (view != NULL);
 
-        i += length_size;
-        tags++;
+  if (view->elements != view->prealloc)
+    g_free (view->elements);
 
-        state = STATE_LENGTH;
-        break;
+  view->elements = view->prealloc;
+  view->max_elements = LDS_PREALLOC_ELEMENTS;
+  view->n_elements = 0;
+}
 
-      case STATE_LENGTH:
-        element->length = klv_utils_ber_decode (&data[i], &length_size);
-        i += length_size;
+const LdsElement *
+lds_view_get (const LdsView * view, guint index)
+{
+  g_return_val_if_fail (view != NULL, NULL);
 
-        state = STATE_VALUE;
-        break;
+  if (index >= view->n_elements)
+    return NULL;
 
-      case STATE_VALUE:
-        element->value = &data[i];
-        _lde_set_allocated (element, FALSE);
-        i += element->length;
+  return &view->elements[index];
+}
 
-        my_lds = g_slist_append(my_lds, (gpointer)element);
+const LdsElement *
+lds_view_last (const LdsView * view)
+{
+  g_return_val_if_fail (view != NULL, NULL);
 
-        state = STATE_TAG;
-        break;
+  if (view->n_elements == 0)
+    return NULL;
+
+  return &view->elements[view->n_elements - 1];
+}
 
-      default:
-        return FALSE;
-    };
+const guchar *
+lds_view_value (const LdsView * view, const LdsElement * element)
+{
+  g_return_val_if_fail (view != NULL, NULL);
+  g_return_val_if_fail (element != NULL, NULL);
+
+  return view->data + element->offset;
+}
+
+gboolean
+lds_get (guchar * data, guint length, Lds ** lds)
+{
+  LdsView view;
+  Lds *my_lds;
+  Lde *element;
+  guint i;
+
+  g_return_val_if_fail (data != NULL, 0);
+  g_return_val_if_fail (lds != NULL, 0);
+
+  if (!lds_view_parse (&view, data, length)) {
+    lds_view_clear (&view);
+    return FALSE;
   }
 
-  *lds = my_lds;
+  /* Build the list backwards, appending would walk it every time */
+  my_lds = NULL;
+  for (i = view.n_elements; i > 0; i--) {
+    element = g_slice_new (Lde);
+    element->tag = view.elements[i - 1].tag;
+    element->length = view.elements[i - 1].length;
+    element->value = &data[view.elements[i - 1].offset];
+    _lde_set_allocated (element, FALSE);
+
+    my_lds = g_slist_prepend (my_lds, (gpointer) element);
+  }
+  lds_view_clear (&view);
+
+  *lds = g_slist_concat (*lds, my_lds);
   return TRUE;
 }
 
@@ -189,7 +345,7 @@ _lde_release(gpointer data)
   if (element->value_is_allocated)
     g_free (element->value);
 
-  g_free(element);
+  g_slice_free (Lde, element);
 }
 
 void
@@ -207,7 +363,7 @@ _lde_create (guint tag, guint length, guchar * value)
   
   g_return_val_if_fail(value != NULL, NULL);
 
-  element = g_malloc (sizeof (Lde));
+  element = g_slice_new (Lde);
 
   element->tag = tag;
   element->length = length;
@@ -27,7 +27,114 @@ G_BEGIN_DECLS
   typedef GSList Lds;
 
 /**
- * @brief Get Lds struct from the given data
+ * @brief Number of elements an \ref LdsView holds without
+ * allocating memory
+ * 
+ */
+#define LDS_PREALLOC_ELEMENTS 256
+
+/**
+ * @brief A single Local Data Set element. It doesn't own any
+ * memory, the value lives in the data the view was parsed from
+ * 
+ */
+  typedef struct _LdsElement LdsElement;
+
+  struct _LdsElement
+  {
+    guint tag;
+    guint length;
+    /* Offset of the value from the start of the data */
+    guint offset;
+  };
+
+/**
+ * @brief Flat view of a Local Data Set. Meant to be placed
+ * on the stack, parsing it only allocates memory for sets with
+ * more than \ref LDS_PREALLOC_ELEMENTS elements
+ * 
+ */
+  typedef struct _LdsView LdsView;
+
+  struct _LdsView
+  {
+    const guchar *data;
+    guint size;
+    guint n_elements;
+    /* Points to prealloc until the set outgrows it */
+    LdsElement *elements;
+    guint max_elements;
+    LdsElement prealloc[LDS_PREALLOC_ELEMENTS];
+  };
+
+/**
+ * @brief Parses the given data into a flat view in a single pass.
+ * Every tag, length and value is bounds checked against length.
+ * Release it with \ref lds_view_clear, also before parsing into
+ * it again
+ * 
+ * @param view The view to fill. It references data, so data has
+ * to outlive it
+ * @param data Raw data representing an Lds
+ * @param length The length of the data in bytes
+ * @return gboolean TRUE if the whole data was successfully parsed
+ */
+  gboolean lds_view_parse (LdsView * view, const guchar * data,
+      guint length);
+
+/**
+ * @brief Walks the tag and length chain of the given data without
+ * storing anything. Every tag, length and value is bounds checked
+ * against length
+ * 
+ * @param data Raw data representing an Lds
+ * @param length The length of the data in bytes
+ * @param last The returned offset of the last element, its tag
+ * included, from the start of data
+ * @return gboolean TRUE if the chain ends exactly at length
+ */
+  gboolean lds_walk (const guchar * data, guint length, guint * last);
+
+/**
+ * @brief Releases the memory the view may have allocated while
+ * parsing. It has to be called once done with every parsed view,
+ * the view can't be used afterwards
+ * 
+ * @param view The view
+ */
+  void lds_view_clear (LdsView * view);
+
+/**
+ * @brief Gets the element at the given position of the view
+ * 
+ * @param view The view
+ * @param index The position of the element
+ * @return const LdsElement* The element or NULL if out of range
+ */
+  const LdsElement *lds_view_get (const LdsView * view, guint index);
+
+/**
+ * @brief Gets the last element of the view
+ * 
+ * @param view The view
+ * @return const LdsElement* The last element or NULL if empty
+ */
+  const LdsElement *lds_view_last (const LdsView * view);
+
+/**
+ * @brief Gets the value field of an element of the view
+ * 
+ * @param view The view the element belongs to
+ * @param element The element
+ * @return const guchar* The value field (use the element length
+ * to get its length)
+ */
+  const guchar *lds_view_value (const LdsView * view,
+      const LdsElement * element);
+
+/**
+ * @brief Get Lds struct from the given data. Prefer \ref lds_view_parse
+ * when the data only needs to be inspected
  * 
  * @param data Raw data representing an Lds. It has to be 
  * released by the user using g_free()
@@ -183,40 +183,38 @@ static TagStruct uas_tags[] = {
 #define UAS_NUM_TAGS ((sizeof(uas_tags) / sizeof(TagStruct)) - 1)
 
 static MisbReturn
-st0601_is_valid_timestamp (Lds * lds)
+st0601_is_valid_timestamp (const LdsElement * element)
 {
-  g_return_val_if_fail (lds != NULL, MISB_RET_INVALID_ARGUMENT);
-
-  if (lds_tag (lds) != UAS_TAG_TIMESTAMP)
+  if (element == NULL)
     return MISB_RET_NO_TIMESTAMP;
-  if (lds_length (lds) != 0x08)
+  if (element->tag != UAS_TAG_TIMESTAMP)
     return MISB_RET_NO_TIMESTAMP;
-  if (lds_value (lds) == NULL)
+  if (element->length != 0x08)
     return MISB_RET_NO_TIMESTAMP;
 
   return MISB_RET_OK;
 }
 
 static MisbReturn
-st0601_is_valid_checksum (Klv * klv, Lds * lds)
+st0601_is_valid_checksum (Klv * klv, const LdsView * view,
+    const LdsElement * element)
 {
   guint16 checksum;
   guint16 lds_checksum;
-  guchar *value;
+  const guchar *value;
 
-  g_return_val_if_fail (lds != NULL, MISB_RET_NO_CHECKSUM);
   g_return_val_if_fail (klv != NULL, MISB_RET_NO_CHECKSUM);
 
-  if (lds_tag (lds) != UAS_TAG_CHECKSUM)
+  if (element == NULL)
     return MISB_RET_NO_CHECKSUM;
-  if (lds_length (lds) != 0x02)
+  if (element->tag != UAS_TAG_CHECKSUM)
     return MISB_RET_NO_CHECKSUM;
-  if (lds_value (lds) == NULL)
+  if (element->length != 0x02)
     return MISB_RET_NO_CHECKSUM;
 
   checksum = klv_utils_calculate_checksum (klv_raw_data (klv),
       klv_packet_length (klv) - 2);
-  value = lds_value (lds);
+  value = lds_view_value (view, element);
   lds_checksum = value[1] | (value[0] << 8);
 
   if (checksum != lds_checksum)
@@ -277,21 +275,19 @@ st0601_try_fix (MisbReturn flag, Lds ** lds, Klv ** new_klv)
 }
 
 static void
-st0601_dump (Klv * klv, Lds * lds)
+st0601_dump (Klv * klv, const LdsView * view)
 {
   guint i, j;
-  Lds *tmp_lds;
+  const LdsElement *element;
   guint tag;
-  guchar *value;
+  const guchar *value;
   Key key;
 
   g_return_if_fail (klv != NULL);
-  g_return_if_fail (lds != NULL);
+  g_return_if_fail (view != NULL);
 
   GST_LOG ("Showing UAS content");
 
-  j = 0;
-  tmp_lds = lds;
   klv_key (klv, &key);
 
   g_print ("=========================\n");
@@ -303,40 +299,75 @@ st0601_dump (Klv * klv, Lds * lds)
   g_print ("\nLength:\t%u\n", klv_length (klv));
   g_print ("Value:\n");
 
-  while (tmp_lds) {
+  for (j = 0; j < view->n_elements; j++) {
+    element = lds_view_get (view, j);
 
     g_print ("--------\n--------\n");
     g_print ("[%u]\n", j);
 
-    tag = lds_tag (tmp_lds);
+    tag = element->tag;
     g_print ("Tag:\t[%u](%s)\n",
         tag,
         (tag >
             UAS_NUM_TAGS) ? uas_tags[UAS_TAG_NOTAG].name : uas_tags[tag].name);
 
     /*Length */
-    g_print ("Length:\t%u\n", lds_length (tmp_lds));
+    g_print ("Length:\t%u\n", element->length);
 
     /*Print value */
-    value = lds_value (tmp_lds);
+    value = lds_view_value (view, element);
     g_print ("Value:");
-    for (i = 0; i < lds_length (tmp_lds); i++) {
+    for (i = 0; i < element->length; i++) {
       if (i % 16 == 0)
         g_print ("\n\t");
 
       g_print ("%02X ", value[i]);
     }
     g_print ("\n");
-
-    tmp_lds = lds_next (tmp_lds);
-    j++;
   }
 }
 
+/* Checks a packet without storing its elements, assuming the usual
+ * layout: the timestamp as the first element and the checksum in the
+ * last 4 bytes, with the tag and length chain ending right at it.
+ * Anything else, including a wrong checksum, is left to the full check.
+ */
+static gboolean
+st0601_is_valid_fast (Klv * klv)
+{
+  const guchar *value;
+  guint length;
+  guint last;
+  guint16 checksum;
+
+  value = klv_value (klv);
+  length = klv_length (klv);
+
+  /* Timestamp (tag, length, 8 bytes) and checksum (tag, length, 2 bytes) */
+  if (length < 14)
+    return FALSE;
+
+  if (value[0] != UAS_TAG_TIMESTAMP || value[1] != 0x08)
+    return FALSE;
+
+  if (value[length - 4] != UAS_TAG_CHECKSUM || value[length - 3] != 0x02)
+    return FALSE;
+
+  /* A value may just happen to end with those bytes */
+  if (!lds_walk (value, length, &last) || last != length - 4)
+    return FALSE;
+
+  checksum = klv_utils_calculate_checksum (klv_raw_data (klv),
+      klv_packet_length (klv) - 2);
+
+  return checksum == (value[length - 1] | (value[length - 2] << 8));
+}
+
 MisbReturn
 st0601_validate_data (gpointer data, gpointer * new_data, gboolean dump)
 {
-  Lds *tmp_lds, *lds;
+  LdsView view;
+  Lds *lds;
   Klv *klv;
   MisbReturn ret;
 
@@ -344,40 +375,55 @@ st0601_validate_data (gpointer data, gpointer * new_data, gboolean dump)
 
   klv = (Klv *) data;
   lds = NULL;
-  tmp_lds = NULL;
   ret = MISB_RET_OK;
 
-  if (!lds_get (klv_value (klv), klv_length (klv), &lds)) {
+  if (!dump && st0601_is_valid_fast (klv))
+    return MISB_RET_OK;
+
+  /* The flat view only allocates for unusually large sets */
+  if (!lds_view_parse (&view, klv_value (klv), klv_length (klv))) {
     GST_WARNING ("Could not get LDS");
-    return MISB_RET_NO_LDS;
+    ret = MISB_RET_NO_LDS;
+    goto out;
   }
 
   /*Last element has to be the checksum */
-  tmp_lds = lds_last (lds);
-  ret = st0601_is_valid_checksum (klv, tmp_lds);
+  ret = st0601_is_valid_checksum (klv, &view, lds_view_last (&view));
 
   if (ret != MISB_RET_OK)
-    goto release_resources;
+    goto out;
 
   /*First element has to be the timestamp */
-  tmp_lds = lds_first (lds);
-  ret = st0601_is_valid_timestamp (tmp_lds);
+  ret = st0601_is_valid_timestamp (lds_view_get (&view, 0));
 
   if (ret == MISB_RET_OK) {
     if (dump)
-      st0601_dump (klv, lds);
-    goto release_resources;
+      st0601_dump (klv, &view);
+    goto out;
   }
 
   if (!new_data)
-    goto release_resources;
+    goto out;
+
+  /* Fixing needs an editable list */
+  if (!lds_get (klv_value (klv), klv_length (klv), &lds)) {
+    GST_WARNING ("Could not get LDS");
+    ret = MISB_RET_NO_LDS;
+    goto out;
+  }
 
   ret = st0601_try_fix (ret, &lds, (Klv **) new_data);
-  if (ret == MISB_RET_FIXED && dump)
-    st0601_dump ((Klv *) (*new_data), lds);
+  if (ret == MISB_RET_FIXED && dump) {
+    lds_view_clear (&view);
+    if (lds_view_parse (&view, klv_value ((Klv *) (*new_data)),
+            klv_length ((Klv *) (*new_data))))
+      st0601_dump ((Klv *) (*new_data), &view);
+  }
 
-release_resources:
   lds_release (lds);
+
+out:
+  lds_view_clear (&view);
   return ret;
 }
 
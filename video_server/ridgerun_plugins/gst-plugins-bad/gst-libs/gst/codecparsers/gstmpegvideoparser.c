@@ -178,36 +178,18 @@ set_fps_from_code (GstMpegVideoSequenceHdr * seqhdr, guint8 fps_code)
 
 /* @size and @offset are wrt current reader position */
 static inline gint
-scan_for_start_codes (const GstByteReader * reader, guint offset, guint size)
+scan_for_start_codes_in_reader (const GstByteReader * reader, guint offset,
+    guint size)
 {
-  const guint8 *data;
-  guint i = 0;
+  gint off;
 
   g_assert ((guint64) offset + size <= reader->size - reader->byte);
 
-  /* we can't find the pattern with less than 4 bytes */
-  if (G_UNLIKELY (size < 4))
+  off = scan_for_start_codes (reader->data + reader->byte + offset, size);
+  if (off < 0)
     return -1;
 
-  data = reader->data + reader->byte + offset;
-
-  while (i <= (size - 4)) {
-    if (data[i + 2] > 1) {
-      i += 3;
-    } else if (data[i + 1]) {
-      i += 2;
-    } else if (data[i] || data[i + 2] != 1) {
-      i++;
-    } else {
-      break;
-    }
-  }
-
-  if (i <= (size - 4))
-    return offset + i;
-
-  /* nothing found */
-  return -1;
+  return offset + off;
 }
 
 /****** API *******/
@@ -243,7 +225,7 @@ gst_mpeg_video_parse (GstMpegVideoPacket * packet,
   size -= offset;
   gst_byte_reader_init (&br, &data[offset], size);
 
-  off = scan_for_start_codes (&br, 0, size);
+  off = scan_for_start_codes_in_reader (&br, 0, size);
 
   if (off < 0) {
     GST_DEBUG ("No start code prefix in this buffer");
@@ -262,7 +244,7 @@ gst_mpeg_video_parse (GstMpegVideoPacket * packet,
 
   /* try to find end of packet */
   size -= off + 4;
-  off = scan_for_start_codes (&br, 0, size);
+  off = scan_for_start_codes_in_reader (&br, 0, size);
 
   if (off >= 0)
     packet->size = off;
@@ -297,13 +297,159 @@ nal_reader_has_more_data (NalReader * nr)
 
 /***********  end of nal parser ***************/
 
+/****** Start code scanning ******/
+
+/* All the scanners return the offset of the first 0x000001 start code
+ * that is followed by at least one more byte, or -1. The NALU is not
+ * empty, so we can at least expect 1 (even 2) bytes following sc */
+
+typedef gint (*ScanForStartCodesFunc) (const guint8 * data, guint size);
+
+/* Looks at the third byte of the candidate, which rules out 3 positions
+ * at once in the common case of it being neither 0 nor 1 */
+static gint
+scan_for_start_codes_scalar (const guint8 * data, guint size, guint i)
+{
+  while (i + 4 <= size) {
+    if (data[i + 2] > 1) {
+      i += 3;
+    } else if (data[i + 1]) {
+      i += 2;
+    } else if (data[i] || data[i + 2] != 1) {
+      i++;
+    } else {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static gint
+scan_for_start_codes_c (const guint8 * data, guint size)
+{
+  return scan_for_start_codes_scalar (data, size, 0);
+}
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HAVE_SCAN_X86 1
+#include <immintrin.h>
+
+/* Compare 16 (or 32) positions at once against 0x00, 0x00, 0x01 with
+ * three overlapping loads. The last load must stay within data and the
+ * match must leave one byte after it, hence the + 3 */
+__attribute__ ((target ("sse2")))
+static gint
+scan_for_start_codes_sse2 (const guint8 * data, guint size)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i one = _mm_set1_epi8 (1);
+  guint i = 0;
+
+  while (i + 16 + 3 <= size) {
+    __m128i b0 = _mm_loadu_si128 ((const __m128i *) (data + i));
+    __m128i b1 = _mm_loadu_si128 ((const __m128i *) (data + i + 1));
+    __m128i b2 = _mm_loadu_si128 ((const __m128i *) (data + i + 2));
+    __m128i m;
+    gint mask;
+
+    m = _mm_and_si128 (_mm_cmpeq_epi8 (b0, zero), _mm_cmpeq_epi8 (b1, zero));
+    m = _mm_and_si128 (m, _mm_cmpeq_epi8 (b2, one));
+    mask = _mm_movemask_epi8 (m);
+    if (G_UNLIKELY (mask))
+      return i + __builtin_ctz (mask);
+
+    i += 16;
+  }
+
+  return scan_for_start_codes_scalar (data, size, i);
+}
+
+__attribute__ ((target ("avx2")))
+static gint
+scan_for_start_codes_avx2 (const guint8 * data, guint size)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i one = _mm256_set1_epi8 (1);
+  guint i = 0;
+
+  while (i + 32 + 3 <= size) {
+    __m256i b0 = _mm256_loadu_si256 ((const __m256i *) (data + i));
+    __m256i b1 = _mm256_loadu_si256 ((const __m256i *) (data + i + 1));
+    __m256i b2 = _mm256_loadu_si256 ((const __m256i *) (data + i + 2));
+    __m256i m;
+    guint32 mask;
+
+    m = _mm256_and_si256 (_mm256_cmpeq_epi8 (b0, zero),
+        _mm256_cmpeq_epi8 (b1, zero));
+    m = _mm256_and_si256 (m, _mm256_cmpeq_epi8 (b2, one));
+    mask = (guint32) _mm256_movemask_epi8 (m);
+    if (G_UNLIKELY (mask))
+      return i + __builtin_ctz (mask);
+
+    i += 32;
+  }
+
+  return scan_for_start_codes_scalar (data, size, i);
+}
+#endif
+
+#if defined (__aarch64__) && defined (__ARM_NEON)
+#define HAVE_SCAN_NEON 1
+#include <arm_neon.h>
+
+/* NEON has no movemask, only check whether any lane matched and let the
+ * scalar code find which one */
+static gint
+scan_for_start_codes_neon (const guint8 * data, guint size)
+{
+  const uint8x16_t one = vdupq_n_u8 (1);
+  guint i = 0;
+
+  while (i + 16 + 3 <= size) {
+    uint8x16_t b0 = vld1q_u8 (data + i);
+    uint8x16_t b1 = vld1q_u8 (data + i + 1);
+    uint8x16_t b2 = vld1q_u8 (data + i + 2);
+    uint8x16_t m;
+
+    m = vandq_u8 (vceqzq_u8 (b0), vceqzq_u8 (b1));
+    m = vandq_u8 (m, vceqq_u8 (b2, one));
+    if (G_UNLIKELY (vmaxvq_u8 (m)))
+      return scan_for_start_codes_scalar (data, size, i);
+
+    i += 16;
+  }
+
+  return scan_for_start_codes_scalar (data, size, i);
+}
+#endif
+
+static ScanForStartCodesFunc
+get_scan_for_start_codes_func (void)
+{
+  static gsize func = 0;
+
+  if (g_once_init_enter (&func)) {
+    ScanForStartCodesFunc f = scan_for_start_codes_c;
+
+#ifdef HAVE_SCAN_X86
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+      f = scan_for_start_codes_avx2;
+    else if (__builtin_cpu_supports ("sse2"))
+      f = scan_for_start_codes_sse2;
+#elif defined (HAVE_SCAN_NEON)
+    f = scan_for_start_codes_neon;
+#endif
+
+    g_once_init_leave (&func, (gsize) f);
+  }
+
+  return (ScanForStartCodesFunc) func;
+}
+
 gint
 scan_for_start_codes (const guint8 * data, guint size)
 {
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
-
-  /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
+  return get_scan_for_start_codes_func () (data, size);
 }
@@ -105,4 +105,8 @@ G_GNUC_INTERNAL gboolean
 decode_vlc (GstBitReader * br, guint * res, const VLCTable * table,
     guint length);
 
+/* Implemented in nalutils.c, which can't be included together with this */
+G_GNUC_INTERNAL gint
+scan_for_start_codes (const guint8 * data, guint size);
+
 #endif /* __PARSER_UTILS__ */
@@ -1416,6 +1416,23 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   mpegts_packetizer_push (base->packetizer, buf);
 
   while (res == GST_FLOW_OK) {
+    /* Packets on PIDs we don't handle and that can't carry a PCR are
+     * dropped straight from their pre-parsed headers */
+    if (!klass->inspect_packet || base->inspect_afc_only) {
+      const MpegTSPacketizerHeader *headers;
+      guint i, n;
+
+      headers = mpegts_packetizer_peek_headers (packetizer, &n);
+      for (i = 0; i < n; i++) {
+        if (FLAGS_HAS_AFC (headers[i].scram_afc_cc) ||
+            (base->push_data && MPEGTS_BIT_IS_SET (base->is_pes,
+                    headers[i].pid)) ||
+            MPEGTS_BIT_IS_SET (base->known_psi, headers[i].pid))
+          break;
+      }
+      mpegts_packetizer_skip_packets (packetizer, i);
+    }
+
     pret = mpegts_packetizer_next_packet (base->packetizer, &packet);
 
     /* If we don't have enough data, return */
@@ -158,6 +158,10 @@ struct _MpegTSBase {
   gboolean push_data;
   gboolean push_section;
 
+  /* Whether inspect_packet() only cares about packets with an adaptation
+   * field, any other packet nothing is done with is then skipped */
+  gboolean inspect_afc_only;
+
   /* Whether the parent bin is streams-aware, meaning we can
    * add/remove streams at any point in time */
   gboolean streams_aware;
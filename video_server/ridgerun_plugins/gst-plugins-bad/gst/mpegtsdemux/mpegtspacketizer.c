@@ -261,6 +261,8 @@ mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
   packetizer->need_sync = FALSE;
+  packetizer->n_headers = 0;
+  packetizer->header_idx = 0;
 
   memset (packetizer->pcrtablelut, 0xff, 0x2000);
   memset (packetizer->observations, 0x0, sizeof (packetizer->observations));
@@ -444,35 +446,30 @@ mpegts_packetizer_parse_adaptation_field_control (MpegTSPacketizer2 *
   return TRUE;
 }
 
+/* The header was already split by mpegts_packetizer_scan_headers() */
 static MpegTSPacketizerPacketReturn
 mpegts_packetizer_parse_packet (MpegTSPacketizer2 * packetizer,
-    MpegTSPacketizerPacket * packet)
+    MpegTSPacketizerPacket * packet, const MpegTSPacketizerHeader * header)
 {
-  guint8 *data;
   guint8 tmp;
 
-  data = packet->data_start;
-  data += 1;
-  tmp = *data;
-
   /* transport_error_indicator 1 */
-  if (G_UNLIKELY (tmp & 0x80))
+  if (G_UNLIKELY (header->flags & MPEGTS_HEADER_TEI))
     return PACKET_BAD;
 
   /* payload_unit_start_indicator 1 */
-  packet->payload_unit_start_indicator = tmp & 0x40;
+  packet->payload_unit_start_indicator = header->flags & MPEGTS_HEADER_PUSI;
 
   /* transport_priority 1 */
   /* PID 13 */
-  packet->pid = GST_READ_UINT16_BE (data) & 0x1FFF;
-  data += 2;
+  packet->pid = header->pid;
 
-  packet->scram_afc_cc = tmp = *data++;
+  packet->scram_afc_cc = tmp = header->scram_afc_cc;
   /* transport_scrambling_control 2 */
   if (G_UNLIKELY (tmp & 0xc0))
     return PACKET_BAD;
 
-  packet->data = data;
+  packet->data = packet->data_start + 4;
 
   packet->afc_flags = 0;
   packet->pcr = G_MAXUINT64;
@@ -578,6 +575,8 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
+  packetizer->n_headers = 0;
+  packetizer->header_idx = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
   pcrtable = packetizer->observations[packetizer->pcrtablelut[0x1fff]];
@@ -618,6 +617,8 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer, gboolean hard)
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
+  packetizer->n_headers = 0;
+  packetizer->header_idx = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
   pcrtable = packetizer->observations[packetizer->pcrtablelut[0x1fff]];
@@ -693,6 +694,8 @@ mpegts_packetizer_flush_bytes (MpegTSPacketizer2 * packetizer, gsize size)
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
+  packetizer->n_headers = 0;
+  packetizer->header_idx = 0;
 }
 
 static gboolean
@@ -742,9 +745,16 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
   data = packetizer->map_data + packetizer->map_offset;
 
   for (i = 0; i + 3 * MPEGTS_MAX_PACKETSIZE < size; i++) {
-    /* find a sync byte */
-    if (data[i] != PACKET_SYNC_BYTE)
-      continue;
+    guint8 *sync;
+
+    /* find a sync byte, memchr() looks at many bytes at a time */
+    sync = memchr (data + i, PACKET_SYNC_BYTE,
+        size - 3 * MPEGTS_MAX_PACKETSIZE - i);
+    if (sync == NULL) {
+      i = size - 3 * MPEGTS_MAX_PACKETSIZE;
+      break;
+    }
+    i = sync - data;
 
     /* check for 4 consecutive sync bytes with each possible packet size */
     for (j = 0; j < G_N_ELEMENTS (psizes); j++) {
@@ -761,6 +771,7 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
 
 out:
   packetizer->map_offset += i;
+  packetizer->n_headers = packetizer->header_idx = 0;
 
   if (packetizer->packet_size == 0) {
     GST_DEBUG ("Could not determine packet size in %" G_GSIZE_FORMAT
@@ -800,8 +811,16 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
     sync_offset = 0;
 
   for (i = sync_offset; i + 2 * packet_size < size; i++) {
-    if (data[i] == PACKET_SYNC_BYTE &&
-        data[i + packet_size] == PACKET_SYNC_BYTE &&
+    guint8 *sync;
+
+    sync = memchr (data + i, PACKET_SYNC_BYTE, size - 2 * packet_size - i);
+    if (sync == NULL) {
+      i = size - 2 * packet_size;
+      break;
+    }
+    i = sync - data;
+
+    if (data[i + packet_size] == PACKET_SYNC_BYTE &&
         data[i + 2 * packet_size] == PACKET_SYNC_BYTE) {
       found = TRUE;
       break;
@@ -809,6 +828,7 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   }
 
   packetizer->map_offset += i - sync_offset;
+  packetizer->n_headers = packetizer->header_idx = 0;
 
   if (!found)
     mpegts_packetizer_flush_bytes (packetizer, packetizer->map_offset);
@@ -816,6 +836,97 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   return found;
 }
 
+/* Check the sync bytes of all the complete packets mapped from
+ * map_offset on (up to MPEGTS_PACKETIZER_BATCH) and split their headers,
+ * stopping at the first one that lost sync */
+static void
+mpegts_packetizer_scan_headers (MpegTSPacketizer2 * packetizer)
+{
+  MpegTSPacketizerHeader *header;
+  const guint8 *data, *p;
+  guint packet_size;
+  guint i, j, n;
+  guint8 bad;
+
+  packet_size = packetizer->packet_size;
+  data = packetizer->map_data + packetizer->map_offset;
+  if (packet_size == MPEGTS_M2TS_PACKETSIZE)
+    data += 4;
+
+  n = MIN ((packetizer->map_size - packetizer->map_offset) / packet_size,
+      MPEGTS_PACKETIZER_BATCH);
+
+  /* Sync bytes are 188+ bytes apart, so instead of SIMD compares check
+   * 8 of them at once without branching and only look closer at a
+   * group that has a bad one */
+  for (i = 0; i + 8 <= n; i += 8) {
+    p = data + i * packet_size;
+    bad = 0;
+    for (j = 0; j < 8; j++)
+      bad |= p[j * packet_size] ^ PACKET_SYNC_BYTE;
+    if (G_UNLIKELY (bad))
+      break;
+  }
+  for (; i < n; i++) {
+    if (data[i * packet_size] != PACKET_SYNC_BYTE)
+      break;
+  }
+  n = i;
+
+  for (i = 0; i < n; i++) {
+    p = data + i * packet_size;
+    header = &packetizer->headers[i];
+
+    header->flags = p[1] & (MPEGTS_HEADER_TEI | MPEGTS_HEADER_PUSI);
+    header->pid = GST_READ_UINT16_BE (p + 1) & 0x1FFF;
+    header->scram_afc_cc = p[3];
+  }
+
+  packetizer->n_headers = n;
+  packetizer->header_idx = 0;
+}
+
+/* Headers of the packets next_packet() will return next, without
+ * consuming them. Together with mpegts_packetizer_skip_packets() this
+ * allows walking over uninteresting packets without parsing them. The
+ * array is valid until the packetizer is used again */
+const MpegTSPacketizerHeader *
+mpegts_packetizer_peek_headers (MpegTSPacketizer2 * packetizer,
+    guint * n_headers)
+{
+  if (packetizer->header_idx == packetizer->n_headers &&
+      packetizer->packet_size && !packetizer->need_sync &&
+      mpegts_packetizer_map (packetizer, packetizer->packet_size))
+    mpegts_packetizer_scan_headers (packetizer);
+
+  *n_headers = packetizer->n_headers - packetizer->header_idx;
+  return &packetizer->headers[packetizer->header_idx];
+}
+
+/* Drop the next n_packets packets, at most what
+ * mpegts_packetizer_peek_headers() returned, without parsing them */
+void
+mpegts_packetizer_skip_packets (MpegTSPacketizer2 * packetizer,
+    guint n_packets)
+{
+  guint packet_size = packetizer->packet_size;
+
+  g_return_if_fail (n_packets <=
+      packetizer->n_headers - packetizer->header_idx);
+
+  if (n_packets == 0)
+    return;
+
+  GST_LOG ("skipping %u packets", n_packets);
+
+  packetizer->map_offset += n_packets * packet_size;
+  packetizer->header_idx += n_packets;
+  packetizer->offset += n_packets * packet_size;
+
+  if (packetizer->map_size - packetizer->map_offset < packet_size)
+    mpegts_packetizer_flush_bytes (packetizer, packetizer->map_offset);
+}
+
 MpegTSPacketizerPacketReturn
 mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
     MpegTSPacketizerPacket * packet)
@@ -844,28 +955,33 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
       packetizer->need_sync = FALSE;
     }
 
-    if (!mpegts_packetizer_map (packetizer, packet_size))
-      return PACKET_NEED_MORE;
+    /* Check the sync bytes of a whole batch of packets at once */
+    if (packetizer->header_idx == packetizer->n_headers) {
+      if (!mpegts_packetizer_map (packetizer, packet_size))
+        return PACKET_NEED_MORE;
+
+      mpegts_packetizer_scan_headers (packetizer);
+      if (G_UNLIKELY (packetizer->n_headers == 0)) {
+        GST_DEBUG ("lost sync");
+        packetizer->need_sync = TRUE;
+        continue;
+      }
+    }
 
     packet_data = &packetizer->map_data[packetizer->map_offset + sync_offset];
 
-    /* Check sync byte */
-    if (G_UNLIKELY (*packet_data != PACKET_SYNC_BYTE)) {
-      GST_DEBUG ("lost sync");
-      packetizer->need_sync = TRUE;
-    } else {
-      /* ALL mpeg-ts variants contain 188 bytes of data. Those with bigger
-       * packet sizes contain either extra data (timesync, FEC, ..) either
-       * before or after the data */
-      packet->data_start = packet_data;
-      packet->data_end = packet->data_start + 188;
-      packet->offset = packetizer->offset;
-      GST_LOG ("offset %" G_GUINT64_FORMAT, packet->offset);
-      packetizer->offset += packet_size;
-      GST_MEMDUMP ("data_start", packet->data_start, 16);
-
-      return mpegts_packetizer_parse_packet (packetizer, packet);
-    }
+    /* ALL mpeg-ts variants contain 188 bytes of data. Those with bigger
+     * packet sizes contain either extra data (timesync, FEC, ..) either
+     * before or after the data */
+    packet->data_start = packet_data;
+    packet->data_end = packet->data_start + 188;
+    packet->offset = packetizer->offset;
+    GST_LOG ("offset %" G_GUINT64_FORMAT, packet->offset);
+    packetizer->offset += packet_size;
+    GST_MEMDUMP ("data_start", packet->data_start, 16);
+
+    return mpegts_packetizer_parse_packet (packetizer, packet,
+        &packetizer->headers[packetizer->header_idx]);
   }
 }
 
@@ -890,6 +1006,7 @@ mpegts_packetizer_clear_packet (MpegTSPacketizer2 * packetizer,
 
   if (packetizer->map_data) {
     packetizer->map_offset += packet_size;
+    packetizer->header_idx++;
     if (packetizer->map_size - packetizer->map_offset < packet_size)
       mpegts_packetizer_flush_bytes (packetizer, packetizer->map_offset);
   }
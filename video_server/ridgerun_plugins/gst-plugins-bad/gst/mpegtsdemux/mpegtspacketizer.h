@@ -241,6 +241,21 @@ typedef struct _MpegTSPCR
   PCROffsetCurrent *current;
 } MpegTSPCR;
 
+/* Maximum number of packets validated and pre-parsed in one go */
+#define MPEGTS_PACKETIZER_BATCH 256
+
+#define MPEGTS_HEADER_TEI   0x80
+#define MPEGTS_HEADER_PUSI  0x40
+
+/* Header of a TS packet, see mpegts_packetizer_peek_headers() */
+typedef struct
+{
+  guint16 pid;
+  /* MPEGTS_HEADER_* */
+  guint8  flags;
+  guint8  scram_afc_cc;
+} MpegTSPacketizerHeader;
+
 struct _MpegTSPacketizer2 {
   GObject     parent;
 
@@ -269,6 +284,12 @@ struct _MpegTSPacketizer2 {
   gsize map_size;
   gboolean need_sync;
 
+  /* Headers of the packets from the mapped data whose sync byte was
+   * already checked. headers[header_idx] is the packet at map_offset */
+  MpegTSPacketizerHeader headers[MPEGTS_PACKETIZER_BATCH];
+  guint n_headers;
+  guint header_idx;
+
   /* Reference offset */
   guint64 refoffset;
 
@@ -348,6 +369,10 @@ G_GNUC_INTERNAL MpegTSPacketizerPacketReturn
 mpegts_packetizer_process_next_packet(MpegTSPacketizer2 * packetizer);
 G_GNUC_INTERNAL void mpegts_packetizer_clear_packet (MpegTSPacketizer2 *packetizer,
 				     MpegTSPacketizerPacket *packet);
+G_GNUC_INTERNAL const MpegTSPacketizerHeader *
+mpegts_packetizer_peek_headers (MpegTSPacketizer2 *packetizer, guint *n_headers);
+G_GNUC_INTERNAL void mpegts_packetizer_skip_packets (MpegTSPacketizer2 *packetizer,
+				     guint n_packets);
 G_GNUC_INTERNAL void mpegts_packetizer_remove_stream(MpegTSPacketizer2 *packetizer,
   gint16 pid);
 
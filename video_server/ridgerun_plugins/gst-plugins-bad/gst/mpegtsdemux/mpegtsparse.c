@@ -39,6 +39,7 @@
 
 #define TABLE_ID_UNSET 0xFF
 #define RUNNING_STATUS_RUNNING 4
+#define PACKET_SYNC_BYTE 0x47
 
 GST_DEBUG_CATEGORY_STATIC (mpegts_parse_debug);
 #define GST_CAT_DEFAULT mpegts_parse_debug
@@ -84,6 +85,7 @@ enum
   PROP_SET_TIMESTAMPS,
   PROP_SMOOTHING_LATENCY,
   PROP_PCR_PID,
+  PROP_PID_FILTER,
   /* FILL ME */
 };
 
@@ -159,6 +161,21 @@ mpegts_parse_class_init (MpegTSParse2Class * klass)
       g_param_spec_int ("pcr-pid", "PID containing PCR",
           "Set the PID to use for PCR values (-1 for auto)",
           -1, G_MAXINT, -1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * MpegTSParse2:pid-filter:
+   *
+   * Only output the packets of these PIDs on the src pad, plus the PAT and
+   * the PMTs. Kept packets are shared with the input buffers and the
+   * others are never parsed, which makes tsparse close to a plain
+   * passthrough. Program pads are not affected.
+   */
+  g_object_class_install_property (gobject_class, PROP_PID_FILTER,
+      gst_param_spec_array ("pid-filter", "PID filter",
+          "PIDs to output on the src pad besides the PAT and the PMTs, "
+          "all if empty (e.g. pid-filter=\"<256,257>\")",
+          g_param_spec_int ("pid", "PID", "PID to output", 0, 0x1fff, 0,
+              G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS),
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   element_class = GST_ELEMENT_CLASS (klass);
   element_class->pad_removed = mpegts_parse_pad_removed;
@@ -193,6 +210,8 @@ mpegts_parse_init (MpegTSParse2 * parse)
   /* We will only need to handle data/section if we have request pads */
   base->push_data = FALSE;
   base->push_section = FALSE;
+  /* We only look at PCRs */
+  base->inspect_afc_only = TRUE;
 
   parse->user_pcr_pid = parse->pcr_pid = -1;
 
@@ -250,6 +269,12 @@ mpegts_parse_reset (MpegTSBase * base)
   parse->bytes_since_pcr = 0;
   parse->pcr_pid = parse->user_pcr_pid;
   parse->ts_offset = 0;
+
+  GST_OBJECT_LOCK (parse);
+  memset (parse->pmt_pids, 0, sizeof (parse->pmt_pids));
+  memset (parse->pcr_pids, 0, sizeof (parse->pcr_pids));
+  GST_OBJECT_UNLOCK (parse);
+  parse->split_size = 0;
 }
 
 static void
@@ -270,6 +295,21 @@ mpegts_parse_set_property (GObject * object, guint prop_id,
     case PROP_PCR_PID:
       parse->pcr_pid = parse->user_pcr_pid = g_value_get_int (value);
       break;
+    case PROP_PID_FILTER:
+    {
+      guint i, n;
+
+      n = gst_value_array_get_size (value);
+      GST_OBJECT_LOCK (parse);
+      memset (parse->allowed_pids, 0, sizeof (parse->allowed_pids));
+      for (i = 0; i < n; i++) {
+        gint pid = g_value_get_int (gst_value_array_get_value (value, i));
+        MPEGTS_BIT_SET (parse->allowed_pids, pid);
+      }
+      parse->filter_pids = n > 0;
+      GST_OBJECT_UNLOCK (parse);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -291,6 +331,23 @@ mpegts_parse_get_property (GObject * object, guint prop_id,
     case PROP_PCR_PID:
       g_value_set_int (value, parse->pcr_pid);
       break;
+    case PROP_PID_FILTER:
+    {
+      GValue val = G_VALUE_INIT;
+      gint pid;
+
+      g_value_init (&val, G_TYPE_INT);
+      GST_OBJECT_LOCK (parse);
+      for (pid = 0; pid < 0x2000; pid++) {
+        if (MPEGTS_BIT_IS_SET (parse->allowed_pids, pid)) {
+          g_value_set_int (&val, pid);
+          gst_value_array_append_value (value, &val);
+        }
+      }
+      GST_OBJECT_UNLOCK (parse);
+      g_value_unset (&val);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -857,6 +914,137 @@ drain_pending_buffers (MpegTSParse2 * parse, gboolean drain_all)
   return ret;
 }
 
+static inline gboolean
+mpegts_parse_keep_packet (MpegTSParse2 * parse, const guint8 * data)
+{
+  guint16 pid = GST_READ_UINT16_BE (data + 1) & 0x1FFF;
+
+  return pid == 0 || MPEGTS_BIT_IS_SET (parse->allowed_pids, pid) ||
+      MPEGTS_BIT_IS_SET (parse->pmt_pids, pid) ||
+      MPEGTS_BIT_IS_SET (parse->pcr_pids, pid);
+}
+
+/* Only keep the packets mpegts_parse_keep_packet() wants. Runs of kept
+ * packets share the memory of the input buffer, only a packet split over
+ * two input buffers is copied. Returns NULL if nothing is left */
+static GstBuffer *
+mpegts_parse_filter_buffer (MpegTSParse2 * parse, GstBuffer * buffer)
+{
+  MpegTSBase *base = (MpegTSBase *) parse;
+  GstBuffer *outbuf;
+  GstMapInfo map;
+  const guint8 *sync;
+  guint packet_size, sync_offset;
+  gsize pos, run_start, run_size, needed;
+
+  packet_size = base->packetizer->packet_size;
+  if (G_UNLIKELY (packet_size == 0)) {
+    GST_DEBUG_OBJECT (parse, "No packet size yet, dropping buffer");
+    gst_buffer_unref (buffer);
+    return NULL;
+  }
+
+  /* M2TS packets don't start with the sync byte, all other variants do */
+  if (packet_size == MPEGTS_M2TS_PACKETSIZE)
+    sync_offset = 4;
+  else
+    sync_offset = 0;
+
+  if (GST_BUFFER_IS_DISCONT (buffer))
+    parse->split_size = 0;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+    gst_buffer_unref (buffer);
+    return NULL;
+  }
+
+  outbuf = gst_buffer_new ();
+  gst_buffer_copy_into (outbuf, buffer,
+      GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+
+  GST_OBJECT_LOCK (parse);
+
+  /* Complete the packet started in the previous buffer */
+  pos = 0;
+  if (parse->split_size) {
+    needed = MIN (packet_size - parse->split_size, map.size);
+    memcpy (parse->split_packet + parse->split_size, map.data, needed);
+    parse->split_size += needed;
+    pos = needed;
+
+    if (parse->split_size == packet_size) {
+      if (parse->split_packet[sync_offset] == PACKET_SYNC_BYTE &&
+          mpegts_parse_keep_packet (parse, parse->split_packet + sync_offset))
+        gst_buffer_append_memory (outbuf,
+            gst_memory_new_wrapped (0, g_memdup (parse->split_packet,
+                    packet_size), packet_size, 0, packet_size, NULL, g_free));
+      parse->split_size = 0;
+    }
+  }
+
+  run_start = pos;
+  run_size = 0;
+  while (pos + packet_size <= map.size) {
+    const guint8 *data = map.data + pos + sync_offset;
+
+    if (G_UNLIKELY (*data != PACKET_SYNC_BYTE)) {
+      GST_DEBUG_OBJECT (parse, "lost sync at offset %" G_GSIZE_FORMAT, pos);
+      if (run_size)
+        gst_buffer_copy_into (outbuf, buffer, GST_BUFFER_COPY_MEMORY,
+            run_start, run_size);
+      run_size = 0;
+
+      sync = memchr (data + 1, PACKET_SYNC_BYTE, map.data + map.size -
+          data - 1);
+      if (sync == NULL) {
+        pos = map.size;
+        break;
+      }
+      pos = sync - map.data - sync_offset;
+      continue;
+    }
+
+    if (mpegts_parse_keep_packet (parse, data)) {
+      if (run_size == 0)
+        run_start = pos;
+      run_size += packet_size;
+    } else if (run_size) {
+      gst_buffer_copy_into (outbuf, buffer, GST_BUFFER_COPY_MEMORY,
+          run_start, run_size);
+      run_size = 0;
+    }
+    pos += packet_size;
+  }
+
+  GST_OBJECT_UNLOCK (parse);
+
+  /* Keep the start of a packet going on in the next buffer */
+  if (pos < map.size) {
+    parse->split_size = map.size - pos;
+    memcpy (parse->split_packet, map.data + pos, parse->split_size);
+  }
+
+  gst_buffer_unmap (buffer, &map);
+
+  if (run_size == map.size) {
+    /* Nothing was filtered out */
+    gst_buffer_unref (outbuf);
+    return buffer;
+  }
+
+  if (run_size)
+    gst_buffer_copy_into (outbuf, buffer, GST_BUFFER_COPY_MEMORY,
+        run_start, run_size);
+  gst_buffer_unref (buffer);
+
+  if (gst_buffer_n_memory (outbuf) == 0) {
+    gst_buffer_unref (outbuf);
+    return NULL;
+  }
+
+  return outbuf;
+}
+
 static GstFlowReturn
 mpegts_parse_input_done (MpegTSBase * base, GstBuffer * buffer)
 {
@@ -865,6 +1053,12 @@ mpegts_parse_input_done (MpegTSBase * base, GstBuffer * buffer)
 
   GST_LOG_OBJECT (parse, "Received buffer %" GST_PTR_FORMAT, buffer);
 
+  if (parse->filter_pids) {
+    buffer = mpegts_parse_filter_buffer (parse, buffer);
+    if (buffer == NULL)
+      return GST_FLOW_OK;
+  }
+
   if (parse->current_pcr != GST_CLOCK_TIME_NONE) {
     GST_DEBUG_OBJECT (parse,
         "InputTS %" GST_TIME_FORMAT " PCR %" GST_TIME_FORMAT,
@@ -915,6 +1109,14 @@ find_pad_for_program (MpegTSParse2 * parse, guint program_number)
   return NULL;
 }
 
+static void
+foreach_program_pcr_pid (gpointer key, MpegTSBaseProgram * program,
+    MpegTSParse2 * parse)
+{
+  if (program->active && program->pcr_pid < 0x1fff)
+    MPEGTS_BIT_SET (parse->pcr_pids, program->pcr_pid);
+}
+
 static void
 mpegts_parse_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
 {
@@ -929,6 +1131,13 @@ mpegts_parse_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
     tspad->program = parseprogram;
     parseprogram->tspad = tspad;
   }
+
+  GST_OBJECT_LOCK (parse);
+  MPEGTS_BIT_SET (parse->pmt_pids, program->pmt_pid);
+  /* a filtered stream can't be timed without the PCR of its program */
+  if (program->pcr_pid < 0x1fff)
+    MPEGTS_BIT_SET (parse->pcr_pids, program->pcr_pid);
+  GST_OBJECT_UNLOCK (parse);
 }
 
 static void
@@ -946,6 +1155,16 @@ mpegts_parse_program_stopped (MpegTSBase * base, MpegTSBaseProgram * program)
     parseprogram->tspad = NULL;
   }
 
+  GST_OBJECT_LOCK (parse);
+  MPEGTS_BIT_UNSET (parse->pmt_pids, program->pmt_pid);
+  /* the PCR PID might be shared with other programs that are still active */
+  if (program->pcr_pid < 0x1fff) {
+    MPEGTS_BIT_UNSET (parse->pcr_pids, program->pcr_pid);
+    g_hash_table_foreach (base->programs, (GHFunc) foreach_program_pcr_pid,
+        parse);
+  }
+  GST_OBJECT_UNLOCK (parse);
+
   parse->pcr_pid = -1;
   parse->ts_offset += parse->current_pcr - parse->base_pcr;
   parse->base_pcr = GST_CLOCK_TIME_NONE;
@@ -75,6 +75,17 @@ struct _MpegTSParse2 {
   GList *pending_buffers;
   GstClockTime previous_pcr;
   guint bytes_since_pcr;
+
+  /* PID filter on the src pad, MPEGTS_BIT_* arrays of the PIDs the user
+   * allowed, of the PMTs and of the PCRs of the active programs,
+   * protected with the OBJECT_LOCK */
+  gboolean filter_pids;
+  guint8 allowed_pids[0x2000 / 8];
+  guint8 pmt_pids[0x2000 / 8];
+  guint8 pcr_pids[0x2000 / 8];
+  /* Start of a packet split over two input buffers */
+  guint8 split_packet[MPEGTS_MAX_PACKETSIZE];
+  guint split_size;
 };
 
 struct _MpegTSParse2Class {
@@ -77,6 +77,11 @@
 /* latency in nsecs */
 #define TS_LATENCY (700 * GST_MSECOND)
 
+/* With pes-arena, a new slab has room for at least TS_DEMUX_SLAB_PES
+ * times the largest PES seen on the stream */
+#define TS_DEMUX_SLAB_MIN_SIZE (64 * 1024)
+#define TS_DEMUX_SLAB_PES 8
+
 GST_DEBUG_CATEGORY_STATIC (ts_demux_debug);
 #define GST_CAT_DEFAULT ts_demux_debug
 
@@ -112,6 +117,19 @@ typedef struct
   guint64 pts, dts;
 } PendingBuffer;
 
+/* Memory PES payloads are assembled into with pes-arena. Every output
+ * buffer keeps a reference, so once the stream holds the only one the
+ * whole slab can be written again. A buffer that downstream keeps for
+ * longer than it takes to fill the next slab pins all of its slab; the
+ * stream then gives each PES its own memory until that slab is released,
+ * so that no more than one slab per stream is pinned this way */
+typedef struct
+{
+  volatile gint ref_count;
+  gsize size;
+  guint8 *data;
+} TSDemuxSlab;
+
 typedef struct _TSDemuxStream TSDemuxStream;
 
 typedef struct _TSDemuxH264ParsingInfos TSDemuxH264ParsingInfos;
@@ -171,6 +189,15 @@ struct _TSDemuxStream
   /* Size of ->data */
   guint allocated_size;
 
+  /* Slab ->data points into with pes-arena, and where the next PES
+   * starts in it */
+  TSDemuxSlab *slab;
+  gsize slab_offset;
+  /* The slab used before ->slab, ->slab is NULL while it's pinned */
+  TSDemuxSlab *retired_slab;
+  /* Largest PES seen, used to size slabs */
+  guint max_pes_size;
+
   /* Current PTS/DTS for this stream (in running time) */
   GstClockTime pts;
   GstClockTime dts;
@@ -287,6 +314,7 @@ enum
   PROP_0,
   PROP_PROGRAM_NUMBER,
   PROP_EMIT_STATS,
+  PROP_PES_ARENA,
   /* FILL ME */
 };
 
@@ -378,6 +406,18 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
           "Emit messages for every pcr/opcr/pts/dts", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstTSDemux:pes-arena:
+   *
+   * Assemble PES payloads in place in large shared slabs instead of one
+   * growing allocation per PES. Output buffers wrap their part of the
+   * slab, which is reused once downstream has released all of them.
+   */
+  g_object_class_install_property (gobject_class, PROP_PES_ARENA,
+      g_param_spec_boolean ("pes-arena", "PES arena",
+          "Assemble PES payloads in shared slabs", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   element_class = GST_ELEMENT_CLASS (klass);
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&video_template));
@@ -471,6 +511,9 @@ gst_ts_demux_set_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       demux->emit_statistics = g_value_get_boolean (value);
       break;
+    case PROP_PES_ARENA:
+      demux->pes_arena = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -489,6 +532,9 @@ gst_ts_demux_get_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       g_value_set_boolean (value, demux->emit_statistics);
       break;
+    case PROP_PES_ARENA:
+      g_value_set_boolean (value, demux->pes_arena);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -623,6 +669,200 @@ gst_ts_demux_srcpad_query (GstPad * pad, GstObject * parent, GstQuery * query)
 
 }
 
+static TSDemuxSlab *
+ts_demux_slab_new (gsize size)
+{
+  TSDemuxSlab *slab = g_slice_new (TSDemuxSlab);
+
+  slab->ref_count = 1;
+  slab->size = size;
+  slab->data = g_malloc (size);
+
+  return slab;
+}
+
+static TSDemuxSlab *
+ts_demux_slab_ref (TSDemuxSlab * slab)
+{
+  g_atomic_int_inc (&slab->ref_count);
+  return slab;
+}
+
+static void
+ts_demux_slab_unref (TSDemuxSlab * slab)
+{
+  if (g_atomic_int_dec_and_test (&slab->ref_count)) {
+    g_free (slab->data);
+    g_slice_free (TSDemuxSlab, slab);
+  }
+}
+
+static inline gboolean
+gst_ts_demux_stream_data_in_slab (TSDemuxStream * stream)
+{
+  return stream->slab != NULL && stream->data != NULL &&
+      stream->data == stream->slab->data + stream->slab_offset;
+}
+
+static inline gboolean
+ts_demux_slab_is_used (TSDemuxSlab * slab)
+{
+  return g_atomic_int_get (&slab->ref_count) > 1;
+}
+
+/* Whether PES payloads can go into a slab. Not while a buffer from the
+ * retired slab is still alive after a whole slab was filled */
+static gboolean
+gst_ts_demux_stream_use_slab (TSDemuxStream * stream)
+{
+  if (stream->slab == NULL && stream->retired_slab != NULL) {
+    if (ts_demux_slab_is_used (stream->retired_slab))
+      return FALSE;
+
+    GST_LOG ("pid 0x%04x retired slab released", stream->stream.pid);
+    ts_demux_slab_unref (stream->retired_slab);
+    stream->retired_slab = NULL;
+  }
+
+  return TRUE;
+}
+
+/* Replace ->slab by a new one. Returns FALSE and leaves ->slab NULL if the
+ * slab retired before ->slab is still pinned by downstream */
+static gboolean
+gst_ts_demux_stream_new_slab (TSDemuxStream * stream, guint size)
+{
+  gsize slab_size;
+
+  if (stream->retired_slab) {
+    if (ts_demux_slab_is_used (stream->retired_slab)) {
+      GST_DEBUG ("pid 0x%04x retired slab still in use, not using slabs "
+          "until it is released", stream->stream.pid);
+      if (stream->slab)
+        ts_demux_slab_unref (stream->slab);
+      stream->slab = NULL;
+      stream->slab_offset = 0;
+      return FALSE;
+    }
+    ts_demux_slab_unref (stream->retired_slab);
+  }
+  stream->retired_slab = stream->slab;
+
+  slab_size = (gsize) MAX (size, stream->max_pes_size) * TS_DEMUX_SLAB_PES;
+  slab_size = MAX (slab_size, TS_DEMUX_SLAB_MIN_SIZE);
+
+  GST_LOG ("pid 0x%04x new slab of %" G_GSIZE_FORMAT " bytes",
+      stream->stream.pid, slab_size);
+
+  stream->slab = ts_demux_slab_new (slab_size);
+  stream->slab_offset = 0;
+
+  return TRUE;
+}
+
+/* Get room for at least size bytes of PES payload in stream->data */
+static void
+gst_ts_demux_stream_alloc_data (GstTSDemux * demux, TSDemuxStream * stream,
+    guint size)
+{
+  TSDemuxSlab *slab;
+
+  g_assert (stream->data == NULL);
+
+  if (!demux->pes_arena || !gst_ts_demux_stream_use_slab (stream))
+    goto no_slab;
+
+  /* Nothing handed out of the slab is alive anymore, start over. Only
+   * this thread adds references so the count can't go back up */
+  slab = stream->slab;
+  if (slab && !ts_demux_slab_is_used (slab))
+    stream->slab_offset = 0;
+
+  /* Keep room for the largest PES seen so far, moving a PES to a new
+   * slab halfway through costs a copy */
+  if (!slab || slab->size - stream->slab_offset < MAX (size,
+          stream->max_pes_size)) {
+    if (!gst_ts_demux_stream_new_slab (stream, size))
+      goto no_slab;
+  }
+
+  slab = stream->slab;
+  stream->data = slab->data + stream->slab_offset;
+  stream->allocated_size = MIN (slab->size - stream->slab_offset, G_MAXUINT);
+  return;
+
+no_slab:
+  stream->data = g_malloc (size);
+  stream->allocated_size = size;
+}
+
+/* Make stream->data hold at least size bytes, keeping its contents */
+static void
+gst_ts_demux_stream_grow_data (TSDemuxStream * stream, guint size)
+{
+  TSDemuxSlab *old;
+
+  if (!gst_ts_demux_stream_data_in_slab (stream)) {
+    do {
+      stream->allocated_size *= 2;
+    } while (size > stream->allocated_size);
+    stream->data = g_realloc (stream->data, stream->allocated_size);
+    return;
+  }
+
+  /* Out of room in the slab, move what we have of this PES to a new one
+   * and expect it to at least double */
+  old = ts_demux_slab_ref (stream->slab);
+  stream->max_pes_size = MAX (stream->max_pes_size, size);
+  if (gst_ts_demux_stream_new_slab (stream, 2 * size)) {
+    memcpy (stream->slab->data, stream->data, stream->current_size);
+    stream->data = stream->slab->data;
+    stream->allocated_size = MIN (stream->slab->size, G_MAXUINT);
+  } else {
+    guint8 *data = g_malloc (2 * size);
+
+    memcpy (data, stream->data, stream->current_size);
+    stream->data = data;
+    stream->allocated_size = 2 * size;
+  }
+  ts_demux_slab_unref (old);
+}
+
+/* Drop the PES being assembled, its slab space is reused by the next one */
+static void
+gst_ts_demux_stream_free_data (TSDemuxStream * stream)
+{
+  if (!gst_ts_demux_stream_data_in_slab (stream))
+    g_free (stream->data);
+  stream->data = NULL;
+}
+
+/* Wrap size bytes at offset of the PES being assembled in a buffer,
+ * stream->data is handed over to it */
+static GstBuffer *
+gst_ts_demux_stream_take_buffer (TSDemuxStream * stream, guint offset,
+    guint size)
+{
+  GstBuffer *buffer;
+
+  if (gst_ts_demux_stream_data_in_slab (stream)) {
+    /* Limit the memory to its own region, the rest of the slab belongs
+     * to other buffers */
+    buffer = gst_buffer_new_wrapped_full (0, stream->data + offset, size, 0,
+        size, ts_demux_slab_ref (stream->slab),
+        (GDestroyNotify) ts_demux_slab_unref);
+    stream->slab_offset = MIN (stream->slab->size,
+        GST_ROUND_UP_16 (stream->slab_offset + stream->current_size));
+  } else {
+    buffer = gst_buffer_new_wrapped_full (0, stream->data,
+        stream->current_size, offset, size, stream->data, g_free);
+  }
+  stream->max_pes_size = MAX (stream->max_pes_size, stream->current_size);
+  stream->data = NULL;
+
+  return buffer;
+}
+
 static void
 clear_simple_buffer (SimpleBuffer * sbuf)
 {
@@ -775,7 +1015,7 @@ scan_keyframe_h264 (TSDemuxStream * stream, const guint8 * data,
       clear_simple_buffer (&h264infos->framedata);
     }
 
-    g_free (stream->data);
+    gst_ts_demux_stream_free_data (stream);
     stream->current_size = gst_byte_writer_get_size (h264infos->sps);
     stream->data = gst_byte_writer_reset_and_get_data (h264infos->sps);
     gst_byte_writer_init (h264infos->sps);
@@ -1864,6 +2104,17 @@ gst_ts_demux_stream_removed (MpegTSBase * base, MpegTSBaseStream * bstream)
   }
 
   tsdemux_h264_parsing_info_clear (&stream->h264infos);
+
+  if (stream->slab) {
+    ts_demux_slab_unref (stream->slab);
+    stream->slab = NULL;
+  }
+  if (stream->retired_slab) {
+    ts_demux_slab_unref (stream->retired_slab);
+    stream->retired_slab = NULL;
+  }
+  stream->slab_offset = 0;
+  stream->max_pes_size = 0;
 }
 
 static void
@@ -1889,8 +2140,7 @@ gst_ts_demux_stream_flush (TSDemuxStream * stream, GstTSDemux * tsdemux,
 {
   GST_DEBUG ("flushing stream %p", stream);
 
-  g_free (stream->data);
-  stream->data = NULL;
+  gst_ts_demux_stream_free_data (stream);
   stream->state = PENDING_PACKET_EMPTY;
   stream->expected_size = 0;
   stream->allocated_size = 0;
@@ -2356,12 +2606,11 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
 
   /* Create the output buffer */
   if (stream->expected_size)
-    stream->allocated_size = MAX (stream->expected_size, length);
+    gst_ts_demux_stream_alloc_data (demux, stream,
+        MAX (stream->expected_size, length));
   else
-    stream->allocated_size = MAX (8192, length);
+    gst_ts_demux_stream_alloc_data (demux, stream, MAX (8192, length));
 
-  g_assert (stream->data == NULL);
-  stream->data = g_malloc (stream->allocated_size);
   memcpy (stream->data, data, length);
   stream->current_size = length;
 
@@ -2428,10 +2677,7 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
       GST_LOG ("BUFFER: appending data");
       if (G_UNLIKELY (stream->current_size + size > stream->allocated_size)) {
         GST_LOG ("resizing buffer");
-        do {
-          stream->allocated_size *= 2;
-        } while (stream->current_size + size > stream->allocated_size);
-        stream->data = g_realloc (stream->data, stream->allocated_size);
+        gst_ts_demux_stream_grow_data (stream, stream->current_size + size);
       }
       memcpy (stream->data + stream->current_size, data, size);
       stream->current_size += size;
@@ -2440,10 +2686,8 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
     case PENDING_PACKET_DISCONT:
     {
       GST_LOG ("DISCONT: not storing/pushing");
-      if (G_UNLIKELY (stream->data)) {
-        g_free (stream->data);
-        stream->data = NULL;
-      }
+      if (G_UNLIKELY (stream->data))
+        gst_ts_demux_stream_free_data (stream);
       stream->continuity_counter = CONTINUITY_UNSET;
       break;
     }
@@ -2689,8 +2933,7 @@ parse_opus_access_unit (TSDemuxStream * stream)
     gst_buffer_list_add (buffer_list, buffer);
   } while (gst_byte_reader_get_remaining (&reader) > 0);
 
-  g_free (stream->data);
-  stream->data = NULL;
+  gst_ts_demux_stream_free_data (stream);
   stream->current_size = 0;
 
   return buffer_list;
@@ -2698,8 +2941,7 @@ parse_opus_access_unit (TSDemuxStream * stream)
 error:
   {
     GST_ERROR ("Failed to parse Opus access unit");
-    g_free (stream->data);
-    stream->data = NULL;
+    gst_ts_demux_stream_free_data (stream);
     stream->current_size = 0;
     if (buffer_list)
       gst_buffer_list_unref (buffer_list);
@@ -2838,17 +3080,14 @@ parse_jp2k_access_unit (TSDemuxStream * stream)
     goto error;
   }
 
-  retbuf = gst_buffer_new_wrapped_full (0, stream->data, stream->current_size,
-      data_location, stream->current_size - data_location,
-      stream->data, g_free);
-  stream->data = NULL;
+  retbuf = gst_ts_demux_stream_take_buffer (stream, data_location,
+      stream->current_size - data_location);
   stream->current_size = 0;
   return retbuf;
 
 error:
   GST_ERROR ("Failed to parse JP2K access unit");
-  g_free (stream->data);
-  stream->data = NULL;
+  gst_ts_demux_stream_free_data (stream);
   stream->current_size = 0;
   return NULL;
 }
@@ -2884,7 +3123,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
 
   if (G_UNLIKELY (demux->program == NULL)) {
     GST_LOG_OBJECT (demux, "No program");
-    g_free (stream->data);
+    gst_ts_demux_stream_free_data (stream);
     goto beach;
   }
 
@@ -2917,7 +3156,8 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
           goto beach;
         }
       } else {
-        buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+        buffer =
+            gst_ts_demux_stream_take_buffer (stream, 0, stream->current_size);
       }
 
       stream->seeked_pts = stream->pts;
@@ -2933,7 +3173,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
 
       stream->continuity_counter = CONTINUITY_UNSET;
       res = GST_FLOW_REWINDING;
-      g_free (stream->data);
+      gst_ts_demux_stream_free_data (stream);
       goto beach;
     }
   } else {
@@ -2957,17 +3197,20 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
         goto beach;
       }
     } else {
-      buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+      buffer =
+          gst_ts_demux_stream_take_buffer (stream, 0, stream->current_size);
     }
 
     /* Set AU header metadata on buffer */
     if (bs->stream_type == GST_MPEGTS_STREAM_TYPE_METADATA_PES_PACKETS) {
       GstKlvMeta meta;
+      guint8 header[5] = { 0, };
 
-      meta.metadata_service_id = stream->data[0];
-      meta.sequence_number = stream->data[1];
-      meta.flags = stream->data[2];
-      meta.au_cell_data_length = (stream->data[3] << 8) | stream->data[4];
+      gst_buffer_extract (buffer, 0, header, sizeof (header));
+      meta.metadata_service_id = header[0];
+      meta.sequence_number = header[1];
+      meta.flags = header[2];
+      meta.au_cell_data_length = (header[3] << 8) | header[4];
 
       GST_DEBUG_OBJECT (stream->pad,
           "Adding GstKlvMeta to buffer (metadata_service_id:%i, sequence_number:%i, flags:%i, au_cell_data_length:%i)",
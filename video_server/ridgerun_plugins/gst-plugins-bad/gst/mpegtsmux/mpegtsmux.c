@@ -107,8 +107,6 @@
 GST_DEBUG_CATEGORY (mpegtsmux_debug);
 #define GST_CAT_DEFAULT mpegtsmux_debug
 
-#define COLLECT_DATA_PAD(collect_data) (((GstCollectData *)(collect_data))->pad)
-
 enum
 {
   PROP_0,
@@ -123,6 +121,16 @@ enum
 #define MPEGTSMUX_DEFAULT_ALIGNMENT    -1
 #define MPEGTSMUX_DEFAULT_M2TS         FALSE
 
+/* packets per output chunk when no alignment is requested */
+#define MPEGTSMUX_DEFAULT_CHUNK_PACKETS 7
+/* output chunks are carved out of blocks of about this size */
+#define MPEGTSMUX_SLAB_SIZE            (64 * 1024)
+/* slabs kept around for reuse once downstream released them */
+#define MPEGTSMUX_MAX_FREE_SLABS       4
+/* AU cell flags for metadata without a GstKlvMeta: random access, reserved
+ * bits set */
+#define MPEGTSMUX_DEFAULT_AU_CELL_FLAGS 0x1F
+
 static GstStaticPadTemplate mpegtsmux_sink_factory =
     GST_STATIC_PAD_TEMPLATE ("sink_%d",
     GST_PAD_SINK,
@@ -186,34 +194,42 @@ static void release_buffer_cb (guint8 * data, void *user_data);
 static GstFlowReturn mpegtsmux_collect_packet (MpegTsMux * mux,
     GstBuffer * buf);
 static GstFlowReturn mpegtsmux_push_packets (MpegTsMux * mux, gboolean force);
+static guint8 *alloc_slab_packet_cb (void *user_data);
+static gboolean new_slab_packet_cb (guint8 * packet, void *user_data,
+    gint64 new_pcr);
+static GstFlowReturn mpegtsmux_push_chunks (MpegTsMux * mux, gboolean force);
 static gboolean new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf,
     gint64 new_pcr);
 
 static void mpegtsmux_prepare_srcpad (MpegTsMux * mux);
-GstFlowReturn mpegtsmux_clip_inc_running_time (GstCollectPads * pads,
-    GstCollectData * cdata, GstBuffer * buf, GstBuffer ** outbuf,
-    gpointer user_data);
-gint mpegtsmux_compare_function (GstCollectPads * pads,
-    GstCollectData * data1, GstClockTime timestamp1,
-    GstCollectData * data2, GstClockTime timestamp2, gpointer user_data);
-static GstFlowReturn mpegtsmux_collected_buffer (GstCollectPads * pads,
-    GstCollectData * data, GstBuffer * buf, MpegTsMux * mux);
-
-static gboolean mpegtsmux_sink_event (GstCollectPads * pads,
-    GstCollectData * data, GstEvent * event, gpointer user_data);
-static GstPad *mpegtsmux_request_new_pad (GstElement * element,
+static GstCaps *mpegtsmux_new_src_caps (MpegTsMux * mux);
+static GstBuffer *mpegtsmux_buffer_to_running_time (MpegTsPadData * pad_data,
+    GstBuffer * buf);
+static MpegTsPadData *mpegtsmux_find_best_pad (MpegTsMux * mux);
+static GstFlowReturn mpegtsmux_aggregate (GstAggregator * agg,
+    gboolean timeout);
+static GstClockTime mpegtsmux_get_next_time (GstAggregator * agg);
+static GstFlowReturn mpegtsmux_update_src_caps (GstAggregator * agg,
+    GstCaps * caps, GstCaps ** ret);
+static GstFlowReturn mpegtsmux_mux_buffer (MpegTsMux * mux,
+    MpegTsPadData * best, GstBuffer * buf);
+
+static gboolean mpegtsmux_sink_event (GstAggregator * agg,
+    GstAggregatorPad * agg_pad, GstEvent * event);
+static GstAggregatorPad *mpegtsmux_create_new_pad (GstAggregator * agg,
     GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
-static GstPad *mpegtsmux_request_new_sink_pad (GstElement * element,
-    GstPadTemplate * templ, const gchar * name, gint * pid);
-static GstPad *mpegtsmux_request_new_meta_pad (GstElement * element,
-    GstPadTemplate * templ, const gchar * name, gint * pid);
+static GstAggregatorPad *mpegtsmux_request_new_sink_pad (GstElement *
+    element, GstPadTemplate * templ, const gchar * name, gint * pid);
+static GstAggregatorPad *mpegtsmux_request_new_meta_pad (GstElement *
+    element, GstPadTemplate * templ, const gchar * name, gint * pid);
 static void mpegtsmux_release_pad (GstElement * element, GstPad * pad);
 static GstStateChangeReturn mpegtsmux_change_state (GstElement * element,
     GstStateChange transition);
 static gboolean mpegtsmux_send_event (GstElement * element, GstEvent * event);
 static void mpegtsmux_set_header_on_caps (MpegTsMux * mux);
-static gboolean mpegtsmux_src_event (GstPad * pad, GstObject * parent,
-    GstEvent * event);
+static gboolean mpegtsmux_src_event (GstAggregator * agg, GstEvent * event);
+static GstPadProbeReturn mpegtsmux_sink_buffer_probe (GstPad * pad,
+    GstPadProbeInfo * info, gpointer user_data);
 
 #if 0
 static void mpegtsmux_set_index (GstElement * element, GstIndex * index);
@@ -229,7 +245,8 @@ typedef struct
   GstBuffer *buffer;
 } StreamData;
 
-G_DEFINE_TYPE (MpegTsMux, mpegtsmux, GST_TYPE_ELEMENT)
+G_DEFINE_TYPE (MpegTsPadData, mpegtsmux_pad, GST_TYPE_AGGREGATOR_PAD);
+G_DEFINE_TYPE (MpegTsMux, mpegtsmux, GST_TYPE_AGGREGATOR)
 
 /* Takes over the ref on the buffer */
      static StreamData *stream_data_new (GstBuffer * buffer)
@@ -253,10 +270,37 @@ stream_data_free (StreamData * data)
 
 #define parent_class mpegtsmux_parent_class
 
+static void mpegtsmux_pad_reset (MpegTsPadData * pad_data);
+
+static void
+mpegtsmux_pad_finalize (GObject * object)
+{
+  mpegtsmux_pad_reset (GST_MPEG_TSMUX_PAD (object));
+
+  G_OBJECT_CLASS (mpegtsmux_pad_parent_class)->finalize (object);
+}
+
+static void
+mpegtsmux_pad_class_init (MpegTsPadDataClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = mpegtsmux_pad_finalize;
+}
+
+static void
+mpegtsmux_pad_init (MpegTsPadData * pad_data)
+{
+  pad_data->pid = -1;
+  pad_data->sparse = FALSE;
+  mpegtsmux_pad_reset (pad_data);
+}
+
 static void
 mpegtsmux_class_init (MpegTsMuxClass * klass)
 {
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+  GstAggregatorClass *gstagg_class = GST_AGGREGATOR_CLASS (klass);
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
   gst_element_class_add_static_pad_template (gstelement_class,
@@ -275,11 +319,20 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
   gobject_class->get_property = GST_DEBUG_FUNCPTR (gst_mpegtsmux_get_property);
   gobject_class->dispose = mpegtsmux_dispose;
 
-  gstelement_class->request_new_pad = mpegtsmux_request_new_pad;
   gstelement_class->release_pad = mpegtsmux_release_pad;
   gstelement_class->change_state = mpegtsmux_change_state;
   gstelement_class->send_event = mpegtsmux_send_event;
 
+  /* In live pipelines the aggregator "latency" property bounds how long a
+   * stream waits for the other pads. Sparse pads like KLV are fed GAPs
+   * while they are idle, see mpegtsmux_sink_buffer_probe() */
+  gstagg_class->create_new_pad = mpegtsmux_create_new_pad;
+  gstagg_class->aggregate = mpegtsmux_aggregate;
+  gstagg_class->get_next_time = mpegtsmux_get_next_time;
+  gstagg_class->update_src_caps = mpegtsmux_update_src_caps;
+  gstagg_class->sink_event = mpegtsmux_sink_event;
+  gstagg_class->src_event = mpegtsmux_src_event;
+
 #if 0
   gstelement_class->set_index = GST_DEBUG_FUNCPTR (mpegtsmux_set_index);
   gstelement_class->get_index = GST_DEBUG_FUNCPTR (mpegtsmux_get_index);
@@ -325,27 +378,8 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
 static void
 mpegtsmux_init (MpegTsMux * mux)
 {
-  mux->srcpad =
-      gst_pad_new_from_static_template (&mpegtsmux_src_factory, "src");
-  gst_pad_use_fixed_caps (mux->srcpad);
-  gst_pad_set_event_function (mux->srcpad,
-      GST_DEBUG_FUNCPTR (mpegtsmux_src_event));
-  gst_element_add_pad (GST_ELEMENT (mux), mux->srcpad);
-
-  mux->collect = gst_collect_pads_new ();
-  gst_collect_pads_set_buffer_function (mux->collect,
-      (GstCollectPadsBufferFunction)
-      GST_DEBUG_FUNCPTR (mpegtsmux_collected_buffer), mux);
-
-  gst_collect_pads_set_event_function (mux->collect,
-      (GstCollectPadsEventFunction) GST_DEBUG_FUNCPTR (mpegtsmux_sink_event),
-      mux);
-  gst_collect_pads_set_clip_function (mux->collect, (GstCollectPadsClipFunction)
-      GST_DEBUG_FUNCPTR (mpegtsmux_clip_inc_running_time), mux);
-
-  gst_collect_pads_set_compare_function (mux->collect,
-      (GstCollectPadsCompareFunction)
-      GST_DEBUG_FUNCPTR (mpegtsmux_compare_function), mux);
+  mux->srcpad = GST_AGGREGATOR_SRC_PAD (mux);
+
   mux->adapter = gst_adapter_new ();
   mux->out_adapter = gst_adapter_new ();
 
@@ -357,10 +391,107 @@ mpegtsmux_init (MpegTsMux * mux)
   mux->prog_map = NULL;
   mux->alignment = MPEGTSMUX_DEFAULT_ALIGNMENT;
 
+  mux->slab_pool = mpegtsmux_slab_pool_new ();
+
   /* initial state */
   mpegtsmux_reset (mux, TRUE);
 }
 
+/* Slabs come back here when the last buffer carved out of them is gone.
+ * Each slab holds a reference on the pool, which can outlive the muxer */
+struct MpegTsMuxSlabPool
+{
+  volatile gint ref_count;
+  GMutex lock;
+  GQueue free_slabs;
+};
+
+typedef struct
+{
+  MpegTsMuxSlabPool *pool;
+  guint8 *data;
+  gsize size;
+} MpegTsMuxSlab;
+
+static MpegTsMuxSlabPool *
+mpegtsmux_slab_pool_new (void)
+{
+  MpegTsMuxSlabPool *pool = g_slice_new0 (MpegTsMuxSlabPool);
+
+  pool->ref_count = 1;
+  g_mutex_init (&pool->lock);
+  g_queue_init (&pool->free_slabs);
+
+  return pool;
+}
+
+static void
+mpegtsmux_slab_free (MpegTsMuxSlab * slab)
+{
+  g_free (slab->data);
+  g_slice_free (MpegTsMuxSlab, slab);
+}
+
+static void
+mpegtsmux_slab_pool_unref (MpegTsMuxSlabPool * pool)
+{
+  MpegTsMuxSlab *slab;
+
+  if (!g_atomic_int_dec_and_test (&pool->ref_count))
+    return;
+
+  while ((slab = g_queue_pop_head (&pool->free_slabs)))
+    mpegtsmux_slab_free (slab);
+  g_mutex_clear (&pool->lock);
+  g_slice_free (MpegTsMuxSlabPool, pool);
+}
+
+/* GDestroyNotify of the GBytes wrapping a slab, called from whatever
+ * thread drops the last buffer of it */
+static void
+mpegtsmux_slab_release (MpegTsMuxSlab * slab)
+{
+  MpegTsMuxSlabPool *pool = slab->pool;
+
+  g_mutex_lock (&pool->lock);
+  if (pool->free_slabs.length < MPEGTSMUX_MAX_FREE_SLABS) {
+    g_queue_push_head (&pool->free_slabs, slab);
+    slab = NULL;
+  }
+  g_mutex_unlock (&pool->lock);
+
+  if (slab)
+    mpegtsmux_slab_free (slab);
+  mpegtsmux_slab_pool_unref (pool);
+}
+
+/* Returns a slab of size bytes, reusing a released one if possible */
+static GBytes *
+mpegtsmux_slab_pool_acquire (MpegTsMuxSlabPool * pool, gsize size)
+{
+  MpegTsMuxSlab *slab;
+
+  g_mutex_lock (&pool->lock);
+  while ((slab = g_queue_pop_head (&pool->free_slabs))) {
+    if (slab->size == size)
+      break;
+    /* left over from a different alignment */
+    mpegtsmux_slab_free (slab);
+  }
+  g_mutex_unlock (&pool->lock);
+
+  if (!slab) {
+    slab = g_slice_new (MpegTsMuxSlab);
+    slab->data = g_malloc (size);
+    slab->size = size;
+  }
+  g_atomic_int_inc (&pool->ref_count);
+  slab->pool = pool;
+
+  return g_bytes_new_with_free_func (slab->data, slab->size,
+      (GDestroyNotify) mpegtsmux_slab_release, slab);
+}
+
 static void
 mpegtsmux_pad_reset (MpegTsPadData * pad_data)
 {
@@ -395,7 +526,7 @@ static void
 mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
 {
   GstBuffer *buf;
-  GSList *walk;
+  GList *walk;
 
   mux->first = TRUE;
   mux->last_flow_ret = GST_FLOW_OK;
@@ -438,13 +569,24 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
   gst_event_replace (&mux->force_key_unit_event, NULL);
   gst_buffer_replace (&mux->out_buffer, NULL);
 
-  if (mux->collect) {
-    GST_COLLECT_PADS_STREAM_LOCK (mux->collect);
-    for (walk = mux->collect->data; walk != NULL; walk = g_slist_next (walk))
-      mpegtsmux_pad_reset ((MpegTsPadData *) walk->data);
-    GST_COLLECT_PADS_STREAM_UNLOCK (mux->collect);
+  if (mux->slab) {
+    g_bytes_unref (mux->slab);
+    mux->slab = NULL;
+    mux->slab_data = NULL;
+  }
+  mux->slab_offset = 0;
+  mux->out_packets = 0;
+  if (mux->out_list) {
+    gst_buffer_list_unref (mux->out_list);
+    mux->out_list = NULL;
   }
 
+  GST_OBJECT_LOCK (mux);
+  for (walk = GST_ELEMENT (mux)->sinkpads; walk != NULL;
+      walk = g_list_next (walk))
+    mpegtsmux_pad_reset (GST_MPEG_TSMUX_PAD (walk->data));
+  GST_OBJECT_UNLOCK (mux);
+
   if (alloc) {
     mux->tsmux = tsmux_new ();
     tsmux_set_write_func (mux->tsmux, new_packet_cb, mux);
@@ -467,10 +609,6 @@ mpegtsmux_dispose (GObject * object)
     g_object_unref (mux->out_adapter);
     mux->out_adapter = NULL;
   }
-  if (mux->collect) {
-    gst_object_unref (mux->collect);
-    mux->collect = NULL;
-  }
   if (mux->prog_map) {
     gst_structure_free (mux->prog_map);
     mux->prog_map = NULL;
@@ -479,6 +617,10 @@ mpegtsmux_dispose (GObject * object)
     g_hash_table_destroy (mux->programs);
     mux->programs = NULL;
   }
+  if (mux->slab_pool) {
+    mpegtsmux_slab_pool_unref (mux->slab_pool);
+    mux->slab_pool = NULL;
+  }
   GST_CALL_PARENT (G_OBJECT_CLASS, dispose, (object));
 }
 
@@ -487,7 +629,7 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
   MpegTsMux *mux = GST_MPEG_TSMUX (object);
-  GSList *walk;
+  GList *walk;
 
   switch (prop_id) {
     case PROP_M2TS_MODE:
@@ -512,15 +654,18 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
         tsmux_set_pat_interval (mux->tsmux, mux->pat_interval);
       break;
     case PROP_PMT_INTERVAL:
-      walk = mux->collect->data;
+      GST_OBJECT_LOCK (mux);
+      walk = GST_ELEMENT (mux)->sinkpads;
       mux->pmt_interval = g_value_get_uint (value);
 
       while (walk) {
-        MpegTsPadData *ts_data = (MpegTsPadData *) walk->data;
+        MpegTsPadData *ts_data = GST_MPEG_TSMUX_PAD (walk->data);
 
-        tsmux_set_pmt_interval (ts_data->prog, mux->pmt_interval);
-        walk = g_slist_next (walk);
+        if (ts_data->prog)
+          tsmux_set_pmt_interval (ts_data->prog, mux->pmt_interval);
+        walk = g_list_next (walk);
       }
+      GST_OBJECT_UNLOCK (mux);
       break;
     case PROP_ALIGNMENT:
       mux->alignment = g_value_get_int (value);
@@ -622,7 +767,7 @@ mpegtsmux_create_stream (MpegTsMux * mux, MpegTsPadData * ts_data)
   guint8 color_spec = 0;
   j2k_private_data *private_data = NULL;
 
-  pad = ts_data->collect.pad;
+  pad = GST_PAD (ts_data);
   caps = gst_pad_get_current_caps (pad);
   if (caps == NULL && !strncmp (GST_PAD_NAME (pad), "meta", 4)) {
     caps = gst_caps_from_string ("meta/x-klv,parsed=true");
@@ -961,18 +1106,23 @@ static GstFlowReturn
 mpegtsmux_create_streams (MpegTsMux * mux)
 {
   GstFlowReturn ret = GST_FLOW_OK;
-  GSList *walk = mux->collect->data;
+  GList *pads, *walk;
+
+  GST_OBJECT_LOCK (mux);
+  pads = g_list_copy_deep (GST_ELEMENT (mux)->sinkpads,
+      (GCopyFunc) gst_object_ref, NULL);
+  GST_OBJECT_UNLOCK (mux);
 
   /* Create the streams */
+  walk = pads;
   while (walk) {
-    GstCollectData *c_data = (GstCollectData *) walk->data;
-    MpegTsPadData *ts_data = (MpegTsPadData *) walk->data;
+    MpegTsPadData *ts_data = GST_MPEG_TSMUX_PAD (walk->data);
     gchar *name = NULL;
 
-    walk = g_slist_next (walk);
+    walk = g_list_next (walk);
 
     if (ts_data->prog_id == -1) {
-      name = GST_PAD_NAME (c_data->pad);
+      name = GST_PAD_NAME (ts_data);
       if (mux->prog_map != NULL && gst_structure_has_field (mux->prog_map,
               name)) {
         gint idx;
@@ -1005,7 +1155,7 @@ mpegtsmux_create_streams (MpegTsMux * mux)
           GINT_TO_POINTER (ts_data->prog_id), ts_data->prog);
 
       /* Take the first stream of the program for the PCR */
-      GST_DEBUG_OBJECT (COLLECT_DATA_PAD (ts_data),
+      GST_DEBUG_OBJECT (GST_PAD (ts_data),
           "Use stream (pid=%d) from pad as PCR for program (prog_id = %d)",
           ts_data->pid, ts_data->prog_id);
 
@@ -1019,17 +1169,21 @@ mpegtsmux_create_streams (MpegTsMux * mux)
     }
   }
 
+  g_list_free_full (pads, gst_object_unref);
+
   return GST_FLOW_OK;
 
   /* ERRORS */
 no_program:
   {
+    g_list_free_full (pads, gst_object_unref);
     GST_ELEMENT_ERROR (mux, STREAM, MUX,
         ("Could not create new program"), (NULL));
     return GST_FLOW_ERROR;
   }
 no_stream:
   {
+    g_list_free_full (pads, gst_object_unref);
     GST_ELEMENT_ERROR (mux, STREAM, MUX,
         ("Could not create handler for stream"), (NULL));
     return ret;
@@ -1037,18 +1191,18 @@ no_stream:
 }
 
 static gboolean
-mpegtsmux_sink_event (GstCollectPads * pads, GstCollectData * data,
-    GstEvent * event, gpointer user_data)
+mpegtsmux_sink_event (GstAggregator * agg, GstAggregatorPad * agg_pad,
+    GstEvent * event)
 {
-  MpegTsMux *mux = GST_MPEG_TSMUX (user_data);
+  MpegTsMux *mux = GST_MPEG_TSMUX (agg);
   gboolean res = FALSE;
   gboolean forward = TRUE;
-  MpegTsPadData *pad_data = (MpegTsPadData *) data;
+  MpegTsPadData *pad_data = GST_MPEG_TSMUX_PAD (agg_pad);
 
 #ifndef GST_DISABLE_GST_DEBUG
   GstPad *pad;
 
-  pad = data->pad;
+  pad = GST_PAD (agg_pad);
 #endif
 
   switch (GST_EVENT_TYPE (event)) {
@@ -1106,9 +1260,16 @@ mpegtsmux_sink_event (GstCollectPads * pads, GstCollectData * data,
         g_free (lang);
       }
 
-      /* handled this, don't want collectpads to forward it downstream */
+      /* The aggregator drops tags, forward global ones ourselves once the
+       * output stream has started, before that they would be misordered */
       res = TRUE;
-      forward = gst_tag_list_get_scope (list) == GST_TAG_SCOPE_GLOBAL;
+      forward = FALSE;
+      if (gst_tag_list_get_scope (list) == GST_TAG_SCOPE_GLOBAL) {
+        if (gst_pad_has_current_caps (mux->srcpad))
+          gst_pad_push_event (mux->srcpad, gst_event_ref (event));
+        else
+          GST_DEBUG_OBJECT (mux, "dropping global tags before caps");
+      }
       break;
     }
     case GST_EVENT_STREAM_START:{
@@ -1116,12 +1277,10 @@ mpegtsmux_sink_event (GstCollectPads * pads, GstCollectData * data,
 
       gst_event_parse_stream_flags (event, &flags);
 
-      /* Don't wait for data on sparse inputs like metadata streams */
-      if ((flags & GST_STREAM_FLAG_SPARSE)) {
-        GST_COLLECT_PADS_STATE_UNSET (data, GST_COLLECT_PADS_STATE_LOCKED);
-        gst_collect_pads_set_waiting (pads, data, FALSE);
-        GST_COLLECT_PADS_STATE_SET (data, GST_COLLECT_PADS_STATE_LOCKED);
-      }
+      /* Don't hold back the first packets waiting on sparse inputs like
+       * metadata streams, see mpegtsmux_find_best_pad() */
+      if ((flags & GST_STREAM_FLAG_SPARSE))
+        pad_data->sparse = TRUE;
       break;
     }
     default:
@@ -1132,15 +1291,16 @@ out:
   if (!forward)
     gst_event_unref (event);
   else
-    res = gst_collect_pads_event_default (pads, data, event, FALSE);
+    res = GST_AGGREGATOR_CLASS (mpegtsmux_parent_class)->sink_event (agg,
+        agg_pad, event);
 
   return res;
 }
 
 static gboolean
-mpegtsmux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
+mpegtsmux_src_event (GstAggregator * agg, GstEvent * event)
 {
-  MpegTsMux *mux = GST_MPEG_TSMUX (parent);
+  MpegTsMux *mux = GST_MPEG_TSMUX (agg);
   gboolean res = TRUE, forward = TRUE;
 
   switch (GST_EVENT_TYPE (event)) {
@@ -1186,7 +1346,7 @@ mpegtsmux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
             done = TRUE;
             break;
           case GST_ITERATOR_OK:
-            GST_INFO_OBJECT (pad, "forwarding");
+            GST_INFO_OBJECT (sinkpad, "forwarding");
             tmp = gst_pad_push_event (sinkpad, gst_event_ref (event));
             GST_INFO_OBJECT (mux, "result %d", tmp);
             /* succeed if at least one pad succeeds */
@@ -1209,7 +1369,8 @@ mpegtsmux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
   }
 
   if (forward)
-    res = gst_pad_event_default (pad, parent, event);
+    res = GST_AGGREGATOR_CLASS (mpegtsmux_parent_class)->src_event (agg,
+        event);
   else
     gst_event_unref (event);
 
@@ -1268,78 +1429,256 @@ out:
 }
 
 
-gint
-mpegtsmux_compare_function (GstCollectPads * pads,
-    GstCollectData * data1, GstClockTime timestamp1,
-    GstCollectData * data2, GstClockTime timestamp2, gpointer user_data)
+/* the empty buffers the aggregator makes out of GAP events */
+static inline gboolean
+mpegtsmux_is_gap_buffer (GstBuffer * buf)
 {
+  return GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_GAP) &&
+      gst_buffer_get_size (buf) == 0;
+}
+
+/* The time segment of the data that arrives on pad now. The aggregator
+ * only updates the pad segment once the queued events are handled */
+static gboolean
+mpegtsmux_get_sticky_segment (GstPad * pad, GstSegment * segment)
+{
+  GstEvent *event;
+
+  event = gst_pad_get_sticky_event (pad, GST_EVENT_SEGMENT, 0);
+  if (!event)
+    return FALSE;
 
-  MpegTsMux *mux = GST_MPEG_TSMUX (user_data);
+  gst_event_copy_segment (event, segment);
+  gst_event_unref (event);
 
-  GST_LOG_OBJECT (pads, "comparing %" GST_TIME_FORMAT
-      " and %" GST_TIME_FORMAT, GST_TIME_ARGS (timestamp1),
-      GST_TIME_ARGS (timestamp2));
+  return segment->format == GST_FORMAT_TIME;
+}
 
-  /* prefer a buffer for a waiting pad when starting to
-     avoid that a non-waiting pad be selected as the pcr stream */
-  if (mux->first) {
-    gboolean data1_waiting;
-    gboolean data2_waiting;
+/* Sends a GAP up to running_time into every sparse pad, so that the
+ * aggregator doesn't wait on it for the buffer that is about to be queued
+ * on another pad. Whatever sparse data is queued already stays in front */
+static void
+mpegtsmux_fill_sparse_pads (MpegTsMux * mux, GstClockTime running_time)
+{
+  GList *walk, *sparse = NULL;
 
-    data1_waiting =
-        GST_COLLECT_PADS_STATE_IS_SET (data1, GST_COLLECT_PADS_STATE_WAITING);
-    data2_waiting =
-        GST_COLLECT_PADS_STATE_IS_SET (data2, GST_COLLECT_PADS_STATE_WAITING);
+  GST_OBJECT_LOCK (mux);
+  for (walk = GST_ELEMENT (mux)->sinkpads; walk; walk = g_list_next (walk)) {
+    MpegTsPadData *pad_data = GST_MPEG_TSMUX_PAD (walk->data);
 
-    if (data1_waiting != data2_waiting) {
-      return data1_waiting ? -1 : 1;
+    if (pad_data->sparse)
+      sparse = g_list_prepend (sparse, gst_object_ref (pad_data));
+  }
+  GST_OBJECT_UNLOCK (mux);
+
+  for (walk = sparse; walk; walk = g_list_next (walk)) {
+    GstPad *pad = GST_PAD (walk->data);
+    GstClockTime position = GST_CLOCK_TIME_NONE;
+    GstSegment segment;
+
+    /* If upstream holds the stream lock it is pushing data right now and
+     * the pad doesn't need a GAP. Waiting for the lock could deadlock on
+     * the aggregator waiting for the buffer we are about to queue */
+    if (!GST_PAD_STREAM_TRYLOCK (pad))
+      continue;
+
+    if (!gst_aggregator_pad_is_eos (GST_AGGREGATOR_PAD (pad)) &&
+        mpegtsmux_get_sticky_segment (pad, &segment))
+      position = gst_segment_position_from_running_time (&segment,
+          GST_FORMAT_TIME, running_time);
+
+    if (GST_CLOCK_TIME_IS_VALID (position)) {
+      GST_LOG_OBJECT (pad, "sparse pad, sending GAP at %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (position));
+      gst_pad_send_event (pad, gst_event_new_gap (position,
+              GST_CLOCK_TIME_NONE));
     }
 
+    GST_PAD_STREAM_UNLOCK (pad);
   }
-  /* non-valid timestamps go first as they are probably headers or so */
-  if (G_UNLIKELY (!GST_CLOCK_TIME_IS_VALID (timestamp1)))
-    return GST_CLOCK_TIME_IS_VALID (timestamp2) ? -1 : 0;
+  g_list_free_full (sparse, gst_object_unref);
+}
 
-  if (G_UNLIKELY (!GST_CLOCK_TIME_IS_VALID (timestamp2)))
-    return 1;
+/* Sparse streams like KLV only get a buffer now and then. The aggregator
+ * waits for data on all pads when not live, so before a buffer of a regular
+ * stream is queued the sparse pads get a GAP up to its running time.
+ * mpegtsmux_aggregate() drops those again once the buffer is muxed */
+static GstPadProbeReturn
+mpegtsmux_sink_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  MpegTsPadData *pad_data = GST_MPEG_TSMUX_PAD (pad);
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstClockTime running_time = GST_CLOCK_TIME_NONE;
+  GstSegment segment;
+  GstObject *mux;
+
+  if (pad_data->sparse)
+    return GST_PAD_PROBE_OK;
 
-  /* compare timestamp */
-  if (timestamp1 < timestamp2)
-    return -1;
+  if (GST_BUFFER_DTS_OR_PTS (buf) != GST_CLOCK_TIME_NONE &&
+      mpegtsmux_get_sticky_segment (pad, &segment))
+    running_time = gst_segment_to_running_time (&segment, GST_FORMAT_TIME,
+        GST_BUFFER_DTS_OR_PTS (buf));
 
-  if (timestamp1 > timestamp2)
-    return 1;
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    return GST_PAD_PROBE_OK;
+
+  mux = gst_object_get_parent (GST_OBJECT (pad));
+  if (mux) {
+    mpegtsmux_fill_sparse_pads (GST_MPEG_TSMUX (mux), running_time);
+    gst_object_unref (mux);
+  }
 
-  return 0;
+  return GST_PAD_PROBE_OK;
 }
 
-GstFlowReturn
-mpegtsmux_clip_inc_running_time (GstCollectPads * pads,
-    GstCollectData * cdata, GstBuffer * buf, GstBuffer ** outbuf,
-    gpointer user_data)
+/* Drops the GAPs queued on sparse pads up to running_time, they only had to
+ * let a buffer at that time through */
+static void
+mpegtsmux_drop_gaps (MpegTsMux * mux, GstClockTime running_time)
 {
-  MpegTsPadData *pad_data = (MpegTsPadData *) cdata;
-  GstClockTime time;
+  GList *walk;
+
+  GST_OBJECT_LOCK (mux);
+  for (walk = GST_ELEMENT (mux)->sinkpads; walk; walk = g_list_next (walk)) {
+    GstAggregatorPad *agg_pad = GST_AGGREGATOR_PAD (walk->data);
+    GstBuffer *buf;
+
+    while ((buf = gst_aggregator_pad_peek_buffer (agg_pad))) {
+      GstClockTime ts = GST_CLOCK_TIME_NONE;
+
+      if (mpegtsmux_is_gap_buffer (buf) && GST_BUFFER_PTS_IS_VALID (buf))
+        ts = gst_segment_to_running_time (&agg_pad->segment, GST_FORMAT_TIME,
+            GST_BUFFER_PTS (buf));
+      gst_buffer_unref (buf);
+
+      if (!GST_CLOCK_TIME_IS_VALID (ts) || ts > running_time)
+        break;
+
+      gst_aggregator_pad_drop_buffer (agg_pad);
+    }
+  }
+  GST_OBJECT_UNLOCK (mux);
+}
+
+/* Returns the pad whose head buffer has to be muxed next, NULL if no pad
+ * has any data queued. Takes a reference on the returned pad */
+static MpegTsPadData *
+mpegtsmux_find_best_pad (MpegTsMux * mux)
+{
+  MpegTsPadData *best = NULL;
+  GstClockTime best_ts = GST_CLOCK_TIME_NONE;
+  gboolean best_sparse = TRUE;
+  gboolean best_gap = FALSE;
+  GList *walk;
+
+  GST_OBJECT_LOCK (mux);
+  for (walk = GST_ELEMENT (mux)->sinkpads; walk; walk = g_list_next (walk)) {
+    MpegTsPadData *pad_data = GST_MPEG_TSMUX_PAD (walk->data);
+    GstAggregatorPad *agg_pad = GST_AGGREGATOR_PAD (pad_data);
+    GstClockTime ts;
+    GstBuffer *buf;
+    gboolean gap;
+
+    buf = gst_aggregator_pad_peek_buffer (agg_pad);
+    if (!buf)
+      continue;
+
+    ts = GST_BUFFER_DTS_OR_PTS (buf);
+    if (GST_CLOCK_TIME_IS_VALID (ts))
+      ts = gst_segment_to_running_time (&agg_pad->segment, GST_FORMAT_TIME,
+          ts);
+    gap = mpegtsmux_is_gap_buffer (buf);
+    gst_buffer_unref (buf);
+
+    if (best) {
+      /* prefer a buffer for a non-sparse pad when starting to
+         avoid that a sparse pad be selected as the pcr stream */
+      if (mux->first && pad_data->sparse != best_sparse) {
+        if (pad_data->sparse)
+          continue;
+      } else if (!GST_CLOCK_TIME_IS_VALID (best_ts)) {
+        /* non-valid timestamps go first as they are probably headers or so */
+        continue;
+      } else if (GST_CLOCK_TIME_IS_VALID (ts) && ts >= best_ts) {
+        /* a GAP only stands in for a buffer at the same time, the buffer
+         * goes first */
+        if (ts > best_ts || gap || !best_gap)
+          continue;
+      }
+    }
+
+    best = pad_data;
+    best_ts = ts;
+    best_sparse = pad_data->sparse;
+    best_gap = gap;
+  }
+  if (best)
+    gst_object_ref (best);
+  GST_OBJECT_UNLOCK (mux);
 
-  *outbuf = buf;
+  return best;
+}
+
+static GstClockTime
+mpegtsmux_get_next_time (GstAggregator * agg)
+{
+  MpegTsMux *mux = GST_MPEG_TSMUX (agg);
+  GstClockTime next_time = GST_CLOCK_TIME_NONE;
+  GList *walk;
+
+  /* The deadline follows the earliest queued buffer, a pad without data
+   * is not waited for past this time plus the latency */
+  GST_OBJECT_LOCK (mux);
+  for (walk = GST_ELEMENT (mux)->sinkpads; walk; walk = g_list_next (walk)) {
+    GstAggregatorPad *agg_pad = GST_AGGREGATOR_PAD (walk->data);
+    GstClockTime ts;
+    GstBuffer *buf;
+
+    buf = gst_aggregator_pad_peek_buffer (agg_pad);
+    if (!buf)
+      continue;
+
+    ts = GST_BUFFER_DTS_OR_PTS (buf);
+    if (GST_CLOCK_TIME_IS_VALID (ts))
+      ts = gst_segment_to_running_time (&agg_pad->segment, GST_FORMAT_TIME,
+          ts);
+    gst_buffer_unref (buf);
+
+    if (GST_CLOCK_TIME_IS_VALID (ts) && (!GST_CLOCK_TIME_IS_VALID (next_time)
+            || ts < next_time))
+      next_time = ts;
+  }
+  GST_OBJECT_UNLOCK (mux);
+
+  return next_time;
+}
+
+/* Converts the timestamps of buf to running time, returns NULL if the
+ * buffer lies outside of the pad segment */
+static GstBuffer *
+mpegtsmux_buffer_to_running_time (MpegTsPadData * pad_data, GstBuffer * buf)
+{
+  GstSegment *segment = &GST_AGGREGATOR_PAD (pad_data)->segment;
+  GstClockTime time;
 
   /* PTS */
   time = GST_BUFFER_PTS (buf);
 
   /* invalid left alone and passed */
   if (G_LIKELY (GST_CLOCK_TIME_IS_VALID (time))) {
-    time = gst_segment_to_running_time (&cdata->segment, GST_FORMAT_TIME, time);
+    time = gst_segment_to_running_time (segment, GST_FORMAT_TIME, time);
     if (G_UNLIKELY (!GST_CLOCK_TIME_IS_VALID (time))) {
-      GST_DEBUG_OBJECT (cdata->pad, "clipping buffer on pad outside segment");
+      GST_DEBUG_OBJECT (pad_data, "clipping buffer on pad outside segment");
       gst_buffer_unref (buf);
-      *outbuf = NULL;
-      goto beach;
+      return NULL;
     } else {
-      GST_LOG_OBJECT (cdata->pad, "buffer pts %" GST_TIME_FORMAT " ->  %"
+      GST_LOG_OBJECT (pad_data, "buffer pts %" GST_TIME_FORMAT " ->  %"
           GST_TIME_FORMAT " running time",
           GST_TIME_ARGS (GST_BUFFER_PTS (buf)), GST_TIME_ARGS (time));
-      buf = *outbuf = gst_buffer_make_writable (buf);
-      GST_BUFFER_PTS (*outbuf) = time;
+      buf = gst_buffer_make_writable (buf);
+      GST_BUFFER_PTS (buf) = time;
     }
   }
 
@@ -1351,7 +1690,7 @@ mpegtsmux_clip_inc_running_time (GstCollectPads * pads,
     gint sign;
     gint64 dts;
 
-    sign = gst_segment_to_running_time_full (&cdata->segment, GST_FORMAT_TIME,
+    sign = gst_segment_to_running_time_full (segment, GST_FORMAT_TIME,
         time, &time);
 
     if (sign > 0)
@@ -1359,78 +1698,132 @@ mpegtsmux_clip_inc_running_time (GstCollectPads * pads,
     else
       dts = -((gint64) time);
 
-    GST_LOG_OBJECT (cdata->pad, "buffer dts %" GST_TIME_FORMAT " -> %"
+    GST_LOG_OBJECT (pad_data, "buffer dts %" GST_TIME_FORMAT " -> %"
         GST_STIME_FORMAT " running time", GST_TIME_ARGS (GST_BUFFER_DTS (buf)),
         GST_STIME_ARGS (dts));
 
     if (GST_CLOCK_STIME_IS_VALID (pad_data->dts) && dts < pad_data->dts) {
       /* Ignore DTS going backward */
-      GST_WARNING_OBJECT (cdata->pad, "ignoring DTS going backward");
+      GST_WARNING_OBJECT (pad_data, "ignoring DTS going backward");
       dts = pad_data->dts;
     }
 
-    *outbuf = gst_buffer_make_writable (buf);
+    buf = gst_buffer_make_writable (buf);
     if (sign > 0)
-      GST_BUFFER_DTS (*outbuf) = time;
+      GST_BUFFER_DTS (buf) = time;
     else
-      GST_BUFFER_DTS (*outbuf) = GST_CLOCK_TIME_NONE;
+      GST_BUFFER_DTS (buf) = GST_CLOCK_TIME_NONE;
 
     pad_data->dts = dts;
   } else {
     pad_data->dts = GST_CLOCK_STIME_NONE;
   }
 
-beach:
-  return GST_FLOW_OK;
+  return buf;
+}
+
+static gboolean
+mpegtsmux_all_pads_eos (MpegTsMux * mux)
+{
+  gboolean eos = TRUE;
+  GList *walk;
+
+  GST_OBJECT_LOCK (mux);
+  for (walk = GST_ELEMENT (mux)->sinkpads; walk && eos;
+      walk = g_list_next (walk))
+    eos = gst_aggregator_pad_is_eos (GST_AGGREGATOR_PAD (walk->data));
+  GST_OBJECT_UNLOCK (mux);
+
+  return eos;
+}
+
+static GstFlowReturn
+mpegtsmux_aggregate (GstAggregator * agg, gboolean timeout)
+{
+  MpegTsMux *mux = GST_MPEG_TSMUX (agg);
+  GstFlowReturn ret = GST_FLOW_OK;
+  MpegTsPadData *best;
+  GstBuffer *buf;
+
+  if (timeout)
+    GST_DEBUG_OBJECT (mux, "deadline reached, not waiting on empty pads");
+
+  best = mpegtsmux_find_best_pad (mux);
+  if (G_UNLIKELY (best == NULL)) {
+    if (!mpegtsmux_all_pads_eos (mux))
+      return GST_FLOW_OK;
+
+    /* EOS */
+    GST_INFO_OBJECT (mux, "EOS");
+    if (!mux->first) {
+      /* drain some possibly cached data */
+      new_packet_m2ts (mux, NULL, -1);
+      mpegtsmux_push_packets (mux, TRUE);
+    }
+
+    /* the aggregator sends the EOS event downstream */
+    return GST_FLOW_EOS;
+  }
+
+  buf = gst_aggregator_pad_pop_buffer (GST_AGGREGATOR_PAD (best));
+  if (G_UNLIKELY (buf == NULL))
+    goto done;
+
+  /* drop the empty buffers the aggregator makes out of GAP events */
+  if (mpegtsmux_is_gap_buffer (buf)) {
+    gst_buffer_unref (buf);
+    goto done;
+  }
+
+  buf = mpegtsmux_buffer_to_running_time (best, buf);
+  if (buf) {
+    GstClockTime running_time = GST_BUFFER_DTS_OR_PTS (buf);
+
+    ret = mpegtsmux_mux_buffer (mux, best, buf);
+
+    /* the GAPs that held the place of idle sparse pads for this buffer are
+     * done, don't let them block the next one */
+    if (GST_CLOCK_TIME_IS_VALID (running_time))
+      mpegtsmux_drop_gaps (mux, running_time);
+  }
+
+done:
+  gst_object_unref (best);
+  return ret;
 }
 
 static GstFlowReturn
-mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
-    GstBuffer * buf, MpegTsMux * mux)
+mpegtsmux_mux_buffer (MpegTsMux * mux, MpegTsPadData * best, GstBuffer * buf)
 {
   GstFlowReturn ret = GST_FLOW_OK;
-  MpegTsPadData *best = (MpegTsPadData *) data;
   TsMuxProgram *prog;
   gint64 pts = GST_CLOCK_STIME_NONE;
   gint64 dts = GST_CLOCK_STIME_NONE;
   gboolean delta = TRUE, header = FALSE;
   StreamData *stream_data;
 
-  GST_DEBUG_OBJECT (mux, "Pads collected");
-
   if (G_UNLIKELY (mux->first)) {
     ret = mpegtsmux_create_streams (mux);
     if (G_UNLIKELY (ret != GST_FLOW_OK)) {
-      if (buf)
-        gst_buffer_unref (buf);
+      gst_buffer_unref (buf);
       return ret;
     }
 
     mpegtsmux_prepare_srcpad (mux);
 
-    mux->first = FALSE;
-  }
-
-  if (G_UNLIKELY (best == NULL)) {
-    /* EOS */
-    GST_INFO_OBJECT (mux, "EOS");
-    /* drain some possibly cached data */
-    new_packet_m2ts (mux, NULL, -1);
-    mpegtsmux_push_packets (mux, TRUE);
-    gst_pad_push_event (mux->srcpad, gst_event_new_eos ());
-
-    if (buf)
-      gst_buffer_unref (buf);
+    /* m2ts packets are held back until the next PCR, only plain TS is
+     * written straight into the output chunks */
+    if (!mux->m2ts_mode)
+      tsmux_set_slab_funcs (mux->tsmux, alloc_slab_packet_cb,
+          new_slab_packet_cb, mux);
 
-    return GST_FLOW_OK;
+    mux->first = FALSE;
   }
 
   prog = best->prog;
   if (prog == NULL)
     goto no_program;
 
-  g_assert (buf != NULL);
-
   if (best->prepare_func) {
     GstBuffer *tmp;
 
@@ -1444,7 +1837,7 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
     GstEvent *event;
 
     event = check_pending_key_unit_event (mux->force_key_unit_event,
-        &best->collect.segment, GST_BUFFER_PTS (buf),
+        &GST_AGGREGATOR_PAD (best)->segment, GST_BUFFER_PTS (buf),
         GST_BUFFER_FLAGS (buf), mux->pending_key_unit_ts);
     if (event) {
       GstClockTime running_time;
@@ -1477,7 +1870,7 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
 
   if (G_UNLIKELY (prog->pcr_stream == NULL)) {
     /* Take the first data stream for the PCR */
-    GST_DEBUG_OBJECT (COLLECT_DATA_PAD (best),
+    GST_DEBUG_OBJECT (GST_PAD (best),
         "Use stream (pid=%d) from pad as PCR for program (prog_id = %d)",
         best->pid, best->prog_id);
 
@@ -1485,7 +1878,7 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
     tsmux_program_set_pcr_stream (prog, best->stream);
   }
 
-  GST_DEBUG_OBJECT (COLLECT_DATA_PAD (best),
+  GST_DEBUG_OBJECT (GST_PAD (best),
       "Chose stream for output (PID: 0x%04x)", best->pid);
 
   if (GST_CLOCK_TIME_IS_VALID (GST_BUFFER_PTS (buf))) {
@@ -1521,43 +1914,32 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
 #endif
   }
 
-  if (best->stream->is_meta && gst_buffer_get_size (buf) > (G_MAXUINT16 - 3)) {
-    GST_WARNING_OBJECT (mux, "KLV meta unit too big, splitting not supported");
-
-    gst_buffer_unref (buf);
-    return GST_FLOW_OK;
-  }
-
   GST_DEBUG_OBJECT (mux, "delta: %d", delta);
 
-  /* Get AU header metadata from buffer and add it to the head of buffer data */
+  stream_data = stream_data_new (buf);
+
+  /* Metadata goes out as AU cells, the cell header is written in place in
+   * front of every PES payload and large AUs are split into fragments */
   if (best->stream->stream_type == TSMUX_ST_METADATA) {
     GstKlvMeta *meta = gst_buffer_get_klv_meta (buf);
-    GstMemory *mem;
-    GstMapInfo map;
+    guint8 service_id = 0, sequence_number = 0;
+    guint8 flags = MPEGTSMUX_DEFAULT_AU_CELL_FLAGS;
 
     if (meta) {
       GST_DEBUG ("KLV Data Mux %i %i %i %i", meta->metadata_service_id,
           meta->sequence_number, meta->flags, meta->au_cell_data_length);
-
-      mem = gst_allocator_alloc (NULL, 5, NULL);
-      if (gst_memory_map (mem, &map, GST_MAP_WRITE)) {
-        map.data[0] = meta->metadata_service_id;
-        map.data[1] = meta->sequence_number;
-        map.data[2] = meta->flags;
-        map.data[3] = (meta->au_cell_data_length & 0xff00) >> 8;
-        map.data[4] = (meta->au_cell_data_length & 0xff);
-
-        gst_memory_unmap (mem, &map);
-        buf = gst_buffer_make_writable (buf);
-        gst_buffer_prepend_memory (buf, mem);
-      }
+      service_id = meta->metadata_service_id;
+      sequence_number = meta->sequence_number;
+      flags = meta->flags;
     }
-  }
 
-  stream_data = stream_data_new (buf);
-  tsmux_stream_add_data (best->stream, stream_data->map_info.data,
-      stream_data->map_info.size, stream_data, pts, dts, !delta);
+    tsmux_stream_add_au_cell (best->stream, stream_data->map_info.data,
+        stream_data->map_info.size, stream_data, pts, dts, service_id,
+        sequence_number, flags);
+  } else {
+    tsmux_stream_add_data (best->stream, stream_data->map_info.data,
+        stream_data->map_info.size, stream_data, pts, dts, !delta);
+  }
 
   /* outgoing ts follows ts of PCR program stream */
   if (prog->pcr_stream == best->stream) {
@@ -1589,23 +1971,22 @@ write_fail:
   }
 no_program:
   {
-    if (buf)
-      gst_buffer_unref (buf);
+    gst_buffer_unref (buf);
     GST_ELEMENT_ERROR (mux, STREAM, MUX,
         ("Stream on pad %" GST_PTR_FORMAT
-            " is not associated with any program", COLLECT_DATA_PAD (best)),
+            " is not associated with any program", GST_PAD (best)),
         (NULL));
     return GST_FLOW_ERROR;
   }
 }
 
-static GstPad *
-mpegtsmux_request_new_pad (GstElement * element, GstPadTemplate * templ,
+static GstAggregatorPad *
+mpegtsmux_create_new_pad (GstAggregator * agg, GstPadTemplate * templ,
     const gchar * name, const GstCaps * caps)
 {
-  MpegTsMux *mux = GST_MPEG_TSMUX (element);
+  GstElement *element = GST_ELEMENT (agg);
   gint pid = -1;
-  GstPad *pad = NULL;
+  GstAggregatorPad *pad = NULL;
   MpegTsPadData *pad_data = NULL;
   gboolean is_meta = FALSE;
 
@@ -1617,52 +1998,27 @@ mpegtsmux_request_new_pad (GstElement * element, GstPadTemplate * templ,
     is_meta = FALSE;
   }
 
-  pad_data = (MpegTsPadData *)
-      gst_collect_pads_add_pad (mux->collect, pad, sizeof (MpegTsPadData),
-      (GstCollectDataDestroyNotify) (mpegtsmux_pad_reset), TRUE);
-  if (pad_data == NULL)
-    goto pad_failure;
-
-  if (is_meta) {
-    GST_COLLECT_PADS_STATE_UNSET (pad_data, GST_COLLECT_PADS_STATE_LOCKED);
-    gst_collect_pads_set_waiting (mux->collect, (GstCollectData *) pad_data,
-        FALSE);
-    GST_COLLECT_PADS_STATE_SET (pad_data, GST_COLLECT_PADS_STATE_LOCKED);
-  }
+  if (pad == NULL)
+    return NULL;
 
-  mpegtsmux_pad_reset (pad_data);
+  pad_data = GST_MPEG_TSMUX_PAD (pad);
   pad_data->pid = pid;
+  /* metadata only shows up on change, never hold the output back for it */
+  pad_data->sparse = is_meta;
 
-  if (G_UNLIKELY (!gst_element_add_pad (element, pad)))
-    goto could_not_add;
+  gst_pad_add_probe (GST_PAD (pad), GST_PAD_PROBE_TYPE_BUFFER,
+      mpegtsmux_sink_buffer_probe, NULL, NULL);
 
   return pad;
-
-  /* ERRORS */
-could_not_add:
-  {
-    GST_ELEMENT_ERROR (element, STREAM, FAILED,
-        ("Internal data stream error."), ("Could not add pad to element"));
-    gst_collect_pads_remove_pad (mux->collect, pad);
-    gst_object_unref (pad);
-    return NULL;
-  }
-pad_failure:
-  {
-    GST_ELEMENT_ERROR (element, STREAM, FAILED,
-        ("Internal data stream error."), ("Could not add pad to collectpads"));
-    gst_object_unref (pad);
-    return NULL;
-  }
 }
 
-static GstPad *
+static GstAggregatorPad *
 mpegtsmux_request_new_sink_pad (GstElement * element, GstPadTemplate * templ,
     const gchar * name, gint * pid)
 {
   MpegTsMux *mux = GST_MPEG_TSMUX (element);
   gchar *pad_name = NULL;
-  GstPad *pad = NULL;
+  GstAggregatorPad *pad = NULL;
 
   if (name != NULL && sscanf (name, "sink_%d", pid) == 1) {
     if (tsmux_find_stream (mux->tsmux, *pid))
@@ -1672,7 +2028,8 @@ mpegtsmux_request_new_sink_pad (GstElement * element, GstPadTemplate * templ,
   }
 
   pad_name = g_strdup_printf ("sink_%d", *pid);
-  pad = gst_pad_new_from_template (templ, pad_name);
+  pad = g_object_new (GST_TYPE_MPEG_TSMUX_PAD, "name", pad_name,
+      "direction", GST_PAD_SINK, "template", templ, NULL);
   g_free (pad_name);
 
   return pad;
@@ -1687,13 +2044,13 @@ stream_exists:
   }
 }
 
-static GstPad *
+static GstAggregatorPad *
 mpegtsmux_request_new_meta_pad (GstElement * element, GstPadTemplate * templ,
     const gchar * name, gint * pid)
 {
   MpegTsMux *mux = GST_MPEG_TSMUX (element);
   gchar *pad_name = NULL;
-  GstPad *pad = NULL;
+  GstAggregatorPad *pad = NULL;
 
   if (name != NULL && sscanf (name, "meta_%d", pid) == 1) {
     if (tsmux_find_stream (mux->tsmux, *pid))
@@ -1703,7 +2060,8 @@ mpegtsmux_request_new_meta_pad (GstElement * element, GstPadTemplate * templ,
   }
 
   pad_name = g_strdup_printf ("meta_%d", *pid);
-  pad = gst_pad_new_from_template (templ, pad_name);
+  pad = g_object_new (GST_TYPE_MPEG_TSMUX_PAD, "name", pad_name,
+      "direction", GST_PAD_SINK, "template", templ, NULL);
   g_free (pad_name);
 
   return pad;
@@ -1725,12 +2083,8 @@ mpegtsmux_release_pad (GstElement * element, GstPad * pad)
 
   GST_DEBUG_OBJECT (mux, "Pad %" GST_PTR_FORMAT " being released", pad);
 
-  if (mux->collect) {
-    gst_collect_pads_remove_pad (mux->collect, pad);
-  }
-
   /* chain up */
-  gst_element_remove_pad (element, pad);
+  GST_ELEMENT_CLASS (parent_class)->release_pad (element, pad);
 }
 
 static void
@@ -1784,6 +2138,9 @@ mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
   gint align = mux->alignment;
   gint av, packet_size;
 
+  if (!mux->m2ts_mode)
+    return mpegtsmux_push_chunks (mux, force);
+
   if (mux->m2ts_mode) {
     packet_size = M2TS_PACKET_LENGTH;
     if (align < 0)
@@ -1882,6 +2239,74 @@ mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
   return gst_pad_push_list (mux->srcpad, buffer_list);
 }
 
+/* Turns the packets written so far into a buffer of the pending list. The
+ * buffer wraps its part of the slab, which stays alive until the last
+ * buffer carved out of it is gone */
+static void
+mpegtsmux_finish_chunk (MpegTsMux * mux)
+{
+  GstBuffer *buf;
+  gsize size;
+
+  size = (gsize) mux->out_packets * NORMAL_TS_PACKET_LENGTH;
+  buf = gst_buffer_new_wrapped_full (0, mux->slab_data + mux->slab_offset,
+      size, 0, size, g_bytes_ref (mux->slab), (GDestroyNotify) g_bytes_unref);
+
+  GST_BUFFER_PTS (buf) = mux->out_pts;
+  GST_BUFFER_FLAG_SET (buf, mux->out_flags);
+
+  GST_LOG_OBJECT (mux, "finished chunk of %u packets", mux->out_packets);
+
+  if (!mux->out_list)
+    mux->out_list = gst_buffer_list_new ();
+  gst_buffer_list_add (mux->out_list, buf);
+
+  mux->slab_offset += size;
+  mux->out_packets = 0;
+}
+
+static GstFlowReturn
+mpegtsmux_push_chunks (MpegTsMux * mux, gboolean force)
+{
+  GstBufferList *buffer_list;
+  guint8 *data;
+
+  if (mux->out_packets > 0) {
+    if (mux->alignment <= 0) {
+      /* no alignment, push all available packets */
+      mpegtsmux_finish_chunk (mux);
+    } else if (force) {
+      GST_LOG_OBJECT (mux, "adding %u null packets",
+          mux->out_chunk_packets - mux->out_packets);
+
+      data = mux->slab_data + mux->slab_offset +
+          mux->out_packets * NORMAL_TS_PACKET_LENGTH;
+      for (; mux->out_packets < mux->out_chunk_packets; mux->out_packets++) {
+        GST_WRITE_UINT8 (data, TSMUX_SYNC_BYTE);
+        /* null packet PID */
+        GST_WRITE_UINT16_BE (data + 1, 0x1FFF);
+        /* no adaptation field exists | continuity counter undefined */
+        GST_WRITE_UINT8 (data + 3, 0x10);
+        /* payload */
+        memset (data + 4, 0, NORMAL_TS_PACKET_LENGTH - 4);
+        data += NORMAL_TS_PACKET_LENGTH;
+      }
+      mpegtsmux_finish_chunk (mux);
+    }
+  }
+
+  if (!mux->out_list)
+    return GST_FLOW_OK;
+
+  buffer_list = mux->out_list;
+  mux->out_list = NULL;
+
+  GST_LOG_OBJECT (mux, "pushing %u chunks",
+      gst_buffer_list_length (buffer_list));
+
+  return gst_pad_push_list (mux->srcpad, buffer_list);
+}
+
 static GstFlowReturn
 mpegtsmux_collect_packet (MpegTsMux * mux, GstBuffer * buf)
 {
@@ -2062,6 +2487,67 @@ alloc_packet_cb (GstBuffer ** _buf, void *user_data)
   *_buf = buf;
 }
 
+/* called when TsMux needs room for a new packet, hands out the next slot
+ * of the current output chunk */
+static guint8 *
+alloc_slab_packet_cb (void *user_data)
+{
+  MpegTsMux *mux = (MpegTsMux *) user_data;
+  gsize chunk_size, slab_size;
+
+  if (mux->out_packets == 0) {
+    mux->out_chunk_packets = mux->alignment > 0 ?
+        mux->alignment : MPEGTSMUX_DEFAULT_CHUNK_PACKETS;
+    chunk_size = (gsize) mux->out_chunk_packets * NORMAL_TS_PACKET_LENGTH;
+
+    /* a chunk never spans two slabs */
+    if (!mux->slab
+        || mux->slab_offset + chunk_size > g_bytes_get_size (mux->slab)) {
+      slab_size = MAX (MPEGTSMUX_SLAB_SIZE / chunk_size, 1) * chunk_size;
+
+      GST_LOG_OBJECT (mux, "next slab of %" G_GSIZE_FORMAT " bytes", slab_size);
+
+      if (mux->slab)
+        g_bytes_unref (mux->slab);
+      mux->slab = mpegtsmux_slab_pool_acquire (mux->slab_pool, slab_size);
+      mux->slab_data = (guint8 *) g_bytes_get_data (mux->slab, NULL);
+      mux->slab_offset = 0;
+    }
+  }
+
+  return mux->slab_data + mux->slab_offset +
+      mux->out_packets * NORMAL_TS_PACKET_LENGTH;
+}
+
+/* Called when the TsMux has written a packet in place */
+static gboolean
+new_slab_packet_cb (guint8 * packet, void *user_data, gint64 new_pcr)
+{
+  MpegTsMux *mux = (MpegTsMux *) user_data;
+
+  if (mux->out_packets == 0) {
+    mux->out_pts = mux->last_ts;
+    mux->out_flags = GST_BUFFER_FLAG_DELTA_UNIT;
+  }
+
+  /* streamheaders */
+  new_packet_common_init (mux, NULL, packet, NORMAL_TS_PACKET_LENGTH);
+
+  /* a chunk is as much a header or key unit as any of its packets */
+  if (mux->is_header)
+    mux->out_flags |= GST_BUFFER_FLAG_HEADER;
+  if (!mux->is_delta) {
+    GST_DEBUG_OBJECT (mux, "marking as non-delta unit");
+    mux->out_flags &= ~GST_BUFFER_FLAG_DELTA_UNIT;
+    mux->is_delta = TRUE;
+  }
+
+  if (++mux->out_packets == mux->out_chunk_packets)
+    mpegtsmux_finish_chunk (mux);
+
+  return TRUE;
+}
+
 static void
 mpegtsmux_set_header_on_caps (MpegTsMux * mux)
 {
@@ -2087,7 +2573,7 @@ mpegtsmux_set_header_on_caps (MpegTsMux * mux)
   }
 
   gst_structure_set_value (structure, "streamheader", &array);
-  gst_pad_set_caps (mux->srcpad, caps);
+  gst_aggregator_set_src_caps (GST_AGGREGATOR (mux), caps);
   g_value_unset (&array);
   gst_caps_unref (caps);
 }
@@ -2095,30 +2581,45 @@ mpegtsmux_set_header_on_caps (MpegTsMux * mux)
 static void
 mpegtsmux_prepare_srcpad (MpegTsMux * mux)
 {
-  GstSegment seg;
-  /* we are not going to seek */
-  GstEvent *new_seg;
-  gchar s_id[32];
-  GstCaps *caps = gst_caps_new_simple ("video/mpegts",
+  GstCaps *caps;
+
+  /* Usually negotiated already through update_src_caps */
+  if (gst_pad_has_current_caps (mux->srcpad))
+    return;
+
+  /* The aggregator sends stream-start, caps and a time segment */
+  caps = mpegtsmux_new_src_caps (mux);
+  gst_aggregator_set_src_caps (GST_AGGREGATOR (mux), caps);
+  gst_caps_unref (caps);
+}
+
+static GstCaps *
+mpegtsmux_new_src_caps (MpegTsMux * mux)
+{
+  return gst_caps_new_simple ("video/mpegts",
       "systemstream", G_TYPE_BOOLEAN, TRUE,
       "packetsize", G_TYPE_INT,
       (mux->m2ts_mode ? M2TS_PACKET_LENGTH : NORMAL_TS_PACKET_LENGTH),
       NULL);
+}
 
-  /* stream-start (FIXME: create id based on input ids) */
-  g_snprintf (s_id, sizeof (s_id), "mpegtsmux-%08x", g_random_int ());
-  gst_pad_push_event (mux->srcpad, gst_event_new_stream_start (s_id));
+static GstFlowReturn
+mpegtsmux_update_src_caps (GstAggregator * agg, GstCaps * caps,
+    GstCaps ** ret)
+{
+  MpegTsMux *mux = GST_MPEG_TSMUX (agg);
+  GstCaps *our_caps;
 
-  gst_segment_init (&seg, GST_FORMAT_TIME);
-  new_seg = gst_event_new_segment (&seg);
+  /* Keep the streamheader on renegotiation, the packet size is fixed by
+   * the m2ts-mode property */
+  our_caps = gst_pad_get_current_caps (agg->srcpad);
+  if (!our_caps)
+    our_caps = mpegtsmux_new_src_caps (mux);
 
-  /* Set caps on src pad from our template and push new segment */
-  gst_pad_set_caps (mux->srcpad, caps);
-  gst_caps_unref (caps);
+  *ret = gst_caps_intersect (our_caps, caps);
+  gst_caps_unref (our_caps);
 
-  if (!gst_pad_push_event (mux->srcpad, new_seg)) {
-    GST_WARNING_OBJECT (mux, "New segment event was not handled downstream");
-  }
+  return GST_FLOW_OK;
 }
 
 static GstStateChangeReturn
@@ -2131,12 +2632,10 @@ mpegtsmux_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_NULL_TO_READY:
       break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:
-      gst_collect_pads_start (mux->collect);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
-      gst_collect_pads_stop (mux->collect);
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
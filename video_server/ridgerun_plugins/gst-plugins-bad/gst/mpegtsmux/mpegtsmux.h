@@ -84,7 +84,7 @@
 #define __MPEGTSMUX_H__
 
 #include <gst/gst.h>
-#include <gst/base/gstcollectpads.h>
+#include <gst/base/gstaggregator.h>
 #include <gst/base/gstadapter.h>
 
 G_BEGIN_DECLS
@@ -94,6 +94,9 @@ G_BEGIN_DECLS
 #define GST_TYPE_MPEG_TSMUX  (mpegtsmux_get_type())
 #define GST_MPEG_TSMUX(obj)  (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_MPEG_TSMUX, MpegTsMux))
 
+#define GST_TYPE_MPEG_TSMUX_PAD  (mpegtsmux_pad_get_type())
+#define GST_MPEG_TSMUX_PAD(obj)  (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_MPEG_TSMUX_PAD, MpegTsPadData))
+
 #define CLOCK_BASE 9LL
 #define CLOCK_FREQ (CLOCK_BASE * 10000)   /* 90 kHz PTS clock */
 #define CLOCK_FREQ_SCR (CLOCK_FREQ * 300) /* 27 MHz SCR clock */
@@ -116,6 +119,8 @@ G_BEGIN_DECLS
 typedef struct MpegTsMux MpegTsMux;
 typedef struct MpegTsMuxClass MpegTsMuxClass;
 typedef struct MpegTsPadData MpegTsPadData;
+typedef struct MpegTsPadDataClass MpegTsPadDataClass;
+typedef struct MpegTsMuxSlabPool MpegTsMuxSlabPool;
 
 typedef GstBuffer * (*MpegTsPadDataPrepareFunction) (GstBuffer * buf,
     MpegTsPadData * data, MpegTsMux * mux);
@@ -123,12 +128,10 @@ typedef GstBuffer * (*MpegTsPadDataPrepareFunction) (GstBuffer * buf,
 typedef void (*MpegTsPadDataFreePrepareDataFunction) (gpointer prepare_data);
 
 struct MpegTsMux {
-  GstElement parent;
+  GstAggregator parent;
 
   GstPad *srcpad;
 
-  GstCollectPads *collect;
-
   TsMux *tsmux;
   GHashTable *programs;
 
@@ -164,6 +167,19 @@ struct MpegTsMux {
   GstAdapter *out_adapter;
   GstBuffer *out_buffer;
 
+  /* TS output, packets are written in place into a slab and pushed as
+   * chunks of alignment packets */
+  GBytes *slab;
+  guint8 *slab_data;
+  gsize slab_offset;
+  /* slabs released by downstream, for reuse */
+  MpegTsMuxSlabPool *slab_pool;
+  guint out_packets;
+  guint out_chunk_packets;
+  GstClockTime out_pts;
+  GstBufferFlags out_flags;
+  GstBufferList *out_list;
+
 #if 0
   /* SPN/PTS index handling */
   GstIndex *element_index;
@@ -172,12 +188,12 @@ struct MpegTsMux {
 };
 
 struct MpegTsMuxClass {
-  GstElementClass parent_class;
+  GstAggregatorClass parent_class;
 };
 
 struct MpegTsPadData {
   /* parent */
-  GstCollectData collect;
+  GstAggregatorPad parent;
 
   gint pid;
   TsMuxStream *stream;
@@ -207,9 +223,17 @@ struct MpegTsPadData {
   TsMuxProgram *prog;
 
   gchar *language;
+
+  /* sparse stream, like KLV metadata, it only gets a buffer now and then */
+  gboolean sparse;
+};
+
+struct MpegTsPadDataClass {
+  GstAggregatorPadClass parent_class;
 };
 
 GType mpegtsmux_get_type (void);
+GType mpegtsmux_pad_get_type (void);
 
 
 G_END_DECLS
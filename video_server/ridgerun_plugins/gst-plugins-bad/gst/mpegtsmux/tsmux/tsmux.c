@@ -193,6 +193,31 @@ tsmux_set_alloc_func (TsMux * mux, TsMuxAllocFunc func, void *user_data)
   mux->alloc_func_data = user_data;
 }
 
+/**
+ * tsmux_set_slab_funcs:
+ * @mux: a #TsMux
+ * @alloc_func: callback returning room for the next packet
+ * @write_func: callback called once the packet has been written
+ * @user_data: user data passed to both callbacks
+ *
+ * Make @mux write its packets in place instead of allocating a buffer for
+ * each of them. @alloc_func must return %TSMUX_PACKET_LENGTH writable bytes,
+ * usually the next free slot of a larger output chunk, and keep returning
+ * the same slot until @write_func has been called for it. When set these
+ * callbacks take precedence over the write and alloc functions.
+ */
+void
+tsmux_set_slab_funcs (TsMux * mux, TsMuxSlabAllocFunc alloc_func,
+    TsMuxSlabWriteFunc write_func, void *user_data)
+{
+  g_return_if_fail (mux != NULL);
+  g_return_if_fail ((alloc_func == NULL) == (write_func == NULL));
+
+  mux->slab_alloc_func = alloc_func;
+  mux->slab_write_func = write_func;
+  mux->slab_func_data = user_data;
+}
+
 /**
  * tsmux_set_pat_interval:
  * @mux: a #TsMux
@@ -890,6 +915,62 @@ tsmux_write_ts_header (guint8 * buf, TsMuxPacketInfo * pi,
   return TRUE;
 }
 
+/* Same as tsmux_section_write_packet, but the section is copied straight
+ * into the packets handed out by the slab alloc function */
+static gboolean
+tsmux_section_write_slab (TsMuxSection * section, TsMux * mux)
+{
+  guint8 *packet;
+  guint8 *data;
+  gsize data_size = 0;
+  gsize payload_written = 0;
+  guint len = 0, offset = 0, payload_len = 0;
+
+  /* Mark the start of new PES unit */
+  section->pi.packet_start_unit_indicator = TRUE;
+
+  data = gst_mpegts_section_packetize (section->section, &data_size);
+
+  if (!data) {
+    TS_DEBUG ("Could not packetize section");
+    return FALSE;
+  }
+
+  section->pi.stream_avail = data_size;
+
+  while (section->pi.stream_avail > 0) {
+    packet = mux->slab_alloc_func (mux->slab_func_data);
+    if (!packet)
+      return FALSE;
+
+    if (section->pi.packet_start_unit_indicator) {
+      /* Room for the pointer byte */
+      section->pi.stream_avail++;
+
+      if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
+        return FALSE;
+
+      packet[offset++] = 0x00;
+      payload_len = len - 1;
+    } else {
+      if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
+        return FALSE;
+      payload_len = len;
+    }
+
+    memcpy (packet + offset, data + payload_written, payload_len);
+
+    if (G_UNLIKELY (!mux->slab_write_func (packet, mux->slab_func_data, -1)))
+      return FALSE;
+
+    section->pi.stream_avail -= len;
+    payload_written += payload_len;
+    section->pi.packet_start_unit_indicator = FALSE;
+  }
+
+  return TRUE;
+}
+
 static gboolean
 tsmux_section_write_packet (GstMpegtsSectionType * type,
     TsMuxSection * section, TsMux * mux)
@@ -907,6 +988,9 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
   g_return_val_if_fail (section != NULL, FALSE);
   g_return_val_if_fail (mux != NULL, FALSE);
 
+  if (mux->slab_alloc_func)
+    return tsmux_section_write_slab (section, mux);
+
   /* Mark the start of new PES unit */
   section->pi.packet_start_unit_indicator = TRUE;
 
@@ -1138,6 +1222,24 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
   }
   pi->stream_avail = tsmux_stream_bytes_avail (stream);
 
+  /* write in place, no buffer for this packet */
+  if (mux->slab_alloc_func) {
+    guint8 *packet;
+
+    packet = mux->slab_alloc_func (mux->slab_func_data);
+    if (!packet
+        || !tsmux_write_ts_header (packet, pi, &payload_len, &payload_offs)
+        || !tsmux_stream_get_data (stream, packet + payload_offs, payload_len))
+      return FALSE;
+
+    res = mux->slab_write_func (packet, mux->slab_func_data, cur_pcr);
+
+    /* Reset all dynamic flags */
+    stream->pi.flags &= TSMUX_PACKET_FLAG_PES_FULL_HEADER;
+
+    return res;
+  }
+
   /* obtain buffer */
   if (!tsmux_get_buffer (mux, &buf))
     return FALSE;
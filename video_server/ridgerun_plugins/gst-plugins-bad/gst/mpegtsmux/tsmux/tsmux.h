@@ -102,6 +102,8 @@ typedef struct TsMux TsMux;
 
 typedef gboolean (*TsMuxWriteFunc) (GstBuffer * buf, void *user_data, gint64 new_pcr);
 typedef void (*TsMuxAllocFunc) (GstBuffer ** buf, void *user_data);
+typedef guint8 * (*TsMuxSlabAllocFunc) (void *user_data);
+typedef gboolean (*TsMuxSlabWriteFunc) (guint8 * packet, void *user_data, gint64 new_pcr);
 
 struct TsMuxSection {
   TsMuxPacketInfo pi;
@@ -175,6 +177,11 @@ struct TsMux {
   /* callback to alloc new packet buffer */
   TsMuxAllocFunc alloc_func;
   void *alloc_func_data;
+  /* callbacks to write packets in place into a larger output chunk,
+   * take precedence over write_func/alloc_func when set */
+  TsMuxSlabAllocFunc slab_alloc_func;
+  TsMuxSlabWriteFunc slab_write_func;
+  void *slab_func_data;
 
   /* scratch space for writing ES_info descriptors */
   guint8 es_info_buf[TSMUX_MAX_ES_INFO_LENGTH];
@@ -187,6 +194,8 @@ void 		tsmux_free 			(TsMux *mux);
 /* Setting muxing session properties */
 void 		tsmux_set_write_func 		(TsMux *mux, TsMuxWriteFunc func, void *user_data);
 void 		tsmux_set_alloc_func 		(TsMux *mux, TsMuxAllocFunc func, void *user_data);
+void 		tsmux_set_slab_funcs 		(TsMux *mux, TsMuxSlabAllocFunc alloc_func,
+						 TsMuxSlabWriteFunc write_func, void *user_data);
 void 		tsmux_set_pat_interval          (TsMux *mux, guint interval);
 guint 		tsmux_get_pat_interval          (TsMux *mux);
 void 		tsmux_resend_pat                (TsMux *mux);
@@ -92,6 +92,7 @@
 #define GST_CAT_DEFAULT mpegtsmux_debug
 
 static guint8 tsmux_stream_pes_header_length (TsMuxStream * stream);
+static void tsmux_stream_initialize_au_cell (TsMuxStream * stream);
 static void tsmux_stream_write_pes_header (TsMuxStream * stream, guint8 * data);
 static void tsmux_stream_find_pts_dts_within (TsMuxStream * stream, guint bound,
     gint64 * pts, gint64 * dts);
@@ -108,6 +109,11 @@ struct TsMuxStreamBuffer
   /* data represents random access point */
   gboolean random_access;
 
+  /* data is a metadata AU, see tsmux_stream_add_au_cell() */
+  gboolean au_cell;
+  guint8 au_service_id;
+  guint8 au_flags;
+
   /* user_data for release function */
   void *user_data;
 };
@@ -425,6 +431,8 @@ tsmux_stream_initialize_pes_packet (TsMuxStream * stream)
   if (stream->state != TSMUX_STREAM_STATE_HEADER)
     return TRUE;
 
+  stream->cur_au_cell = FALSE;
+
   if (stream->pes_payload_size != 0) {
     /* Use prescribed fixed PES payload size */
     stream->cur_pes_payload_size = stream->pes_payload_size;
@@ -455,6 +463,8 @@ tsmux_stream_initialize_pes_packet (TsMuxStream * stream)
       stream->pi.flags |= TSMUX_PACKET_FLAG_RANDOM_ACCESS;
       stream->pi.flags |= TSMUX_PACKET_FLAG_ADAPTATION;
     }
+    if (buf->au_cell)
+      tsmux_stream_initialize_au_cell (stream);
   }
 
   if (stream->is_video_stream) {
@@ -465,11 +475,66 @@ tsmux_stream_initialize_pes_packet (TsMuxStream * stream)
     /* Unbounded for video streams if pes packet length is over 16 bit */
     if ((stream->cur_pes_payload_size + hdr_len - 6) > G_MAXUINT16)
       stream->cur_pes_payload_size = 0;
+  } else if (!stream->cur_au_cell) {
+    guint8 hdr_len;
+
+    hdr_len = tsmux_stream_pes_header_length (stream);
+
+    /* Others can't be unbounded, the rest goes into the next PES packet */
+    if ((stream->cur_pes_payload_size + hdr_len - 6) > G_MAXUINT16)
+      stream->cur_pes_payload_size = G_MAXUINT16 - (hdr_len - 6);
   }
 
   return TRUE;
 }
 
+/* Limits the PES to a single AU cell of the head buffer, splitting it into
+ * fragments that fit the 16 bit PES_packet_length, and prepares the cell
+ * header that tsmux_stream_write_pes_header() puts in front of the data */
+static void
+tsmux_stream_initialize_au_cell (TsMuxStream * stream)
+{
+  TsMuxStreamBuffer *buf = (TsMuxStreamBuffer *) (stream->buffers->data);
+  guint32 consumed, remaining, max_len;
+  guint8 fragment;
+  guint8 *hdr;
+
+  consumed = stream->cur_buffer == buf ? stream->cur_buffer_consumed : 0;
+  remaining = buf->size - consumed;
+
+  /* Only the first fragment carries the timestamps of the AU */
+  if (consumed > 0) {
+    stream->pts = GST_CLOCK_STIME_NONE;
+    stream->dts = GST_CLOCK_STIME_NONE;
+    stream->pi.flags &= ~(TSMUX_PACKET_FLAG_PES_WRITE_PTS_DTS |
+        TSMUX_PACKET_FLAG_PES_WRITE_PTS);
+  }
+
+  stream->cur_au_cell = TRUE;
+  max_len = G_MAXUINT16 - (tsmux_stream_pes_header_length (stream) - 6);
+
+  if (remaining <= max_len) {
+    stream->cur_pes_payload_size = remaining;
+    fragment = consumed == 0 ? TSMUX_AU_CELL_FRAGMENT_COMPLETE :
+        TSMUX_AU_CELL_FRAGMENT_LAST;
+  } else {
+    stream->cur_pes_payload_size = max_len;
+    fragment = consumed == 0 ? TSMUX_AU_CELL_FRAGMENT_FIRST :
+        TSMUX_AU_CELL_FRAGMENT_MIDDLE;
+  }
+
+  /* The sequence number goes up with every cell, fragments included */
+  hdr = stream->au_cell_header;
+  hdr[0] = buf->au_service_id;
+  hdr[1] = stream->au_sequence_number++;
+  hdr[2] = fragment | (buf->au_flags & ~TSMUX_AU_CELL_FRAGMENT_MASK);
+  hdr[3] = (stream->cur_pes_payload_size >> 8) & 0xff;
+  hdr[4] = stream->cur_pes_payload_size & 0xff;
+
+  TS_DEBUG ("AU cell of %u bytes, %u left in AU, fragment 0x%02x",
+      stream->cur_pes_payload_size, remaining, fragment);
+}
+
 /**
  * tsmux_stream_get_data:
  * @stream: a #TsMuxStream
@@ -580,6 +645,10 @@ tsmux_stream_pes_header_length (TsMuxStream * stream)
     }
   }
 
+  /* The AU cell header is not part of the PES header but is written with it */
+  if (stream->cur_au_cell)
+    packet_len += TSMUX_AU_CELL_HEADER_LEN;
+
   return packet_len;
 }
 
@@ -624,6 +693,7 @@ tsmux_stream_write_pes_header (TsMuxStream * stream, guint8 * data)
   guint16 length_to_write;
   guint8 hdr_len = tsmux_stream_pes_header_length (stream);
   guint8 *orig_data = data;
+  guint8 au_len = stream->cur_au_cell ? TSMUX_AU_CELL_HEADER_LEN : 0;
 
   /* start_code prefix + stream_id + pes_packet_length = 6 bytes */
   data[0] = 0x00;
@@ -663,8 +733,8 @@ tsmux_stream_write_pes_header (TsMuxStream * stream, guint8 * data)
 
     /* Header length is the total pes length,
      * minus the 9 bytes of start codes, flags + hdr_len */
-    g_return_if_fail (hdr_len >= 9);
-    *data++ = (hdr_len - 9);
+    g_return_if_fail (hdr_len >= 9 + au_len);
+    *data++ = (hdr_len - 9 - au_len);
 
     if (stream->pi.flags & TSMUX_PACKET_FLAG_PES_WRITE_PTS_DTS) {
       tsmux_put_ts (&data, 0x3, stream->pts);
@@ -688,6 +758,9 @@ tsmux_stream_write_pes_header (TsMuxStream * stream, guint8 * data)
       while (data < orig_data + stream->pi.pes_header_length + 9)
         *data++ = 0xff;
   }
+
+  if (au_len)
+    memcpy (data, stream->au_cell_header, au_len);
 }
 
 /**
@@ -720,6 +793,7 @@ tsmux_stream_add_data (TsMuxStream * stream, guint8 * data, guint len,
   packet->size = len;
   packet->user_data = user_data;
   packet->random_access = random_access;
+  packet->au_cell = FALSE;
 
   packet->pts = pts;
   packet->dts = dts;
@@ -731,6 +805,47 @@ tsmux_stream_add_data (TsMuxStream * stream, guint8 * data, guint len,
   stream->buffers = g_list_append (stream->buffers, packet);
 }
 
+/**
+ * tsmux_stream_add_au_cell:
+ * @stream: a #TsMuxStream
+ * @data: metadata AU to add
+ * @len: length of @data
+ * @user_data: user data to pass to release func
+ * @pts: PTS of the AU in @data
+ * @dts: DTS of the AU in @data
+ * @service_id: metadata_service_id of the AU cells
+ * @sequence_number: sequence_number of the first AU cell
+ * @flags: decoder_config_flag and random_access_indicator of the AU cells
+ *
+ * Submit the metadata access unit in @data into @stream. Every PES packet
+ * carries an AU cell header in front of the data; an AU that is too large
+ * for a single PES packet is split into cell fragments.
+ *
+ * @sequence_number is only used for the first AU of the stream, the
+ * following cells are numbered by the stream itself.
+ */
+void
+tsmux_stream_add_au_cell (TsMuxStream * stream, guint8 * data, guint len,
+    void *user_data, gint64 pts, gint64 dts, guint8 service_id,
+    guint8 sequence_number, guint8 flags)
+{
+  TsMuxStreamBuffer *packet;
+
+  g_return_if_fail (stream != NULL);
+
+  tsmux_stream_add_data (stream, data, len, user_data, pts, dts, FALSE);
+
+  packet = (TsMuxStreamBuffer *) g_list_last (stream->buffers)->data;
+  packet->au_cell = TRUE;
+  packet->au_service_id = service_id;
+  packet->au_flags = flags;
+
+  if (!stream->au_sequence_valid) {
+    stream->au_sequence_number = sequence_number;
+    stream->au_sequence_valid = TRUE;
+  }
+}
+
 /**
  * tsmux_stream_get_es_descrs:
  * @stream: a #TsMuxStream
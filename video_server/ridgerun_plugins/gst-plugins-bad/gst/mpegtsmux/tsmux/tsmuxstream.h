@@ -152,6 +152,17 @@ enum TsMuxStreamType {
   TSMUX_ST_VIDEO_DIRAC                = 0xD1
 };
 
+/* Metadata AU cell header (13818-1 2.12.4): metadata_service_id,
+ * sequence_number, flags and AU_cell_data_length */
+#define TSMUX_AU_CELL_HEADER_LEN 5
+
+/* cell_fragment_indication, top 2 bits of the AU cell flags */
+#define TSMUX_AU_CELL_FRAGMENT_MASK     0xC0
+#define TSMUX_AU_CELL_FRAGMENT_COMPLETE 0xC0
+#define TSMUX_AU_CELL_FRAGMENT_FIRST    0x80
+#define TSMUX_AU_CELL_FRAGMENT_LAST     0x40
+#define TSMUX_AU_CELL_FRAGMENT_MIDDLE   0x00
+
 enum TsMuxStreamState {
     TSMUX_STREAM_STATE_HEADER,
     TSMUX_STREAM_STATE_PACKET
@@ -223,6 +234,13 @@ struct TsMuxStream {
   gboolean is_meta;
   gboolean is_audio;
 
+  /* Metadata AU cells, every PES carries one cell (fragment) whose header
+   * is written right after the PES header */
+  gboolean cur_au_cell;
+  guint8 au_cell_header[TSMUX_AU_CELL_HEADER_LEN];
+  guint8 au_sequence_number;
+  gboolean au_sequence_valid;
+
   /* Opus */
   gboolean is_opus;
   guint8 opus_channel_config_code;
@@ -252,6 +270,12 @@ void 		tsmux_stream_set_buffer_release_func 	(TsMuxStream *stream,
 void 		tsmux_stream_add_data 		(TsMuxStream *stream, guint8 *data, guint len,
        						 void *user_data, gint64 pts, gint64 dts,
                                                  gboolean random_access);
+/* Same as tsmux_stream_add_data, the data is written as one metadata AU
+ * cell, or as cell fragments if it does not fit a single PES packet */
+void 		tsmux_stream_add_au_cell	(TsMuxStream *stream, guint8 *data, guint len,
+       						 void *user_data, gint64 pts, gint64 dts,
+                                                 guint8 service_id, guint8 sequence_number,
+                                                 guint8 flags);
 
 void 		tsmux_stream_pcr_ref 		(TsMuxStream *stream);
 void 		tsmux_stream_pcr_unref  	(TsMuxStream *stream);
@@ -187,6 +187,8 @@ gst_h264_parse_reset_frame (GstH264Parse * h264parse)
 
   /* done parsing; reset state */
   h264parse->current_off = -1;
+  h264parse->scan_nal = -1;
+  h264parse->scan_off = 0;
 
   h264parse->picture_start = FALSE;
   h264parse->update_caps = FALSE;
@@ -199,6 +201,15 @@ gst_h264_parse_reset_frame (GstH264Parse * h264parse)
   gst_adapter_clear (h264parse->frame_out);
 }
 
+static void
+gst_h264_parse_clear_config_nals (GstH264Parse * h264parse)
+{
+  if (h264parse->config_nals) {
+    gst_memory_unref (h264parse->config_nals);
+    h264parse->config_nals = NULL;
+  }
+}
+
 static void
 gst_h264_parse_reset_stream_info (GstH264Parse * h264parse)
 {
@@ -236,6 +247,7 @@ gst_h264_parse_reset_stream_info (GstH264Parse * h264parse)
     gst_buffer_replace (&h264parse->sps_nals[i], NULL);
   for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++)
     gst_buffer_replace (&h264parse->pps_nals[i], NULL);
+  gst_h264_parse_clear_config_nals (h264parse);
 }
 
 static void
@@ -470,6 +482,15 @@ gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
     return;
   }
 
+  /* streams repeat their parameter sets, usually unchanged, in front of
+   * every keyframe; keep the stored copy and the serialised config then */
+  if (store[id] && gst_buffer_get_size (store[id]) == size &&
+      gst_buffer_memcmp (store[id], 0, nalu->data + nalu->offset,
+          size) == 0) {
+    GST_LOG_OBJECT (h264parse, "nal %u unchanged", id);
+    return;
+  }
+
   buf = gst_buffer_new_allocate (NULL, size, NULL);
   gst_buffer_fill (buf, 0, nalu->data + nalu->offset, size);
 
@@ -481,6 +502,9 @@ gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
     gst_buffer_unref (store[id]);
 
   store[id] = buf;
+
+  /* the parameter sets inserted into AUs have to be serialised again */
+  gst_h264_parse_clear_config_nals (h264parse);
 }
 
 #ifndef GST_DISABLE_GST_DEBUG
@@ -1051,6 +1075,61 @@ gst_h264_parse_handle_frame_packetized (GstBaseParse * parse,
   return ret;
 }
 
+/* Same as gst_h264_parser_identify_nalu(), but remembers how far the
+ * search for the end of the NAL starting at @offset got. A large NAL
+ * trickling in over many small buffers is then scanned only once, instead
+ * of from its start again every time a buffer is added. */
+static GstH264ParserResult
+gst_h264_parse_identify_nalu (GstH264Parse * h264parse, const guint8 * data,
+    guint offset, gsize size, GstH264NalUnit * nalu)
+{
+  GstH264NalParser *nalparser = h264parse->nalparser;
+  GstH264ParserResult pres;
+  GstH264NalUnit next;
+  guint scan_off, end;
+
+  pres = gst_h264_parser_identify_nalu_unchecked (nalparser, data, offset,
+      size, nalu);
+  if (pres != GST_H264_PARSER_OK)
+    return pres;
+
+  /* The two NALs are exactly 1 byte size and are placed at the end of an AU,
+   * there is no need to wait for the following */
+  if (nalu->type == GST_H264_NAL_SEQ_END ||
+      nalu->type == GST_H264_NAL_STREAM_END)
+    return GST_H264_PARSER_OK;
+
+  if (h264parse->scan_nal == (gint) offset
+      && h264parse->scan_off > nalu->offset)
+    scan_off = h264parse->scan_off;
+  else
+    scan_off = nalu->offset;
+  h264parse->scan_nal = offset;
+
+  /* only the position of the next start code is of interest here */
+  pres = gst_h264_parser_identify_nalu_unchecked (nalparser, data, scan_off,
+      size, &next);
+  if (pres == GST_H264_PARSER_NO_NAL || pres == GST_H264_PARSER_ERROR) {
+    /* the last 3 bytes could still be the start of a start code */
+    h264parse->scan_off = MAX (scan_off, size - 3);
+    GST_LOG_OBJECT (h264parse, "Nal start %u, no end found up to %u",
+        nalu->offset, h264parse->scan_off);
+    return GST_H264_PARSER_NO_NAL_END;
+  }
+
+  end = next.offset - 3;
+  h264parse->scan_off = end;
+
+  while (end > nalu->offset && data[end - 1] == 00)
+    end--;
+
+  nalu->size = end - nalu->offset;
+  if (nalu->size < 2)
+    return GST_H264_PARSER_BROKEN_DATA;
+
+  return GST_H264_PARSER_OK;
+}
+
 static GstFlowReturn
 gst_h264_parse_handle_frame (GstBaseParse * parse,
     GstBaseParseFrame * frame, gint * skipsize)
@@ -1154,7 +1233,7 @@ gst_h264_parse_handle_frame (GstBaseParse * parse,
 
   while (TRUE) {
     pres =
-        gst_h264_parser_identify_nalu (nalparser, data, current_off, size,
+        gst_h264_parse_identify_nalu (h264parse, data, current_off, size,
         &nalu);
 
     switch (pres) {
@@ -1273,6 +1352,12 @@ end:
 
   gst_h264_parse_parse_frame (parse, frame);
 
+  /* the input was already gathered into one buffer for parsing, hand out
+   * a view on it rather than having the base class copy it out again */
+  if (!frame->out_buffer)
+    frame->out_buffer = gst_buffer_copy_region (frame->buffer,
+        GST_BUFFER_COPY_ALL, 0, framesize);
+
   return gst_base_parse_finish_frame (parse, frame, framesize);
 
 more:
@@ -2169,12 +2254,13 @@ gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
     h264parse->discont = FALSE;
   }
 
-  /* replace with transformed AVC output if applicable */
+  /* replace with transformed AVC output if applicable, keeping the
+   * NALs as separate memories rather than merging them */
   av = gst_adapter_available (h264parse->frame_out);
   if (av) {
     GstBuffer *buf;
 
-    buf = gst_adapter_take_buffer (h264parse->frame_out, av);
+    buf = gst_adapter_take_buffer_fast (h264parse->frame_out, av);
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -2297,6 +2383,65 @@ gst_h264_parse_prepare_key_unit (GstH264Parse * parse, GstEvent * event)
   parse->push_codec = TRUE;
 }
 
+/* Serialises all stored SPS and PPS NALs in the output format into one
+ * memory, which is then shared by every AU they get inserted into. It is
+ * only rebuilt when a parameter set or the output format changed. */
+static GstMemory *
+gst_h264_parse_get_config_nals (GstH264Parse * h264parse)
+{
+  GstBuffer *codec_nal, *buf;
+  GstByteWriter bw;
+  const gboolean bs = h264parse->format == GST_H264_PARSE_FORMAT_BYTE;
+  const gint nls = 4 - h264parse->nal_length_size;
+  gboolean ok = TRUE;
+  gint i;
+
+  if (h264parse->config_nals &&
+      h264parse->config_nals_format == h264parse->format &&
+      h264parse->config_nals_nl == h264parse->nal_length_size)
+    return h264parse->config_nals;
+
+  gst_h264_parse_clear_config_nals (h264parse);
+
+  gst_byte_writer_init (&bw);
+  for (i = 0; i < GST_H264_MAX_SPS_COUNT + GST_H264_MAX_PPS_COUNT; i++) {
+    if (i < GST_H264_MAX_SPS_COUNT)
+      codec_nal = h264parse->sps_nals[i];
+    else
+      codec_nal = h264parse->pps_nals[i - GST_H264_MAX_SPS_COUNT];
+
+    if (codec_nal) {
+      gsize nal_size = gst_buffer_get_size (codec_nal);
+      if (bs) {
+        ok &= gst_byte_writer_put_uint32_be (&bw, 1);
+      } else {
+        ok &= gst_byte_writer_put_uint32_be (&bw, (nal_size << (nls * 8)));
+        ok &= gst_byte_writer_set_pos (&bw,
+            gst_byte_writer_get_pos (&bw) - nls);
+      }
+      ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+    }
+  }
+
+  if (G_UNLIKELY (!ok) || gst_byte_writer_get_size (&bw) == 0) {
+    if (!ok)
+      GST_ERROR_OBJECT (h264parse, "failed to serialise SPS/PPS");
+    gst_byte_writer_reset (&bw);
+    return NULL;
+  }
+
+  GST_DEBUG_OBJECT (h264parse, "serialised SPS/PPS, %u bytes",
+      gst_byte_writer_get_size (&bw));
+
+  buf = gst_byte_writer_reset_and_get_buffer (&bw);
+  h264parse->config_nals = gst_memory_ref (gst_buffer_peek_memory (buf, 0));
+  h264parse->config_nals_format = h264parse->format;
+  h264parse->config_nals_nl = h264parse->nal_length_size;
+  gst_buffer_unref (buf);
+
+  return h264parse->config_nals;
+}
+
 static gboolean
 gst_h264_parse_handle_sps_pps_nals (GstH264Parse * h264parse,
     GstBuffer * buffer, GstBaseParseFrame * frame)
@@ -2324,60 +2469,29 @@ gst_h264_parse_handle_sps_pps_nals (GstH264Parse * h264parse,
       }
     }
   } else {
-    /* insert config NALs into AU */
-    GstByteWriter bw;
+    /* insert config NALs into AU, sharing the serialised parameter sets */
+    GstMemory *config_nals;
     GstBuffer *new_buf;
-    const gboolean bs = h264parse->format == GST_H264_PARSE_FORMAT_BYTE;
-    const gint nls = 4 - h264parse->nal_length_size;
-    gboolean ok;
 
-    gst_byte_writer_init_with_size (&bw, gst_buffer_get_size (buffer), FALSE);
-    ok = gst_byte_writer_put_buffer (&bw, buffer, 0, h264parse->idr_pos);
     GST_DEBUG_OBJECT (h264parse, "- inserting SPS/PPS");
-    for (i = 0; i < GST_H264_MAX_SPS_COUNT; i++) {
-      if ((codec_nal = h264parse->sps_nals[i])) {
-        gsize nal_size = gst_buffer_get_size (codec_nal);
-        GST_DEBUG_OBJECT (h264parse, "inserting SPS nal");
-        if (bs) {
-          ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-        } else {
-          ok &= gst_byte_writer_put_uint32_be (&bw, (nal_size << (nls * 8)));
-          ok &= gst_byte_writer_set_pos (&bw,
-              gst_byte_writer_get_pos (&bw) - nls);
-        }
+    config_nals = gst_h264_parse_get_config_nals (h264parse);
 
-        ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
-        send_done = TRUE;
-      }
-    }
-    for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++) {
-      if ((codec_nal = h264parse->pps_nals[i])) {
-        gsize nal_size = gst_buffer_get_size (codec_nal);
-        GST_DEBUG_OBJECT (h264parse, "inserting PPS nal");
-        if (bs) {
-          ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-        } else {
-          ok &= gst_byte_writer_put_uint32_be (&bw, (nal_size << (nls * 8)));
-          ok &= gst_byte_writer_set_pos (&bw,
-              gst_byte_writer_get_pos (&bw) - nls);
-        }
-        ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
-        send_done = TRUE;
-      }
-    }
-    ok &= gst_byte_writer_put_buffer (&bw, buffer, h264parse->idr_pos, -1);
-    /* collect result and push */
-    new_buf = gst_byte_writer_reset_and_get_buffer (&bw);
+    new_buf = gst_buffer_new ();
     gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
+    if (h264parse->idr_pos > 0)
+      gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_MEMORY, 0,
+          h264parse->idr_pos);
+    if (config_nals) {
+      gst_buffer_append_memory (new_buf, gst_memory_ref (config_nals));
+      send_done = TRUE;
+    }
+    gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_MEMORY,
+        h264parse->idr_pos, -1);
     /* should already be keyframe/IDR, but it may not have been,
      * so mark it as such to avoid being discarded by picky decoder */
     GST_BUFFER_FLAG_UNSET (new_buf, GST_BUFFER_FLAG_DELTA_UNIT);
     gst_buffer_replace (&frame->out_buffer, new_buf);
     gst_buffer_unref (new_buf);
-    /* some result checking seems to make some compilers happy */
-    if (G_UNLIKELY (!ok)) {
-      GST_ERROR_OBJECT (h264parse, "failed to insert SPS/PPS");
-    }
   }
 
   return send_done;
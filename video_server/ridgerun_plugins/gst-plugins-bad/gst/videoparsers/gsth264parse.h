@@ -75,6 +75,9 @@ struct _GstH264Parse
   guint align;
   guint format;
   gint current_off;
+  /* how far the end of the NAL at scan_nal has been searched for */
+  gint scan_nal;
+  guint scan_off;
   /* True if input format and alignment match negotiated output */
   gboolean can_passthrough;
 
@@ -90,6 +93,10 @@ struct _GstH264Parse
   /* collected SPS and PPS NALUs */
   GstBuffer *sps_nals[GST_H264_MAX_SPS_COUNT];
   GstBuffer *pps_nals[GST_H264_MAX_PPS_COUNT];
+  /* the above serialised in the output format, for insertion into AUs */
+  GstMemory *config_nals;
+  guint config_nals_format;
+  guint config_nals_nl;
 
   /* Infos we need to keep track of */
   guint32 sei_cpb_removal_delay;
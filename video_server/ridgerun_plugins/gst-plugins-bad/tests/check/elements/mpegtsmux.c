@@ -39,6 +39,12 @@ static GstStaticPadTemplate audio_src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_STATIC_CAPS ("audio/mpeg")
     );
 
+static GstStaticPadTemplate klv_src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("meta/x-klv")
+    );
+
 /* For ease of programming we use globals to keep refs for our floating
  * src and sink pads we create; otherwise we always have to do get_pad,
  * get_peer, and then remove references in every test function */
@@ -54,6 +60,10 @@ static GstPad *mysrcpad, *mysinkpad;
                           "alignment = (string) nal, " \
                           "parsed = (boolean) true "
 
+#define KLV_CAPS_STRING "meta/x-klv, " \
+                        "parsed = (boolean) true, " \
+                        "stream_type = (int) 21 "
+
 #define KEYFRAME_DISTANCE 10
 
 typedef void (CheckOutputBuffersFunc) (GList * buffers);
@@ -75,14 +85,14 @@ setup_src_pad (GstElement * element,
     sinkpad = gst_element_get_request_pad (element, sinkname);
   fail_if (sinkpad == NULL, "Could not get sink pad from %s",
       GST_ELEMENT_NAME (element));
-  /* references are owned by: 1) us, 2) tsmux, 3) collect pads */
-  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 3);
+  /* references are owned by: 1) us, 2) tsmux */
+  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 2);
   fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK,
       "Could not link source and %s sink pads", GST_ELEMENT_NAME (element));
   gst_object_unref (sinkpad);   /* because we got it higher up */
 
-  /* references are owned by: 1) tsmux, 2) collect pads */
-  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 2);
+  /* references are owned by: 1) tsmux */
+  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 1);
 
   if (padname)
     *padname = g_strdup (GST_PAD_NAME (sinkpad));
@@ -98,16 +108,16 @@ teardown_src_pad (GstElement * element, const gchar * sinkname)
   /* clean up floating src pad */
   if (!(sinkpad = gst_element_get_static_pad (element, sinkname)))
     sinkpad = gst_element_get_request_pad (element, sinkname);
-  /* pad refs held by 1) tsmux 2) collectpads and 3) us (through _get) */
-  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 3);
+  /* pad refs held by 1) tsmux and 2) us (through _get) */
+  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 2);
   srcpad = gst_pad_get_peer (sinkpad);
 
   gst_pad_unlink (srcpad, sinkpad);
   GST_DEBUG ("src %p", srcpad);
 
   /* after unlinking, pad refs still held by
-   * 1) tsmux and 2) collectpads and 3) us (through _get) */
-  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 3);
+   * 1) tsmux and 2) us (through _get) */
+  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 2);
   gst_object_unref (sinkpad);
   /* one more ref is held by element itself */
 
@@ -147,6 +157,22 @@ cleanup_tsmux (GstElement * mux, const gchar * sinkname)
   gst_check_teardown_element (mux);
 }
 
+static gboolean have_eos = FALSE;
+
+static gboolean
+eos_event_func (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    g_mutex_lock (&check_mutex);
+    have_eos = TRUE;
+    g_cond_signal (&check_cond);
+    g_mutex_unlock (&check_mutex);
+  }
+
+  gst_event_unref (event);
+  return TRUE;
+}
+
 static void
 check_tsmux_pad (GstStaticPadTemplate * srctemplate,
     const gchar * src_caps_string, gint pes_id, gint pmt_id,
@@ -163,6 +189,8 @@ check_tsmux_pad (GstStaticPadTemplate * srctemplate,
   gchar *padname;
 
   mux = setup_tsmux (srctemplate, sinkname, &padname);
+  gst_pad_set_event_function (mysinkpad, eos_event_func);
+  have_eos = FALSE;
 
   if (alignment != 0)
     g_object_set (mux, "alignment", alignment, NULL);
@@ -200,6 +228,13 @@ check_tsmux_pad (GstStaticPadTemplate * srctemplate,
     ts += 40 * GST_MSECOND;
   }
 
+  /* muxing happens in the aggregator thread, drain it */
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+  g_mutex_lock (&check_mutex);
+  while (!have_eos)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
   if (check_func)
     check_func (buffers);
 
@@ -398,13 +433,31 @@ sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
   TestData *data = (TestData *) gst_pad_get_element_private (pad);
 
-  if (event->type == GST_EVENT_CUSTOM_DOWNSTREAM)
+  if (event->type == GST_EVENT_CUSTOM_DOWNSTREAM) {
+    g_mutex_lock (&check_mutex);
     data->sink_event = event;
+    g_cond_signal (&check_cond);
+    g_mutex_unlock (&check_mutex);
+  }
 
   gst_event_unref (event);
   return TRUE;
 }
 
+/* The event is pushed from the aggregator thread */
+static void
+wait_for_sink_event (TestData * data)
+{
+  gint64 end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+
+  g_mutex_lock (&check_mutex);
+  while (data->sink_event == NULL) {
+    if (!g_cond_wait_until (&check_cond, &check_mutex, end_time))
+      break;
+  }
+  g_mutex_unlock (&check_mutex);
+}
+
 static void
 link_sinks (GstElement * mpegtsmux,
     GstPad ** src1, GstPad ** src2, GstPad ** src3, TestData * test_data)
@@ -546,6 +599,7 @@ GST_START_TEST (test_force_key_unit_event_downstream)
   thread_data_4 = pad_push (src1, gst_buffer_new (), 4 * GST_SECOND);
 
   g_thread_join (thread_data_2->thread);
+  wait_for_sink_event (&test_data);
   fail_unless (test_data.sink_event != NULL);
 
   gst_element_set_state (mpegtsmux, GST_STATE_NULL);
@@ -620,6 +674,7 @@ GST_START_TEST (test_force_key_unit_event_upstream)
   thread_data_4 = pad_push (src1, gst_buffer_new (), 4 * GST_SECOND);
 
   g_thread_join (thread_data_2->thread);
+  wait_for_sink_event (&test_data);
   fail_unless (test_data.sink_event != NULL);
 
   gst_element_set_state (mpegtsmux, GST_STATE_NULL);
@@ -642,6 +697,7 @@ GST_START_TEST (test_force_key_unit_event_upstream)
 GST_END_TEST;
 
 static GstFlowReturn expected_flow;
+static gboolean have_chained = FALSE;
 
 static GstFlowReturn
 flow_test_stat_chain_func (GstPad * pad, GstObject * parent, GstBuffer * buffer)
@@ -650,51 +706,84 @@ flow_test_stat_chain_func (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 
   GST_INFO ("returning flow %s (%d)", gst_flow_get_name (expected_flow),
       expected_flow);
+
+  g_mutex_lock (&check_mutex);
+  have_chained = TRUE;
+  g_cond_signal (&check_cond);
+  g_mutex_unlock (&check_mutex);
+
   return expected_flow;
 }
 
+/* Waits up to 5 seconds for the aggregator thread to push something to
+ * flow_test_stat_chain_func() */
+static gboolean
+wait_for_chain (void)
+{
+  gint64 end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+  gboolean res;
+
+  g_mutex_lock (&check_mutex);
+  while (!have_chained) {
+    if (!g_cond_wait_until (&check_cond, &check_mutex, end_time))
+      break;
+  }
+  res = have_chained;
+  g_mutex_unlock (&check_mutex);
+
+  return res;
+}
+
 GST_START_TEST (test_propagate_flow_status)
 {
   GstElement *mux;
   gchar *padname;
   GstBuffer *inbuffer;
   GstCaps *caps;
-  guint i;
+  guint i, j;
 
   GstFlowReturn expected[] = { GST_FLOW_OK, GST_FLOW_FLUSHING, GST_FLOW_EOS,
     GST_FLOW_NOT_NEGOTIATED, GST_FLOW_ERROR, GST_FLOW_NOT_SUPPORTED
   };
 
-  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
-  gst_pad_set_chain_function (mysinkpad, flow_test_stat_chain_func);
-
-  fail_unless (gst_element_set_state (mux,
-          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
-      "could not set to playing");
+  for (i = 0; i < G_N_ELEMENTS (expected); ++i) {
+    GstFlowReturn res = GST_FLOW_OK;
 
-  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
-  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
-  gst_caps_unref (caps);
+    /* The aggregator returns the downstream flow on a later push and then
+     * stays in that state, so every flow gets its own muxer */
+    mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+    gst_pad_set_chain_function (mysinkpad, flow_test_stat_chain_func);
+    have_chained = FALSE;
 
-  for (i = 0; i < G_N_ELEMENTS (expected); ++i) {
-    GstFlowReturn res;
+    fail_unless (gst_element_set_state (mux,
+            GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+        "could not set to playing");
 
-    inbuffer = gst_buffer_new_and_alloc (1);
-    ASSERT_BUFFER_REFCOUNT (inbuffer, "inbuffer", 1);
+    caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+    gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+    gst_caps_unref (caps);
 
     expected_flow = expected[i];
     GST_INFO ("expecting flow %s (%d)", gst_flow_get_name (expected_flow),
         expected_flow);
 
-    GST_BUFFER_TIMESTAMP (inbuffer) = i * GST_SECOND;
+    for (j = 0; j < 100 && res == GST_FLOW_OK; ++j) {
+      inbuffer = gst_buffer_new_and_alloc (1);
+      ASSERT_BUFFER_REFCOUNT (inbuffer, "inbuffer", 1);
+      GST_BUFFER_TIMESTAMP (inbuffer) = j * GST_SECOND;
 
-    res = gst_pad_push (mysrcpad, inbuffer);
+      res = gst_pad_push (mysrcpad, inbuffer);
+      /* Once downstream returned the flow, the aggregator flushes its sink
+       * pads with it and one of the next pushes fails */
+      if (res == GST_FLOW_OK && expected_flow != GST_FLOW_OK)
+        fail_unless (wait_for_chain (), "nothing was pushed downstream");
+    }
 
     fail_unless_equals_int (res, expected[i]);
-  }
 
-  cleanup_tsmux (mux, padname);
-  g_free (padname);
+    cleanup_tsmux (mux, padname);
+    g_free (padname);
+  }
 }
 
 GST_END_TEST;
@@ -803,6 +892,207 @@ GST_START_TEST (test_keyframe_flag_propagation)
 
 GST_END_TEST;
 
+GST_START_TEST (test_klv_au_cell_split)
+{
+  GstElement *mux;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  GstMapInfo map;
+  GList *l;
+  gchar *padname;
+  guint cells = 0, total = 0, size = 100000;
+  guint8 fragments[4];
+  guint8 sequence[4];
+
+  mux = setup_tsmux (&klv_src_template, "meta_%d", &padname);
+  gst_pad_set_event_function (mysinkpad, eos_event_func);
+  have_eos = FALSE;
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (KLV_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* too big for a single PES packet */
+  inbuffer = gst_buffer_new_and_alloc (size);
+  gst_buffer_memset (inbuffer, 0, 0xAB, size);
+  GST_BUFFER_PTS (inbuffer) = 0;
+  fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+  g_mutex_lock (&check_mutex);
+  while (!have_eos)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  for (l = buffers; l; l = l->next) {
+    guint8 *data;
+    gsize left;
+
+    gst_buffer_map (GST_BUFFER (l->data), &map, GST_MAP_READ);
+    for (data = map.data, left = map.size; left >= 188; data += 188,
+        left -= 188) {
+      guint8 *pes = data + 4;
+
+      fail_unless (data[0] == 0x47);
+      /* payload_unit_start_indicator */
+      if (!(data[1] & 0x40))
+        continue;
+      if (data[3] & 0x20)
+        pes += 1 + data[4];
+
+      /* metadata PES, the AU cell header follows the PES header */
+      if (GST_READ_UINT32_BE (pes) != 0x000001FC)
+        continue;
+      pes += 9 + pes[8];
+
+      fail_unless (cells < G_N_ELEMENTS (fragments));
+      sequence[cells] = pes[1];
+      fragments[cells] = pes[2] & 0xC0;
+      total += GST_READ_UINT16_BE (pes + 3);
+      cells++;
+    }
+    gst_buffer_unmap (GST_BUFFER (l->data), &map);
+  }
+
+  fail_unless_equals_int (cells, 2);
+  fail_unless_equals_int (total, size);
+  fail_unless_equals_int (fragments[0], 0x80);
+  fail_unless_equals_int (fragments[1], 0x40);
+  fail_unless_equals_int ((guint8) (sequence[0] + 1), sequence[1]);
+
+  gst_check_drop_buffers ();
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
+/* Waits up to 5 seconds for the muxer to output something */
+static gboolean
+wait_for_output (void)
+{
+  gint64 end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+  gboolean res;
+
+  g_mutex_lock (&check_mutex);
+  while (buffers == NULL) {
+    if (!g_cond_wait_until (&check_cond, &check_mutex, end_time))
+      break;
+  }
+  res = (buffers != NULL);
+  g_mutex_unlock (&check_mutex);
+
+  return res;
+}
+
+static gboolean
+live_query_func (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_LATENCY) {
+    gst_query_set_latency (query, TRUE, 0, GST_CLOCK_TIME_NONE);
+    return TRUE;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+static GstBuffer *
+create_video_buffer (GstClockTime pts)
+{
+  GstBuffer *buf = gst_buffer_new_and_alloc (1000);
+
+  gst_buffer_memset (buf, 0, 0x42, 1000);
+  GST_BUFFER_PTS (buf) = pts;
+  GST_BUFFER_DTS (buf) = pts;
+
+  return buf;
+}
+
+/* Muxes video on one pad while a second pad, created from other_template
+ * on other_sinkname, never gets any data */
+static void
+check_empty_pad_does_not_block (GstStaticPadTemplate * other_template,
+    const gchar * other_caps_string, const gchar * other_sinkname,
+    gboolean live)
+{
+  GstElement *mux;
+  GstPad *othersrcpad;
+  GstCaps *caps;
+  GstClock *clock = NULL;
+  gchar *padname, *otherpadname;
+  guint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  othersrcpad = setup_src_pad (mux, other_template, other_sinkname,
+      &otherpadname);
+
+  if (live) {
+    gst_pad_set_query_function (mysrcpad, live_query_func);
+    gst_pad_set_query_function (othersrcpad, live_query_func);
+
+    clock = gst_system_clock_obtain ();
+    gst_element_set_clock (mux, clock);
+    gst_element_set_start_time (mux, GST_CLOCK_TIME_NONE);
+    gst_element_set_base_time (mux, gst_clock_get_time (clock));
+  }
+  gst_pad_set_active (othersrcpad, TRUE);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events_with_stream_id (mysrcpad, mux, caps,
+      GST_FORMAT_TIME, "video");
+  gst_caps_unref (caps);
+  caps = gst_caps_from_string (other_caps_string);
+  gst_check_setup_events_with_stream_id (othersrcpad, mux, caps,
+      GST_FORMAT_TIME, "other");
+  gst_caps_unref (caps);
+
+  for (i = 0; i < 3; i++) {
+    fail_unless (gst_pad_push (mysrcpad,
+            create_video_buffer (i * 40 * GST_MSECOND)) == GST_FLOW_OK);
+  }
+
+  fail_unless (wait_for_output (), "no output while %s is empty",
+      otherpadname);
+
+  gst_element_set_state (mux, GST_STATE_NULL);
+  gst_pad_set_active (othersrcpad, FALSE);
+  teardown_src_pad (mux, otherpadname);
+  gst_check_drop_buffers ();
+  cleanup_tsmux (mux, padname);
+  g_free (otherpadname);
+  g_free (padname);
+  if (clock)
+    gst_object_unref (clock);
+}
+
+/* A KLV pad that never sees any metadata must not stall the video, also
+ * when the pipeline is not live and the muxer doesn't time out pads */
+GST_START_TEST (test_silent_klv_pad)
+{
+  check_empty_pad_does_not_block (&klv_src_template, KLV_CAPS_STRING,
+      "meta_%d", FALSE);
+}
+
+GST_END_TEST;
+
+/* In a live pipeline the muxer stops waiting for an empty audio pad once
+ * the deadline of the queued video has passed */
+GST_START_TEST (test_live_deadline)
+{
+  check_empty_pad_does_not_block (&audio_src_template, AUDIO_CAPS_STRING,
+      "sink_%d", TRUE);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegtsmux_suite (void)
 {
@@ -819,6 +1109,9 @@ mpegtsmux_suite (void)
   tcase_add_test (tc_chain, test_multiple_state_change);
   tcase_add_test (tc_chain, test_align);
   tcase_add_test (tc_chain, test_keyframe_flag_propagation);
+  tcase_add_test (tc_chain, test_klv_au_cell_split);
+  tcase_add_test (tc_chain, test_silent_klv_pad);
+  tcase_add_test (tc_chain, test_live_deadline);
 
   return s;
 }
@@ -0,0 +1,184 @@
+/* GStreamer
+ *
+ * unit test for tsparse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstharness.h>
+#include <gst/check/gstcheck.h>
+#include <string.h>
+
+#define TS_PACKET_SIZE 188
+
+#define PMT_PID 0x1000
+#define PCR_PID 0x100
+#define VIDEO_PID 0x101
+#define AUDIO_PID 0x102
+
+static guint32
+mpegts_crc32 (const guint8 * data, guint len)
+{
+  guint32 crc = 0xffffffff;
+  guint i, j;
+
+  for (i = 0; i < len; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+static void
+write_header (guint8 * packet, guint16 pid, gboolean start, guint8 afc,
+    guint8 cc)
+{
+  memset (packet, 0xff, TS_PACKET_SIZE);
+  packet[0] = 0x47;
+  packet[1] = (start ? 0x40 : 0x00) | (pid >> 8);
+  packet[2] = pid & 0xff;
+  packet[3] = (afc << 4) | (cc & 0x0f);
+}
+
+static void
+write_section (guint8 * packet, guint16 pid, const guint8 * section,
+    guint len, guint8 cc)
+{
+  write_header (packet, pid, TRUE, 0x1, cc);
+  packet[4] = 0;
+  memcpy (packet + 5, section, len);
+  GST_WRITE_UINT32_BE (packet + 5 + len, mpegts_crc32 (section, len));
+}
+
+/* PAT, PMT, a PCR only packet on its own PID and a payload packet for
+ * each of the two streams of the program */
+static GstBuffer *
+create_stream (guint repeat)
+{
+  static const guint8 pat[] = {
+    0x00, 0xb0, 13, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0 | (PMT_PID >> 8), PMT_PID & 0xff
+  };
+  static const guint8 pmt[] = {
+    0x02, 0xb0, 23, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0xe0 | (PCR_PID >> 8), PCR_PID & 0xff, 0xf0, 0x00,
+    0x1b, 0xe0 | (VIDEO_PID >> 8), VIDEO_PID & 0xff, 0xf0, 0x00,
+    0x0f, 0xe0 | (AUDIO_PID >> 8), AUDIO_PID & 0xff, 0xf0, 0x00
+  };
+  guint8 *data, *packet;
+  guint i;
+
+  data = g_malloc (repeat * 5 * TS_PACKET_SIZE);
+  for (i = 0, packet = data; i < repeat; i++) {
+    write_section (packet, 0, pat, sizeof (pat), i);
+    packet += TS_PACKET_SIZE;
+    write_section (packet, PMT_PID, pmt, sizeof (pmt), i);
+    packet += TS_PACKET_SIZE;
+
+    /* adaptation field only, with a PCR of i * 10ms */
+    write_header (packet, PCR_PID, FALSE, 0x2, 0);
+    packet[4] = 183;
+    packet[5] = 0x10;
+    GST_WRITE_UINT32_BE (packet + 6, (i * 900) >> 1);
+    packet[10] = ((i * 900) & 1) << 7 | 0x7e;
+    packet[11] = 0x00;
+    packet += TS_PACKET_SIZE;
+
+    write_header (packet, VIDEO_PID, FALSE, 0x1, i);
+    packet += TS_PACKET_SIZE;
+    write_header (packet, AUDIO_PID, FALSE, 0x1, i);
+    packet += TS_PACKET_SIZE;
+  }
+
+  return gst_buffer_new_wrapped (data, repeat * 5 * TS_PACKET_SIZE);
+}
+
+static void
+collect_pids (GstHarness * h, gboolean * seen)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  gsize i;
+
+  while ((buf = gst_harness_try_pull (h))) {
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+    fail_unless_equals_int (map.size % TS_PACKET_SIZE, 0);
+    for (i = 0; i < map.size; i += TS_PACKET_SIZE) {
+      fail_unless_equals_int (map.data[i], 0x47);
+      seen[GST_READ_UINT16_BE (map.data + i + 1) & 0x1fff] = TRUE;
+    }
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+}
+
+GST_START_TEST (test_pid_filter)
+{
+  GstHarness *h = gst_harness_new ("tsparse");
+  GValue filter = G_VALUE_INIT;
+  GValue pid = G_VALUE_INIT;
+  gboolean *seen = g_new0 (gboolean, 0x2000);
+
+  g_value_init (&filter, GST_TYPE_ARRAY);
+  g_value_init (&pid, G_TYPE_INT);
+  g_value_set_int (&pid, VIDEO_PID);
+  gst_value_array_append_value (&filter, &pid);
+  g_object_set_property (G_OBJECT (h->element), "pid-filter", &filter);
+  g_value_unset (&pid);
+  g_value_unset (&filter);
+
+  gst_harness_set_src_caps_str (h,
+      "video/mpegts, systemstream=(boolean)true, packetsize=(int)188");
+
+  /* the first buffer announces the program, the second one is filtered
+   * knowing about its PMT and PCR PIDs */
+  fail_unless_equals_int (gst_harness_push (h, create_stream (4)),
+      GST_FLOW_OK);
+  collect_pids (h, seen);
+  memset (seen, 0, 0x2000 * sizeof (gboolean));
+
+  fail_unless_equals_int (gst_harness_push (h, create_stream (4)),
+      GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+  collect_pids (h, seen);
+
+  fail_unless (seen[0x0000]);
+  fail_unless (seen[PMT_PID]);
+  fail_unless (seen[PCR_PID]);
+  fail_unless (seen[VIDEO_PID]);
+  fail_if (seen[AUDIO_PID]);
+
+  g_free (seen);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+mpegtsparse_suite (void)
+{
+  Suite *s = suite_create ("mpegtsparse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_pid_filter);
+
+  return s;
+}
+
+GST_CHECK_MAIN (mpegtsparse)
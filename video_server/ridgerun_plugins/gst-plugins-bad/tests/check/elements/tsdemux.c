@@ -0,0 +1,262 @@
+/* GStreamer
+ *
+ * unit test for tsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <string.h>
+
+#define TS_PACKET_SIZE 188
+
+#define PMT_PID 0x1000
+#define VIDEO_PID 0x101
+
+/* PES header with a PTS, followed by the payload in the same packet */
+#define PES_HEADER_SIZE 14
+#define PES_PAYLOAD_SIZE (TS_PACKET_SIZE - 4 - PES_HEADER_SIZE)
+
+/* Enough PES for the stream to go through several slabs */
+#define NUM_PES 2000
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/mpegts, systemstream = (boolean) true, "
+        "packetsize = (int) 188"));
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstPad *mysrcpad, *mysinkpad;
+
+/* output buffers pushed so far, and which of them are kept alive */
+static guint n_output;
+static GstBuffer *held[4];
+
+static guint32
+mpegts_crc32 (const guint8 * data, guint len)
+{
+  guint32 crc = 0xffffffff;
+  guint i, j;
+
+  for (i = 0; i < len; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+static void
+write_section (guint8 * packet, guint16 pid, const guint8 * section,
+    guint len)
+{
+  memset (packet, 0xff, TS_PACKET_SIZE);
+  packet[0] = 0x47;
+  packet[1] = 0x40 | (pid >> 8);
+  packet[2] = pid & 0xff;
+  packet[3] = 0x10;
+  packet[4] = 0;
+  memcpy (packet + 5, section, len);
+  GST_WRITE_UINT32_BE (packet + 5 + len, mpegts_crc32 (section, len));
+}
+
+static void
+fill_payload (guint8 * data, guint index)
+{
+  GST_WRITE_UINT32_BE (data, index);
+  memset (data + 4, index & 0xff, PES_PAYLOAD_SIZE - 4);
+}
+
+static void
+check_payload (GstBuffer * buffer, guint index)
+{
+  guint8 expected[PES_PAYLOAD_SIZE];
+
+  fill_payload (expected, index);
+  fail_unless_equals_int (gst_buffer_get_size (buffer), PES_PAYLOAD_SIZE);
+  fail_unless (gst_buffer_memcmp (buffer, 0, expected, PES_PAYLOAD_SIZE) == 0,
+      "PES %u has wrong contents", index);
+}
+
+/* A PES of a MPEG-2 video stream without PCR per TS packet */
+static GstBuffer *
+create_pes_packets (guint first, guint n)
+{
+  guint8 *data, *packet;
+  guint i;
+
+  data = g_malloc (n * TS_PACKET_SIZE);
+  for (i = 0, packet = data; i < n; i++, packet += TS_PACKET_SIZE) {
+    guint64 pts = (first + i) * 3000;
+
+    packet[0] = 0x47;
+    packet[1] = 0x40 | (VIDEO_PID >> 8);
+    packet[2] = VIDEO_PID & 0xff;
+    packet[3] = 0x10 | ((first + i) & 0x0f);
+
+    packet[4] = 0x00;
+    packet[5] = 0x00;
+    packet[6] = 0x01;
+    packet[7] = 0xe0;
+    GST_WRITE_UINT16_BE (packet + 8, 3 + 5 + PES_PAYLOAD_SIZE);
+    packet[10] = 0x80;
+    packet[11] = 0x80;
+    packet[12] = 5;
+    packet[13] = 0x21 | ((pts >> 29) & 0x0e);
+    GST_WRITE_UINT16_BE (packet + 14, ((pts >> 14) & 0xfffe) | 1);
+    GST_WRITE_UINT16_BE (packet + 16, ((pts << 1) & 0xfffe) | 1);
+    fill_payload (packet + 4 + PES_HEADER_SIZE, first + i);
+  }
+
+  return gst_buffer_new_wrapped (data, n * TS_PACKET_SIZE);
+}
+
+static GstBuffer *
+create_program (void)
+{
+  static const guint8 pat[] = {
+    0x00, 0xb0, 13, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0 | (PMT_PID >> 8), PMT_PID & 0xff
+  };
+  static const guint8 pmt[] = {
+    0x02, 0xb0, 18, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0xff, 0xff, 0xf0, 0x00,
+    0x02, 0xe0 | (VIDEO_PID >> 8), VIDEO_PID & 0xff, 0xf0, 0x00
+  };
+  guint8 *data = g_malloc (2 * TS_PACKET_SIZE);
+
+  write_section (data, 0, pat, sizeof (pat));
+  write_section (data + TS_PACKET_SIZE, PMT_PID, pmt, sizeof (pmt));
+
+  return gst_buffer_new_wrapped (data, 2 * TS_PACKET_SIZE);
+}
+
+static GstFlowReturn
+sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  guint i;
+
+  check_payload (buffer, n_output);
+
+  /* keep a few buffers from the start for the whole stream, as a sink
+   * showing a still frame would */
+  for (i = 0; i < G_N_ELEMENTS (held); i++) {
+    if (n_output == i * 10) {
+      held[i] = buffer;
+      buffer = NULL;
+      break;
+    }
+  }
+  if (buffer)
+    gst_buffer_unref (buffer);
+  n_output++;
+
+  return GST_FLOW_OK;
+}
+
+static void
+pad_added_cb (GstElement * demux, GstPad * pad, gpointer user_data)
+{
+  fail_unless (mysinkpad == NULL);
+
+  mysinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
+  gst_pad_set_chain_function (mysinkpad, sink_chain);
+  gst_pad_set_active (mysinkpad, TRUE);
+  fail_unless_equals_int (gst_pad_link (pad, mysinkpad), GST_PAD_LINK_OK);
+}
+
+static void
+run_demux (gboolean pes_arena)
+{
+  GstElement *demux;
+  GstCaps *caps;
+  guint i;
+
+  n_output = 0;
+  memset (held, 0, sizeof (held));
+  mysinkpad = NULL;
+
+  demux = gst_check_setup_element ("tsdemux");
+  g_object_set (demux, "pes-arena", pes_arena, NULL);
+  g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added_cb), NULL);
+  mysrcpad = gst_check_setup_src_pad (demux, &src_template);
+  gst_pad_set_active (mysrcpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (demux, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_pad_get_pad_template_caps (mysrcpad);
+  gst_check_setup_events (mysrcpad, demux, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, create_program ()),
+      GST_FLOW_OK);
+  for (i = 0; i < NUM_PES; i += 100) {
+    fail_unless_equals_int (gst_pad_push (mysrcpad,
+            create_pes_packets (i, 100)), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  fail_unless (mysinkpad != NULL);
+  fail_unless_equals_int (n_output, NUM_PES);
+
+  /* what downstream kept must not have been written over since */
+  for (i = 0; i < G_N_ELEMENTS (held); i++) {
+    fail_unless (held[i] != NULL);
+    check_payload (held[i], i * 10);
+    gst_buffer_unref (held[i]);
+  }
+
+  gst_element_set_state (demux, GST_STATE_NULL);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_object_unref (mysinkpad);
+  gst_check_teardown_src_pad (demux);
+  gst_check_teardown_element (demux);
+}
+
+GST_START_TEST (test_pes_output)
+{
+  run_demux (FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pes_arena)
+{
+  run_demux (TRUE);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsdemux_suite (void)
+{
+  Suite *s = suite_create ("tsdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_pes_output);
+  tcase_add_test (tc_chain, test_pes_arena);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsdemux)
@@ -0,0 +1,182 @@
+/* GStreamer
+ *
+ * scan-start-codes.c: measures the start code scanning speed of the
+ * H.264, H.265 and MPEG video parsers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Builds a synthetic Annex-B stream of random NAL units (with emulation
+ * prevention applied) and splits it into NAL units over and over with
+ * the public parser API, reporting the throughput in GB/s.
+ *
+ * Usage: scan-start-codes [megabytes] [nal size] [iterations]
+ *        (defaults to 64 MB of 100000 byte NAL units, 20 iterations)
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
+#include <gst/codecparsers/gstmpegvideoparser.h>
+
+static guint8 *
+make_stream (gsize size, guint nal_size, const guint8 * header,
+    guint header_size)
+{
+  guint8 *data = g_malloc (size);
+  gsize i = 0, nal_end;
+
+  while (i < size) {
+    memcpy (data + i, "\x00\x00\x00\x01", MIN (4, size - i));
+    i += 4;
+    if (i + header_size <= size)
+      memcpy (data + i, header, header_size);
+    i += header_size;
+
+    nal_end = MIN (i + nal_size, size);
+    for (; i < nal_end; i++) {
+      /* Mostly non zero bytes, as in entropy coded data */
+      data[i] = g_random_int_range (0, 8) ? g_random_int_range (1, 256) : 0;
+      /* emulation prevention */
+      if (i >= 2 && data[i - 2] == 0 && data[i - 1] == 0 && data[i] <= 3)
+        data[i] = 3;
+    }
+  }
+
+  return data;
+}
+
+static void
+report (const gchar * name, gsize size, guint iterations, guint64 n_nals,
+    gint64 elapsed)
+{
+  g_print ("%-10s %" G_GUINT64_FORMAT " NAL units in %.3f s: %.2f GB/s\n",
+      name, n_nals, elapsed / 1e6,
+      (gdouble) size * iterations / (elapsed * 1e3));
+}
+
+static void
+bench_h264 (const guint8 * data, gsize size, guint iterations)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  GstH264NalUnit nalu;
+  GstH264ParserResult res;
+  guint64 n_nals = 0;
+  gint64 start;
+  guint offset, i;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++) {
+    offset = 0;
+    do {
+      res = gst_h264_parser_identify_nalu (parser, data, offset, size, &nalu);
+      offset = nalu.offset + nalu.size;
+      n_nals++;
+    } while (res == GST_H264_PARSER_OK);
+  }
+  report ("h264", size, iterations, n_nals, g_get_monotonic_time () - start);
+
+  gst_h264_nal_parser_free (parser);
+}
+
+static void
+bench_h265 (const guint8 * data, gsize size, guint iterations)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265NalUnit nalu;
+  GstH265ParserResult res;
+  guint64 n_nals = 0;
+  gint64 start;
+  guint offset, i;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++) {
+    offset = 0;
+    do {
+      res = gst_h265_parser_identify_nalu (parser, data, offset, size, &nalu);
+      offset = nalu.offset + nalu.size;
+      n_nals++;
+    } while (res == GST_H265_PARSER_OK);
+  }
+  report ("h265", size, iterations, n_nals, g_get_monotonic_time () - start);
+
+  gst_h265_parser_free (parser);
+}
+
+static void
+bench_mpegvideo (const guint8 * data, gsize size, guint iterations)
+{
+  GstMpegVideoPacket packet;
+  guint64 n_nals = 0;
+  gint64 start;
+  guint offset, i;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++) {
+    offset = 0;
+    while (gst_mpeg_video_parse (&packet, data, size, offset)) {
+      n_nals++;
+      if (packet.size < 0)
+        break;
+      offset = packet.offset + packet.size;
+    }
+  }
+  report ("mpegvideo", size, iterations, n_nals,
+      g_get_monotonic_time () - start);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  /* non-IDR slice, TRAIL_R slice and slice start codes */
+  static const guint8 h264_header[] = { 0x41 };
+  static const guint8 h265_header[] = { 0x02, 0x01 };
+  static const guint8 mpeg_header[] = { 0x01 };
+  guint8 *data;
+  gsize size = 64;
+  guint nal_size = 100000, iterations = 20;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    size = atoi (argv[1]);
+  if (argc > 2)
+    nal_size = atoi (argv[2]);
+  if (argc > 3)
+    iterations = atoi (argv[3]);
+  size *= 1024 * 1024;
+
+  data = make_stream (size, nal_size, h264_header, sizeof (h264_header));
+  bench_h264 (data, size, iterations);
+  g_free (data);
+
+  data = make_stream (size, nal_size, h265_header, sizeof (h265_header));
+  bench_h265 (data, size, iterations);
+  g_free (data);
+
+  /* MPEG video start codes are 3 bytes, the leading zero is padding */
+  data = make_stream (size, nal_size, mpeg_header, sizeof (mpeg_header));
+  bench_mpegvideo (data, size, iterations);
+  g_free (data);
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+/* GStreamer
+ *
+ * tsmux-benchmark.c: measures the cost of muxing a stream with mpegtsmux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Pushes a fixed size H.264 access unit at the given bitrate through
+ * mpegtsmux as fast as possible and reports the CPU time spent and the
+ * amount of buffers handed downstream per second of stream.
+ *
+ * Usage: tsmux-benchmark [seconds] [kbps] [alignment]
+ *        (defaults to 600 seconds of a 20000 kbps 30 fps stream, auto
+ *        alignment)
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <gst/gst.h>
+
+#define FRAMERATE 30
+
+static guint64 n_buffers;
+static guint64 n_lists;
+
+static GstPadProbeReturn
+count_buffers (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    n_buffers += gst_buffer_list_length (GST_PAD_PROBE_INFO_BUFFER_LIST (info));
+    n_lists++;
+  } else {
+    n_buffers++;
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static gdouble
+cpu_time (void)
+{
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+      usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GstElement *pipeline, *sink;
+  GstMessage *msg;
+  GstPad *pad;
+  GError *error = NULL;
+  gchar *desc;
+  guint seconds = 600, kbps = 20000;
+  gint alignment = -1;
+  guint frame_size;
+  gint64 start, elapsed;
+  gdouble cpu;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    seconds = atoi (argv[1]);
+  if (argc > 2)
+    kbps = atoi (argv[2]);
+  if (argc > 3)
+    alignment = atoi (argv[3]);
+
+  frame_size = kbps * 1000 / 8 / FRAMERATE;
+
+  desc = g_strdup_printf ("fakesrc num-buffers=%u sizetype=fixed "
+      "sizemax=%u filltype=zero datarate=%u ! "
+      "video/x-h264,stream-format=byte-stream,alignment=au ! "
+      "mpegtsmux alignment=%d ! fakesink name=sink sync=false",
+      seconds * FRAMERATE, frame_size, frame_size * FRAMERATE, alignment);
+  pipeline = gst_parse_launch (desc, &error);
+  g_free (desc);
+
+  if (!pipeline) {
+    g_print ("Unable to create pipeline: %s\n", error->message);
+    g_clear_error (&error);
+    return -1;
+  }
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      count_buffers, NULL, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (sink);
+
+  cpu = cpu_time ();
+  start = g_get_monotonic_time ();
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+  elapsed = g_get_monotonic_time () - start;
+  cpu = cpu_time () - cpu;
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_print ("Pipeline failed\n");
+
+  g_print ("%u s of %u kbps muxed in %.3f s (%.3f s CPU): "
+      "%.1f x realtime, %.1f %% of a core per stream\n", seconds, kbps,
+      elapsed / 1e6, cpu, seconds / cpu, 100.0 * cpu / seconds);
+  g_print ("%" G_GUINT64_FORMAT " buffers in %" G_GUINT64_FORMAT
+      " lists: %.0f buffers per stream second\n", n_buffers, n_lists,
+      (gdouble) n_buffers / seconds);
+
+  gst_message_unref (msg);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return 0;
+}
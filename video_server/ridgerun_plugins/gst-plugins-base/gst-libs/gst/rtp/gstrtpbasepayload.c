@@ -36,6 +36,18 @@ GST_DEBUG_CATEGORY_STATIC (rtpbasepayload_debug);
 #define GST_RTP_BASE_PAYLOAD_GET_PRIVATE(obj)  \
    (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_RTP_BASE_PAYLOAD, GstRTPBasePayloadPrivate))
 
+/* The headers of the packets pushed with
+ * gst_rtp_base_payload_push_fragmented() are carved out of blocks like this
+ * one, each header memory holds a ref on its block */
+typedef struct
+{
+  volatile gint ref_count;
+  gsize size;
+  guint8 *data;
+} HeaderBlock;
+
+#define HEADER_BLOCK_MIN_SIZE 4096
+
 struct _GstRTPBasePayloadPrivate
 {
   gboolean ts_offset_random;
@@ -62,6 +74,9 @@ struct _GstRTPBasePayloadPrivate
 
   GstCaps *subclass_srccaps;
   GstCaps *sinkcaps;
+
+  HeaderBlock *header_block;
+  gsize header_offset;
 };
 
 /* RTPBasePayload signals and args */
@@ -358,6 +373,36 @@ gst_rtp_base_payload_init (GstRTPBasePayload * rtpbasepayload, gpointer g_class)
   rtpbasepayload->priv->prop_max_ptime = DEFAULT_MAX_PTIME;
 }
 
+static HeaderBlock *
+header_block_new (gsize size)
+{
+  HeaderBlock *block;
+
+  block = g_slice_new (HeaderBlock);
+  block->ref_count = 1;
+  block->size = size;
+  block->data = g_malloc (size);
+
+  return block;
+}
+
+static HeaderBlock *
+header_block_ref (HeaderBlock * block)
+{
+  g_atomic_int_inc (&block->ref_count);
+
+  return block;
+}
+
+static void
+header_block_unref (HeaderBlock * block)
+{
+  if (g_atomic_int_dec_and_test (&block->ref_count)) {
+    g_free (block->data);
+    g_slice_free (HeaderBlock, block);
+  }
+}
+
 static void
 gst_rtp_base_payload_finalize (GObject * object)
 {
@@ -373,6 +418,9 @@ gst_rtp_base_payload_finalize (GObject * object)
   gst_caps_replace (&rtpbasepayload->priv->subclass_srccaps, NULL);
   gst_caps_replace (&rtpbasepayload->priv->sinkcaps, NULL);
 
+  if (rtpbasepayload->priv->header_block)
+    header_block_unref (rtpbasepayload->priv->header_block);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -1312,6 +1360,155 @@ gst_rtp_base_payload_push_list (GstRTPBasePayload * payload,
   return res;
 }
 
+/* Returns room for @size bytes of headers in the current header block. The
+ * block is rewound once all packets carved out of it have been released
+ * downstream, so that in steady state no new blocks are allocated. */
+static guint8 *
+gst_rtp_base_payload_alloc_headers (GstRTPBasePayload * payload, gsize size)
+{
+  GstRTPBasePayloadPrivate *priv = payload->priv;
+  guint8 *data;
+
+  if (priv->header_block && g_atomic_int_get (&priv->header_block->ref_count)
+      == 1)
+    priv->header_offset = 0;
+
+  if (!priv->header_block
+      || priv->header_offset + size > priv->header_block->size) {
+    if (priv->header_block)
+      header_block_unref (priv->header_block);
+    priv->header_block = header_block_new (MAX (HEADER_BLOCK_MIN_SIZE, size));
+    priv->header_offset = 0;
+  }
+
+  data = priv->header_block->data + priv->header_offset;
+  priv->header_offset += size;
+
+  return data;
+}
+
+/**
+ * gst_rtp_base_payload_push_fragmented:
+ * @payload: a #GstRTPBasePayload
+ * @buffer: (transfer full): a #GstBuffer with the data of one access unit
+ * @offset: offset in @buffer of the first byte to payload
+ * @header_len: number of bytes of payload specific header in each packet
+ * @fragment_size: maximum number of bytes of @buffer in each packet, or 0
+ *     to fill the packets up to the MTU
+ * @func: (scope call) (allow-none): function filling in the payload
+ *     specific header of each packet
+ * @user_data: user data passed to @func
+ *
+ * Splits the data of @buffer from @offset on into as few packets as
+ * possible and pushes them as one #GstBufferList, with the marker bit set
+ * on the last packet.
+ *
+ * The RTP header and the @header_len bytes of payload specific header of
+ * every packet are carved out of one block of memory that is reused once
+ * downstream released the packets, and the payload refers to the memory of
+ * @buffer without copying it. This makes payloading an access unit cost
+ * far fewer allocations than allocating each packet separately.
+ *
+ * This function takes ownership of @buffer.
+ *
+ * Returns: a #GstFlowReturn.
+ *
+ * Since: 1.16
+ */
+GstFlowReturn
+gst_rtp_base_payload_push_fragmented (GstRTPBasePayload * payload,
+    GstBuffer * buffer, guint offset, guint header_len, guint fragment_size,
+    GstRTPBasePayloadFragmentFunc func, gpointer user_data)
+{
+  GstRTPBasePayloadPrivate *priv;
+  GstBufferList *list;
+  GstBuffer *outbuf;
+  GstMemory *mem;
+  guint8 *headers, *header;
+  gsize size, stride;
+  guint n_fragments, i, len;
+
+  g_return_val_if_fail (GST_IS_RTP_BASE_PAYLOAD (payload), GST_FLOW_ERROR);
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), GST_FLOW_ERROR);
+
+  priv = payload->priv;
+
+  size = gst_buffer_get_size (buffer);
+  if (G_UNLIKELY (offset > size))
+    goto invalid_offset;
+
+  if (fragment_size == 0) {
+    len = gst_rtp_buffer_calc_payload_len (payload->mtu, 0, 0);
+    if (G_UNLIKELY (len <= header_len))
+      goto mtu_too_small;
+    fragment_size = len - header_len;
+  }
+
+  size -= offset;
+  n_fragments = size ? (size + fragment_size - 1) / fragment_size : 1;
+
+  GST_LOG_OBJECT (payload, "payloading %" G_GSIZE_FORMAT " bytes in %u "
+      "packets", size, n_fragments);
+
+  stride = GST_ROUND_UP_4 (GST_RTP_HEADER_LEN + header_len);
+  headers = gst_rtp_base_payload_alloc_headers (payload, n_fragments * stride);
+
+  list = gst_buffer_list_new_sized (n_fragments);
+  for (i = 0; i < n_fragments; i++) {
+    header = headers + i * stride;
+
+    /* version 2 without padding, extension and CSRCs, the marker bit ends
+     * the access unit. The rest is filled in when pushing */
+    memset (header, 0, GST_RTP_HEADER_LEN + header_len);
+    header[0] = GST_RTP_VERSION << 6;
+    if (i == n_fragments - 1)
+      header[1] = 0x80;
+
+    if (func)
+      func (payload, header + GST_RTP_HEADER_LEN, i, n_fragments, user_data);
+
+    mem = gst_memory_new_wrapped (0, header, stride, 0,
+        GST_RTP_HEADER_LEN + header_len, header_block_ref (priv->header_block),
+        (GDestroyNotify) header_block_unref);
+
+    outbuf = gst_buffer_new ();
+    gst_buffer_append_memory (outbuf, mem);
+
+    len = MIN (fragment_size, size);
+    if (len > 0)
+      gst_buffer_copy_into (outbuf, buffer, GST_BUFFER_COPY_MEMORY, offset,
+          len);
+    offset += len;
+    size -= len;
+
+    GST_BUFFER_PTS (outbuf) = GST_BUFFER_PTS (buffer);
+    GST_BUFFER_DTS (outbuf) = GST_BUFFER_DTS (buffer);
+    GST_BUFFER_OFFSET (outbuf) = GST_BUFFER_OFFSET (buffer);
+
+    gst_buffer_list_add (list, outbuf);
+  }
+  gst_buffer_unref (buffer);
+
+  return gst_rtp_base_payload_push_list (payload, list);
+
+  /* ERRORS */
+invalid_offset:
+  {
+    GST_ERROR_OBJECT (payload, "offset %u beyond buffer of %" G_GSIZE_FORMAT
+        " bytes", offset, size);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_ERROR;
+  }
+mtu_too_small:
+  {
+    GST_ELEMENT_ERROR (payload, STREAM, FAILED, (NULL),
+        ("MTU %u too small for %u bytes of payload header", payload->mtu,
+            header_len));
+    gst_buffer_unref (buffer);
+    return GST_FLOW_ERROR;
+  }
+}
+
 /**
  * gst_rtp_base_payload_push:
  * @payload: a #GstRTPBasePayload
@@ -112,6 +112,24 @@ struct _GstRTPBasePayload
   gpointer _gst_reserved[GST_PADDING];
 };
 
+/**
+ * GstRTPBasePayloadFragmentFunc:
+ * @payload: a #GstRTPBasePayload
+ * @header: the payload specific header of the packet to fill in
+ * @index: index of the packet in the access unit
+ * @n_fragments: number of packets of the access unit
+ * @user_data: user data passed to gst_rtp_base_payload_push_fragmented()
+ *
+ * Fills in the payload specific header of a packet made by
+ * gst_rtp_base_payload_push_fragmented().
+ *
+ * Since: 1.16
+ */
+typedef void (*GstRTPBasePayloadFragmentFunc) (GstRTPBasePayload *payload,
+                                               guint8 *header, guint index,
+                                               guint n_fragments,
+                                               gpointer user_data);
+
 /**
  * GstRTPBasePayloadClass:
  * @parent_class: the parent class
@@ -172,6 +190,15 @@ GST_RTP_API
 GstFlowReturn   gst_rtp_base_payload_push_list          (GstRTPBasePayload *payload,
                                                          GstBufferList *list);
 
+GST_RTP_API
+GstFlowReturn   gst_rtp_base_payload_push_fragmented    (GstRTPBasePayload *payload,
+                                                         GstBuffer *buffer,
+                                                         guint offset,
+                                                         guint header_len,
+                                                         guint fragment_size,
+                                                         GstRTPBasePayloadFragmentFunc func,
+                                                         gpointer user_data);
+
 #ifdef G_DEFINE_AUTOPTR_CLEANUP_FUNC
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GstRTPBasePayload, gst_object_unref)
 #endif
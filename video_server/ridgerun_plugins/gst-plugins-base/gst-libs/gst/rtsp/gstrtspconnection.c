@@ -170,6 +170,11 @@ struct _GstRTSPConnection
 
   gchar *proxy_host;
   guint proxy_port;
+
+  /* Send batching and backlog limits applied by watches */
+  gsize batch_bytes;
+  gsize backlog_bytes;
+  GstClockTime backlog_time;
 };
 
 enum
@@ -323,6 +328,10 @@ gst_rtsp_connection_create (const GstRTSPUrl * url, GstRTSPConnection ** conn)
 
   newconn->remember_session_id = TRUE;
 
+  newconn->batch_bytes = 0;
+  newconn->backlog_bytes = 0;
+  newconn->backlog_time = 0;
+
   newconn->auth_method = GST_RTSP_AUTH_NONE;
   newconn->username = NULL;
   newconn->passwd = NULL;
@@ -1204,6 +1213,96 @@ error:
   }
 }
 
+/* Write @vectors to @conn without blocking, with a single sendmsg() when
+ * the connection is a plain socket. @vectors is modified to skip the data
+ * that was written and @bytes_written is updated even when this fails.
+ * Returns #GST_RTSP_EINTR when the socket can't take all of the data. */
+static GstRTSPResult
+writev_bytes (GstRTSPConnection * conn, GOutputVector * vectors,
+    guint n_vectors, gsize * bytes_written)
+{
+#ifdef MSG_DONTWAIT
+  struct msghdr msg;
+  struct iovec *iov;
+  gssize r;
+  gint fd;
+#endif
+  guint i;
+
+  *bytes_written = 0;
+
+#ifdef MSG_DONTWAIT
+  /* the socket is in blocking mode and GSocket would wait for it to become
+   * writable again, so use the fd directly */
+  if (G_IS_SOCKET_CONNECTION (conn->stream0) &&
+      conn->output_stream == g_io_stream_get_output_stream (conn->stream0)) {
+    fd = g_socket_get_fd (conn->write_socket);
+    iov = g_newa (struct iovec, n_vectors);
+
+    while (n_vectors) {
+      for (i = 0; i < n_vectors; i++) {
+        iov[i].iov_base = (gpointer) vectors[i].buffer;
+        iov[i].iov_len = vectors[i].size;
+      }
+      memset (&msg, 0, sizeof (msg));
+      msg.msg_iov = iov;
+      msg.msg_iovlen = n_vectors;
+
+      do {
+        r = sendmsg (fd, &msg, MSG_DONTWAIT | SEND_FLAGS);
+      } while (r < 0 && errno == EINTR);
+
+      if (G_UNLIKELY (r <= 0))
+        goto error;
+
+      *bytes_written += r;
+
+      while (n_vectors && (gsize) r >= vectors->size) {
+        r -= vectors->size;
+        vectors++;
+        n_vectors--;
+      }
+      if (n_vectors) {
+        vectors->buffer = (const guint8 *) vectors->buffer + r;
+        vectors->size -= r;
+      }
+    }
+    return GST_RTSP_OK;
+  }
+#endif
+
+  /* TLS has to go through its own stream, write one vector at a time */
+  for (i = 0; i < n_vectors; i++) {
+    GstRTSPResult res;
+    guint idx = 0;
+
+    res = write_bytes (conn->output_stream, vectors[i].buffer, &idx,
+        vectors[i].size, FALSE, conn->cancellable);
+    *bytes_written += idx;
+    if (res != GST_RTSP_OK)
+      return res;
+  }
+  return GST_RTSP_OK;
+
+#ifdef MSG_DONTWAIT
+  /* ERRORS */
+error:
+  {
+    gint errsv = errno;
+
+    if (G_UNLIKELY (r == 0))
+      return GST_RTSP_EEOF;
+
+    /* the rest stays queued until the socket is writable again */
+    if (errsv == EAGAIN || errsv == EWOULDBLOCK)
+      return GST_RTSP_EINTR;
+
+    GST_DEBUG ("sendmsg failed: %s", g_strerror (errsv));
+    return GST_RTSP_ESYS;
+  }
+#endif
+}
+
 static gint
 fill_raw_bytes (GstRTSPConnection * conn, guint8 * buffer, guint size,
     gboolean block, GError ** err)
@@ -3133,17 +3232,115 @@ gst_rtsp_connection_get_remember_session_id (GstRTSPConnection * conn)
   return conn->remember_session_id;
 }
 
+/**
+ * gst_rtsp_connection_set_send_batch:
+ * @conn: a #GstRTSPConnection
+ * @bytes: the batch size in bytes, 0 to disable batching
+ *
+ * Make the #GstRTSPWatch of @conn hold back interleaved RTP data until a
+ * complete frame, or @bytes of it, is available and then write all of it
+ * with a single vectored write. A frame is complete when a packet has the
+ * marker bit set or when a packet with a different RTP timestamp shows up.
+ * Anything else that is sent, including RTCP, flushes the held data too.
+ * Data is never held for longer than 10 milliseconds, so the last packets
+ * of a stream without marker bits still go out.
+ *
+ * The default value is 0.
+ *
+ * Since: 1.16
+ */
+void
+gst_rtsp_connection_set_send_batch (GstRTSPConnection * conn, gsize bytes)
+{
+  g_return_if_fail (conn != NULL);
+
+  conn->batch_bytes = bytes;
+}
+
+/**
+ * gst_rtsp_connection_get_send_batch:
+ * @conn: a #GstRTSPConnection
+ *
+ * Get the batch size set with gst_rtsp_connection_set_send_batch().
+ *
+ * Returns: the batch size in bytes, 0 when batching is disabled.
+ *
+ * Since: 1.16
+ */
+gsize
+gst_rtsp_connection_get_send_batch (GstRTSPConnection * conn)
+{
+  g_return_val_if_fail (conn != NULL, 0);
+
+  return conn->batch_bytes;
+}
+
+/**
+ * gst_rtsp_connection_set_send_backlog:
+ * @conn: a #GstRTSPConnection
+ * @bytes: maximum bytes
+ * @time: maximum age of the oldest queued message
+ *
+ * Set limits for the data queued in any #GstRTSPWatch of @conn, on top of
+ * the ones set with gst_rtsp_watch_set_send_backlog(). Once @bytes are
+ * queued or the oldest queued message waited for @time,
+ * gst_rtsp_watch_write_data() and gst_rtsp_watch_send_message() will return
+ * #GST_RTSP_ENOMEM.
+ *
+ * A value of 0 for @bytes or @time means no limits.
+ *
+ * Since: 1.16
+ */
+void
+gst_rtsp_connection_set_send_backlog (GstRTSPConnection * conn, gsize bytes,
+    GstClockTime time)
+{
+  g_return_if_fail (conn != NULL);
+
+  conn->backlog_bytes = bytes;
+  conn->backlog_time = time;
+}
+
+/**
+ * gst_rtsp_connection_get_send_backlog:
+ * @conn: a #GstRTSPConnection
+ * @bytes: (out) (allow-none): maximum bytes
+ * @time: (out) (allow-none): maximum age of the oldest queued message
+ *
+ * Get the limits set with gst_rtsp_connection_set_send_backlog().
+ *
+ * Since: 1.16
+ */
+void
+gst_rtsp_connection_get_send_backlog (GstRTSPConnection * conn, gsize * bytes,
+    GstClockTime * time)
+{
+  g_return_if_fail (conn != NULL);
+
+  if (bytes)
+    *bytes = conn->backlog_bytes;
+  if (time)
+    *time = conn->backlog_time;
+}
+
 
 #define READ_ERR    (G_IO_HUP | G_IO_ERR | G_IO_NVAL)
 #define READ_COND   (G_IO_IN | READ_ERR)
 #define WRITE_ERR   (G_IO_HUP | G_IO_ERR | G_IO_NVAL)
 #define WRITE_COND  (G_IO_OUT | WRITE_ERR)
 
+/* maximum amount of queued messages written with one vectored write */
+#define WRITEV_MAX_VECTORS 64
+
+/* how long interleaved data can be held back for batching */
+#define BATCH_TIMEOUT_MS 10
+
 typedef struct
 {
   guint8 *data;
   guint size;
   guint id;
+  gint64 time;
 } GstRTSPRec;
 
 /* async functions */
@@ -3159,6 +3356,7 @@ struct _GstRTSPWatch
   GSource *readsrc;
   GSource *writesrc;
   GSource *controlsrc;
+  GSource *batchsrc;
 
   gboolean keep_running;
 
@@ -3176,6 +3374,10 @@ struct _GstRTSPWatch
   GCond queue_not_full;
   gboolean flushing;
 
+  /* interleaved data held back until the frame is complete */
+  gsize batch_bytes;
+  guint32 batch_ts;
+
   GstRTSPWatchFuncs funcs;
 
   gpointer user_data;
@@ -3183,7 +3385,21 @@ struct _GstRTSPWatch
 };
 
 #define IS_BACKLOG_FULL(w) (((w)->max_bytes != 0 && (w)->messages_bytes >= (w)->max_bytes) || \
-      ((w)->max_messages != 0 && (w)->messages->length >= (w)->max_messages))
+      ((w)->max_messages != 0 && (w)->messages->length >= (w)->max_messages) || \
+      ((w)->conn->backlog_bytes != 0 && (w)->messages_bytes >= (w)->conn->backlog_bytes) || \
+      ((w)->conn->backlog_time != 0 && backlog_age (w) >= (w)->conn->backlog_time))
+
+/* time the oldest queued message has been waiting */
+static GstClockTime
+backlog_age (GstRTSPWatch * watch)
+{
+  GstRTSPRec *rec = g_queue_peek_tail (watch->messages);
+
+  if (rec == NULL)
+    return 0;
+
+  return (g_get_monotonic_time () - rec->time) * GST_USECOND;
+}
 
 static gboolean
 gst_rtsp_source_prepare (GSource * source, gint * timeout)
@@ -3421,6 +3637,67 @@ gst_rtsp_source_dispatch (GSource * source, GSourceFunc callback G_GNUC_UNUSED,
   return watch->keep_running;
 }
 
+static void
+gst_rtsp_rec_free (gpointer data)
+{
+  GstRTSPRec *rec = data;
+
+  g_free (rec->data);
+  g_slice_free (GstRTSPRec, rec);
+}
+
+/* write as many queued messages as possible with one vectored write and
+ * store the ids of the ones that were completely written in @ids. Called
+ * with the watch lock */
+static GstRTSPResult
+write_queued (GstRTSPWatch * watch, guint * ids, guint * n_ids)
+{
+  GOutputVector vectors[WRITEV_MAX_VECTORS];
+  GstRTSPResult res;
+  GstRTSPRec *rec;
+  GList *walk;
+  gsize bytes = 0, written;
+  guint n = 0;
+
+  for (walk = watch->messages->tail; walk && n < WRITEV_MAX_VECTORS;
+      walk = walk->prev) {
+    rec = walk->data;
+    if (n > 0 && watch->conn->batch_bytes != 0 &&
+        bytes + rec->size > watch->conn->batch_bytes)
+      break;
+
+    vectors[n].buffer = rec->data;
+    vectors[n].size = rec->size;
+    bytes += rec->size;
+    n++;
+  }
+
+  res = writev_bytes (watch->conn, vectors, n, &written);
+
+  while ((rec = g_queue_peek_tail (watch->messages)) && written >= rec->size) {
+    g_queue_pop_tail (watch->messages);
+    watch->messages_bytes -= rec->size;
+    written -= rec->size;
+    ids[(*n_ids)++] = rec->id;
+    gst_rtsp_rec_free (rec);
+  }
+
+  if (written > 0) {
+    /* finish the partially written message on its own */
+    rec = g_queue_pop_tail (watch->messages);
+    watch->messages_bytes -= rec->size;
+
+    watch->write_off = written;
+    watch->write_data = rec->data;
+    watch->write_size = rec->size;
+    watch->write_id = rec->id;
+
+    g_slice_free (GstRTSPRec, rec);
+  }
+
+  return res;
+}
+
 static gboolean
 gst_rtsp_source_dispatch_write (GPollableOutputStream * stream,
     GstRTSPWatch * watch)
@@ -3434,67 +3711,63 @@ gst_rtsp_source_dispatch_write (GPollableOutputStream * stream,
 
   g_mutex_lock (&watch->mutex);
   do {
-    if (watch->write_data == NULL) {
-      GstRTSPRec *rec;
-
-      /* get a new message from the queue */
-      rec = g_queue_pop_tail (watch->messages);
-      if (rec == NULL) {
-        if (watch->writesrc) {
-          if (!g_source_is_destroyed ((GSource *) watch))
-            g_source_remove_child_source ((GSource *) watch, watch->writesrc);
-          g_source_unref (watch->writesrc);
-          watch->writesrc = NULL;
-          /* we create and add the write source again when we actually have
-           * something to write */
-
-          /* since write source is now removed we add read source on the write
-           * socket instead to be able to detect when client closes get channel
-           * in tunneled mode */
-          if (watch->conn->control_stream) {
-            watch->controlsrc =
-                g_pollable_input_stream_create_source (G_POLLABLE_INPUT_STREAM
-                (watch->conn->control_stream), NULL);
-            g_source_set_callback (watch->controlsrc,
-                (GSourceFunc) gst_rtsp_source_dispatch_read_get_channel, watch,
-                NULL);
-            g_source_add_child_source ((GSource *) watch, watch->controlsrc);
-          } else {
-            watch->controlsrc = NULL;
-          }
+    guint ids[WRITEV_MAX_VECTORS];
+    guint i, n_ids = 0;
+
+    if (watch->write_data != NULL) {
+      res = write_bytes (conn->output_stream, watch->write_data,
+          &watch->write_off, watch->write_size, FALSE, conn->cancellable);
+      if (res == GST_RTSP_OK) {
+        ids[n_ids++] = watch->write_id;
+        g_free (watch->write_data);
+        watch->write_data = NULL;
+      }
+    } else if (watch->messages->length > 0) {
+      /* anything held back for batching goes out now as well */
+      watch->batch_bytes = 0;
+      res = write_queued (watch, ids, &n_ids);
+    } else {
+      if (watch->writesrc) {
+        if (!g_source_is_destroyed ((GSource *) watch))
+          g_source_remove_child_source ((GSource *) watch, watch->writesrc);
+        g_source_unref (watch->writesrc);
+        watch->writesrc = NULL;
+        /* we create and add the write source again when we actually have
+         * something to write */
+
+        /* since write source is now removed we add read source on the write
+         * socket instead to be able to detect when client closes get channel
+         * in tunneled mode */
+        if (watch->conn->control_stream) {
+          watch->controlsrc =
+              g_pollable_input_stream_create_source (G_POLLABLE_INPUT_STREAM
+              (watch->conn->control_stream), NULL);
+          g_source_set_callback (watch->controlsrc,
+              (GSourceFunc) gst_rtsp_source_dispatch_read_get_channel, watch,
+              NULL);
+          g_source_add_child_source ((GSource *) watch, watch->controlsrc);
+        } else {
+          watch->controlsrc = NULL;
         }
-        break;
       }
-
-      watch->messages_bytes -= rec->size;
-
-      watch->write_off = 0;
-      watch->write_data = rec->data;
-      watch->write_size = rec->size;
-      watch->write_id = rec->id;
-
-      g_slice_free (GstRTSPRec, rec);
+      break;
     }
 
-    res = write_bytes (conn->output_stream, watch->write_data,
-        &watch->write_off, watch->write_size, FALSE, conn->cancellable);
-
     if (!IS_BACKLOG_FULL (watch))
       g_cond_signal (&watch->queue_not_full);
     g_mutex_unlock (&watch->mutex);
 
+    if (watch->funcs.message_sent) {
+      for (i = 0; i < n_ids; i++)
+        watch->funcs.message_sent (watch, ids[i], watch->user_data);
+    }
+
     if (res == GST_RTSP_EINTR)
       goto write_blocked;
-    else if (G_LIKELY (res == GST_RTSP_OK)) {
-      if (watch->funcs.message_sent)
-        watch->funcs.message_sent (watch, watch->write_id, watch->user_data);
-    } else {
+    else if (G_UNLIKELY (res != GST_RTSP_OK))
       goto write_error;
-    }
-    g_mutex_lock (&watch->mutex);
 
-    g_free (watch->write_data);
-    watch->write_data = NULL;
+    g_mutex_lock (&watch->mutex);
   } while (TRUE);
   g_mutex_unlock (&watch->mutex);
 
@@ -3518,13 +3791,71 @@ write_error:
   }
 }
 
+/* make the watch check for writability on the socket. Called with the
+ * watch lock */
 static void
-gst_rtsp_rec_free (gpointer data)
+start_write (GstRTSPWatch * watch)
 {
-  GstRTSPRec *rec = data;
+  if (watch->writesrc)
+    return;
 
-  g_free (rec->data);
-  g_slice_free (GstRTSPRec, rec);
+  /* remove the read source on the write socket, we will be able to detect
+   * errors while writing */
+  if (watch->controlsrc) {
+    g_source_remove_child_source ((GSource *) watch, watch->controlsrc);
+    g_source_unref (watch->controlsrc);
+    watch->controlsrc = NULL;
+  }
+
+  watch->writesrc =
+      g_pollable_output_stream_create_source (G_POLLABLE_OUTPUT_STREAM
+      (watch->conn->output_stream), NULL);
+  g_source_set_callback (watch->writesrc,
+      (GSourceFunc) gst_rtsp_source_dispatch_write, watch, NULL);
+  g_source_add_child_source ((GSource *) watch, watch->writesrc);
+}
+
+/* Called with the watch lock */
+static void
+batch_stop_timeout (GstRTSPWatch * watch)
+{
+  if (watch->batchsrc == NULL)
+    return;
+
+  if (!g_source_is_destroyed ((GSource *) watch))
+    g_source_remove_child_source ((GSource *) watch, watch->batchsrc);
+  g_source_unref (watch->batchsrc);
+  watch->batchsrc = NULL;
+}
+
+/* called from the main context of the watch when data was held back for
+ * too long */
+static gboolean
+gst_rtsp_source_dispatch_batch (GstRTSPWatch * watch)
+{
+  g_mutex_lock (&watch->mutex);
+  batch_stop_timeout (watch);
+  if (watch->batch_bytes > 0) {
+    GST_LOG ("flushing %" G_GSIZE_FORMAT " held bytes", watch->batch_bytes);
+    watch->batch_bytes = 0;
+    start_write (watch);
+  }
+  g_mutex_unlock (&watch->mutex);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Called with the watch lock */
+static void
+batch_start_timeout (GstRTSPWatch * watch)
+{
+  if (watch->batchsrc)
+    return;
+
+  watch->batchsrc = g_timeout_source_new (BATCH_TIMEOUT_MS);
+  g_source_set_callback (watch->batchsrc,
+      (GSourceFunc) gst_rtsp_source_dispatch_batch, watch, NULL);
+  g_source_add_child_source ((GSource *) watch, watch->batchsrc);
 }
 
 static void
@@ -3552,6 +3883,8 @@ gst_rtsp_source_finalize (GSource * source)
     g_source_unref (watch->writesrc);
   if (watch->controlsrc)
     g_source_unref (watch->controlsrc);
+  if (watch->batchsrc)
+    g_source_unref (watch->batchsrc);
 
   g_mutex_clear (&watch->mutex);
 }
@@ -3640,6 +3973,7 @@ gst_rtsp_watch_reset (GstRTSPWatch * watch)
     g_source_unref (watch->controlsrc);
     watch->controlsrc = NULL;
   }
+  batch_stop_timeout (watch);
 
   if (watch->conn->input_stream) {
     watch->readsrc =
@@ -3759,6 +4093,39 @@ gst_rtsp_watch_get_send_backlog (GstRTSPWatch * watch,
   g_mutex_unlock (&watch->mutex);
 }
 
+/* check if @data is interleaved RTP that can wait for the rest of its
+ * frame before being written. Called with the watch lock */
+static gboolean
+batch_hold (GstRTSPWatch * watch, const guint8 * data, guint size)
+{
+  gsize batch = watch->conn->batch_bytes;
+  guint32 ts;
+
+  /* '$', channel, length and the fixed RTP header. RTCP goes on the odd
+   * channels and is never held */
+  if (batch == 0 || size < 4 + 12 || data[0] != '$' || (data[1] & 1) ||
+      (data[4] & 0xc0) != 0x80)
+    return FALSE;
+
+  ts = GST_READ_UINT32_BE (data + 4 + 4);
+
+  /* a new timestamp means that the held frame is complete */
+  if (watch->batch_bytes > 0 && ts != watch->batch_ts)
+    return FALSE;
+
+  /* the marker bit ends the frame */
+  if (data[4 + 1] & 0x80)
+    return FALSE;
+
+  if (watch->batch_bytes + size >= batch)
+    return FALSE;
+
+  watch->batch_ts = ts;
+  watch->batch_bytes += size;
+
+  return TRUE;
+}
+
 /**
  * gst_rtsp_watch_write_data:
  * @watch: a #GstRTSPWatch
@@ -3790,6 +4157,7 @@ gst_rtsp_watch_write_data (GstRTSPWatch * watch, const guint8 * data,
   GstRTSPRec *rec;
   guint off = 0;
   GMainContext *context = NULL;
+  gboolean hold;
 
   g_return_val_if_fail (watch != NULL, GST_RTSP_EINVAL);
   g_return_val_if_fail (data != NULL, GST_RTSP_EINVAL);
@@ -3799,8 +4167,10 @@ gst_rtsp_watch_write_data (GstRTSPWatch * watch, const guint8 * data,
   if (watch->flushing)
     goto flushing;
 
+  hold = batch_hold (watch, data, size);
+
   /* try to send the message synchronously first */
-  if (watch->messages->length == 0 && watch->write_data == NULL) {
+  if (!hold && watch->messages->length == 0 && watch->write_data == NULL) {
     res =
         write_bytes (watch->conn->output_stream, data, &off, size,
         FALSE, watch->conn->cancellable);
@@ -3833,29 +4203,25 @@ gst_rtsp_watch_write_data (GstRTSPWatch * watch, const guint8 * data,
   } while (G_UNLIKELY (rec->id == 0));
 
   /* add the record to a queue. */
+  rec->time = g_get_monotonic_time ();
   g_queue_push_head (watch->messages, rec);
   watch->messages_bytes += rec->size;
 
-  /* make sure the main context will now also check for writability on the
-   * socket */
+  /* held data is written together with the rest of its frame, or when the
+   * batch timeout expires */
   context = ((GSource *) watch)->context;
-  if (!watch->writesrc) {
-    /* remove the read source on the write socket, we will be able to detect
-     * errors while writing */
-    if (watch->controlsrc) {
-      g_source_remove_child_source ((GSource *) watch, watch->controlsrc);
-      g_source_unref (watch->controlsrc);
-      watch->controlsrc = NULL;
-    }
-
-    watch->writesrc =
-        g_pollable_output_stream_create_source (G_POLLABLE_OUTPUT_STREAM
-        (watch->conn->output_stream), NULL);
-    g_source_set_callback (watch->writesrc,
-        (GSourceFunc) gst_rtsp_source_dispatch_write, watch, NULL);
-    g_source_add_child_source ((GSource *) watch, watch->writesrc);
+  if (hold) {
+    batch_start_timeout (watch);
+    goto queued;
   }
+  batch_stop_timeout (watch);
+  watch->batch_bytes = 0;
+
+  /* make sure the main context will now also check for writability on the
+   * socket */
+  start_write (watch);
 
+queued:
   if (id != NULL)
     *id = rec->id;
   res = GST_RTSP_OK;
@@ -3881,6 +4247,8 @@ too_much_backlog:
     GST_WARNING ("too much backlog: max_bytes %" G_GSIZE_FORMAT ", current %"
         G_GSIZE_FORMAT ", max_messages %u, current %u", watch->max_bytes,
         watch->messages_bytes, watch->max_messages, watch->messages->length);
+    if (hold)
+      watch->batch_bytes -= size;
     g_mutex_unlock (&watch->mutex);
     g_free ((gpointer) data);
     return GST_RTSP_ENOMEM;
@@ -4008,6 +4376,9 @@ gst_rtsp_watch_set_flushing (GstRTSPWatch * watch, gboolean flushing)
   if (flushing) {
     g_queue_foreach (watch->messages, (GFunc) gst_rtsp_rec_free, NULL);
     g_queue_clear (watch->messages);
+    watch->messages_bytes = 0;
+    watch->batch_bytes = 0;
+    batch_stop_timeout (watch);
   }
   g_mutex_unlock (&watch->mutex);
 }
@@ -226,6 +226,20 @@ void               gst_rtsp_connection_set_remember_session_id (GstRTSPConnectio
 GST_RTSP_API
 gboolean           gst_rtsp_connection_get_remember_session_id (GstRTSPConnection *conn);
 
+GST_RTSP_API
+void               gst_rtsp_connection_set_send_batch (GstRTSPConnection *conn, gsize bytes);
+
+GST_RTSP_API
+gsize              gst_rtsp_connection_get_send_batch (GstRTSPConnection *conn);
+
+GST_RTSP_API
+void               gst_rtsp_connection_set_send_backlog (GstRTSPConnection *conn,
+                                                         gsize bytes, GstClockTime time);
+
+GST_RTSP_API
+void               gst_rtsp_connection_get_send_backlog (GstRTSPConnection *conn,
+                                                         gsize *bytes, GstClockTime *time);
+
 /* async IO */
 
 /**
@@ -1845,6 +1845,74 @@ GST_START_TEST (rtp_base_payload_max_framerate_attribute)
 
 GST_END_TEST;
 
+static void
+fill_fragment_header (GstRTPBasePayload * payload, guint8 * header,
+    guint index, guint n_fragments, gpointer user_data)
+{
+  header[0] = index;
+  header[1] = n_fragments;
+}
+
+/* payload an access unit with gst_rtp_base_payload_push_fragmented() and
+ * validate that it is split into MTU sized packets with consecutive sequence
+ * numbers, that the payload header is filled in, that only the last packet
+ * has the marker bit set and that the payload data is carried over intact.
+ */
+GST_START_TEST (rtp_base_payload_push_fragmented_test)
+{
+  State *state;
+  GstBuffer *buf;
+  GstRTPBuffer rtp = { NULL };
+  guint8 *data, *payload;
+  guint16 seq;
+  guint i, j, offset;
+
+  state = create_payloader ("application/x-rtp", &sinktmpl,
+      "perfect-rtptime", FALSE, "mtu", GST_RTP_HEADER_LEN + 2 + 300, NULL);
+
+  set_state (state, GST_STATE_PLAYING);
+
+  push_buffer (state, "pts", 0 * GST_SECOND, NULL);
+
+  data = g_malloc (1000);
+  for (i = 0; i < 1000; i++)
+    data[i] = i & 0xff;
+  buf = gst_buffer_new_wrapped (data, 1000);
+  GST_BUFFER_PTS (buf) = 1 * GST_SECOND;
+
+  fail_unless_equals_int (gst_rtp_base_payload_push_fragmented
+      (GST_RTP_BASE_PAYLOAD (state->element), buf, 0, 2, 0,
+          fill_fragment_header, NULL), GST_FLOW_OK);
+
+  set_state (state, GST_STATE_NULL);
+
+  validate_buffers_received (5);
+
+  get_buffer_field (0, "seq", &seq, NULL);
+
+  offset = 0;
+  for (i = 1; i < 5; i++) {
+    validate_buffer (i, "pts", 1 * GST_SECOND, "seq", seq + i, NULL);
+
+    buf = GST_BUFFER (g_list_nth_data (buffers, i));
+    fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp));
+    fail_unless_equals_int (gst_rtp_buffer_get_marker (&rtp), i == 4);
+    fail_unless_equals_int (gst_rtp_buffer_get_payload_len (&rtp),
+        i < 4 ? 2 + 300 : 2 + 100);
+    payload = gst_rtp_buffer_get_payload (&rtp);
+    fail_unless_equals_int (payload[0], i - 1);
+    fail_unless_equals_int (payload[1], 4);
+    for (j = 2; j < gst_rtp_buffer_get_payload_len (&rtp); j++, offset++)
+      fail_unless_equals_int (payload[j], offset & 0xff);
+    gst_rtp_buffer_unmap (&rtp);
+  }
+  fail_unless_equals_int (offset, 1000);
+
+  destroy_payloader (state);
+}
+
+GST_END_TEST;
+
 static Suite *
 rtp_basepayloading_suite (void)
 {
@@ -1856,6 +1924,7 @@ rtp_basepayloading_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, rtp_base_payload_buffer_test);
   tcase_add_test (tc_chain, rtp_base_payload_buffer_list_test);
+  tcase_add_test (tc_chain, rtp_base_payload_push_fragmented_test);
 
   tcase_add_test (tc_chain, rtp_base_payload_normal_rtptime_test);
   tcase_add_test (tc_chain, rtp_base_payload_perfect_rtptime_test);
@@ -840,6 +840,98 @@ GST_START_TEST (test_rtspconnection_backlog)
 
 GST_END_TEST;
 
+static guint8 *
+make_interleaved_rtp (guint size, guint32 ts, gboolean marker)
+{
+  guint8 *data = g_malloc0 (size);
+
+  data[0] = '$';
+  data[1] = 0;
+  GST_WRITE_UINT16_BE (data + 2, size - 4);
+  data[4] = 0x80;
+  data[5] = marker ? 0x80 : 0x00;
+  GST_WRITE_UINT32_BE (data + 8, ts);
+
+  return data;
+}
+
+GST_START_TEST (test_rtspconnection_send_batch)
+{
+  GSocketConnection *conn1 = NULL;
+  GSocketConnection *conn2 = NULL;
+  GSocket *sock;
+  GstRTSPConnection *rtsp_conn = NULL;
+  GstRTSPWatch *watch;
+  GInputStream *istream;
+  guint8 recv[4 * 64];
+  gsize count;
+  guint id;
+  gint i;
+
+  create_connection (&conn1, &conn2);
+  sock = g_socket_connection_get_socket (conn1);
+  fail_unless (sock != NULL);
+
+  fail_unless (gst_rtsp_connection_create_from_socket (sock, "127.0.0.1",
+          4444, NULL, &rtsp_conn) == GST_RTSP_OK);
+  fail_unless (rtsp_conn != NULL);
+
+  gst_rtsp_connection_set_send_batch (rtsp_conn, 4096);
+  fail_unless_equals_int (gst_rtsp_connection_get_send_batch (rtsp_conn),
+      4096);
+
+  watch = gst_rtsp_watch_new (rtsp_conn, &watch_funcs, NULL, NULL);
+  fail_unless (watch != NULL);
+  fail_unless (gst_rtsp_watch_attach (watch, NULL) > 0);
+  g_source_unref ((GSource *) watch);
+
+  message_sent_count = 0;
+
+  /* packets of an incomplete frame are held back */
+  for (i = 0; i < 3; i++) {
+    id = 0;
+    fail_unless (gst_rtsp_watch_write_data (watch,
+            make_interleaved_rtp (64, 1000, FALSE), 64, &id) == GST_RTSP_OK);
+    fail_unless (id > 0);
+  }
+  while (g_main_context_iteration (NULL, FALSE));
+  fail_unless_equals_int (message_sent_count, 0);
+  fail_if (g_socket_condition_check (g_socket_connection_get_socket (conn2),
+          G_IO_IN) & G_IO_IN);
+
+  /* the marker completes the frame and everything is written */
+  fail_unless (gst_rtsp_watch_write_data (watch,
+          make_interleaved_rtp (64, 1000, TRUE), 64, &id) == GST_RTSP_OK);
+  while (message_sent_count < 4)
+    g_main_context_iteration (NULL, TRUE);
+
+  istream = g_io_stream_get_input_stream (G_IO_STREAM (conn2));
+  fail_unless (g_input_stream_read_all (istream, recv, sizeof (recv), &count,
+          NULL, NULL));
+  fail_unless_equals_int (count, sizeof (recv));
+  for (i = 0; i < 4; i++) {
+    fail_unless_equals_int (recv[i * 64], '$');
+    fail_unless_equals_int (recv[i * 64 + 5], i == 3 ? 0x80 : 0x00);
+  }
+
+  /* held back data counts for the connection backlog */
+  gst_rtsp_connection_set_send_backlog (rtsp_conn, 100, 0);
+  fail_unless (gst_rtsp_watch_write_data (watch,
+          make_interleaved_rtp (64, 2000, FALSE), 64, &id) == GST_RTSP_OK);
+  fail_unless (gst_rtsp_watch_write_data (watch,
+          make_interleaved_rtp (64, 2000, FALSE), 64, &id) == GST_RTSP_OK);
+  fail_unless (gst_rtsp_watch_write_data (watch,
+          make_interleaved_rtp (64, 2000, FALSE), 64, &id) == GST_RTSP_ENOMEM);
+
+  g_source_destroy ((GSource *) watch);
+  fail_unless (gst_rtsp_connection_close (rtsp_conn) == GST_RTSP_OK);
+  fail_unless (gst_rtsp_connection_free (rtsp_conn) == GST_RTSP_OK);
+  g_object_unref (conn1);
+  g_object_unref (conn2);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_rtspconnection_ip)
 {
   GstRTSPConnection *conn = NULL;
@@ -874,6 +966,7 @@ rtspconnection_suite (void)
   tcase_add_test (tc_chain, test_rtspconnection_connect);
   tcase_add_test (tc_chain, test_rtspconnection_poll);
   tcase_add_test (tc_chain, test_rtspconnection_backlog);
+  tcase_add_test (tc_chain, test_rtspconnection_send_batch);
   tcase_add_test (tc_chain, test_rtspconnection_ip);
 
   return s;
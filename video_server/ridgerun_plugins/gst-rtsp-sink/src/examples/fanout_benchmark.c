@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2016-2017 RidgeRun, LLC (http://www.ridgerun.com)
+ * All Rights Reserved.
+ *
+ * The contents of this software are proprietary and confidential to RidgeRun,
+ * LLC.  No part of this program may be photocopied, reproduced or translated
+ * into another programming language without prior written consent of
+ * RidgeRun, LLC.  The user is free to modify the source code after obtaining
+ * a software license from RidgeRun.  All source code changes must be provided
+ * back to RidgeRun without any encumbrance.
+ */
+
+/*
+ * Fan-out load harness. The server side runs an rtspsink pipeline in this
+ * process while the fake clients run in a child process, so that the CPU
+ * reported here belongs to the server only. For every client count the
+ * server CPU usage and the per-client RTP interarrival jitter (RFC 3550)
+ * are printed.
+ *
+ * Usage: fanout_benchmark [--shared] [--seconds N] [clients ...]
+ *        (defaults to 1 10 100 clients, 10 seconds each)
+ */
+
+#include <gst/gst.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define MAPPING "/bench"
+#define SERVICE "12346"
+#define URL "rtsp://127.0.0.1:" SERVICE MAPPING
+
+typedef struct _Client Client;
+struct _Client
+{
+  GstElement *pipeline;
+  gint clock_rate;
+  gboolean first;
+  gint64 last_arrival;
+  guint32 last_rtptime;
+  gdouble jitter;
+  guint64 packets;
+};
+
+static GstPadProbeReturn
+client_probe (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  Client *client = (Client *) data;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  guint8 header[8];
+  gint64 arrival;
+  guint32 rtptime;
+  gdouble transit;
+
+  if (gst_buffer_extract (buf, 0, header, sizeof (header)) != sizeof (header))
+    return GST_PAD_PROBE_OK;
+
+  if (!client->clock_rate) {
+    GstCaps *caps = gst_pad_get_current_caps (pad);
+    if (caps) {
+      gst_structure_get_int (gst_caps_get_structure (caps, 0), "clock-rate",
+          &client->clock_rate);
+      gst_caps_unref (caps);
+    }
+    if (!client->clock_rate)
+      return GST_PAD_PROBE_OK;
+  }
+
+  arrival = g_get_monotonic_time ();
+  rtptime = GST_READ_UINT32_BE (header + 4);
+  client->packets++;
+
+  if (!client->first) {
+    /* D(i-1,i) = (Rj - Ri) - (Sj - Si), in RTP clock units */
+    transit = (gdouble) (arrival - client->last_arrival) *
+        client->clock_rate / G_USEC_PER_SEC -
+        (gdouble) (gint32) (rtptime - client->last_rtptime);
+    client->jitter += (ABS (transit) - client->jitter) / 16.0;
+  }
+
+  client->first = FALSE;
+  client->last_arrival = arrival;
+  client->last_rtptime = rtptime;
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+client_pad_added (GstElement * src, GstPad * pad, gpointer data)
+{
+  Client *client = (Client *) data;
+  GstElement *fakesink;
+  GstPad *sinkpad;
+
+  fakesink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (fakesink, "sync", FALSE, "async", FALSE, NULL);
+  gst_bin_add (GST_BIN (client->pipeline), fakesink);
+  gst_element_sync_state_with_parent (fakesink);
+
+  sinkpad = gst_element_get_static_pad (fakesink, "sink");
+  gst_pad_link (pad, sinkpad);
+  gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER, client_probe, client,
+      NULL);
+  gst_object_unref (sinkpad);
+}
+
+static gboolean
+quit_loop (gpointer data)
+{
+  g_main_loop_quit ((GMainLoop *) data);
+  return FALSE;
+}
+
+static gint
+run_clients (guint count, guint seconds)
+{
+  Client *clients;
+  GMainLoop *loop;
+  gdouble sum = 0, worst = 0;
+  guint i, active = 0;
+
+  clients = g_new0 (Client, count);
+  for (i = 0; i < count; ++i) {
+    GstElement *src;
+
+    clients[i].first = TRUE;
+    clients[i].pipeline = gst_pipeline_new (NULL);
+    src = gst_element_factory_make ("rtspsrc", NULL);
+    g_object_set (src, "location", URL, "latency", 0, NULL);
+    g_signal_connect (src, "pad-added", G_CALLBACK (client_pad_added),
+        &clients[i]);
+    gst_bin_add (GST_BIN (clients[i].pipeline), src);
+    gst_element_set_state (clients[i].pipeline, GST_STATE_PLAYING);
+  }
+
+  loop = g_main_loop_new (NULL, FALSE);
+  g_timeout_add_seconds (seconds, quit_loop, loop);
+  g_main_loop_run (loop);
+  g_main_loop_unref (loop);
+
+  for (i = 0; i < count; ++i) {
+    gst_element_set_state (clients[i].pipeline, GST_STATE_NULL);
+    gst_object_unref (clients[i].pipeline);
+
+    /* Report in milliseconds */
+    if (clients[i].packets && clients[i].clock_rate) {
+      gdouble jitter = clients[i].jitter * 1000 / clients[i].clock_rate;
+      sum += jitter;
+      worst = MAX (worst, jitter);
+      active++;
+    }
+  }
+
+  g_print ("%u %f %f\n", active, active ? sum / active : 0, worst);
+  g_free (clients);
+
+  return 0;
+}
+
+static gdouble
+cpu_seconds (void)
+{
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+      (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static void
+child_exited (GPid pid, gint status, gpointer data)
+{
+  g_spawn_close_pid (pid);
+  g_main_loop_quit ((GMainLoop *) data);
+}
+
+static gboolean
+run_round (const gchar * self, guint count, guint seconds)
+{
+  gchar *argv[6];
+  gchar out[128] = { 0 };
+  gchar *scount, *sseconds;
+  gdouble cpu, jitter_avg = 0, jitter_max = 0;
+  GMainLoop *loop;
+  gint64 start;
+  guint active = 0;
+  gint outfd;
+  GPid pid;
+  gboolean ret;
+
+  scount = g_strdup_printf ("%u", count);
+  sseconds = g_strdup_printf ("%u", seconds);
+  argv[0] = (gchar *) self;
+  argv[1] = "--client";
+  argv[2] = scount;
+  argv[3] = "--seconds";
+  argv[4] = sseconds;
+  argv[5] = NULL;
+
+  cpu = cpu_seconds ();
+  start = g_get_monotonic_time ();
+
+  /* The server lives in the default main context, keep it running while
+     the clients do their job */
+  ret = g_spawn_async_with_pipes (NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+      NULL, NULL, &pid, NULL, &outfd, NULL, NULL);
+  if (ret) {
+    loop = g_main_loop_new (NULL, FALSE);
+    g_child_watch_add (pid, child_exited, loop);
+    g_main_loop_run (loop);
+    g_main_loop_unref (loop);
+
+    if (read (outfd, out, sizeof (out) - 1) > 0)
+      sscanf (out, "%u %lf %lf", &active, &jitter_avg, &jitter_max);
+    close (outfd);
+  }
+
+  cpu = cpu_seconds () - cpu;
+
+  g_print ("clients %4u (%4u receiving): server cpu %6.2f%%, jitter avg "
+      "%.3f ms max %.3f ms\n", count, active,
+      100.0 * cpu * G_USEC_PER_SEC / (g_get_monotonic_time () - start),
+      jitter_avg, jitter_max);
+
+  g_free (scount);
+  g_free (sseconds);
+
+  return ret;
+}
+
+int
+main (gint argc, gchar * argv[])
+{
+  GstElement *pipeline;
+  GError *error = NULL;
+  gboolean shared = FALSE;
+  guint seconds = 10;
+  guint client = 0;
+  GArray *counts;
+  gchar *desc;
+  gint ret = -1;
+  gint i;
+  guint j;
+
+  gst_init (&argc, &argv);
+
+  counts = g_array_new (FALSE, FALSE, sizeof (guint));
+  for (i = 1; i < argc; ++i) {
+    if (!strcmp (argv[i], "--shared")) {
+      shared = TRUE;
+    } else if (!strcmp (argv[i], "--seconds") && i + 1 < argc) {
+      seconds = atoi (argv[++i]);
+    } else if (!strcmp (argv[i], "--client") && i + 1 < argc) {
+      client = atoi (argv[++i]);
+    } else {
+      guint count = atoi (argv[i]);
+      g_array_append_val (counts, count);
+    }
+  }
+
+  /* Child process, just be the clients */
+  if (client) {
+    ret = run_clients (client, seconds);
+    goto out;
+  }
+
+  if (!counts->len) {
+    guint defaults[] = { 1, 10, 100 };
+    g_array_append_vals (counts, defaults, G_N_ELEMENTS (defaults));
+  }
+
+  desc = g_strdup_printf ("videotestsrc is-live=true ! "
+      "video/x-raw,width=1280,height=720,framerate=30/1 ! "
+      "x264enc speed-preset=ultrafast tune=zerolatency key-int-max=30 ! "
+      "video/x-h264,mapping=" MAPPING " ! rtspsink service=" SERVICE
+      " shared-payload=%s", shared ? "true" : "false");
+  pipeline = gst_parse_launch_full (desc, NULL, GST_PARSE_FLAG_FATAL_ERRORS,
+      &error);
+  g_free (desc);
+  if (!pipeline || error) {
+    g_printerr ("Unable to build pipeline: %s\n",
+        error ? error->message : "(no debug)");
+    goto out;
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  g_print ("Serving " URL " (shared-payload=%s)\n", shared ? "true" : "false");
+
+  for (j = 0; j < counts->len; ++j)
+    run_round (argv[0], g_array_index (counts, guint, j), seconds);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  ret = 0;
+
+out:
+  g_array_unref (counts);
+  g_clear_error (&error);
+  gst_deinit ();
+
+  return ret;
+}
@@ -33,6 +33,7 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include "gstrtspsink.h"
+#include "gstrtspsinkiopool.h"
 #include <gst/rtsp-server/rtsp-server.h>
 
 
@@ -41,6 +42,16 @@
 typedef gboolean (*GstRtspSinkIteratorFunc) (GstRtspSink *, GstRtspSinkPad *,
     gpointer);
 
+typedef struct _GstRtspSinkClient GstRtspSinkClient;
+struct _GstRtspSinkClient
+{
+  GstRTSPClient *client;
+  gchar *address;
+  gchar *mapping;
+  GstClockTime connected;
+  volatile gint plays;
+};
+
 typedef struct _GstRtspSinkPayloader GstRtspSinkPayloader;
 struct _GstRtspSinkPayloader
 {
@@ -63,6 +74,19 @@ enum
   PROP_TTL,
   PROP_AUTH,
   PROP_TIMEOUT,
+  PROP_DIRECT_FEED,
+  PROP_DROPPED,
+  PROP_SHARED_PAYLOAD,
+  PROP_GOP_CACHE,
+  PROP_GOP_CACHE_MAX_BYTES,
+  PROP_GOP_CACHE_MAX_TIME,
+  PROP_TCP_BATCH_BYTES,
+  PROP_TCP_BACKLOG_BYTES,
+  PROP_TCP_BACKLOG_TIME,
+  PROP_STATS,
+  PROP_STATS_INTERVAL,
+  PROP_IO_THREADS,
+  PROP_IO_CPUS,
 };
 
 /* The name of the mapping field on the caps*/
@@ -79,6 +103,19 @@ enum
 #define DEFAULT_TIMEOUT 60
 #define DEFAULT_TIMEOUT_MIN 1
 #define DEFAULT_TIMEOUT_MAX G_MAXUINT
+#define DEFAULT_DIRECT_FEED FALSE
+#define DEFAULT_FEED_QUEUE_SIZE 30
+#define DEFAULT_SHARED_PAYLOAD FALSE
+#define DEFAULT_CONSUMER_MAX_BYTES 262144
+#define DEFAULT_GOP_CACHE FALSE
+#define DEFAULT_GOP_CACHE_MAX_BYTES (4 * 1024 * 1024)
+#define DEFAULT_GOP_CACHE_MAX_TIME (5 * GST_SECOND)
+#define DEFAULT_TCP_BATCH_BYTES 0
+#define DEFAULT_TCP_BACKLOG_BYTES 0
+#define DEFAULT_TCP_BACKLOG_TIME 0
+#define DEFAULT_STATS_INTERVAL 0
+#define DEFAULT_IO_THREADS 0
+#define DEFAULT_IO_CPUS NULL
 
 #define GST_RTSP_SINK_VIDEO_CAPS_MAKE(mimetype, ...)				\
   mimetype ", "								\
@@ -157,6 +194,10 @@ static void gst_rtsp_sink_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static void gst_rtsp_sink_finalize (GObject * object);
 static GstFlowReturn gst_rtsp_sink_push_buffer (GstPad * pad, GstBuffer * buf);
+static GstFlowReturn gst_rtsp_sink_push_rtp (GstPad * pad, GstSample * sample);
+static GstFlowReturn gst_rtsp_sink_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buf);
+static gboolean gst_rtsp_sink_feed_event (GstPad * pad, GstEvent * event);
 static gboolean gst_rtsp_sink_event_function (GstPad * pad,
     GstObject * parent, GstEvent * event);
 static gboolean gst_rtsp_sink_set_caps (GstPad * pad, GstCaps * caps);
@@ -169,8 +210,10 @@ static GstStateChangeReturn gst_rtsp_sink_change_state (GstElement * element,
 static gboolean gst_rtsp_sink_start (GstRtspSink * sink);
 static void gst_rtsp_sink_stop (GstRtspSink * sink);
 static const gchar *rtsp_sink_get_payloader_from_mime (const gchar * mime);
-static gchar *rtsp_sink_get_pipeline (const gchar * mimetype, gchar * padname,
-    guint index);
+static gchar *rtsp_sink_get_pipeline (GstRtspSink * sink,
+    const gchar * mimetype, gchar * padname, guint index);
+static gboolean rtsp_sink_setup_payloader (GstRtspSink * sink,
+    GstRtspSinkPad * pad, const gchar * mimetype);
 static gboolean rtsp_sink_configure_mapping (GstRtspSink * sink, GstPad * pad,
     gchar * mapping, const gchar * mimetype);
 static gboolean rtsp_sink_attach_if_needed (GstRtspSink * sink);
@@ -189,8 +232,22 @@ static void rtsp_client_connected_callback (GstRTSPServer * server,
     GstRTSPClient * client, gpointer data);
 static void configure_timeout (GstRTSPClient * client, GstRTSPSession * session,
     gpointer user_data);
+static void rtsp_client_play_request (GstRTSPClient * client,
+    GstRTSPContext * ctx, gpointer user_data);
+static gboolean rtsp_sink_request_keyframe (GstRtspSink * sink,
+    GstRtspSinkPad * pad, gpointer data);
 static gboolean rtsp_sink_reset_caps (GstRtspSink * sink,
     GstRtspSinkPad * pad, gpointer data);
+static gboolean rtsp_sink_sum_dropped (GstRtspSink * sink,
+    GstRtspSinkPad * pad, gpointer data);
+static gboolean rtsp_sink_all_eos (GstRtspSink * sink,
+    GstRtspSinkPad * pad, gpointer data);
+static gboolean rtsp_sink_pad_in_media (GstRtspSinkPad * pad);
+static void rtsp_sink_unmap_pad (GstRtspSink * sink, GstRtspSinkPad * pad);
+static void rtsp_client_closed (GstRTSPClient * client, gpointer user_data);
+static void rtsp_sink_client_free (GstRtspSinkClient * sinkclient);
+static GstStructure *gst_rtsp_sink_get_stats (GstRtspSink * sink);
+static void rtsp_sink_schedule_stats (GstRtspSink * sink);
 
 #ifdef EVAL
 static void print_eval ();
@@ -204,6 +261,11 @@ rtsp_sink_get_sink_by_name (GstRtspSink * sink, GstRtspSinkPad * pad,
   GstAppSink **appsink = (GstAppSink **) namedata[1];
   const gchar *name = (gchar *) namedata[0];
   gchar *sinkname;
+
+  /* Direct feed pads don't have an associated appsink */
+  if (!pad->appsink)
+    return TRUE;
+
   g_object_get (pad->appsink, "name", &sinkname, NULL);
   if (!strcmp (sinkname, name)) {
     *appsink = gst_object_ref (pad->appsink);
@@ -333,6 +395,107 @@ gst_rtsp_sink_class_init (GstRtspSinkClass * klass)
           DEFAULT_TIMEOUT_MIN, DEFAULT_TIMEOUT_MAX,
           DEFAULT_TIMEOUT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_DIRECT_FEED,
+      g_param_spec_boolean ("direct-feed",
+          "Direct feed",
+          "Push buffers from the sink pads directly into the payloaders, "
+          "bypassing the internal appsink/appsrc pair and preserving the "
+          "upstream timestamps. Must be set before requesting pads",
+          DEFAULT_DIRECT_FEED, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_DROPPED,
+      g_param_spec_uint64 ("dropped",
+          "Dropped buffers",
+          "Total amount of buffers dropped on their way to the clients",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SHARED_PAYLOAD,
+      g_param_spec_boolean ("shared-payload",
+          "Shared payload",
+          "Payload each stream exactly once inside the sink, independently "
+          "of the connected clients, and feed the RTP packets to the shared "
+          "media. Must be set before requesting pads",
+          DEFAULT_SHARED_PAYLOAD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_GOP_CACHE,
+      g_param_spec_boolean ("gop-cache",
+          "GOP cache",
+          "Cache the last keyframe and its delta units per mapping and burst "
+          "them into new medias. Clients joining a running media trigger a "
+          "keyframe request upstream",
+          DEFAULT_GOP_CACHE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_GOP_CACHE_MAX_BYTES,
+      g_param_spec_uint ("gop-cache-max-bytes",
+          "GOP cache maximum bytes",
+          "Maximum size of a cached GOP, larger GOPs are not cached "
+          "(0 = unlimited)", 0, G_MAXUINT,
+          DEFAULT_GOP_CACHE_MAX_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_GOP_CACHE_MAX_TIME,
+      g_param_spec_uint64 ("gop-cache-max-time",
+          "GOP cache maximum time",
+          "Maximum duration of a cached GOP in nanoseconds, longer GOPs are "
+          "not cached (-1 = unlimited)", 0, G_MAXUINT64,
+          DEFAULT_GOP_CACHE_MAX_TIME,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TCP_BATCH_BYTES,
+      g_param_spec_uint ("tcp-batch-bytes",
+          "TCP batch bytes",
+          "For clients using TCP interleaved transport, collect the RTP "
+          "packets of a frame, up to this amount of bytes, and write them "
+          "at once (0 = write every packet on its own)", 0, G_MAXUINT,
+          DEFAULT_TCP_BATCH_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TCP_BACKLOG_BYTES,
+      g_param_spec_uint ("tcp-backlog-bytes",
+          "TCP backlog bytes",
+          "Maximum amount of bytes queued for a TCP interleaved client, "
+          "packets beyond it are dropped (0 = unlimited)", 0, G_MAXUINT,
+          DEFAULT_TCP_BACKLOG_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TCP_BACKLOG_TIME,
+      g_param_spec_uint64 ("tcp-backlog-time",
+          "TCP backlog time",
+          "Maximum time in nanoseconds data may wait queued for a TCP "
+          "interleaved client, packets are dropped while the oldest one is "
+          "older (0 = unlimited)", 0, G_MAXUINT64,
+          DEFAULT_TCP_BACKLOG_TIME,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Per mapping and per client statistics: buffers, bytes, bitrate, "
+          "drops and queue depth of every mapping, and the RTCP reported "
+          "loss and jitter of every connected client",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STATS_INTERVAL,
+      g_param_spec_uint ("stats-interval",
+          "Statistics interval",
+          "Interval in milliseconds to post the statistics as an element "
+          "message on the bus (0 = disabled)", 0, G_MAXUINT,
+          DEFAULT_STATS_INTERVAL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_IO_THREADS,
+      g_param_spec_uint ("io-threads",
+          "I/O threads",
+          "Amount of threads serving the client connections, new clients "
+          "go to the least loaded one (0 = use the default main context)",
+          0, G_MAXUINT, DEFAULT_IO_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_IO_CPUS,
+      g_param_spec_string ("io-cpus",
+          "I/O CPUs",
+          "List of CPUs to pin the I/O threads to, as in \"0,2-3\". "
+          "Threads are assigned to them in a round robin fashion "
+          "(NULL = no pinning)", DEFAULT_IO_CPUS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 /* initialize the new element
@@ -354,6 +517,20 @@ gst_rtsp_sink_init (GstRtspSink * sink)
   sink->pool = gst_rtsp_address_pool_new ();
   sink->timeout_source = 0;
   sink->timeout = DEFAULT_TIMEOUT;
+  sink->direct_feed = DEFAULT_DIRECT_FEED;
+  sink->shared_payload = DEFAULT_SHARED_PAYLOAD;
+  sink->gop_cache = DEFAULT_GOP_CACHE;
+  sink->gop_cache_max_bytes = DEFAULT_GOP_CACHE_MAX_BYTES;
+  sink->gop_cache_max_time = DEFAULT_GOP_CACHE_MAX_TIME;
+  sink->tcp_batch_bytes = DEFAULT_TCP_BATCH_BYTES;
+  sink->tcp_backlog_bytes = DEFAULT_TCP_BACKLOG_BYTES;
+  sink->tcp_backlog_time = DEFAULT_TCP_BACKLOG_TIME;
+  sink->clients = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) rtsp_sink_client_free);
+  sink->stats_interval = DEFAULT_STATS_INTERVAL;
+  sink->stats_source = 0;
+  sink->io_threads = DEFAULT_IO_THREADS;
+  sink->io_cpus = g_strdup (DEFAULT_IO_CPUS);
   g_mutex_init (&sink->padlock);
 }
 
@@ -368,9 +545,12 @@ gst_rtsp_sink_new_sample (GstAppSink * appsink, gpointer data)
   GST_LOG_OBJECT (sink, "New buffer at %s:%s", GST_DEBUG_PAD_NAME (pad));
 
   sample = gst_app_sink_pull_sample (appsink);
+
+  if (sink->shared_payload)
+    return gst_rtsp_sink_push_rtp (pad, sample);
+
   buf = gst_sample_get_buffer (sample);
   gst_buffer_ref (buf);
-
   gst_sample_unref (sample);
 
   return gst_rtsp_sink_push_buffer (pad, buf);
@@ -403,8 +583,13 @@ gst_rtsp_sink_attach_appsink (GstRtspSink * sink, GstGhostPad * pad)
   callbacks.new_preroll = NULL;
   callbacks.new_sample = gst_rtsp_sink_new_sample;
 
+  /* Don't make a running pipeline wait for us to preroll */
+  if (GST_STATE (sink) > GST_STATE_READY)
+    g_object_set (appsink, "async", FALSE, NULL);
+
   gst_app_sink_set_callbacks (appsink, &callbacks, (gpointer) pad, NULL);
   gst_bin_add (GST_BIN (sink), GST_ELEMENT (appsink));
+  gst_element_sync_state_with_parent (GST_ELEMENT (appsink));
 
   target = gst_element_get_static_pad (GST_ELEMENT (appsink), "sink");
   gst_ghost_pad_set_target (pad, target);
@@ -418,8 +603,10 @@ gst_rtsp_sink_request_new_pad (GstElement * element,
   GstRtspSink *sink = GST_RTSP_SINK (element);
   GstPad *pad;
 
+  /* Pads may come and go while serving, the mapping is registered once
+     the caps arrive */
   if (sink->attached)
-    goto attached;
+    GST_INFO_OBJECT (sink, "Already attached, hot adding pad");
 
   pad = GST_PAD (gst_rtsp_sink_pad_new_from_template (templ, name));
   if (!pad)
@@ -430,14 +617,19 @@ gst_rtsp_sink_request_new_pad (GstElement * element,
 
   sink->padcount++;
   gst_pad_set_event_function (pad, gst_rtsp_sink_event_function);
-  gst_rtsp_sink_attach_appsink (sink, GST_GHOST_PAD (pad));
 
-  return pad;
-attached:
-  {
-    GST_ERROR_OBJECT (sink, "Already attached, can't create new pads");
-    return NULL;
+  /* In direct feed mode the ghost pad has no target, buffers are
+     handled by our own chain function and caps by the template */
+  if (sink->direct_feed) {
+    gst_pad_set_chain_function (pad, GST_DEBUG_FUNCPTR (gst_rtsp_sink_chain));
+    gst_pad_set_query_function (pad, gst_pad_query_default);
+    GST_PAD_UNSET_PROXY_CAPS (pad);
+    GST_PAD_SET_ACCEPT_TEMPLATE (pad);
+  } else {
+    gst_rtsp_sink_attach_appsink (sink, GST_GHOST_PAD (pad));
   }
+
+  return pad;
 nopad:
   {
     GST_ERROR_OBJECT (sink, "Unable to create pad %s", name);
@@ -449,8 +641,36 @@ static void
 gst_rtsp_sink_release_pad (GstElement * element, GstPad * pad)
 {
   GstRtspSink *sink = GST_RTSP_SINK (element);
-  sink->padcount--;
+  GstRtspSinkPad *rtsppad = GST_RTSP_SINK_PAD (pad);
+
   GST_INFO_OBJECT (sink, "Releasing pad %s", GST_OBJECT_NAME (pad));
+
+  /* Wait for the chain function to be done with the pad, it reads the
+     factory and feed pad without taking the padlock */
+  gst_pad_set_active (pad, FALSE);
+
+  /* Stop our own streaming threads before the pad goes away */
+  if (rtsppad->appsink) {
+    gst_element_set_locked_state (GST_ELEMENT (rtsppad->appsink), TRUE);
+    gst_element_set_state (GST_ELEMENT (rtsppad->appsink), GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (sink), GST_ELEMENT (rtsppad->appsink));
+    rtsppad->appsink = NULL;
+  }
+
+  if (rtsppad->payloader) {
+    gst_element_set_locked_state (rtsppad->payloader, TRUE);
+    gst_element_set_state (rtsppad->payloader, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (sink), rtsppad->payloader);
+    rtsppad->payloader = NULL;
+  }
+
+  g_mutex_lock (&sink->padlock);
+  if (rtsppad->factory)
+    rtsp_sink_unmap_pad (sink, rtsppad);
+  g_mutex_unlock (&sink->padlock);
+
+  gst_element_remove_pad (element, pad);
+  sink->padcount--;
 }
 
 static void
@@ -580,6 +800,121 @@ gst_rtsp_sink_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (sink);
       break;
 
+    case PROP_DIRECT_FEED:
+      if (sink->shared_payload) {
+        GST_WARNING_OBJECT (sink,
+            "Direct feed can't be combined with shared payload");
+        break;
+      }
+
+      if (sink->padcount > 0) {
+        GST_WARNING_OBJECT
+            (sink,
+            "Can't set direct feed because pads were already requested, leaving old %s",
+            sink->direct_feed ? "true" : "false");
+        break;
+      }
+
+      sink->direct_feed = g_value_get_boolean (value);
+      GST_INFO_OBJECT (sink, "Setting direct feed to %s",
+          sink->direct_feed ? "true" : "false");
+
+      /* There won't be any appsink inside the bin to flag us as a sink */
+      if (sink->direct_feed)
+        GST_OBJECT_FLAG_SET (sink, GST_ELEMENT_FLAG_SINK);
+      else
+        GST_OBJECT_FLAG_UNSET (sink, GST_ELEMENT_FLAG_SINK);
+      break;
+
+    case PROP_SHARED_PAYLOAD:
+      if (sink->direct_feed) {
+        GST_WARNING_OBJECT (sink,
+            "Shared payload can't be combined with direct feed");
+        break;
+      }
+
+      if (sink->padcount > 0) {
+        GST_WARNING_OBJECT
+            (sink,
+            "Can't set shared payload because pads were already requested, leaving old %s",
+            sink->shared_payload ? "true" : "false");
+        break;
+      }
+
+      sink->shared_payload = g_value_get_boolean (value);
+      GST_INFO_OBJECT (sink, "Setting shared payload to %s",
+          sink->shared_payload ? "true" : "false");
+      break;
+
+    case PROP_GOP_CACHE:
+      GST_OBJECT_LOCK (sink);
+      sink->gop_cache = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (sink);
+      break;
+
+    case PROP_GOP_CACHE_MAX_BYTES:
+      GST_OBJECT_LOCK (sink);
+      sink->gop_cache_max_bytes = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (sink);
+      break;
+
+    case PROP_GOP_CACHE_MAX_TIME:
+      GST_OBJECT_LOCK (sink);
+      sink->gop_cache_max_time = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (sink);
+      break;
+
+    case PROP_TCP_BATCH_BYTES:
+      GST_OBJECT_LOCK (sink);
+      sink->tcp_batch_bytes = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (sink);
+      break;
+
+    case PROP_TCP_BACKLOG_BYTES:
+      GST_OBJECT_LOCK (sink);
+      sink->tcp_backlog_bytes = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (sink);
+      break;
+
+    case PROP_TCP_BACKLOG_TIME:
+      GST_OBJECT_LOCK (sink);
+      sink->tcp_backlog_time = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (sink);
+      break;
+
+    case PROP_STATS_INTERVAL:
+      GST_OBJECT_LOCK (sink);
+      sink->stats_interval = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (sink);
+
+      /* Reschedule if we are already running */
+      if (sink->server)
+        rtsp_sink_schedule_stats (sink);
+      break;
+
+    case PROP_IO_THREADS:
+      if (sink->server) {
+        GST_WARNING_OBJECT (sink, "Can't change I/O threads while running, "
+            "leaving old %u", sink->io_threads);
+        break;
+      }
+
+      sink->io_threads = g_value_get_uint (value);
+      GST_INFO_OBJECT (sink, "Setting %u I/O threads", sink->io_threads);
+      break;
+
+    case PROP_IO_CPUS:
+      if (sink->server) {
+        GST_WARNING_OBJECT (sink, "Can't change I/O CPUs while running, "
+            "leaving old %s", sink->io_cpus);
+        break;
+      }
+
+      g_free (sink->io_cpus);
+      sink->io_cpus = g_value_dup_string (value);
+      GST_INFO_OBJECT (sink, "Pinning I/O threads to CPUs %s", sink->io_cpus);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -619,6 +954,50 @@ gst_rtsp_sink_get_property (GObject * object, guint prop_id,
     case PROP_TIMEOUT:
       g_value_set_uint (value, sink->timeout);
       break;
+    case PROP_DIRECT_FEED:
+      g_value_set_boolean (value, sink->direct_feed);
+      break;
+    case PROP_SHARED_PAYLOAD:
+      g_value_set_boolean (value, sink->shared_payload);
+      break;
+    case PROP_GOP_CACHE:
+      g_value_set_boolean (value, sink->gop_cache);
+      break;
+    case PROP_GOP_CACHE_MAX_BYTES:
+      g_value_set_uint (value, sink->gop_cache_max_bytes);
+      break;
+    case PROP_GOP_CACHE_MAX_TIME:
+      g_value_set_uint64 (value, sink->gop_cache_max_time);
+      break;
+    case PROP_TCP_BATCH_BYTES:
+      g_value_set_uint (value, sink->tcp_batch_bytes);
+      break;
+    case PROP_TCP_BACKLOG_BYTES:
+      g_value_set_uint (value, sink->tcp_backlog_bytes);
+      break;
+    case PROP_TCP_BACKLOG_TIME:
+      g_value_set_uint64 (value, sink->tcp_backlog_time);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_rtsp_sink_get_stats (sink));
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, sink->stats_interval);
+      break;
+    case PROP_IO_THREADS:
+      g_value_set_uint (value, sink->io_threads);
+      break;
+    case PROP_IO_CPUS:
+      g_value_set_string (value, sink->io_cpus);
+      break;
+    case PROP_DROPPED:
+    {
+      guint64 dropped = 0;
+
+      rtsp_sink_iterate_pads (sink, rtsp_sink_sum_dropped, &dropped);
+      g_value_set_uint64 (value, dropped);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -640,9 +1019,10 @@ gst_rtsp_sink_set_caps (GstPad * pad, GstCaps * caps)
 
   /* This doesn't need to be an error, TS may need to 
      negotiate multiple times, we can configure ourselves 
-     the first time
+     the first time. Pads added after attaching still need their
+     mapping.
    */
-  if (sink->attached)
+  if (sink->attached && GST_RTSP_SINK_PAD (pad)->factory)
     goto attached;
 
   if (!name)
@@ -685,6 +1065,17 @@ gst_rtsp_sink_set_caps (GstPad * pad, GstCaps * caps)
   if (!rtsp_sink_attach_if_needed (sink))
     goto attachfail;
 
+  /* Direct feed pads forward the caps on the first buffer */
+  if (sink->direct_feed)
+    return TRUE;
+
+  /* The appsink receives RTP from our own payloader */
+  if (sink->shared_payload) {
+    if (!rtsp_sink_setup_payloader (sink, GST_RTSP_SINK_PAD (pad), mimetype))
+      goto payloadfail;
+    return TRUE;
+  }
+
   appsink_pad = gst_ghost_pad_get_target (GST_GHOST_PAD (pad));
   appsink = GST_APP_SINK (gst_pad_get_parent (appsink_pad));
   gst_app_sink_set_caps (appsink, caps);
@@ -722,6 +1113,114 @@ attachfail:
     GST_ERROR_OBJECT (sink, "Failed to attach to server");
     return FALSE;
   }
+payloadfail:
+  {
+    GST_ERROR_OBJECT (sink, "Failed to set up shared payloader for %s", name);
+    return FALSE;
+  }
+}
+
+static GstClockTime
+rtsp_sink_apply_offset (GstClockTime time, GstClockTimeDiff offset)
+{
+  if (!GST_CLOCK_TIME_IS_VALID (time))
+    return GST_CLOCK_TIME_NONE;
+
+  if ((GstClockTimeDiff) time + offset < 0)
+    return 0;
+
+  return time + offset;
+}
+
+/* Current running time of the media pipeline, 0 while it is not playing */
+static GstClockTime
+rtsp_sink_get_media_time (GstElement * pipeline)
+{
+  GstClockTime media_time = 0;
+  GstClock *clock;
+
+  if (GST_STATE (pipeline) == GST_STATE_PLAYING) {
+    clock = gst_element_get_clock (pipeline);
+    if (clock) {
+      media_time = GST_CLOCK_DIFF (gst_element_get_base_time (pipeline),
+          gst_clock_get_time (clock));
+      gst_object_unref (clock);
+    }
+  }
+
+  return media_time;
+}
+
+/* Moves the running times pts and dts into the media timeline and stores
+   them in buf, which must be writable. The DTS never goes backwards */
+static void
+rtsp_sink_retime_buffer (GstRtspSinkPad * rtsppad, GstBuffer * buf,
+    GstClockTime pts, GstClockTime dts)
+{
+  dts = rtsp_sink_apply_offset (dts, rtsppad->ts_offset);
+  if (GST_CLOCK_TIME_IS_VALID (dts)) {
+    if (GST_CLOCK_TIME_IS_VALID (rtsppad->last_dts)
+        && dts < rtsppad->last_dts)
+      dts = rtsppad->last_dts;
+    rtsppad->last_dts = dts;
+  }
+  GST_BUFFER_PTS (buf) = rtsp_sink_apply_offset (pts, rtsppad->ts_offset);
+  GST_BUFFER_DTS (buf) = dts;
+}
+
+static GstClockTime
+rtsp_sink_get_running_time (GstRtspSinkPad * rtsppad, GstBuffer * buf)
+{
+  GstClockTime time = GST_BUFFER_DTS_OR_PTS (buf);
+
+  return gst_segment_to_running_time (&rtsppad->segment, GST_FORMAT_TIME,
+      time);
+}
+
+/* Bursts the cached GOP into a freshly created media. The blocking appsrc
+   paces the burst to whatever the payloader can take. The appsrc stamps
+   the live buffers with the media running time as they arrive, so the
+   cached ones are placed right before now, keeping their spacing from the
+   keyframe up to until, the buffer that triggered the replay */
+static void
+gst_rtsp_sink_replay_cache (GstRtspSink * sink, GstRtspSinkPad * rtsppad,
+    GstBuffer * until)
+{
+  GList *cached, *walk;
+  GstBuffer *buf;
+  GstClockTime until_time, pts, dts;
+  guint replayed = 0;
+
+  cached = gst_rtsp_sink_pad_cache_get (rtsppad);
+
+  until_time = rtsp_sink_get_running_time (rtsppad, until);
+  if (GST_CLOCK_TIME_IS_VALID (until_time))
+    rtsppad->ts_offset = GST_CLOCK_DIFF (until_time,
+        rtsp_sink_get_media_time (rtsppad->factory->pipeline));
+  rtsppad->last_dts = GST_CLOCK_TIME_NONE;
+
+  for (walk = cached; walk && walk->data != until; walk = walk->next) {
+    pts = dts = GST_CLOCK_TIME_NONE;
+    if (GST_CLOCK_TIME_IS_VALID (until_time)) {
+      pts = gst_segment_to_running_time (&rtsppad->segment, GST_FORMAT_TIME,
+          GST_BUFFER_PTS (walk->data));
+      dts = gst_segment_to_running_time (&rtsppad->segment, GST_FORMAT_TIME,
+          GST_BUFFER_DTS (walk->data));
+    }
+
+    /* Without a time reference the appsrc stamps them on arrival */
+    buf = gst_buffer_make_writable (gst_buffer_ref (walk->data));
+    rtsp_sink_retime_buffer (rtsppad, buf, pts, dts);
+
+    if (GST_FLOW_OK != gst_app_src_push_buffer (rtsppad->appsrc, buf))
+      break;
+    replayed++;
+  }
+
+  GST_DEBUG_OBJECT (sink, "Replayed %u cached buffers into mapping %s",
+      replayed, rtsppad->factory->mapping);
+
+  g_list_free_full (cached, (GDestroyNotify) gst_buffer_unref);
 }
 
 static GstFlowReturn
@@ -733,11 +1232,19 @@ gst_rtsp_sink_push_buffer (GstPad * pad, GstBuffer * buf)
   GstBuffer *compensation_buffer;
   GstFlowReturn ret = GST_FLOW_OK;
 
+  /* Keep the GOP even without clients, so that the first one can start
+     decoding right away */
+  if (sink->gop_cache)
+    gst_rtsp_sink_pad_cache_buffer (rtsppad, buf, sink->gop_cache_max_bytes,
+        sink->gop_cache_max_time);
+
+  gst_rtsp_sink_pad_count_buffer (rtsppad, buf);
+
   if (!sink->attached)
     goto noattached;
 
   factory = rtsppad->factory;
-  if (!factory || !factory->is_prepared)
+  if (!rtsp_sink_pad_in_media (rtsppad))
     /* We are not ready to stream yet */
     goto noprepared;
 
@@ -757,6 +1264,9 @@ gst_rtsp_sink_push_buffer (GstPad * pad, GstBuffer * buf)
     gst_app_src_set_caps (rtsppad->appsrc, caps);
     gst_caps_unref (caps);
 
+    if (sink->gop_cache)
+      gst_rtsp_sink_replay_cache (sink, rtsppad, buf);
+
 #ifdef EVAL
     rtsppad->start_time = GST_BUFFER_PTS (buf);
     GST_LOG_OBJECT (sink, "Setting new eval start time to %" GST_TIME_FORMAT,
@@ -778,6 +1288,9 @@ gst_rtsp_sink_push_buffer (GstPad * pad, GstBuffer * buf)
   if (GST_FLOW_OK != ret)
     goto pushfail;
 
+  g_atomic_pointer_set (&rtsppad->queue_bytes,
+      gst_app_src_get_current_level_bytes (rtsppad->appsrc));
+
   GST_LOG_OBJECT (sink, "Pushed buffer into %s",
       GST_OBJECT_NAME (rtsppad->appsrc));
 
@@ -840,120 +1353,638 @@ pushfail:
   {
     GST_INFO_OBJECT (sink,
         "Unable to push buffer into server, probably stream is closing");
+    gst_rtsp_sink_pad_count_dropped (rtsppad);
     return GST_FLOW_OK;
   }
 
 }
 
-static const gchar *
-rtsp_sink_get_payloader_from_mime (const gchar * mime)
+static gboolean
+rtsp_sink_setup_payloader (GstRtspSink * sink, GstRtspSinkPad * pad,
+    const gchar * mimetype)
 {
-  GstRtspSinkPayloader *payloader;
+  const gchar *payname;
+  GstPad *target;
+  gchar *name;
 
-  for (payloader = payloaders; payloader; ++payloader) {
-    if (!strcmp (mime, payloader->mimetype))
-      return payloader->payloader;
-  }
+  /* Survives server restarts, we just keep using it */
+  if (pad->payloader)
+    return TRUE;
 
-  return NULL;
-}
+  payname = rtsp_sink_get_payloader_from_mime (mimetype);
+  if (!payname)
+    goto nopayloader;
 
-#define PIPEDESC "appsrc is-live=true do-timestamp=true format=3 max-bytes=1 block=true name=%s ! queue ! %s name=pay%u"
+  name = g_strdup_printf ("%s_pay", GST_OBJECT_NAME (pad));
+  pad->payloader = gst_element_factory_make (payname, name);
+  g_free (name);
+  if (!pad->payloader)
+    goto nopayloader;
 
-static gchar *
-rtsp_sink_get_pipeline (const gchar * mimetype, gchar * padname, guint index)
-{
-  gchar *pipeline = NULL;
-  const gchar *payloader = NULL;
+  /* Clients may join at any point, make sure they get the stream
+     configuration in-band */
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (pad->payloader),
+          "config-interval"))
+    g_object_set (pad->payloader, "config-interval", -1, NULL);
 
-  payloader = rtsp_sink_get_payloader_from_mime (mimetype);
-  if (!payloader)
-    goto exit;
+  GST_INFO_OBJECT (sink, "Creating shared %s for %s:%s",
+      GST_OBJECT_NAME (pad->payloader), GST_DEBUG_PAD_NAME (pad));
 
-  /* Allocate mem for worst case scenario */
-  pipeline = g_malloc (strlen (PIPEDESC) + strlen (padname) +
-      strlen (payloader) + 1);
-  sprintf (pipeline, PIPEDESC, padname, payloader, index);
+  gst_bin_add (GST_BIN (sink), pad->payloader);
 
-exit:
-  {
-    return pipeline;
-  }
-}
+  /* Move the ghost pad in front of the payloader, this releases the
+     appsink so it can now take the RTP packets */
+  target = gst_element_get_static_pad (pad->payloader, "sink");
+  gst_ghost_pad_set_target (GST_GHOST_PAD (pad), target);
+  gst_object_unref (target);
 
-static gboolean
-rtsp_sink_get_factory_by_mapping (GstRtspSink * sink, GstRtspSinkPad * pad,
-    gpointer data)
-{
-  gpointer *factorydata = (gpointer *) data;
-  RrRtspMediaFactory **factory = (RrRtspMediaFactory **) factorydata[1];
-  const gchar *mapping = (gchar *) factorydata[0];
+  if (!gst_element_link (pad->payloader, GST_ELEMENT (pad->appsink)))
+    goto nolink;
 
-  if (pad->factory && !strcmp (mapping, pad->factory->mapping)) {
-    GST_DEBUG_OBJECT (sink, "Recycling mapping %s for %s", mapping,
-        GST_OBJECT_NAME (pad));
-    *factory = gst_object_ref (pad->factory);
+  gst_element_sync_state_with_parent (pad->payloader);
+
+  return TRUE;
+
+nopayloader:
+  {
+    GST_ERROR_OBJECT (sink, "Unable to create payloader for %s", mimetype);
+    return FALSE;
+  }
+nolink:
+  {
+    GST_ERROR_OBJECT (sink, "Unable to link %s to %s",
+        GST_OBJECT_NAME (pad->payloader), GST_OBJECT_NAME (pad->appsink));
     return FALSE;
   }
-  return TRUE;
 }
 
-static gboolean
-rtsp_sink_configure_mapping (GstRtspSink * sink, GstPad * pad,
-    gchar * mapping, const gchar * mimetype)
+static GstFlowReturn
+gst_rtsp_sink_push_rtp (GstPad * pad, GstSample * sample)
 {
-  GstRtspSinkPad *mypad = GST_RTSP_SINK_PAD (pad);
-  RrRtspMediaFactory *factory = NULL;
-  GstRTSPMountPoints *rtsp_mount_points;
-  gchar *new_pipeline = NULL;
-  gchar *full_pipeline = NULL;
-  gchar *current_pipeline = NULL;
-  gboolean has_factory = FALSE;
-  gpointer factorydata[2] = { mapping, &factory };
-  /* Auth */
-  GstRTSPAuth *auth;
-  GstRTSPToken *token;
-  gchar *basic;
-  gchar *authorize = NULL;
-  gchar *p, *comma, *col;
-  gchar *user = NULL, *passwd = NULL;
-  gboolean usernumber = TRUE;
-  gboolean AUTHO = TRUE;
+  GstRtspSink *sink = GST_RTSP_SINK (GST_PAD_PARENT (pad));
+  GstRtspSinkPad *rtsppad = GST_RTSP_SINK_PAD (pad);
+  RrRtspMediaFactory *factory = rtsppad->factory;
+  const GstSegment *segment = gst_sample_get_segment (sample);
+  GstBuffer *buf = gst_sample_get_buffer (sample);
+  GstClockTime pts, dts;
+  GstFlowReturn ret = GST_FLOW_OK;
+  gchar *name;
 
-  rtsp_sink_iterate_pads (sink, rtsp_sink_get_factory_by_mapping, factorydata);
-  has_factory = factory ? TRUE : FALSE;
-  if (has_factory) {
-    factory->index++;
-  } else {
-    /* Create the factory that will remain associated with this mapping */
-    factory = rr_rtsp_media_factory_new ();
-    if (!factory)
-      goto no_factory;
-  }
+  gst_rtsp_sink_pad_count_buffer (rtsppad, buf);
 
+  if (!sink->attached)
+    goto noattached;
 
-  /* Setting the multicast group */
-  if (sink->multicast) {
-    GST_INFO_OBJECT (sink, "multicast support set on %s",
-        sink->multicast ? "true" : "false");
-    /* make a new address pool */
-    gst_rtsp_media_factory_set_address_pool (GST_RTSP_MEDIA_FACTORY
-        (factory), sink->pool);
-    /* only allow multicast */
-    gst_rtsp_media_factory_set_protocols (GST_RTSP_MEDIA_FACTORY (factory),
-        GST_RTSP_LOWER_TRANS_UDP_MCAST);
-  }
+  if (!rtsp_sink_pad_in_media (rtsppad))
+    goto noprepared;
 
-  new_pipeline =
-      rtsp_sink_get_pipeline (mimetype, GST_OBJECT_NAME (pad), factory->index);
-  if (!new_pipeline)
-    goto no_payloader;
+  pts = gst_segment_to_running_time (segment, GST_FORMAT_TIME,
+      GST_BUFFER_PTS (buf));
+  dts = gst_segment_to_running_time (segment, GST_FORMAT_TIME,
+      GST_BUFFER_DTS (buf));
 
-  GST_INFO_OBJECT (sink, "Using \"%s\" as pipeline for %s", new_pipeline,
-      GST_OBJECT_NAME (pad));
+  if (!rtsppad->appsrc) {
+    /* We need a reference time to compute the offset */
+    if (!GST_CLOCK_TIME_IS_VALID (pts))
+      goto notime;
 
-  if (has_factory) {
-    current_pipeline =
+    /* A new media was created, feed it from now on */
+    name = g_strdup_printf ("pay%u", rtsppad->payindex);
+    rtsppad->appsrc =
+        GST_APP_SRC (gst_bin_get_by_name (GST_BIN (factory->pipeline), name));
+    g_free (name);
+    if (!rtsppad->appsrc)
+      goto noappsrc;
+
+    /* Same as with the direct feed, the packets keep the payloader
+       timestamps and their spacing, moved into the media running time */
+    rtsppad->ts_offset = GST_CLOCK_DIFF (pts,
+        rtsp_sink_get_media_time (factory->pipeline));
+    rtsppad->last_dts = GST_CLOCK_TIME_NONE;
+
+    GST_INFO_OBJECT (sink, "Feeding %s into mapping %s with offset %"
+        GST_STIME_FORMAT, GST_OBJECT_NAME (rtsppad->appsrc), factory->mapping,
+        GST_STIME_ARGS (rtsppad->ts_offset));
+  }
+
+  /* The payloader runs for the whole sink, never let a media that falls
+     behind block it */
+  if (gst_app_src_get_current_level_bytes (rtsppad->appsrc) >=
+      gst_app_src_get_max_bytes (rtsppad->appsrc))
+    goto full;
+
+  /* Only the metadata is copied here, memories are shared */
+  buf = gst_buffer_make_writable (gst_buffer_ref (buf));
+  rtsp_sink_retime_buffer (rtsppad, buf, pts, dts);
+
+  gst_app_src_set_caps (rtsppad->appsrc, gst_sample_get_caps (sample));
+  gst_sample_unref (sample);
+
+  if (GST_FLOW_OK != gst_app_src_push_buffer (rtsppad->appsrc, buf))
+    goto pushfail;
+
+  g_atomic_pointer_set (&rtsppad->queue_bytes,
+      gst_app_src_get_current_level_bytes (rtsppad->appsrc));
+
+  return ret;
+
+noattached:
+  {
+    GST_LOG_OBJECT (sink, "Server not attached yet");
+    goto drop;
+  }
+noprepared:
+  {
+    GST_LOG_OBJECT (sink, "Dropping packet for %s, no clients connected yet",
+        GST_OBJECT_NAME (rtsppad));
+    if (rtsppad->appsrc) {
+      gst_object_unref (rtsppad->appsrc);
+      rtsppad->appsrc = NULL;
+    }
+    goto drop;
+  }
+notime:
+  {
+    GST_DEBUG_OBJECT (sink, "Dropping untimed packet for %s",
+        GST_OBJECT_NAME (rtsppad));
+    goto drop;
+  }
+noappsrc:
+  {
+    GST_ERROR_OBJECT (sink, "Unable to get appsrc for %s, aborting",
+        GST_OBJECT_NAME (rtsppad));
+    ret = GST_FLOW_ERROR;
+    goto drop;
+  }
+full:
+  {
+    GST_LOG_OBJECT (sink, "Media for mapping %s is full, dropping packet",
+        factory->mapping);
+    gst_rtsp_sink_pad_count_dropped (rtsppad);
+    goto drop;
+  }
+pushfail:
+  {
+    GST_INFO_OBJECT (sink,
+        "Unable to push packet into server, probably stream is closing");
+    gst_rtsp_sink_pad_count_dropped (rtsppad);
+    return GST_FLOW_OK;
+  }
+drop:
+  {
+    gst_sample_unref (sample);
+    return ret;
+  }
+}
+
+static void
+gst_rtsp_sink_feed_overrun (GstElement * queue, gpointer data)
+{
+  GstRtspSinkPad *rtsppad = GST_RTSP_SINK_PAD (data);
+
+  /* The feed queue is leaky, every overrun drops the oldest buffer */
+  gst_rtsp_sink_pad_count_dropped (rtsppad);
+}
+
+static GstFlowReturn
+gst_rtsp_sink_open_feed (GstRtspSink * sink, GstRtspSinkPad * rtsppad,
+    GstClockTime running_time)
+{
+  RrRtspMediaFactory *factory = rtsppad->factory;
+  GstElement *queue;
+  GstEvent *stream_start;
+  GstSegment segment;
+  GstCaps *caps;
+  gchar *stream_id;
+
+  queue = gst_bin_get_by_name (GST_BIN (factory->pipeline),
+      GST_OBJECT_NAME (rtsppad));
+  if (!queue)
+    goto noqueue;
+
+  caps = gst_pad_get_current_caps (GST_PAD (rtsppad));
+  if (!caps)
+    goto nocaps;
+
+  rtsppad->feedpad = gst_element_get_static_pad (queue, "sink");
+  g_signal_connect_object (queue, "overrun",
+      G_CALLBACK (gst_rtsp_sink_feed_overrun), rtsppad, 0);
+
+  /* Translate our running time into the media's running time so that
+     the timestamps keep their upstream spacing but remain monotonic
+     across media (re)creations */
+  rtsppad->ts_offset = GST_CLOCK_DIFF (running_time,
+      rtsp_sink_get_media_time (factory->pipeline));
+  rtsppad->last_dts = GST_CLOCK_TIME_NONE;
+
+  GST_INFO_OBJECT (sink, "Opened direct feed into mapping %s with offset %"
+      GST_STIME_FORMAT, factory->mapping, GST_STIME_ARGS (rtsppad->ts_offset));
+
+  /* The feed starts a new stream, replay the sticky events */
+  stream_start = gst_pad_get_sticky_event (GST_PAD (rtsppad),
+      GST_EVENT_STREAM_START, 0);
+  if (!stream_start) {
+    stream_id = g_strdup_printf ("%s/%s", GST_OBJECT_NAME (sink),
+        GST_OBJECT_NAME (rtsppad));
+    stream_start = gst_event_new_stream_start (stream_id);
+    g_free (stream_id);
+  }
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  if (!gst_pad_send_event (rtsppad->feedpad, stream_start)
+      || !gst_pad_send_event (rtsppad->feedpad, gst_event_new_caps (caps))
+      || !gst_pad_send_event (rtsppad->feedpad,
+          gst_event_new_segment (&segment)))
+    goto notready;
+  gst_caps_unref (caps);
+
+#ifdef EVAL
+  rtsppad->start_time = running_time;
+  GST_LOG_OBJECT (sink, "Setting new eval start time to %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (rtsppad->start_time));
+#endif
+
+  gst_object_unref (queue);
+
+  return GST_FLOW_OK;
+
+noqueue:
+  {
+    GST_ERROR_OBJECT (sink, "Unable to get feed queue for %s",
+        GST_OBJECT_NAME (rtsppad));
+    return GST_FLOW_ERROR;
+  }
+nocaps:
+  {
+    GST_ERROR_OBJECT (sink, "Unable to get negotiated caps");
+    gst_object_unref (queue);
+    return GST_FLOW_ERROR;
+  }
+notready:
+  {
+    /* The media pipeline is still starting up, try again on the next
+       buffer */
+    GST_DEBUG_OBJECT (sink, "Media for mapping %s not ready yet",
+        factory->mapping);
+    gst_caps_unref (caps);
+    gst_object_unref (rtsppad->feedpad);
+    rtsppad->feedpad = NULL;
+    gst_object_unref (queue);
+    return GST_FLOW_FLUSHING;
+  }
+}
+
+/* Moves buf into the media timeline and pushes it into the feed */
+static GstFlowReturn
+gst_rtsp_sink_feed_one (GstRtspSinkPad * rtsppad, GstBuffer * buf)
+{
+  GstClockTime pts, dts;
+
+  pts = gst_segment_to_running_time (&rtsppad->segment, GST_FORMAT_TIME,
+      GST_BUFFER_PTS (buf));
+  dts = gst_segment_to_running_time (&rtsppad->segment, GST_FORMAT_TIME,
+      GST_BUFFER_DTS (buf));
+
+  /* Only the metadata is copied here, memories are shared */
+  buf = gst_buffer_make_writable (buf);
+  rtsp_sink_retime_buffer (rtsppad, buf, pts, dts);
+
+  GST_LOG_OBJECT (rtsppad, "Feeding buffer %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (GST_BUFFER_PTS (buf)));
+
+  return gst_pad_chain (rtsppad->feedpad, buf);
+}
+
+static GstFlowReturn
+gst_rtsp_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  GstRtspSink *sink = GST_RTSP_SINK (parent);
+  GstRtspSinkPad *rtsppad = GST_RTSP_SINK_PAD (pad);
+  RrRtspMediaFactory *factory;
+  GstClockTime running_time;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GList *cached = NULL;
+  GList *walk;
+  guint replayed = 0;
+
+  /* Keep the GOP around even without clients, so that the first one can
+     start decoding right away */
+  if (sink->gop_cache)
+    gst_rtsp_sink_pad_cache_buffer (rtsppad, buf, sink->gop_cache_max_bytes,
+        sink->gop_cache_max_time);
+
+  gst_rtsp_sink_pad_count_buffer (rtsppad, buf);
+
+  if (!sink->attached)
+    goto noattached;
+
+  factory = rtsppad->factory;
+  if (!rtsp_sink_pad_in_media (rtsppad))
+    /* We are not ready to stream yet */
+    goto noprepared;
+
+  running_time = rtsp_sink_get_running_time (rtsppad, buf);
+
+  if (!rtsppad->feedpad) {
+    /* Start the media timeline at the cached keyframe, if any */
+    if (sink->gop_cache)
+      cached = gst_rtsp_sink_pad_cache_get (rtsppad);
+    if (cached)
+      running_time = rtsp_sink_get_running_time (rtsppad, cached->data);
+
+    /* We need a reference time to compute the offset */
+    if (!GST_CLOCK_TIME_IS_VALID (running_time))
+      goto notime;
+
+    ret = gst_rtsp_sink_open_feed (sink, rtsppad, running_time);
+    if (GST_FLOW_FLUSHING == ret) {
+      ret = GST_FLOW_OK;
+      goto drop;
+    } else if (GST_FLOW_OK != ret) {
+      goto no_push;
+    }
+
+    /* Burst the cached GOP, the current buffer is the last one in it */
+    for (walk = cached; walk && walk->data != buf; walk = walk->next) {
+      ret = gst_rtsp_sink_feed_one (rtsppad, gst_buffer_ref (walk->data));
+      if (GST_FLOW_OK != ret)
+        break;
+      replayed++;
+    }
+    GST_DEBUG_OBJECT (sink, "Replayed %u cached buffers into mapping %s",
+        replayed, factory->mapping);
+    g_list_free_full (cached, (GDestroyNotify) gst_buffer_unref);
+    cached = NULL;
+
+    if (GST_FLOW_OK != ret) {
+      gst_buffer_unref (buf);
+      goto pushfail;
+    }
+
+    running_time = rtsp_sink_get_running_time (rtsppad, buf);
+  }
+
+#ifdef EVAL
+  if (GST_CLOCK_TIME_IS_VALID (rtsppad->start_time)
+      && GST_CLOCK_DIFF (rtsppad->start_time, running_time) >=
+      5 * 60 * GST_SECOND) {
+    gst_pad_send_event (rtsppad->feedpad, gst_event_new_eos ());
+    rtsppad->start_time = GST_CLOCK_TIME_NONE;
+    print_eval ();
+  }
+#endif
+
+  ret = gst_rtsp_sink_feed_one (rtsppad, buf);
+  if (GST_FLOW_OK != ret)
+    goto pushfail;
+
+  return ret;
+
+noattached:
+  {
+    GST_LOG_OBJECT (sink, "Server not attached yet");
+    goto drop;
+  }
+noprepared:
+  {
+    GST_LOG_OBJECT (sink, "Dropping buffer for %s, no clients connected yet",
+        GST_OBJECT_NAME (rtsppad));
+    if (rtsppad->feedpad) {
+      gst_object_unref (rtsppad->feedpad);
+      rtsppad->feedpad = NULL;
+    }
+    goto drop;
+  }
+notime:
+  {
+    GST_LOG_OBJECT (sink, "Dropping untimestamped buffer on %s",
+        GST_OBJECT_NAME (rtsppad));
+    g_list_free_full (cached, (GDestroyNotify) gst_buffer_unref);
+    goto drop;
+  }
+pushfail:
+  {
+    GST_INFO_OBJECT (sink, "Unable to feed buffer into server (%s), "
+        "probably stream is closing", gst_flow_get_name (ret));
+    /* Reopen the feed, the media may be restarting */
+    gst_object_unref (rtsppad->feedpad);
+    rtsppad->feedpad = NULL;
+    gst_rtsp_sink_pad_count_dropped (rtsppad);
+    return GST_FLOW_OK;
+  }
+drop:
+  {
+    gst_rtsp_sink_pad_count_dropped (rtsppad);
+    goto no_push;
+  }
+no_push:
+  {
+    gst_buffer_unref (buf);
+    return ret;
+  }
+}
+
+static gboolean
+gst_rtsp_sink_feed_event (GstPad * pad, GstEvent * event)
+{
+  GstRtspSink *sink = GST_RTSP_SINK (GST_PAD_PARENT (pad));
+  GstRtspSinkPad *rtsppad = GST_RTSP_SINK_PAD (pad);
+  gboolean all_eos = TRUE;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:
+    {
+      GstCaps *caps;
+
+      /* Same as with the appsink, renegotiation is not an error */
+      gst_event_parse_caps (event, &caps);
+      gst_rtsp_sink_set_caps (pad, caps);
+      if (rtsppad->feedpad)
+        gst_pad_send_event (rtsppad->feedpad, gst_event_ref (event));
+      break;
+    }
+    case GST_EVENT_SEGMENT:
+      gst_event_copy_segment (event, &rtsppad->segment);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_segment_init (&rtsppad->segment, GST_FORMAT_TIME);
+      rtsppad->eos = FALSE;
+      break;
+    case GST_EVENT_EOS:
+      rtsppad->eos = TRUE;
+      if (rtsppad->feedpad)
+        gst_pad_send_event (rtsppad->feedpad, gst_event_ref (event));
+
+      /* We have no child sinks, so post EOS ourselves once all our pads
+         are done */
+      rtsp_sink_iterate_pads (sink, rtsp_sink_all_eos, &all_eos);
+      if (all_eos)
+        gst_element_post_message (GST_ELEMENT (sink),
+            gst_message_new_eos (GST_OBJECT (sink)));
+      break;
+    default:
+      break;
+  }
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static gboolean
+rtsp_sink_sum_dropped (GstRtspSink * sink, GstRtspSinkPad * pad, gpointer data)
+{
+  guint64 *dropped = (guint64 *) data;
+
+  *dropped += gst_rtsp_sink_pad_get_dropped (pad);
+
+  return TRUE;
+}
+
+static gboolean
+rtsp_sink_all_eos (GstRtspSink * sink, GstRtspSinkPad * pad, gpointer data)
+{
+  gboolean *all_eos = (gboolean *) data;
+
+  if (!pad->eos) {
+    *all_eos = FALSE;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* A pad added while its mapping was already streaming is not part of the
+   running media, it only shows up in the next one */
+static gboolean
+rtsp_sink_pad_in_media (GstRtspSinkPad * pad)
+{
+  RrRtspMediaFactory *factory = pad->factory;
+
+  return factory && factory->is_prepared
+      && factory->generation >= pad->generation;
+}
+
+static const gchar *
+rtsp_sink_get_payloader_from_mime (const gchar * mime)
+{
+  GstRtspSinkPayloader *payloader;
+
+  for (payloader = payloaders; payloader; ++payloader) {
+    if (!strcmp (mime, payloader->mimetype))
+      return payloader->payloader;
+  }
+
+  return NULL;
+}
+
+#define PIPEDESC "appsrc is-live=true do-timestamp=true format=3 max-bytes=1 block=true name=%s ! queue ! %s name=pay%u"
+#define DIRECT_PIPEDESC "queue leaky=downstream max-size-buffers=%u max-size-bytes=0 max-size-time=0 name=%s ! %s name=pay%u"
+/* In shared payload mode the RTP packets are already built, the appsrc
+   itself acts as the payloader for the server. The packets come with the
+   payloader timestamps, already moved into the media timeline */
+#define SHARED_PIPEDESC "appsrc is-live=true do-timestamp=false format=3 max-bytes=%u name=pay%u"
+
+static gchar *
+rtsp_sink_get_pipeline (GstRtspSink * sink, const gchar * mimetype,
+    gchar * padname, guint index)
+{
+  gchar *pipeline = NULL;
+  const gchar *payloader = NULL;
+
+  payloader = rtsp_sink_get_payloader_from_mime (mimetype);
+  if (!payloader)
+    goto exit;
+
+  if (sink->direct_feed)
+    pipeline = g_strdup_printf (DIRECT_PIPEDESC, DEFAULT_FEED_QUEUE_SIZE,
+        padname, payloader, index);
+  else if (sink->shared_payload)
+    pipeline = g_strdup_printf (SHARED_PIPEDESC, DEFAULT_CONSUMER_MAX_BYTES,
+        index);
+  else
+    pipeline = g_strdup_printf (PIPEDESC, padname, payloader, index);
+
+exit:
+  {
+    return pipeline;
+  }
+}
+
+static gboolean
+rtsp_sink_get_factory_by_mapping (GstRtspSink * sink, GstRtspSinkPad * pad,
+    gpointer data)
+{
+  gpointer *factorydata = (gpointer *) data;
+  RrRtspMediaFactory **factory = (RrRtspMediaFactory **) factorydata[1];
+  const gchar *mapping = (gchar *) factorydata[0];
+
+  if (pad->factory && !strcmp (mapping, pad->factory->mapping)) {
+    GST_DEBUG_OBJECT (sink, "Recycling mapping %s for %s", mapping,
+        GST_OBJECT_NAME (pad));
+    *factory = gst_object_ref (pad->factory);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static gboolean
+rtsp_sink_configure_mapping (GstRtspSink * sink, GstPad * pad,
+    gchar * mapping, const gchar * mimetype)
+{
+  GstRtspSinkPad *mypad = GST_RTSP_SINK_PAD (pad);
+  RrRtspMediaFactory *factory = NULL;
+  GstRTSPMountPoints *rtsp_mount_points;
+  gchar *new_pipeline = NULL;
+  gchar *full_pipeline = NULL;
+  gchar *current_pipeline = NULL;
+  gboolean has_factory = FALSE;
+  gpointer factorydata[2] = { mapping, &factory };
+  /* Auth */
+  GstRTSPAuth *auth;
+  GstRTSPToken *token;
+  gchar *basic;
+  gchar *authorize = NULL;
+  gchar *p, *comma, *col;
+  gchar *user = NULL, *passwd = NULL;
+  gboolean usernumber = TRUE;
+  gboolean AUTHO = TRUE;
+
+  rtsp_sink_iterate_pads (sink, rtsp_sink_get_factory_by_mapping, factorydata);
+  has_factory = factory ? TRUE : FALSE;
+  if (has_factory) {
+    factory->index++;
+  } else {
+    /* Create the factory that will remain associated with this mapping */
+    factory = rr_rtsp_media_factory_new ();
+    if (!factory)
+      goto no_factory;
+  }
+
+
+  /* Setting the multicast group */
+  if (sink->multicast) {
+    GST_INFO_OBJECT (sink, "multicast support set on %s",
+        sink->multicast ? "true" : "false");
+    /* make a new address pool */
+    gst_rtsp_media_factory_set_address_pool (GST_RTSP_MEDIA_FACTORY
+        (factory), sink->pool);
+    /* only allow multicast */
+    gst_rtsp_media_factory_set_protocols (GST_RTSP_MEDIA_FACTORY (factory),
+        GST_RTSP_LOWER_TRANS_UDP_MCAST);
+  }
+
+  new_pipeline =
+      rtsp_sink_get_pipeline (sink, mimetype, GST_OBJECT_NAME (pad),
+      factory->index);
+  if (!new_pipeline)
+    goto no_payloader;
+  mypad->payindex = factory->index;
+
+  GST_INFO_OBJECT (sink, "Using \"%s\" as pipeline for %s", new_pipeline,
+      GST_OBJECT_NAME (pad));
+
+  if (has_factory) {
+    current_pipeline =
         gst_rtsp_media_factory_get_launch (GST_RTSP_MEDIA_FACTORY (factory));
     full_pipeline =
         g_malloc (strlen (new_pipeline) + strlen (current_pipeline) + 5);
@@ -978,9 +2009,15 @@ rtsp_sink_configure_mapping (GstRtspSink * sink, GstPad * pad,
       gst_object_ref (GST_RTSP_MEDIA_FACTORY (factory)));
 
   /* Store the name of the mapping */
-  factory->mapping = g_strdup (mapping);
+  if (!has_factory)
+    factory->mapping = g_strdup (mapping);
   mypad->factory = factory;
 
+  /* If the mapping is streaming already, its current media was built
+     without us. Its clients are left alone, new ones get the new
+     description once the media is created again */
+  mypad->generation = factory->generation + 1;
+
   /* don't need the ref to the mapper anymore */
   g_object_unref (rtsp_mount_points);
   g_free (full_pipeline);
@@ -1107,6 +2144,10 @@ rtsp_sink_attach_if_needed (GstRtspSink * sink)
 {
   gboolean needs_attach = TRUE;
 
+  /* Hot added mappings go live as soon as they are mounted */
+  if (sink->attached)
+    return TRUE;
+
   rtsp_sink_iterate_pads (sink, rtsp_sink_needs_attach, &needs_attach);
   if (needs_attach) {
     /* This is the same as set port */
@@ -1184,16 +2225,341 @@ rtsp_client_connected_callback (GstRTSPServer * server,
     GstRTSPClient * client, gpointer data)
 {
   GstRtspSink *sink = GST_RTSP_SINK (data);
+  GstRTSPConnection *conn;
+  GstRtspSinkClient *sinkclient;
+  guint batch_bytes, backlog_bytes;
+  GstClockTime backlog_time;
 
   GST_INFO_OBJECT (sink, "New client connected");
+
+  sinkclient = g_new0 (GstRtspSinkClient, 1);
+  sinkclient->client = g_object_ref (client);
+  sinkclient->connected = g_get_monotonic_time () * GST_USECOND;
+  sinkclient->plays = 0;
+
+  GST_OBJECT_LOCK (sink);
+  batch_bytes = sink->tcp_batch_bytes;
+  backlog_bytes = sink->tcp_backlog_bytes;
+  backlog_time = sink->tcp_backlog_time;
+  GST_OBJECT_UNLOCK (sink);
+
+  /* Interleaved RTP shares the RTSP connection, only TCP clients are
+     affected by these */
+  conn = gst_rtsp_client_get_connection (client);
+  if (conn) {
+#ifdef HAVE_GST_RTSP_CONNECTION_SET_SEND_BATCH
+    gst_rtsp_connection_set_send_batch (conn, batch_bytes);
+    gst_rtsp_connection_set_send_backlog (conn, backlog_bytes, backlog_time);
+#else
+    if (batch_bytes || backlog_bytes || backlog_time)
+      GST_WARNING_OBJECT (sink, "TCP batching and backlog limits are not "
+          "supported by this gstreamer-rtsp library");
+#endif
+    sinkclient->address = g_strdup (gst_rtsp_connection_get_ip (conn));
+  }
+
+  GST_OBJECT_LOCK (sink);
+  g_hash_table_insert (sink->clients, client, sinkclient);
+  GST_OBJECT_UNLOCK (sink);
+
   g_signal_connect (client, "new-session", G_CALLBACK (configure_timeout),
       sink);
+  g_signal_connect (client, "play-request",
+      G_CALLBACK (rtsp_client_play_request), sink);
+  g_signal_connect_object (client, "closed", G_CALLBACK (rtsp_client_closed),
+      sink, 0);
+}
+
+static void
+rtsp_client_closed (GstRTSPClient * client, gpointer user_data)
+{
+  GstRtspSink *sink = GST_RTSP_SINK (user_data);
+
+  GST_INFO_OBJECT (sink, "Client disconnected");
+
+  GST_OBJECT_LOCK (sink);
+  g_hash_table_remove (sink->clients, client);
+  GST_OBJECT_UNLOCK (sink);
+}
+
+static void
+rtsp_sink_client_free (GstRtspSinkClient * sinkclient)
+{
+  g_object_unref (sinkclient->client);
+  g_free (sinkclient->address);
+  g_free (sinkclient->mapping);
+  g_free (sinkclient);
+}
+
+static void
+rtsp_client_play_request (GstRTSPClient * client, GstRTSPContext * ctx,
+    gpointer user_data)
+{
+  GstRtspSink *sink = GST_RTSP_SINK (user_data);
+  GstRtspSinkClient *sinkclient;
+
+  if (!ctx->uri)
+    return;
+
+  GST_OBJECT_LOCK (sink);
+  sinkclient = g_hash_table_lookup (sink->clients, client);
+  if (sinkclient) {
+    g_free (sinkclient->mapping);
+    sinkclient->mapping = g_strdup (ctx->uri->abspath);
+    g_atomic_int_inc (&sinkclient->plays);
+  }
+  GST_OBJECT_UNLOCK (sink);
+
+  if (!sink->gop_cache)
+    return;
+
+  /* A client joining a running media can't get the cached GOP, since the
+     media is shared, ask upstream for a fresh keyframe instead */
+  rtsp_sink_iterate_pads (sink, rtsp_sink_request_keyframe,
+      ctx->uri->abspath);
+}
+
+/* Whether a request path is for mapping, either exactly or for one of its
+ * streams. "/cam10" is not a path of "/cam1" */
+static gboolean
+rtsp_sink_path_matches (const gchar * path, const gchar * mapping)
+{
+  gsize len = strlen (mapping);
+
+  if (strncmp (path, mapping, len) != 0)
+    return FALSE;
+
+  return path[len] == '\0' || path[len] == '/' ||
+      (len > 0 && mapping[len - 1] == '/');
+}
+
+static gboolean
+rtsp_sink_request_keyframe (GstRtspSink * sink, GstRtspSinkPad * pad,
+    gpointer data)
+{
+  const gchar *path = (const gchar *) data;
+
+  if (!pad->factory || !rtsp_sink_path_matches (path, pad->factory->mapping))
+    return TRUE;
+
+  GST_INFO_OBJECT (sink, "Requesting keyframe for mapping %s",
+      pad->factory->mapping);
+  gst_pad_push_event (GST_PAD (pad),
+      gst_video_event_new_upstream_force_key_unit (GST_CLOCK_TIME_NONE, TRUE,
+          0));
+
+  return TRUE;
+}
+
+/* Fills the receiver report of the client at address, if any. The sources
+ * in the RTP session have no link to the RTSP client, so they are matched
+ * by the address they send RTCP from. This only works for UDP transports.
+ */
+static gboolean
+rtsp_sink_get_receiver_report (GstRTSPStream * stream, const gchar * address,
+    GstStructure * clientstats)
+{
+  GObject *rtpsession;
+  GstStructure *stats = NULL;
+  const GValue *value;
+  GValueArray *sources;
+  gsize len = strlen (address);
+  gboolean found = FALSE;
+  guint i;
+
+  rtpsession = gst_rtsp_stream_get_rtpsession (stream);
+  if (!rtpsession)
+    return FALSE;
+
+  g_object_get (rtpsession, "stats", &stats, NULL);
+  g_object_unref (rtpsession);
+  if (!stats)
+    return FALSE;
+
+  value = gst_structure_get_value (stats, "source-stats");
+  if (!value || !G_VALUE_HOLDS_BOXED (value))
+    goto out;
+
+  sources = (GValueArray *) g_value_get_boxed (value);
+  for (i = 0; sources && i < sources->n_values && !found; ++i) {
+    const GstStructure *source =
+        gst_value_get_structure (&sources->values[i]);
+    gboolean internal = TRUE, have_rb = FALSE;
+    const gchar *from;
+    guint fractionlost = 0, jitter = 0;
+    gint packetslost = 0;
+
+    gst_structure_get (source, "internal", G_TYPE_BOOLEAN, &internal,
+        "have-rb", G_TYPE_BOOLEAN, &have_rb, NULL);
+    if (internal || !have_rb)
+      continue;
+
+    from = gst_structure_get_string (source, "rtcp-from");
+    if (!from || strncmp (from, address, len) || from[len] != ':')
+      continue;
+
+    gst_structure_get (source, "rb-fractionlost", G_TYPE_UINT, &fractionlost,
+        "rb-packetslost", G_TYPE_INT, &packetslost,
+        "rb-jitter", G_TYPE_UINT, &jitter, NULL);
+    gst_structure_set (clientstats, "fraction-lost", G_TYPE_UINT,
+        fractionlost, "packets-lost", G_TYPE_INT, packetslost,
+        "jitter", G_TYPE_UINT, jitter, NULL);
+    found = TRUE;
+  }
+
+out:
+  gst_structure_free (stats);
+  return found;
+}
+
+static void
+rtsp_sink_get_client_report (GstRTSPClient * client, const gchar * address,
+    GstStructure * clientstats)
+{
+  GList *sessions, *swalk;
+  gboolean found = FALSE;
+
+  sessions = gst_rtsp_client_session_filter (client, NULL, NULL);
+  for (swalk = sessions; swalk && !found; swalk = swalk->next) {
+    GList *medias, *mwalk;
+
+    medias = gst_rtsp_session_filter (swalk->data, NULL, NULL);
+    for (mwalk = medias; mwalk && !found; mwalk = mwalk->next) {
+      GstRTSPMedia *media = gst_rtsp_session_media_get_media (mwalk->data);
+      guint i;
+
+      for (i = 0; i < gst_rtsp_media_n_streams (media) && !found; ++i)
+        found = rtsp_sink_get_receiver_report (gst_rtsp_media_get_stream
+            (media, i), address, clientstats);
+    }
+    g_list_free_full (medias, g_object_unref);
+  }
+  g_list_free_full (sessions, g_object_unref);
+}
+
+static gboolean
+rtsp_sink_collect_stats (GstRtspSink * sink, GstRtspSinkPad * pad,
+    gpointer data)
+{
+  GValue *mappings = (GValue *) data;
+  GValue value = G_VALUE_INIT;
+
+  g_value_init (&value, GST_TYPE_STRUCTURE);
+  g_value_take_boxed (&value, gst_rtsp_sink_pad_get_stats (pad));
+  gst_value_array_append_and_take_value (mappings, &value);
+
+  return TRUE;
+}
+
+static GstStructure *
+gst_rtsp_sink_get_stats (GstRtspSink * sink)
+{
+  GstStructure *stats;
+  GValue mappings = G_VALUE_INIT;
+  GValue clients = G_VALUE_INIT;
+  GHashTableIter iter;
+  GstRtspSinkClient *sinkclient;
+  GList *reports = NULL, *walk;
+  GstClockTime now = g_get_monotonic_time () * GST_USECOND;
+  guint i;
+
+  g_value_init (&mappings, GST_TYPE_ARRAY);
+  g_value_init (&clients, GST_TYPE_ARRAY);
+
+  g_mutex_lock (&sink->padlock);
+  rtsp_sink_iterate_pads (sink, rtsp_sink_collect_stats, &mappings);
+  g_mutex_unlock (&sink->padlock);
+
+  /* Snapshot the clients, the RTCP lookup can't run under the lock */
+  GST_OBJECT_LOCK (sink);
+  g_hash_table_iter_init (&iter, sink->clients);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & sinkclient)) {
+    GstStructure *clientstats = gst_structure_new ("client-stats",
+        "address", G_TYPE_STRING, sinkclient->address,
+        "mapping", G_TYPE_STRING, sinkclient->mapping,
+        "connected-time", G_TYPE_UINT64, now - sinkclient->connected,
+        "plays", G_TYPE_UINT, g_atomic_int_get (&sinkclient->plays), NULL);
+
+    /* Pairs of client and its structure */
+    reports = g_list_prepend (reports, g_object_ref (sinkclient->client));
+    reports = g_list_prepend (reports, clientstats);
+  }
+  GST_OBJECT_UNLOCK (sink);
+
+  for (walk = reports; walk; walk = walk->next->next) {
+    GstStructure *clientstats = walk->data;
+    GstRTSPClient *client = walk->next->data;
+    const gchar *address = gst_structure_get_string (clientstats, "address");
+    const gchar *mapping = gst_structure_get_string (clientstats, "mapping");
+    GValue value = G_VALUE_INIT;
+
+    if (address)
+      rtsp_sink_get_client_report (client, address, clientstats);
+    g_object_unref (client);
+
+    /* Account the client in its mapping */
+    for (i = 0; mapping && i < gst_value_array_get_size (&mappings); ++i) {
+      GstStructure *mappingstats = (GstStructure *)
+          gst_value_get_structure (gst_value_array_get_value (&mappings, i));
+      const gchar *name = gst_structure_get_string (mappingstats, "mapping");
+      guint count = 0;
+
+      if (!name || !rtsp_sink_path_matches (mapping, name))
+        continue;
+
+      gst_structure_get_uint (mappingstats, "clients", &count);
+      gst_structure_set (mappingstats, "clients", G_TYPE_UINT, count + 1,
+          NULL);
+    }
+
+    g_value_init (&value, GST_TYPE_STRUCTURE);
+    g_value_take_boxed (&value, clientstats);
+    gst_value_array_append_and_take_value (&clients, &value);
+  }
+  g_list_free (reports);
+
+  stats = gst_structure_new ("rtspsink-stats",
+      "clients", G_TYPE_UINT, gst_value_array_get_size (&clients), NULL);
+  gst_structure_take_value (stats, "mapping-stats", &mappings);
+  gst_structure_take_value (stats, "client-stats", &clients);
+
+  return stats;
+}
+
+static gboolean
+rtsp_sink_post_stats (GstRtspSink * sink)
+{
+  GstStructure *stats = gst_rtsp_sink_get_stats (sink);
+
+  gst_element_post_message (GST_ELEMENT (sink),
+      gst_message_new_element (GST_OBJECT (sink), stats));
+
+  return TRUE;
+}
+
+static void
+rtsp_sink_schedule_stats (GstRtspSink * sink)
+{
+  guint interval;
+
+  GST_OBJECT_LOCK (sink);
+  interval = sink->stats_interval;
+  GST_OBJECT_UNLOCK (sink);
+
+  if (sink->stats_source)
+    g_source_remove (sink->stats_source);
+  sink->stats_source = 0;
+
+  if (interval)
+    sink->stats_source = g_timeout_add (interval,
+        (GSourceFunc) rtsp_sink_post_stats, sink);
 }
 
 static gboolean
 gst_rtsp_sink_start (GstRtspSink * sink)
 {
   static const gint period = 2;
+  GstRtspSinkIoPool *iopool;
 
   GST_DEBUG_OBJECT (sink, "Initializing RtspSink");
 
@@ -1203,12 +2569,28 @@ gst_rtsp_sink_start (GstRtspSink * sink)
     return FALSE;
   }
 
+  /* Spread the client connections over our own threads instead of
+     serving all of them from the default main context */
+  if (sink->io_threads) {
+    iopool = gst_rtsp_sink_io_pool_new (sink->io_threads, sink->io_cpus);
+    if (iopool) {
+      gst_rtsp_server_set_thread_pool (sink->server,
+          GST_RTSP_THREAD_POOL (iopool));
+      g_object_unref (iopool);
+    } else {
+      GST_WARNING_OBJECT (sink, "Unable to start I/O threads, serving "
+          "clients from the default main context");
+    }
+  }
+
   sink->timeout_source =
       g_timeout_add_seconds (period, (GSourceFunc) rtsp_sink_timeout, sink);
 
   g_signal_connect (sink->server, "client-connected",
       G_CALLBACK (rtsp_client_connected_callback), sink);
 
+  rtsp_sink_schedule_stats (sink);
+
 #ifdef EVAL
   print_eval ();
 #endif
@@ -1222,9 +2604,18 @@ rtsp_sink_remove_mappings (GstRtspSink * sink, GstRtspSinkPad * pad,
 {
   GstRTSPMountPoints *mount_points;
 
+  /* Hot added pads may still be waiting for caps */
+  if (!pad->factory)
+    return TRUE;
+
   mount_points = gst_rtsp_server_get_mount_points (sink->server);
   gst_rtsp_mount_points_remove_factory (mount_points, pad->factory->mapping);
 
+  if (pad->feedpad) {
+    gst_object_unref (pad->feedpad);
+    pad->feedpad = NULL;
+  }
+
   /* Also remove factory references from pads that they are created
      again and avoid duplicate element errors in bins */
   gst_object_unref (pad->factory);
@@ -1235,6 +2626,114 @@ rtsp_sink_remove_mappings (GstRtspSink * sink, GstRtspSinkPad * pad,
   return TRUE;
 }
 
+/* Drops the branch ending in the payloader with the given index from a
+   launch description built by rtsp_sink_configure_mapping. The server
+   only looks for pay0, pay1... up to the first missing one, so the
+   payloaders after it are renamed to close the gap */
+static gchar *
+rtsp_sink_remove_from_launch (const gchar * launch, guint index)
+{
+  gchar **tokens;
+  GString *result;
+  guint i, start = 0;
+  guint64 payindex;
+
+  tokens = g_strsplit (launch, " ", -1);
+  result = g_string_new (NULL);
+
+  for (i = 0; tokens[i]; i++) {
+    if (!g_str_has_prefix (tokens[i], "name=pay"))
+      continue;
+
+    /* Each branch ends with the name of its payloader */
+    payindex = g_ascii_strtoull (tokens[i] + strlen ("name=pay"), NULL, 10);
+    if (payindex != index) {
+      if (payindex > index) {
+        g_free (tokens[i]);
+        tokens[i] = g_strdup_printf ("name=pay%u", (guint) payindex - 1);
+      }
+      for (; start <= i; start++) {
+        if (result->len)
+          g_string_append_c (result, ' ');
+        g_string_append (result, tokens[start]);
+      }
+    }
+    start = i + 1;
+  }
+
+  g_strfreev (tokens);
+
+  return g_string_free (result, FALSE);
+}
+
+static gboolean
+rtsp_sink_renumber_payloader (GstRtspSink * sink, GstRtspSinkPad * pad,
+    gpointer data)
+{
+  gpointer *renumberdata = (gpointer *) data;
+  RrRtspMediaFactory *factory = renumberdata[0];
+  guint index = *(guint *) renumberdata[1];
+
+  if (pad->factory == factory && pad->payindex > index)
+    pad->payindex--;
+
+  return TRUE;
+}
+
+/* Detaches a released pad from its mapping. Clients of the running media
+   get an EOS for this stream, and the mount point goes away along with
+   the last pad feeding it. Otherwise the pad is left out of the media
+   created for the next clients */
+static void
+rtsp_sink_unmap_pad (GstRtspSink * sink, GstRtspSinkPad * pad)
+{
+  RrRtspMediaFactory *factory = pad->factory;
+  RrRtspMediaFactory *other = NULL;
+  gpointer factorydata[2] = { factory->mapping, &other };
+  GstRTSPMountPoints *mount_points;
+  gchar *launch, *new_launch;
+  gpointer renumberdata[2] = { factory, &pad->payindex };
+
+  if (pad->feedpad) {
+    gst_pad_send_event (pad->feedpad, gst_event_new_eos ());
+    gst_object_unref (pad->feedpad);
+    pad->feedpad = NULL;
+  }
+
+  if (pad->appsrc) {
+    gst_app_src_end_of_stream (pad->appsrc);
+    gst_object_unref (pad->appsrc);
+    pad->appsrc = NULL;
+  }
+
+  /* Look for anyone else still using the mapping */
+  pad->factory = NULL;
+  rtsp_sink_iterate_pads (sink, rtsp_sink_get_factory_by_mapping, factorydata);
+
+  if (other) {
+    launch = gst_rtsp_media_factory_get_launch (GST_RTSP_MEDIA_FACTORY
+        (factory));
+    new_launch = rtsp_sink_remove_from_launch (launch, pad->payindex);
+    GST_INFO_OBJECT (sink, "Using reduced pipeline %s", new_launch);
+    gst_rtsp_media_factory_set_launch (GST_RTSP_MEDIA_FACTORY (factory),
+        new_launch);
+    g_free (new_launch);
+    g_free (launch);
+
+    /* Keep the indexes in line with the new payloader names */
+    rtsp_sink_iterate_pads (sink, rtsp_sink_renumber_payloader, renumberdata);
+    factory->index--;
+    gst_object_unref (other);
+  } else if (sink->server) {
+    GST_INFO_OBJECT (sink, "Removing mapping %s", factory->mapping);
+    mount_points = gst_rtsp_server_get_mount_points (sink->server);
+    gst_rtsp_mount_points_remove_factory (mount_points, factory->mapping);
+    gst_object_unref (mount_points);
+  }
+
+  gst_object_unref (factory);
+}
+
 static gboolean
 rtsp_sink_reset_caps (GstRtspSink * sink, GstRtspSinkPad * pad, gpointer data)
 {
@@ -1244,6 +2743,13 @@ rtsp_sink_reset_caps (GstRtspSink * sink, GstRtspSinkPad * pad, gpointer data)
   g_return_val_if_fail (NULL != sink, FALSE);
   g_return_val_if_fail (NULL != pad, FALSE);
 
+  /* Direct feed pads hold no caps of their own, just start over */
+  if (sink->direct_feed) {
+    gst_segment_init (&pad->segment, GST_FORMAT_TIME);
+    pad->eos = FALSE;
+    return TRUE;
+  }
+
   appsink = GST_APP_SINK (gst_bin_get_by_name (GST_BIN (sink),
           GST_OBJECT_NAME (pad)));
 
@@ -1297,6 +2803,10 @@ gst_rtsp_sink_stop (GstRtspSink * sink)
 
   GST_DEBUG_OBJECT (sink, "Closing current RTSP session");
 
+  if (sink->stats_source)
+    g_source_remove (sink->stats_source);
+  sink->stats_source = 0;
+
   if (!sink->attached) {
     GST_INFO_OBJECT (sink, "Not attached");
     return;
@@ -1312,7 +2822,13 @@ gst_rtsp_sink_stop (GstRtspSink * sink)
   g_object_unref (session_pool);
 
   /* remove the test factories url */
+  g_mutex_lock (&sink->padlock);
   rtsp_sink_iterate_pads (sink, rtsp_sink_remove_mappings, NULL);
+  g_mutex_unlock (&sink->padlock);
+
+  GST_OBJECT_LOCK (sink);
+  g_hash_table_remove_all (sink->clients);
+  GST_OBJECT_UNLOCK (sink);
 
   /* Remove the source from the main context to release the socket */
   if (sink->source)
@@ -1390,8 +2906,10 @@ gst_rtsp_sink_finalize (GObject * object)
   g_free (sink->ip_min);
   g_free (sink->ip_max);
   g_free (sink->auth);
+  g_free (sink->io_cpus);
 
   g_object_unref (sink->pool);
+  g_hash_table_unref (sink->clients);
 
   /* Chain up to the parent class */
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -1405,6 +2923,9 @@ gst_rtsp_sink_event_function (GstPad * pad, GstObject * parent,
 
   GST_LOG_OBJECT (pad, "Got %s event", GST_EVENT_TYPE_NAME (event));
 
+  if (GST_RTSP_SINK (parent)->direct_feed)
+    return gst_rtsp_sink_feed_event (pad, event);
+
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_CAPS:
     {
@@ -72,7 +72,33 @@ struct _GstRtspSink
   gchar *auth;
 
   GstRTSPAddressPool *pool;
-  
+
+  /* Bypass appsink/appsrc and feed the payloaders directly */
+  gboolean direct_feed;
+
+  /* Payload once per mapping and feed the RTP packets to the media */
+  gboolean shared_payload;
+
+  /* Per mapping GOP cache for fast client start */
+  gboolean gop_cache;
+  guint gop_cache_max_bytes;
+  GstClockTime gop_cache_max_time;
+
+  guint tcp_batch_bytes;
+  guint tcp_backlog_bytes;
+  GstClockTime tcp_backlog_time;
+
+  /* Connected clients, protected by the object lock */
+  GHashTable *clients;
+
+  /* Periodic statistics message */
+  guint stats_interval;
+  guint stats_source;
+
+  /* Client I/O threads */
+  guint io_threads;
+  gchar *io_cpus;
+
   GMutex padlock;
 };
 
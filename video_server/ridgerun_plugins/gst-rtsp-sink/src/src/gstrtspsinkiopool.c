@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2016-2017 RidgeRun, LLC (http://www.ridgerun.com)
+ * All Rights Reserved.
+ *
+ * The contents of this software are proprietary and confidential to RidgeRun,
+ * LLC.  No part of this program may be photocopied, reproduced or translated
+ * into another programming language without prior written consent of
+ * RidgeRun, LLC.  The user is free to modify the source code after obtaining
+ * a software license from RidgeRun.  All source code changes must be provided
+ * back to RidgeRun without any encumbrance.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+
+#include "gstrtspsinkiopool.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_rtsp_sink_io_pool_debug);
+#define GST_CAT_DEFAULT gst_rtsp_sink_io_pool_debug
+
+/* Bookkeeping attached to every thread of the pool */
+typedef struct _GstRtspSinkIoThread GstRtspSinkIoThread;
+struct _GstRtspSinkIoThread
+{
+  guint index;
+  gint cpu;
+  volatile gint clients;
+};
+
+static GQuark io_thread_quark;
+
+G_DEFINE_TYPE (GstRtspSinkIoPool, gst_rtsp_sink_io_pool,
+    GST_TYPE_RTSP_THREAD_POOL);
+#define parent_class gst_rtsp_sink_io_pool_parent_class
+
+static void gst_rtsp_sink_io_pool_finalize (GObject * object);
+static GstRTSPThread *gst_rtsp_sink_io_pool_get_thread (GstRTSPThreadPool *
+    pool, GstRTSPThreadType type, GstRTSPContext * ctx);
+static gpointer gst_rtsp_sink_io_pool_run (gpointer data);
+static void gst_rtsp_sink_io_pool_client_closed (GstRTSPClient * client,
+    gpointer data);
+static GArray *gst_rtsp_sink_io_pool_parse_cpus (const gchar * cpus);
+
+static void
+gst_rtsp_sink_io_pool_class_init (GstRtspSinkIoPoolClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstRTSPThreadPoolClass *pool_class = GST_RTSP_THREAD_POOL_CLASS (klass);
+
+  gobject_class->finalize = gst_rtsp_sink_io_pool_finalize;
+  pool_class->get_thread = gst_rtsp_sink_io_pool_get_thread;
+
+  io_thread_quark = g_quark_from_static_string ("rtspsink-io-thread");
+
+  GST_DEBUG_CATEGORY_INIT (gst_rtsp_sink_io_pool_debug, "rtspsinkiopool", 0,
+      "GstRtspSink client I/O thread pool");
+}
+
+static void
+gst_rtsp_sink_io_pool_init (GstRtspSinkIoPool * this)
+{
+  this->threads = NULL;
+  this->n_threads = 0;
+}
+
+/* Starts the given amount of threads right away. If cpus is a list like
+ * "0,2-3" the threads are pinned to those CPUs in a round robin fashion.
+ */
+GstRtspSinkIoPool *
+gst_rtsp_sink_io_pool_new (guint threads, const gchar * cpus)
+{
+  GstRtspSinkIoPool *pool;
+  GstRtspSinkIoThread *iothread;
+  GArray *cpulist;
+  GError *error = NULL;
+  GThread *gthread;
+  gchar *name;
+  guint i;
+
+  g_return_val_if_fail (threads > 0, NULL);
+
+  pool = g_object_new (GST_TYPE_RTSP_SINK_IO_POOL, NULL);
+  pool->threads = g_new0 (GstRTSPThread *, threads);
+
+  cpulist = gst_rtsp_sink_io_pool_parse_cpus (cpus);
+
+  for (i = 0; i < threads; ++i) {
+    iothread = g_new0 (GstRtspSinkIoThread, 1);
+    iothread->index = i;
+    iothread->cpu = cpulist->len ?
+        g_array_index (cpulist, gint, i % cpulist->len) : -1;
+    iothread->clients = 0;
+
+    pool->threads[i] = gst_rtsp_thread_new (GST_RTSP_THREAD_TYPE_CLIENT);
+    gst_mini_object_set_qdata (GST_MINI_OBJECT (pool->threads[i]),
+        io_thread_quark, iothread, g_free);
+
+    /* The running thread holds its own reference */
+    name = g_strdup_printf ("rtspsink-io%u", i);
+    gthread = g_thread_try_new (name, gst_rtsp_sink_io_pool_run,
+        gst_rtsp_thread_ref (pool->threads[i]), &error);
+    g_free (name);
+    if (!gthread)
+      goto nothread;
+
+    g_thread_unref (gthread);
+    pool->n_threads++;
+  }
+
+  g_array_unref (cpulist);
+
+  GST_INFO_OBJECT (pool, "Started %u client I/O threads", pool->n_threads);
+
+  return pool;
+
+nothread:
+  {
+    GST_ERROR_OBJECT (pool, "Unable to start I/O thread: %s", error->message);
+    g_error_free (error);
+    gst_rtsp_thread_unref (pool->threads[i]);
+    gst_rtsp_thread_unref (pool->threads[i]);
+    pool->threads[i] = NULL;
+    g_array_unref (cpulist);
+    g_object_unref (pool);
+    return NULL;
+  }
+}
+
+static void
+gst_rtsp_sink_io_pool_finalize (GObject * object)
+{
+  GstRtspSinkIoPool *this = GST_RTSP_SINK_IO_POOL (object);
+  guint i;
+
+  GST_DEBUG_OBJECT (this, "Freeing I/O pool");
+
+  /* Each loop quits once its last client is gone */
+  for (i = 0; i < this->n_threads; ++i)
+    gst_rtsp_thread_stop (this->threads[i]);
+  g_free (this->threads);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static GstRTSPThread *
+gst_rtsp_sink_io_pool_get_thread (GstRTSPThreadPool * pool,
+    GstRTSPThreadType type, GstRTSPContext * ctx)
+{
+  GstRtspSinkIoPool *this = GST_RTSP_SINK_IO_POOL (pool);
+  GstRtspSinkIoThread *iothread, *best = NULL;
+  GstRTSPThread *thread = NULL;
+  guint i;
+
+  /* Media threads are none of our business */
+  if (GST_RTSP_THREAD_TYPE_CLIENT != type || !ctx || !ctx->client)
+    return GST_RTSP_THREAD_POOL_CLASS (parent_class)->get_thread (pool, type,
+        ctx);
+
+  for (i = 0; i < this->n_threads; ++i) {
+    iothread = gst_mini_object_get_qdata (GST_MINI_OBJECT (this->threads[i]),
+        io_thread_quark);
+    if (!best
+        || g_atomic_int_get (&iothread->clients) <
+        g_atomic_int_get (&best->clients)) {
+      best = iothread;
+      thread = this->threads[i];
+    }
+  }
+
+  if (!thread || !gst_rtsp_thread_reuse (thread))
+    return NULL;
+
+  g_atomic_int_inc (&best->clients);
+  g_signal_connect_data (ctx->client, "closed",
+      G_CALLBACK (gst_rtsp_sink_io_pool_client_closed),
+      gst_rtsp_thread_ref (thread), (GClosureNotify) gst_rtsp_thread_unref, 0);
+
+  GST_DEBUG_OBJECT (this, "Client %p goes to thread %u (%d clients)",
+      ctx->client, best->index, g_atomic_int_get (&best->clients));
+
+  /* gst_rtsp_thread_reuse() took the reference handed to the server, which
+   * stops and unrefs the thread when the client goes away */
+  return thread;
+}
+
+static void
+gst_rtsp_sink_io_pool_client_closed (GstRTSPClient * client, gpointer data)
+{
+  GstRTSPThread *thread = (GstRTSPThread *) data;
+  GstRtspSinkIoThread *iothread;
+
+  iothread = gst_mini_object_get_qdata (GST_MINI_OBJECT (thread),
+      io_thread_quark);
+  g_atomic_int_add (&iothread->clients, -1);
+}
+
+static gpointer
+gst_rtsp_sink_io_pool_run (gpointer data)
+{
+  GstRTSPThread *thread = (GstRTSPThread *) data;
+  GstRtspSinkIoThread *iothread;
+
+  iothread = gst_mini_object_get_qdata (GST_MINI_OBJECT (thread),
+      io_thread_quark);
+
+#ifdef HAVE_SCHED_SETAFFINITY
+  if (iothread->cpu >= 0) {
+    cpu_set_t set;
+
+    CPU_ZERO (&set);
+    CPU_SET (iothread->cpu, &set);
+    if (sched_setaffinity (0, sizeof (set), &set))
+      GST_WARNING ("Unable to pin I/O thread %u to CPU %d", iothread->index,
+          iothread->cpu);
+  }
+#else
+  if (iothread->cpu >= 0)
+    GST_WARNING ("CPU pinning is not supported on this platform");
+#endif
+
+  GST_DEBUG ("I/O thread %u running on CPU %d", iothread->index,
+      iothread->cpu);
+
+  g_main_context_push_thread_default (thread->context);
+  g_main_loop_run (thread->loop);
+  g_main_context_pop_thread_default (thread->context);
+
+  GST_DEBUG ("I/O thread %u exiting", iothread->index);
+  gst_rtsp_thread_unref (thread);
+
+  return NULL;
+}
+
+static GArray *
+gst_rtsp_sink_io_pool_parse_cpus (const gchar * cpus)
+{
+  GArray *list = g_array_new (FALSE, FALSE, sizeof (gint));
+  gchar **ranges;
+  gchar *end;
+  gint first, last, cpu;
+  guint i;
+
+  if (!cpus)
+    return list;
+
+  ranges = g_strsplit (cpus, ",", -1);
+  for (i = 0; ranges[i]; ++i) {
+    first = strtol (ranges[i], &end, 10);
+    last = '-' == *end ? strtol (end + 1, &end, 10) : first;
+    if (end == ranges[i] || first < 0 || last < first) {
+      GST_WARNING ("Ignoring invalid CPU range \"%s\"", ranges[i]);
+      continue;
+    }
+
+    for (cpu = first; cpu <= last; ++cpu)
+      g_array_append_val (list, cpu);
+  }
+  g_strfreev (ranges);
+
+  return list;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2016-2017 RidgeRun, LLC (http://www.ridgerun.com)
+ * All Rights Reserved.
+ *
+ * The contents of this software are proprietary and confidential to RidgeRun,
+ * LLC.  No part of this program may be photocopied, reproduced or translated
+ * into another programming language without prior written consent of
+ * RidgeRun, LLC.  The user is free to modify the source code after obtaining
+ * a software license from RidgeRun.  All source code changes must be provided
+ * back to RidgeRun without any encumbrance.
+ */
+
+#ifndef __GST_RTSP_SINK_IO_POOL_H__
+#define __GST_RTSP_SINK_IO_POOL_H__
+
+#include <gst/gst.h>
+#include <gst/rtsp-server/rtsp-server.h>
+
+G_BEGIN_DECLS
+#define GST_TYPE_RTSP_SINK_IO_POOL (gst_rtsp_sink_io_pool_get_type ())
+#define GST_RTSP_SINK_IO_POOL(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_RTSP_SINK_IO_POOL, GstRtspSinkIoPool))
+#define GST_IS_RTSP_SINK_IO_POOL(obj) (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_RTSP_SINK_IO_POOL))
+typedef struct _GstRtspSinkIoPool GstRtspSinkIoPool;
+typedef struct _GstRtspSinkIoPoolClass GstRtspSinkIoPoolClass;
+
+/* A fixed set of client I/O threads. Every new client is attached to the
+   thread currently serving the least clients */
+struct _GstRtspSinkIoPool
+{
+  GstRTSPThreadPool parent;
+
+  GstRTSPThread **threads;
+  guint n_threads;
+};
+
+struct _GstRtspSinkIoPoolClass
+{
+  GstRTSPThreadPoolClass parent_class;
+};
+
+GType gst_rtsp_sink_io_pool_get_type (void);
+GstRtspSinkIoPool *gst_rtsp_sink_io_pool_new (guint threads,
+    const gchar * cpus);
+
+G_END_DECLS
+#endif // __GST_RTSP_SINK_IO_POOL_H__
@@ -70,6 +70,24 @@ gst_rtsp_sink_pad_init (GstRtspSinkPad * this)
   this->factory = NULL;
   this->appsrc = NULL;
   this->appsink = NULL;
+  this->feedpad = NULL;
+  gst_segment_init (&this->segment, GST_FORMAT_TIME);
+  this->ts_offset = 0;
+  this->last_dts = GST_CLOCK_TIME_NONE;
+  this->eos = FALSE;
+  this->generation = 0;
+  this->payloader = NULL;
+  this->payindex = 0;
+  g_queue_init (&this->gop);
+  this->gop_bytes = 0;
+  this->gop_valid = FALSE;
+  this->buffers = 0;
+  this->bytes = 0;
+  this->dropped = 0;
+  this->queue_bytes = 0;
+  this->last_bytes = 0;
+  this->last_sample = GST_CLOCK_TIME_NONE;
+  this->bitrate = 0;
 
 #ifdef EVAL
   this->start_time = GST_CLOCK_TIME_NONE;
@@ -95,6 +113,155 @@ gst_rtsp_sink_pad_finalize (GObject * object)
   }
   this->appsrc = NULL;
 
+  if (this->feedpad) {
+    gst_object_unref (this->feedpad);
+  }
+  this->feedpad = NULL;
+
+  gst_rtsp_sink_pad_cache_clear (this);
+
   /* Chain up to the parent class */
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
+
+/* Keeps track of the last keyframe and every delta unit after it. If the
+ * GOP grows beyond the given limits the cache is discarded until the next
+ * keyframe, since a partial GOP is not decodable anyway.
+ */
+void
+gst_rtsp_sink_pad_cache_buffer (GstRtspSinkPad * pad, GstBuffer * buf,
+    gsize max_bytes, GstClockTime max_time)
+{
+  GstBuffer *first;
+  GstClockTime start, end;
+  gsize size;
+
+  g_return_if_fail (pad);
+  g_return_if_fail (buf);
+
+  if (!GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT)) {
+    gst_rtsp_sink_pad_cache_clear (pad);
+    pad->gop_valid = TRUE;
+  } else if (!pad->gop_valid) {
+    /* Waiting for a keyframe */
+    return;
+  }
+
+  size = gst_buffer_get_size (buf);
+  if (max_bytes && pad->gop_bytes + size > max_bytes)
+    goto overflow;
+
+  first = g_queue_peek_head (&pad->gop);
+  if (first && GST_CLOCK_TIME_IS_VALID (max_time)) {
+    start = GST_BUFFER_DTS_OR_PTS (first);
+    end = GST_BUFFER_DTS_OR_PTS (buf);
+    if (GST_CLOCK_TIME_IS_VALID (start) && GST_CLOCK_TIME_IS_VALID (end)
+        && end > start && end - start > max_time)
+      goto overflow;
+  }
+
+  g_queue_push_tail (&pad->gop, gst_buffer_ref (buf));
+  pad->gop_bytes += size;
+
+  return;
+
+overflow:
+  {
+    GST_DEBUG_OBJECT (pad, "GOP exceeds the cache limits, discarding it");
+    gst_rtsp_sink_pad_cache_clear (pad);
+  }
+}
+
+void
+gst_rtsp_sink_pad_cache_clear (GstRtspSinkPad * pad)
+{
+  GstBuffer *buf;
+
+  g_return_if_fail (pad);
+
+  while ((buf = g_queue_pop_head (&pad->gop)))
+    gst_buffer_unref (buf);
+
+  pad->gop_bytes = 0;
+  pad->gop_valid = FALSE;
+}
+
+/* Returns a list of references to the cached buffers, oldest first. Free
+ * it with g_list_free_full (list, (GDestroyNotify) gst_buffer_unref).
+ */
+GList *
+gst_rtsp_sink_pad_cache_get (GstRtspSinkPad * pad)
+{
+  GList *list = NULL;
+  GList *walk;
+
+  g_return_val_if_fail (pad, NULL);
+
+  for (walk = pad->gop.tail; walk; walk = walk->prev)
+    list = g_list_prepend (list, gst_buffer_ref (walk->data));
+
+  return list;
+}
+
+/* Called for every buffer that enters the mapping. Only atomic adds here,
+ * this is the hot path.
+ */
+void
+gst_rtsp_sink_pad_count_buffer (GstRtspSinkPad * pad, GstBuffer * buf)
+{
+  g_atomic_pointer_add (&pad->buffers, 1);
+  g_atomic_pointer_add (&pad->bytes, gst_buffer_get_size (buf));
+}
+
+void
+gst_rtsp_sink_pad_count_dropped (GstRtspSinkPad * pad)
+{
+  g_atomic_pointer_add (&pad->dropped, 1);
+}
+
+guint64
+gst_rtsp_sink_pad_get_dropped (GstRtspSinkPad * pad)
+{
+  return (gsize) g_atomic_pointer_get (&pad->dropped);
+}
+
+/* Builds a snapshot of the mapping counters. The bitrate is averaged over
+ * at least a second, more frequent calls return the previous value.
+ */
+GstStructure *
+gst_rtsp_sink_pad_get_stats (GstRtspSinkPad * pad)
+{
+  GstStructure *stats;
+  GstClockTime now;
+  gsize bytes;
+
+  g_return_val_if_fail (pad, NULL);
+
+  bytes = (gsize) g_atomic_pointer_get (&pad->bytes);
+  now = g_get_monotonic_time () * GST_USECOND;
+
+  GST_OBJECT_LOCK (pad);
+  if (!GST_CLOCK_TIME_IS_VALID (pad->last_sample)) {
+    pad->last_sample = now;
+    pad->last_bytes = bytes;
+  } else if (now - pad->last_sample >= GST_SECOND) {
+    pad->bitrate = gst_util_uint64_scale (bytes - pad->last_bytes, 8 *
+        GST_SECOND, now - pad->last_sample);
+    pad->last_sample = now;
+    pad->last_bytes = bytes;
+  }
+
+  stats = gst_structure_new ("mapping-stats",
+      "pad", G_TYPE_STRING, GST_OBJECT_NAME (pad),
+      "mapping", G_TYPE_STRING, pad->factory ? pad->factory->mapping : NULL,
+      "buffers", G_TYPE_UINT64,
+      (guint64) (gsize) g_atomic_pointer_get (&pad->buffers),
+      "bytes", G_TYPE_UINT64, (guint64) bytes,
+      "dropped", G_TYPE_UINT64, gst_rtsp_sink_pad_get_dropped (pad),
+      "bitrate", G_TYPE_UINT64, pad->bitrate,
+      "queue-bytes", G_TYPE_UINT64,
+      (guint64) (gsize) g_atomic_pointer_get (&pad->queue_bytes), NULL);
+  GST_OBJECT_UNLOCK (pad);
+
+  return stats;
+}
@@ -20,6 +20,7 @@
 #include <gst/gst.h>
 #include "rtspmediafactory.h"
 #include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
 
 G_BEGIN_DECLS
 #define TYPE_GST_RTSP_SINK_PAD (gst_rtsp_sink_pad_get_type ())
@@ -39,6 +40,37 @@ struct _GstRtspSinkPad
   gchar *mapping;
   GstAppSink *appsink;
 
+  /* Direct feed: head pad of the mapping's payloader pipeline */
+  GstPad *feedpad;
+  GstSegment segment;
+  /* Direct feed and shared payload: our running time to media time */
+  GstClockTimeDiff ts_offset;
+  GstClockTime last_dts;
+  gboolean eos;
+
+  /* First media of the factory that carries this pad's stream */
+  guint generation;
+
+  /* Shared payload: persistent payloader */
+  GstElement *payloader;
+  guint payindex;
+
+  /* GOP cache: last keyframe and the delta units that follow it */
+  GQueue gop;
+  gsize gop_bytes;
+  gboolean gop_valid;
+
+  /* Statistics, updated atomically from the streaming thread */
+  volatile gsize buffers;
+  volatile gsize bytes;
+  volatile gsize dropped;
+  volatile gsize queue_bytes;
+
+  /* Bitrate sampling, protected by the object lock */
+  gsize last_bytes;
+  GstClockTime last_sample;
+  guint64 bitrate;
+
 #ifdef EVAL
   GstClockTime start_time;
 #endif
@@ -53,5 +85,15 @@ GstRtspSinkPad *gst_rtsp_sink_pad_new_from_template (GstPadTemplate * templ,
     const gchar * name);
 GType gst_rtsp_sink_pad_get_type (void);
 
+void gst_rtsp_sink_pad_cache_buffer (GstRtspSinkPad * pad, GstBuffer * buf,
+    gsize max_bytes, GstClockTime max_time);
+void gst_rtsp_sink_pad_cache_clear (GstRtspSinkPad * pad);
+GList *gst_rtsp_sink_pad_cache_get (GstRtspSinkPad * pad);
+
+void gst_rtsp_sink_pad_count_buffer (GstRtspSinkPad * pad, GstBuffer * buf);
+void gst_rtsp_sink_pad_count_dropped (GstRtspSinkPad * pad);
+guint64 gst_rtsp_sink_pad_get_dropped (GstRtspSinkPad * pad);
+GstStructure *gst_rtsp_sink_pad_get_stats (GstRtspSinkPad * pad);
+
 G_END_DECLS
 #endif // __RTSP_SINK_PAD_H__
@@ -66,6 +66,7 @@ rr_rtsp_media_factory_init (RrRtspMediaFactory * this)
   this->mapping = NULL;
   this->is_prepared = FALSE;
   this->index = 0;
+  this->generation = 0;
 
   /* If many clients connect, make them use our same pipeline instead of
    * creating a new one for each */
@@ -98,7 +99,8 @@ rr_rtsp_media_factory_create_pipeline (GstRTSPMediaFactory * base,
   g_signal_connect (media, "prepared",
       G_CALLBACK (rr_rtsp_media_factory_prepared), (gpointer) this);
 
-  GST_INFO_OBJECT (this, "Successfully created pipeline");
+  this->generation++;
+  GST_INFO_OBJECT (this, "Successfully created pipeline %u", this->generation);
   this->is_prepared = TRUE;
 
   return this->pipeline;
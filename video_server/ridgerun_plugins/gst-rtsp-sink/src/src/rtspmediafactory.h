@@ -35,6 +35,9 @@ struct _RrRtspMediaFactory
   gchar *mapping;
   gboolean is_prepared;
   guint index;
+
+  /* Amount of media pipelines created so far */
+  guint generation;
 };
 
 struct _RrRtspMediaFactoryClass
@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2016-2017 RidgeRun, LLC (http://www.ridgerun.com)
+ * All Rights Reserved.
+ *
+ * The contents of this software are proprietary and confidential to RidgeRun,
+ * LLC.  No part of this program may be photocopied, reproduced or translated
+ * into another programming language without prior written consent of
+ * RidgeRun, LLC.  The user is free to modify the source code after obtaining
+ * a software license from RidgeRun.  All source code changes must be provided
+ * back to RidgeRun without any encumbrance.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtsp-server/rtsp-server.h>
+
+#include "gstrtspsinkpad.h"
+
+/* The plug-in types are not linked into the test, the pads are looked
+   into through their structure */
+#define RTSP_SINK_PAD(pad) ((GstRtspSinkPad *) (pad))
+
+#define MAPPING "/test"
+#define MAX_STREAMS 4
+#define BUFFER_SIZE 160
+#define BUFFER_DURATION (20 * GST_MSECOND)
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstElement *
+setup_rtspsink (gboolean direct_feed, gboolean gop_cache)
+{
+  GstElement *sink;
+
+  sink = gst_check_setup_element ("rtspsink");
+  /* Let the server pick any free port, nobody connects to it */
+  g_object_set (sink, "service", "0", "direct-feed", direct_feed,
+      "gop-cache", gop_cache, NULL);
+  fail_if (gst_element_set_state (sink, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  return sink;
+}
+
+static void
+cleanup_rtspsink (GstElement * sink)
+{
+  gst_element_set_state (sink, GST_STATE_NULL);
+  gst_object_unref (sink);
+}
+
+/* Requests a pad and feeds it the events that put it in MAPPING */
+static GstPad *
+add_stream (GstElement * sink, GstPad ** srcpad)
+{
+  GstPad *sinkpad;
+  GstSegment segment;
+  GstCaps *caps;
+  gchar *stream_id;
+
+  sinkpad = gst_element_get_request_pad (sink, "sink_%d");
+  fail_unless (sinkpad != NULL);
+
+  *srcpad = gst_pad_new_from_static_template (&srctemplate, "src");
+  fail_unless (gst_pad_set_active (*srcpad, TRUE));
+  fail_unless_equals_int (gst_pad_link (*srcpad, sinkpad), GST_PAD_LINK_OK);
+
+  stream_id = g_strdup_printf ("rtspsink-test/%s", GST_PAD_NAME (sinkpad));
+  fail_unless (gst_pad_push_event (*srcpad,
+          gst_event_new_stream_start (stream_id)));
+  g_free (stream_id);
+
+  caps = gst_caps_new_simple ("audio/x-mulaw", "rate", G_TYPE_INT, 8000,
+      "channels", G_TYPE_INT, 1, "mapping", G_TYPE_STRING, MAPPING, NULL);
+  fail_unless (gst_pad_push_event (*srcpad, gst_event_new_caps (caps)));
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (*srcpad, gst_event_new_segment (&segment)));
+
+  fail_unless (RTSP_SINK_PAD (sinkpad)->factory != NULL);
+
+  return sinkpad;
+}
+
+static void
+remove_stream (GstElement * sink, GstPad * sinkpad, GstPad * srcpad)
+{
+  gst_pad_unlink (srcpad, sinkpad);
+  gst_element_release_request_pad (sink, sinkpad);
+  gst_object_unref (sinkpad);
+
+  gst_pad_set_active (srcpad, FALSE);
+  gst_object_unref (srcpad);
+}
+
+/* Checks that every pad owns one of the payloaders pay0..payN-1 of the
+   mapping, the server stops looking for streams at the first gap */
+static void
+check_mapping (GstPad ** sinkpads, guint n_streams)
+{
+  GstRTSPMediaFactory *factory;
+  GstRTSPMedia *media;
+  GstRTSPUrl *url;
+  GstElement *element, *payloader, *queue, *src;
+  GstPad *pad, *peer;
+  gboolean seen[MAX_STREAMS] = { FALSE, };
+  guint i, payindex;
+  gchar *name;
+
+  fail_unless (n_streams <= MAX_STREAMS);
+
+  factory = GST_RTSP_MEDIA_FACTORY (RTSP_SINK_PAD (sinkpads[0])->factory);
+  for (i = 0; i < n_streams; i++) {
+    fail_unless (GST_RTSP_MEDIA_FACTORY (RTSP_SINK_PAD (sinkpads[i])->factory)
+        == factory);
+    payindex = RTSP_SINK_PAD (sinkpads[i])->payindex;
+    fail_unless (payindex < n_streams, "%s uses pay%u with %u streams",
+        GST_PAD_NAME (sinkpads[i]), payindex, n_streams);
+    fail_if (seen[payindex], "pay%u is used twice", payindex);
+    seen[payindex] = TRUE;
+  }
+
+  /* Build the media the way the server does for a new client */
+  fail_unless_equals_int (gst_rtsp_url_parse ("rtsp://127.0.0.1" MAPPING,
+          &url), GST_RTSP_OK);
+  element = gst_rtsp_media_factory_create_element (factory, url);
+  fail_unless (element != NULL);
+  media = gst_rtsp_media_new (element);
+  gst_rtsp_media_collect_streams (media);
+  fail_unless_equals_int (gst_rtsp_media_n_streams (media), n_streams);
+
+  /* And each payloader is fed by the pad that claims it */
+  for (i = 0; i < n_streams; i++) {
+    name = g_strdup_printf ("pay%u", RTSP_SINK_PAD (sinkpads[i])->payindex);
+    payloader = gst_bin_get_by_name (GST_BIN (element), name);
+    fail_unless (payloader != NULL, "no %s in the media", name);
+    g_free (name);
+
+    pad = gst_element_get_static_pad (payloader, "sink");
+    peer = gst_pad_get_peer (pad);
+    queue = gst_pad_get_parent_element (peer);
+    gst_object_unref (peer);
+    gst_object_unref (pad);
+
+    pad = gst_element_get_static_pad (queue, "sink");
+    peer = gst_pad_get_peer (pad);
+    src = gst_pad_get_parent_element (peer);
+    fail_unless_equals_string (GST_ELEMENT_NAME (src),
+        GST_PAD_NAME (sinkpads[i]));
+    gst_object_unref (peer);
+    gst_object_unref (pad);
+
+    gst_object_unref (src);
+    gst_object_unref (queue);
+    gst_object_unref (payloader);
+  }
+
+  g_object_unref (media);
+  gst_rtsp_url_free (url);
+}
+
+GST_START_TEST (test_mapping_lifecycle)
+{
+  GstElement *sink;
+  GstPad *sinkpads[MAX_STREAMS];
+  GstPad *srcpads[MAX_STREAMS];
+  guint i;
+
+  sink = setup_rtspsink (FALSE, FALSE);
+
+  for (i = 0; i < 3; i++)
+    sinkpads[i] = add_stream (sink, &srcpads[i]);
+  check_mapping (sinkpads, 3);
+
+  /* Dropping a stream from the middle moves the following ones down */
+  remove_stream (sink, sinkpads[1], srcpads[1]);
+  sinkpads[1] = sinkpads[2];
+  srcpads[1] = srcpads[2];
+  fail_unless_equals_int (RTSP_SINK_PAD (sinkpads[0])->payindex, 0);
+  fail_unless_equals_int (RTSP_SINK_PAD (sinkpads[1])->payindex, 1);
+  check_mapping (sinkpads, 2);
+
+  /* A stream added back takes the payloader right after them */
+  sinkpads[2] = add_stream (sink, &srcpads[2]);
+  fail_unless_equals_int (RTSP_SINK_PAD (sinkpads[2])->payindex, 2);
+  check_mapping (sinkpads, 3);
+
+  /* Same for the first one */
+  remove_stream (sink, sinkpads[0], srcpads[0]);
+  for (i = 0; i < 2; i++) {
+    sinkpads[i] = sinkpads[i + 1];
+    srcpads[i] = srcpads[i + 1];
+  }
+  check_mapping (sinkpads, 2);
+  sinkpads[2] = add_stream (sink, &srcpads[2]);
+  check_mapping (sinkpads, 3);
+
+  for (i = 0; i < 3; i++)
+    remove_stream (sink, sinkpads[i], srcpads[i]);
+
+  cleanup_rtspsink (sink);
+}
+
+GST_END_TEST;
+
+static void
+push_buffer (GstPad * srcpad, guint8 id, GstClockTime pts, gboolean keyframe)
+{
+  GstBuffer *buf;
+
+  buf = gst_buffer_new_allocate (NULL, BUFFER_SIZE, NULL);
+  gst_buffer_memset (buf, 0, id, BUFFER_SIZE);
+  GST_BUFFER_PTS (buf) = pts;
+  GST_BUFFER_DURATION (buf) = BUFFER_DURATION;
+  if (!keyframe)
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  /* Without clients the buffers are dropped, but still cached */
+  fail_unless_equals_int (gst_pad_push (srcpad, buf), GST_FLOW_OK);
+}
+
+static guint8
+get_buffer_id (GstBuffer * buf)
+{
+  guint8 id = 0;
+
+  fail_unless_equals_int (gst_buffer_extract (buf, 0, &id, 1), 1);
+
+  return id;
+}
+
+/* Checks that the GOP cached in sinkpad holds the buffers ids, in order */
+static void
+check_cache (GstPad * sinkpad, const guint8 * ids, guint n_ids)
+{
+  GQueue *gop = &RTSP_SINK_PAD (sinkpad)->gop;
+  GList *walk;
+  guint i = 0;
+
+  fail_unless_equals_int (g_queue_get_length (gop), n_ids);
+  for (walk = gop->head; walk; walk = walk->next, i++)
+    fail_unless_equals_int (get_buffer_id (walk->data), ids[i]);
+}
+
+GST_START_TEST (test_gop_cache_order)
+{
+  GstElement *sink;
+  GstPad *sinkpad, *srcpad;
+  const guint8 first[] = { 1, 2, 3 };
+  const guint8 second[] = { 4, 5 };
+
+  sink = setup_rtspsink (TRUE, TRUE);
+  sinkpad = add_stream (sink, &srcpad);
+
+  /* Nothing to decode from before the first keyframe */
+  push_buffer (srcpad, 0, 0, FALSE);
+  check_cache (sinkpad, NULL, 0);
+
+  push_buffer (srcpad, 1, 1 * BUFFER_DURATION, TRUE);
+  push_buffer (srcpad, 2, 2 * BUFFER_DURATION, FALSE);
+  push_buffer (srcpad, 3, 3 * BUFFER_DURATION, FALSE);
+  check_cache (sinkpad, first, G_N_ELEMENTS (first));
+
+  /* A new keyframe starts over */
+  push_buffer (srcpad, 4, 4 * BUFFER_DURATION, TRUE);
+  push_buffer (srcpad, 5, 5 * BUFFER_DURATION, FALSE);
+  check_cache (sinkpad, second, G_N_ELEMENTS (second));
+
+  remove_stream (sink, sinkpad, srcpad);
+  cleanup_rtspsink (sink);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_gop_cache_limits)
+{
+  GstElement *sink;
+  GstPad *sinkpad, *srcpad;
+  const guint8 bytes_gop[] = { 1, 2 };
+  const guint8 bytes_next[] = { 5 };
+  const guint8 time_gop[] = { 6, 7, 8 };
+  const guint8 time_next[] = { 10 };
+
+  sink = setup_rtspsink (TRUE, TRUE);
+  g_object_set (sink, "gop-cache-max-bytes", 2 * BUFFER_SIZE + BUFFER_SIZE / 2,
+      "gop-cache-max-time", GST_CLOCK_TIME_NONE, NULL);
+  sinkpad = add_stream (sink, &srcpad);
+
+  push_buffer (srcpad, 1, 1 * BUFFER_DURATION, TRUE);
+  push_buffer (srcpad, 2, 2 * BUFFER_DURATION, FALSE);
+  check_cache (sinkpad, bytes_gop, G_N_ELEMENTS (bytes_gop));
+
+  /* A GOP over the size limit is dropped as a whole, a partial one would
+     not decode, and nothing is cached until the next keyframe */
+  push_buffer (srcpad, 3, 3 * BUFFER_DURATION, FALSE);
+  check_cache (sinkpad, NULL, 0);
+  push_buffer (srcpad, 4, 4 * BUFFER_DURATION, FALSE);
+  check_cache (sinkpad, NULL, 0);
+  push_buffer (srcpad, 5, 5 * BUFFER_DURATION, TRUE);
+  check_cache (sinkpad, bytes_next, G_N_ELEMENTS (bytes_next));
+
+  /* Same for the duration, measured from the keyframe */
+  g_object_set (sink, "gop-cache-max-bytes", 0,
+      "gop-cache-max-time", (guint64) (2 * BUFFER_DURATION), NULL);
+  push_buffer (srcpad, 6, 6 * BUFFER_DURATION, TRUE);
+  push_buffer (srcpad, 7, 7 * BUFFER_DURATION, FALSE);
+  push_buffer (srcpad, 8, 8 * BUFFER_DURATION, FALSE);
+  check_cache (sinkpad, time_gop, G_N_ELEMENTS (time_gop));
+
+  push_buffer (srcpad, 9, 9 * BUFFER_DURATION, FALSE);
+  check_cache (sinkpad, NULL, 0);
+  push_buffer (srcpad, 10, 10 * BUFFER_DURATION, TRUE);
+  check_cache (sinkpad, time_next, G_N_ELEMENTS (time_next));
+
+  remove_stream (sink, sinkpad, srcpad);
+  cleanup_rtspsink (sink);
+}
+
+GST_END_TEST;
+
+static GstPadProbeReturn
+payloader_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  g_mutex_lock (&check_mutex);
+  buffers = g_list_append (buffers,
+      gst_buffer_ref (GST_PAD_PROBE_INFO_BUFFER (info)));
+  g_cond_signal (&check_cond);
+  g_mutex_unlock (&check_mutex);
+
+  /* Nothing is linked after the payloader */
+  return GST_PAD_PROBE_DROP;
+}
+
+GST_START_TEST (test_gop_cache_replay)
+{
+  GstElement *sink, *pipeline, *payloader;
+  GstPad *sinkpad, *srcpad, *paypad;
+  GstRTSPMediaFactory *factory;
+  GstRTSPMedia *media;
+  GstRTSPUrl *url;
+  GstClockTime first_pts;
+  const guint8 cached[] = { 0, 1, 2 };
+  GList *walk;
+  guint i;
+
+  sink = setup_rtspsink (TRUE, TRUE);
+  sinkpad = add_stream (sink, &srcpad);
+
+  for (i = 0; i < G_N_ELEMENTS (cached); i++)
+    push_buffer (srcpad, i, i * BUFFER_DURATION, i == 0);
+  check_cache (sinkpad, cached, G_N_ELEMENTS (cached));
+
+  /* Create the media as the server would for the first client */
+  factory = GST_RTSP_MEDIA_FACTORY (RTSP_SINK_PAD (sinkpad)->factory);
+  fail_unless_equals_int (gst_rtsp_url_parse ("rtsp://127.0.0.1" MAPPING,
+          &url), GST_RTSP_OK);
+  media = gst_rtsp_media_factory_construct (factory, url);
+  fail_unless (media != NULL);
+  pipeline = RTSP_SINK_PAD (sinkpad)->factory->pipeline;
+  fail_unless (pipeline != NULL);
+
+  payloader = gst_bin_get_by_name (GST_BIN (pipeline), "pay0");
+  fail_unless (payloader != NULL);
+  paypad = gst_element_get_static_pad (payloader, "sink");
+  gst_pad_add_probe (paypad, GST_PAD_PROBE_TYPE_BUFFER, payloader_probe,
+      NULL, NULL);
+  fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  /* The next buffer opens the feed, the cached GOP must go first */
+  push_buffer (srcpad, 3, 3 * BUFFER_DURATION, FALSE);
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < 4)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  fail_unless_equals_int (g_list_length (buffers), 4);
+  first_pts = GST_BUFFER_PTS (buffers->data);
+  fail_unless (GST_CLOCK_TIME_IS_VALID (first_pts));
+  for (walk = buffers, i = 0; walk; walk = walk->next, i++) {
+    fail_unless_equals_int (get_buffer_id (walk->data), i);
+    /* The burst keeps the spacing from the keyframe */
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (walk->data) - first_pts,
+        i * BUFFER_DURATION);
+  }
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (paypad);
+  gst_object_unref (payloader);
+  g_object_unref (media);
+  gst_rtsp_url_free (url);
+
+  remove_stream (sink, sinkpad, srcpad);
+  cleanup_rtspsink (sink);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtspsink_suite (void)
+{
+  Suite *s = suite_create ("rtspsink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_mapping_lifecycle);
+  tcase_add_test (tc_chain, test_gop_cache_order);
+  tcase_add_test (tc_chain, test_gop_cache_limits);
+  tcase_add_test (tc_chain, test_gop_cache_replay);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtspsink);
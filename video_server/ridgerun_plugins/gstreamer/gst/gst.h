@@ -32,6 +32,7 @@
 #include <gst/gstversion.h>
 
 #include <gst/gstatomicqueue.h>
+#include <gst/gstatomicring.h>
 #include <gst/gstbin.h>
 #include <gst/gstbuffer.h>
 #include <gst/gstbufferlist.h>
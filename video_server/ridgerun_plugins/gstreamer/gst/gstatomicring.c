@@ -0,0 +1,483 @@
+/* GStreamer
+ *
+ * gstatomicring.c:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "gst_private.h"
+
+#include <gst/gst.h>
+#include "gstatomicring.h"
+#include "glib-compat-private.h"
+
+/**
+ * SECTION:gstatomicring
+ * @title: GstAtomicRing
+ * @short_description: A bounded atomic queue implementation
+ * @see_also: #GstAtomicQueue
+ *
+ * The #GstAtomicRing object implements a queue of fixed size that can be
+ * used from multiple producer and multiple consumer threads. Unlike
+ * #GstAtomicQueue it never allocates after creation; gst_atomic_ring_push()
+ * fails when the ring is full instead of growing it.
+ *
+ * gst_atomic_ring_push() and gst_atomic_ring_pop() never block.
+ * gst_atomic_ring_push_wait() and gst_atomic_ring_pop_wait() wait until
+ * there is space or an item in the ring, or until the ring is set to
+ * flushing with gst_atomic_ring_set_flushing(). Threads that don't wait
+ * never take a lock, as long as no other thread is waiting.
+ *
+ * Since: 1.16
+ */
+
+G_DEFINE_BOXED_TYPE (GstAtomicRing, gst_atomic_ring,
+    (GBoxedCopyFunc) gst_atomic_ring_ref,
+    (GBoxedFreeFunc) gst_atomic_ring_unref);
+
+/* The ring is the bounded MPMC queue of Dmitry Vyukov. Each cell carries a
+ * sequence number that tells producers and consumers at which position the
+ * cell can next be written or read:
+ *
+ *  - seq == pos: the cell is free for the producer at position pos
+ *  - seq == pos + 1: the cell holds the item for the consumer at pos
+ *
+ * Producers and consumers claim a position with a single compare and
+ * exchange on tail and head respectively, and then publish the cell by
+ * updating its sequence number. Positions wrap around, all comparisons are
+ * done on the signed difference. */
+
+#define CACHE_LINE_SIZE 64
+
+/* number of times a waiting thread retries before it takes the lock */
+#define SPIN_COUNT 100
+
+typedef struct
+{
+  volatile gint seq;
+  gpointer data;
+} GstARingCell;
+
+struct _GstAtomicRing
+{
+  volatile gint refcount;
+  guint mask;
+  GstARingCell *cells;
+
+  /* only used when threads wait */
+  GMutex lock;
+  GCond cond;
+  volatile gint waiters;
+  volatile gint flushing;
+
+  /* keep tail and head on their own cache lines, away from each other and
+   * from the fields above */
+  guint8 padding0[CACHE_LINE_SIZE];
+  volatile gint tail;
+  guint8 padding1[CACHE_LINE_SIZE - sizeof (gint)];
+  volatile gint head;
+  guint8 padding2[CACHE_LINE_SIZE - sizeof (gint)];
+};
+
+static guint
+clp2 (guint n)
+{
+  guint res = 1;
+
+  while (res < n)
+    res <<= 1;
+
+  return res;
+}
+
+/**
+ * gst_atomic_ring_new:
+ * @size: ring size
+ *
+ * Create a new atomic ring instance. @size will be rounded up to the nearest
+ * power of 2 and is the maximum number of items the ring can hold.
+ *
+ * Returns: a new #GstAtomicRing
+ *
+ * Since: 1.16
+ */
+GstAtomicRing *
+gst_atomic_ring_new (guint size)
+{
+  GstAtomicRing *ring;
+  guint i;
+
+  g_return_val_if_fail (size > 0 && size <= G_MAXINT / 2, NULL);
+
+  ring = g_new0 (GstAtomicRing, 1);
+
+  ring->refcount = 1;
+  /* we keep the size as a mask for performance */
+  ring->mask = clp2 (MAX (size, 2)) - 1;
+  ring->cells = g_new (GstARingCell, ring->mask + 1);
+  for (i = 0; i <= ring->mask; i++) {
+    ring->cells[i].seq = i;
+    ring->cells[i].data = NULL;
+  }
+  g_mutex_init (&ring->lock);
+  g_cond_init (&ring->cond);
+  ring->waiters = 0;
+  ring->flushing = FALSE;
+  ring->tail = 0;
+  ring->head = 0;
+
+  return ring;
+}
+
+/**
+ * gst_atomic_ring_ref:
+ * @ring: a #GstAtomicRing
+ *
+ * Increase the refcount of @ring.
+ *
+ * Since: 1.16
+ */
+void
+gst_atomic_ring_ref (GstAtomicRing * ring)
+{
+  g_return_if_fail (ring != NULL);
+
+  g_atomic_int_inc (&ring->refcount);
+}
+
+static void
+gst_atomic_ring_free (GstAtomicRing * ring)
+{
+  g_mutex_clear (&ring->lock);
+  g_cond_clear (&ring->cond);
+  g_free (ring->cells);
+  g_free (ring);
+}
+
+/**
+ * gst_atomic_ring_unref:
+ * @ring: a #GstAtomicRing
+ *
+ * Unref @ring and free the memory when the refcount reaches 0. Items that
+ * are still in the ring are not freed.
+ *
+ * Since: 1.16
+ */
+void
+gst_atomic_ring_unref (GstAtomicRing * ring)
+{
+  g_return_if_fail (ring != NULL);
+
+  if (g_atomic_int_dec_and_test (&ring->refcount))
+    gst_atomic_ring_free (ring);
+}
+
+static gboolean
+ring_push (GstAtomicRing * ring, gpointer data)
+{
+  GstARingCell *cell;
+  guint pos;
+  gint diff;
+
+  pos = g_atomic_int_get (&ring->tail);
+  while (TRUE) {
+    cell = &ring->cells[pos & ring->mask];
+    diff = (gint) ((guint) g_atomic_int_get (&cell->seq) - pos);
+
+    if (G_LIKELY (diff == 0)) {
+      /* the cell is free, try to claim the position */
+      if (G_LIKELY (g_atomic_int_compare_and_exchange (&ring->tail, pos,
+                  pos + 1)))
+        break;
+    } else if (diff < 0) {
+      /* the consumer of the previous round did not free the cell yet */
+      return FALSE;
+    }
+    /* some other producer claimed the position, try the next one */
+    pos = g_atomic_int_get (&ring->tail);
+  }
+
+  cell->data = data;
+  g_atomic_int_set (&cell->seq, pos + 1);
+
+  return TRUE;
+}
+
+static gpointer
+ring_pop (GstAtomicRing * ring)
+{
+  GstARingCell *cell;
+  gpointer ret;
+  guint pos;
+  gint diff;
+
+  pos = g_atomic_int_get (&ring->head);
+  while (TRUE) {
+    cell = &ring->cells[pos & ring->mask];
+    diff = (gint) ((guint) g_atomic_int_get (&cell->seq) - (pos + 1));
+
+    if (G_LIKELY (diff == 0)) {
+      /* the cell holds an item, try to claim the position */
+      if (G_LIKELY (g_atomic_int_compare_and_exchange (&ring->head, pos,
+                  pos + 1)))
+        break;
+    } else if (diff < 0) {
+      /* the producer did not publish the cell yet */
+      return NULL;
+    }
+    /* some other consumer claimed the position, try the next one */
+    pos = g_atomic_int_get (&ring->head);
+  }
+
+  ret = cell->data;
+  /* free the cell for the producer of the next round */
+  g_atomic_int_set (&cell->seq, pos + ring->mask + 1);
+
+  return ret;
+}
+
+/* wake up the threads waiting in push_wait or pop_wait. The waiters
+ * register themselves before checking the ring with the lock held, so
+ * either they see our change or we see them and take the lock */
+static inline void
+ring_wake (GstAtomicRing * ring)
+{
+  if (G_UNLIKELY (g_atomic_int_get (&ring->waiters) > 0)) {
+    g_mutex_lock (&ring->lock);
+    g_cond_broadcast (&ring->cond);
+    g_mutex_unlock (&ring->lock);
+  }
+}
+
+/**
+ * gst_atomic_ring_push:
+ * @ring: a #GstAtomicRing
+ * @data: (transfer full): the data, not %NULL
+ *
+ * Append @data to the tail of the ring when there is space for it.
+ *
+ * Returns: %TRUE if @data was added, %FALSE when @ring is full.
+ *
+ * Since: 1.16
+ */
+gboolean
+gst_atomic_ring_push (GstAtomicRing * ring, gpointer data)
+{
+  g_return_val_if_fail (ring != NULL, FALSE);
+  g_return_val_if_fail (data != NULL, FALSE);
+
+  if (!ring_push (ring, data))
+    return FALSE;
+
+  ring_wake (ring);
+
+  return TRUE;
+}
+
+/**
+ * gst_atomic_ring_pop:
+ * @ring: a #GstAtomicRing
+ *
+ * Get the head element of the ring.
+ *
+ * Returns: (transfer full) (nullable): the head element of @ring or %NULL
+ * when the ring is empty.
+ *
+ * Since: 1.16
+ */
+gpointer
+gst_atomic_ring_pop (GstAtomicRing * ring)
+{
+  gpointer ret;
+
+  g_return_val_if_fail (ring != NULL, NULL);
+
+  ret = ring_pop (ring);
+  if (ret)
+    ring_wake (ring);
+
+  return ret;
+}
+
+/**
+ * gst_atomic_ring_push_wait:
+ * @ring: a #GstAtomicRing
+ * @data: (transfer full): the data, not %NULL
+ *
+ * Append @data to the tail of the ring, waiting for space when the ring is
+ * full.
+ *
+ * Returns: %TRUE if @data was added, %FALSE when @ring is flushing. @data
+ * is not added to the ring in that case.
+ *
+ * Since: 1.16
+ */
+gboolean
+gst_atomic_ring_push_wait (GstAtomicRing * ring, gpointer data)
+{
+  gboolean res;
+  guint i;
+
+  g_return_val_if_fail (ring != NULL, FALSE);
+  g_return_val_if_fail (data != NULL, FALSE);
+
+  for (i = 0; i < SPIN_COUNT; i++) {
+    if (G_UNLIKELY (g_atomic_int_get (&ring->flushing)))
+      return FALSE;
+    if (G_LIKELY (ring_push (ring, data))) {
+      ring_wake (ring);
+      return TRUE;
+    }
+  }
+
+  g_mutex_lock (&ring->lock);
+  g_atomic_int_inc (&ring->waiters);
+  while (TRUE) {
+    if (g_atomic_int_get (&ring->flushing)) {
+      res = FALSE;
+      break;
+    }
+    if (ring_push (ring, data)) {
+      res = TRUE;
+      break;
+    }
+    g_cond_wait (&ring->cond, &ring->lock);
+  }
+  /* we hold the lock, wake up the other waiters directly */
+  if (!g_atomic_int_dec_and_test (&ring->waiters) && res)
+    g_cond_broadcast (&ring->cond);
+  g_mutex_unlock (&ring->lock);
+
+  return res;
+}
+
+/**
+ * gst_atomic_ring_pop_wait:
+ * @ring: a #GstAtomicRing
+ *
+ * Get the head element of the ring, waiting for an item when the ring is
+ * empty.
+ *
+ * Returns: (transfer full) (nullable): the head element of @ring or %NULL
+ * when @ring is flushing.
+ *
+ * Since: 1.16
+ */
+gpointer
+gst_atomic_ring_pop_wait (GstAtomicRing * ring)
+{
+  gpointer ret;
+  guint i;
+
+  g_return_val_if_fail (ring != NULL, NULL);
+
+  for (i = 0; i < SPIN_COUNT; i++) {
+    if (G_UNLIKELY (g_atomic_int_get (&ring->flushing)))
+      return NULL;
+    if (G_LIKELY ((ret = ring_pop (ring)))) {
+      ring_wake (ring);
+      return ret;
+    }
+  }
+
+  g_mutex_lock (&ring->lock);
+  g_atomic_int_inc (&ring->waiters);
+  while (TRUE) {
+    if (g_atomic_int_get (&ring->flushing)) {
+      ret = NULL;
+      break;
+    }
+    if ((ret = ring_pop (ring)))
+      break;
+    g_cond_wait (&ring->cond, &ring->lock);
+  }
+  /* we hold the lock, wake up the other waiters directly */
+  if (!g_atomic_int_dec_and_test (&ring->waiters) && ret)
+    g_cond_broadcast (&ring->cond);
+  g_mutex_unlock (&ring->lock);
+
+  return ret;
+}
+
+/**
+ * gst_atomic_ring_set_flushing:
+ * @ring: a #GstAtomicRing
+ * @flushing: the new flushing state
+ *
+ * When @flushing is %TRUE, make all threads waiting in
+ * gst_atomic_ring_push_wait() and gst_atomic_ring_pop_wait() return and make
+ * further calls to those functions fail immediately. The items in the ring
+ * can still be retrieved with gst_atomic_ring_pop().
+ *
+ * Since: 1.16
+ */
+void
+gst_atomic_ring_set_flushing (GstAtomicRing * ring, gboolean flushing)
+{
+  g_return_if_fail (ring != NULL);
+
+  g_mutex_lock (&ring->lock);
+  g_atomic_int_set (&ring->flushing, flushing);
+  g_cond_broadcast (&ring->cond);
+  g_mutex_unlock (&ring->lock);
+}
+
+/**
+ * gst_atomic_ring_length:
+ * @ring: a #GstAtomicRing
+ *
+ * Get the amount of items in the ring. When other threads are using @ring
+ * the result is only an estimate.
+ *
+ * Returns: the number of elements in the ring.
+ *
+ * Since: 1.16
+ */
+guint
+gst_atomic_ring_length (GstAtomicRing * ring)
+{
+  guint head, tail;
+
+  g_return_val_if_fail (ring != NULL, 0);
+
+  head = g_atomic_int_get (&ring->head);
+  tail = g_atomic_int_get (&ring->tail);
+
+  /* claimed positions can be ahead of the published cells, and head can
+   * move past the tail we read before it */
+  if ((gint) (tail - head) <= 0)
+    return 0;
+
+  return MIN (tail - head, ring->mask + 1);
+}
+
+/**
+ * gst_atomic_ring_get_size:
+ * @ring: a #GstAtomicRing
+ *
+ * Get the maximum number of items @ring can hold.
+ *
+ * Returns: the size of @ring
+ *
+ * Since: 1.16
+ */
+guint
+gst_atomic_ring_get_size (GstAtomicRing * ring)
+{
+  g_return_val_if_fail (ring != NULL, 0);
+
+  return ring->mask + 1;
+}
@@ -0,0 +1,83 @@
+/* GStreamer
+ *
+ * gstatomicring.h:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gst/gstconfig.h>
+
+#ifndef __GST_ATOMIC_RING_H__
+#define __GST_ATOMIC_RING_H__
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_ATOMIC_RING (gst_atomic_ring_get_type())
+
+/**
+ * GstAtomicRing:
+ *
+ * Opaque bounded atomic data queue.
+ *
+ * Use the accessor functions to get the stored values.
+ *
+ * Since: 1.16
+ */
+typedef struct _GstAtomicRing GstAtomicRing;
+
+
+GST_API
+GType              gst_atomic_ring_get_type      (void);
+
+GST_API
+GstAtomicRing *    gst_atomic_ring_new           (guint size) G_GNUC_MALLOC;
+
+GST_API
+void               gst_atomic_ring_ref           (GstAtomicRing * ring);
+
+GST_API
+void               gst_atomic_ring_unref         (GstAtomicRing * ring);
+
+GST_API
+gboolean           gst_atomic_ring_push          (GstAtomicRing * ring, gpointer data);
+
+GST_API
+gpointer           gst_atomic_ring_pop           (GstAtomicRing * ring);
+
+GST_API
+gboolean           gst_atomic_ring_push_wait     (GstAtomicRing * ring, gpointer data);
+
+GST_API
+gpointer           gst_atomic_ring_pop_wait      (GstAtomicRing * ring);
+
+GST_API
+void               gst_atomic_ring_set_flushing  (GstAtomicRing * ring, gboolean flushing);
+
+GST_API
+guint              gst_atomic_ring_length        (GstAtomicRing * ring);
+
+GST_API
+guint              gst_atomic_ring_get_size      (GstAtomicRing * ring);
+
+#ifdef G_DEFINE_AUTOPTR_CLEANUP_FUNC
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(GstAtomicRing, gst_atomic_ring_unref)
+#endif
+
+G_END_DECLS
+
+#endif /* __GST_ATOMIC_RING_H__ */
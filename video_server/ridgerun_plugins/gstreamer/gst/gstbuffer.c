@@ -141,15 +141,24 @@ struct _GstMetaItem
   GstMeta meta;
 };
 #define ITEM_SIZE(info) ((info)->size + sizeof (GstMetaItem))
+#define ITEM_INLINE_SIZE(info) ((ITEM_SIZE (info) + 7) & ~(gsize) 7)
 
 #define GST_BUFFER_MEM_MAX         16
 
+/* bytes in the buffer for metas, enough for a video meta and a few small
+ * ones */
+#define GST_BUFFER_META_INLINE_SIZE 256
+/* number of metas that can be found without walking the list */
+#define GST_BUFFER_META_INDEX_MAX  4
+
 #define GST_BUFFER_SLICE_SIZE(b)   (((GstBufferImpl *)(b))->slice_size)
 #define GST_BUFFER_MEM_LEN(b)      (((GstBufferImpl *)(b))->len)
 #define GST_BUFFER_MEM_ARRAY(b)    (((GstBufferImpl *)(b))->mem)
 #define GST_BUFFER_MEM_PTR(b,i)    (((GstBufferImpl *)(b))->mem[i])
 #define GST_BUFFER_BUFMEM(b)       (((GstBufferImpl *)(b))->bufmem)
 #define GST_BUFFER_META(b)         (((GstBufferImpl *)(b))->item)
+#define GST_BUFFER_META_INDEXED(b) \
+    (((GstBufferImpl *)(b))->n_metas == ((GstBufferImpl *)(b))->n_index)
 
 typedef struct
 {
@@ -164,11 +173,130 @@ typedef struct
   /* memory of the buffer when allocated from 1 chunk */
   GstMemory *bufmem;
 
-  /* FIXME, make metadata allocation more efficient by using part of the
-   * GstBufferImpl */
+  /* the metas, most recently added first */
   GstMetaItem *item;
+  guint n_metas;
+
+  /* metas are allocated from here while there is space, the space is reused
+   * when the last one allocated here is removed */
+  guint n_inline_metas;
+  gsize inline_used;
+  guint64 inline_metas[GST_BUFFER_META_INLINE_SIZE / 8];
+
+  /* API of the first metas that were added, in the order they were added. When
+   * all metas are in here, lookups don't need to walk the list */
+  guint n_index;
+  GType index_api[GST_BUFFER_META_INDEX_MAX];
+  GstMeta *index[GST_BUFFER_META_INDEX_MAX];
 } GstBufferImpl;
 
+static GstMetaItem *
+_meta_item_alloc (GstBufferImpl * buffer, const GstMetaInfo * info)
+{
+  GstMetaItem *item;
+  gsize size = ITEM_INLINE_SIZE (info);
+
+  if (buffer->inline_used + size <= GST_BUFFER_META_INLINE_SIZE) {
+    item = (GstMetaItem *) ((guint8 *) buffer->inline_metas +
+        buffer->inline_used);
+    buffer->inline_used += size;
+    buffer->n_inline_metas++;
+    /* We warn in gst_meta_register() about metas without
+     * init function but let's play safe here and prevent
+     * uninitialized memory
+     */
+    if (!info->init_func)
+      memset (item, 0, ITEM_SIZE (info));
+  } else if (!info->init_func) {
+    item = g_slice_alloc0 (ITEM_SIZE (info));
+  } else {
+    item = g_slice_alloc (ITEM_SIZE (info));
+  }
+  return item;
+}
+
+static void
+_meta_item_free (GstBufferImpl * buffer, GstMetaItem * item,
+    const GstMetaInfo * info)
+{
+  guint8 *start = (guint8 *) buffer->inline_metas;
+
+  if ((guint8 *) item >= start &&
+      (guint8 *) item < start + GST_BUFFER_META_INLINE_SIZE) {
+    if (--buffer->n_inline_metas == 0)
+      buffer->inline_used = 0;
+    else if ((guint8 *) item + ITEM_INLINE_SIZE (info) ==
+        start + buffer->inline_used)
+      buffer->inline_used -= ITEM_INLINE_SIZE (info);
+  } else {
+    g_slice_free1 (ITEM_SIZE (info), item);
+  }
+}
+
+static void
+_meta_index_add (GstBufferImpl * buffer, GstMeta * meta)
+{
+  buffer->n_metas++;
+  if (buffer->n_index < GST_BUFFER_META_INDEX_MAX) {
+    buffer->index_api[buffer->n_index] = meta->info->api;
+    buffer->index[buffer->n_index] = meta;
+    buffer->n_index++;
+  }
+}
+
+static void
+_meta_index_rebuild (GstBufferImpl * buffer)
+{
+  GstMetaItem *walk;
+  guint i;
+
+  /* the list has the most recently added metas first, index the newest ones
+   * in the order they were added */
+  buffer->n_index = MIN (buffer->n_metas, GST_BUFFER_META_INDEX_MAX);
+  for (walk = buffer->item, i = buffer->n_index; walk && i > 0;
+      walk = walk->next, i--) {
+    buffer->index_api[i - 1] = walk->meta.info->api;
+    buffer->index[i - 1] = &walk->meta;
+  }
+}
+
+/* call after @meta was taken out of the list */
+static void
+_meta_index_remove (GstBufferImpl * buffer, GstMeta * meta)
+{
+  guint i;
+
+  buffer->n_metas--;
+  for (i = 0; i < buffer->n_index; i++) {
+    if (buffer->index[i] == meta) {
+      buffer->n_index--;
+      memmove (&buffer->index_api[i], &buffer->index_api[i + 1],
+          (buffer->n_index - i) * sizeof (GType));
+      memmove (&buffer->index[i], &buffer->index[i + 1],
+          (buffer->n_index - i) * sizeof (GstMeta *));
+
+      /* make room for the metas that didn't fit in the index before */
+      if (buffer->n_metas > buffer->n_index)
+        _meta_index_rebuild (buffer);
+      break;
+    }
+  }
+}
+
+/* the most recently added indexed meta of @api, only complete when
+ * GST_BUFFER_META_INDEXED() */
+static inline GstMeta *
+_meta_index_lookup (GstBufferImpl * buffer, GType api)
+{
+  guint i;
+
+  for (i = buffer->n_index; i > 0; i--) {
+    if (buffer->index_api[i - 1] == api)
+      return buffer->index[i - 1];
+  }
+  return NULL;
+}
+
 
 static gboolean
 _is_span (GstMemory ** mem, gsize len, gsize * poffset, GstMemory ** parent)
@@ -734,8 +862,8 @@ _gst_buffer_free (GstBuffer * buffer)
       info->free_func (meta, buffer);
 
     next = walk->next;
-    /* and free the slice */
-    g_slice_free1 (ITEM_SIZE (info), walk);
+    /* and free the item */
+    _meta_item_free ((GstBufferImpl *) buffer, walk, info);
   }
 
   /* get the size, when unreffing the memory, we could also unref the buffer
@@ -779,6 +907,10 @@ gst_buffer_init (GstBufferImpl * buffer, gsize size)
 
   GST_BUFFER_MEM_LEN (buffer) = 0;
   GST_BUFFER_META (buffer) = NULL;
+  buffer->n_metas = 0;
+  buffer->n_inline_metas = 0;
+  buffer->inline_used = 0;
+  buffer->n_index = 0;
 }
 
 /**
@@ -2129,6 +2261,9 @@ gst_buffer_get_meta (GstBuffer * buffer, GType api)
   g_return_val_if_fail (buffer != NULL, NULL);
   g_return_val_if_fail (api != 0, NULL);
 
+  if (G_LIKELY (GST_BUFFER_META_INDEXED (buffer)))
+    return _meta_index_lookup ((GstBufferImpl *) buffer, api);
+
   /* find GstMeta of the requested API */
   for (item = GST_BUFFER_META (buffer); item; item = item->next) {
     GstMeta *meta = &item->meta;
@@ -2178,22 +2313,13 @@ gst_buffer_add_meta (GstBuffer * buffer, const GstMetaInfo * info,
 {
   GstMetaItem *item;
   GstMeta *result = NULL;
-  gsize size;
 
   g_return_val_if_fail (buffer != NULL, NULL);
   g_return_val_if_fail (info != NULL, NULL);
   g_return_val_if_fail (gst_buffer_is_writable (buffer), NULL);
 
-  /* create a new slice */
-  size = ITEM_SIZE (info);
-  /* We warn in gst_meta_register() about metas without
-   * init function but let's play safe here and prevent
-   * uninitialized memory
-   */
-  if (!info->init_func)
-    item = g_slice_alloc0 (size);
-  else
-    item = g_slice_alloc (size);
+  /* create a new item, in the buffer when it fits */
+  item = _meta_item_alloc ((GstBufferImpl *) buffer, info);
   result = &item->meta;
   result->info = info;
   result->flags = GST_META_FLAG_NONE;
@@ -2209,12 +2335,13 @@ gst_buffer_add_meta (GstBuffer * buffer, const GstMetaInfo * info,
   /* and add to the list of metadata */
   item->next = GST_BUFFER_META (buffer);
   GST_BUFFER_META (buffer) = item;
+  _meta_index_add ((GstBufferImpl *) buffer, result);
 
   return result;
 
 init_failed:
   {
-    g_slice_free1 (size, item);
+    _meta_item_free ((GstBufferImpl *) buffer, item, info);
     return NULL;
   }
 }
@@ -2252,12 +2379,13 @@ gst_buffer_remove_meta (GstBuffer * buffer, GstMeta * meta)
         GST_BUFFER_META (buffer) = walk->next;
       else
         prev->next = walk->next;
+      _meta_index_remove ((GstBufferImpl *) buffer, m);
       /* call free_func if any */
       if (info->free_func)
         info->free_func (m, buffer);
 
-      /* and free the slice */
-      g_slice_free1 (ITEM_SIZE (info), walk);
+      /* and free the item */
+      _meta_item_free ((GstBufferImpl *) buffer, walk, info);
       break;
     }
     prev = walk;
@@ -2327,12 +2455,17 @@ gst_buffer_iterate_meta_filtered (GstBuffer * buffer, gpointer * state,
   g_return_val_if_fail (state != NULL, NULL);
 
   meta = (GstMetaItem **) state;
-  if (*meta == NULL)
-    /* state NULL, move to first item */
+  if (*meta == NULL) {
+    /* state NULL, nothing to walk when the index knows there is no such meta */
+    if (GST_BUFFER_META_INDEXED (buffer) &&
+        !_meta_index_lookup ((GstBufferImpl *) buffer, meta_api_type))
+      return NULL;
+    /* move to first item */
     *meta = GST_BUFFER_META (buffer);
-  else
+  } else {
     /* state !NULL, move to next item in list */
     *meta = (*meta)->next;
+  }
 
   while (*meta != NULL && (*meta)->meta.info->api != meta_api_type)
     *meta = (*meta)->next;
@@ -2392,13 +2525,14 @@ gst_buffer_foreach_meta (GstBuffer * buffer, GstBufferForeachMetaFunc func,
         prev = GST_BUFFER_META (buffer) = next;
       else
         prev->next = next;
+      _meta_index_remove ((GstBufferImpl *) buffer, m);
 
       /* call free_func if any */
       if (info->free_func)
         info->free_func (m, buffer);
 
-      /* and free the slice */
-      g_slice_free1 (ITEM_SIZE (info), walk);
+      /* and free the item */
+      _meta_item_free ((GstBufferImpl *) buffer, walk, info);
     } else {
       prev = walk;
     }
@@ -96,6 +96,33 @@ GST_DEBUG_CATEGORY_STATIC (gst_buffer_pool_debug);
 #define GST_BUFFER_POOL_LOCK(pool)   (g_rec_mutex_lock(&pool->priv->rec_lock))
 #define GST_BUFFER_POOL_UNLOCK(pool) (g_rec_mutex_unlock(&pool->priv->rec_lock))
 
+/* Threads are spread over this many caches, each holding up to
+ * THREAD_CACHE_SIZE buffers. A cache that runs empty or full exchanges
+ * half of its capacity with the shared queue at once. All caches together
+ * hold at most max_buffers, or min_buffers for pools without a maximum, so
+ * that buffers parked in the cache of one thread don't make the others
+ * allocate new ones. */
+#define THREAD_CACHE_SLOTS 16
+#define THREAD_CACHE_SIZE  16
+#define THREAD_CACHE_BATCH (THREAD_CACHE_SIZE / 2)
+
+typedef struct
+{
+  volatile gint lock;
+  guint n_buffers;
+  GstBuffer *buffers[THREAD_CACHE_SIZE];
+  /* keep the caches of different threads on different cache lines, the
+   * size of the fields above is a multiple of 64 bytes plus 8. The array of
+   * caches is aligned to 64 bytes as well. */
+  guint8 padding[64 - 2 * sizeof (gint)];
+} GstBufferPoolCache;
+
+#define THREAD_CACHE_ALIGN 64
+
+/* slot of the current thread in the caches, plus one */
+static GPrivate thread_cache_slot = G_PRIVATE_INIT (NULL);
+static volatile gint thread_cache_n_slots = 0;
+
 struct _GstBufferPoolPrivate
 {
   GstAtomicQueue *queue;
@@ -116,6 +143,17 @@ struct _GstBufferPoolPrivate
   guint cur_buffers;
   GstAllocator *allocator;
   GstAllocationParams params;
+
+  /* per thread caches, NULL unless GST_BUFFER_POOL_OPTION_THREAD_CACHE.
+   * caches points into caches_mem, aligned to THREAD_CACHE_ALIGN */
+  GstBufferPoolCache *caches;
+  gpointer caches_mem;
+  /* buffers in all caches together and the limit for that */
+  volatile gint n_cached;
+  gint cache_limit;
+  /* number of threads waiting for a buffer, the caches are bypassed on
+   * release while there are any */
+  volatile gint waiters;
 };
 
 static void gst_buffer_pool_finalize (GObject * object);
@@ -200,6 +238,7 @@ gst_buffer_pool_finalize (GObject * object)
   gst_atomic_queue_unref (priv->queue);
   gst_poll_free (priv->poll);
   gst_structure_free (priv->config);
+  g_free (priv->caches_mem);
   g_rec_mutex_clear (&priv->rec_lock);
   if (priv->allocator)
     gst_object_unref (priv->allocator);
@@ -313,6 +352,165 @@ alloc_failed:
   }
 }
 
+/* put a free buffer in the shared queue and wake up a waiting thread */
+static void
+queue_push (GstBufferPool * pool, GstBuffer * buffer)
+{
+  GstBufferPoolPrivate *priv = pool->priv;
+
+  gst_atomic_queue_push (priv->queue, buffer);
+  gst_poll_write_control (priv->poll);
+}
+
+/* take a free buffer from the shared queue, or NULL */
+static GstBuffer *
+queue_pop (GstBufferPool * pool)
+{
+  GstBufferPoolPrivate *priv = pool->priv;
+  GstBuffer *buffer;
+
+  buffer = gst_atomic_queue_pop (priv->queue);
+  if (G_LIKELY (buffer)) {
+    while (!gst_poll_read_control (priv->poll)) {
+      if (errno == EWOULDBLOCK) {
+        /* We put the buffer into the queue but did not finish writing control
+         * yet, let's wait a bit and retry */
+        g_thread_yield ();
+        continue;
+      } else {
+        /* Critical error but GstPoll already complained */
+        break;
+      }
+    }
+  }
+  return buffer;
+}
+
+static GstBufferPoolCache *
+thread_cache_get (GstBufferPool * pool)
+{
+  guint slot;
+
+  slot = GPOINTER_TO_UINT (g_private_get (&thread_cache_slot));
+  if (G_UNLIKELY (slot == 0)) {
+    slot = g_atomic_int_add (&thread_cache_n_slots, 1) % THREAD_CACHE_SLOTS;
+    g_private_set (&thread_cache_slot, GUINT_TO_POINTER (++slot));
+  }
+  return &pool->priv->caches[slot - 1];
+}
+
+/* Threads sharing a slot (or draining it) only contend on the lock when
+ * there are more than THREAD_CACHE_SLOTS threads, the loser falls back to
+ * the shared queue */
+static inline gboolean
+thread_cache_trylock (GstBufferPoolCache * cache)
+{
+  return g_atomic_int_compare_and_exchange (&cache->lock, 0, 1);
+}
+
+static inline void
+thread_cache_unlock (GstBufferPoolCache * cache)
+{
+  g_atomic_int_set (&cache->lock, 0);
+}
+
+/* take a buffer from the cache of the current thread, refilling it from
+ * the shared queue when it is empty */
+static GstBuffer *
+thread_cache_pop (GstBufferPool * pool)
+{
+  GstBufferPoolCache *cache;
+  GstBuffer *buffer;
+
+  cache = thread_cache_get (pool);
+  if (G_UNLIKELY (!thread_cache_trylock (cache)))
+    return queue_pop (pool);
+
+  if (cache->n_buffers == 0) {
+    /* don't take more than the limit away from the other threads */
+    while (cache->n_buffers < THREAD_CACHE_BATCH &&
+        g_atomic_int_get (&pool->priv->n_cached) < pool->priv->cache_limit) {
+      if (!(buffer = queue_pop (pool)))
+        break;
+      cache->buffers[cache->n_buffers++] = buffer;
+      g_atomic_int_inc (&pool->priv->n_cached);
+    }
+  }
+
+  if (cache->n_buffers) {
+    buffer = cache->buffers[--cache->n_buffers];
+    g_atomic_int_add (&pool->priv->n_cached, -1);
+  } else {
+    buffer = NULL;
+  }
+  thread_cache_unlock (cache);
+
+  /* the cache is empty and limited, take from the queue directly */
+  if (buffer == NULL)
+    buffer = queue_pop (pool);
+
+  return buffer;
+}
+
+/* keep a buffer in the cache of the current thread, handing half of the
+ * cache back to the shared queue when it is full */
+static gboolean
+thread_cache_push (GstBufferPool * pool, GstBuffer * buffer)
+{
+  GstBufferPoolPrivate *priv = pool->priv;
+  GstBufferPoolCache *cache;
+
+  cache = thread_cache_get (pool);
+  if (G_UNLIKELY (!thread_cache_trylock (cache)))
+    return FALSE;
+
+  /* checked with the cache locked, so that a thread that starts waiting
+   * and drains the caches can't miss this buffer */
+  if (G_UNLIKELY (g_atomic_int_get (&priv->waiters) > 0)) {
+    thread_cache_unlock (cache);
+    return FALSE;
+  }
+
+  if (cache->n_buffers == THREAD_CACHE_SIZE) {
+    while (cache->n_buffers > THREAD_CACHE_SIZE - THREAD_CACHE_BATCH) {
+      queue_push (pool, cache->buffers[--cache->n_buffers]);
+      g_atomic_int_add (&priv->n_cached, -1);
+    }
+  }
+
+  /* enough buffers parked in caches, make this one available to all */
+  if (g_atomic_int_get (&priv->n_cached) >= priv->cache_limit) {
+    thread_cache_unlock (cache);
+    return FALSE;
+  }
+
+  cache->buffers[cache->n_buffers++] = buffer;
+  g_atomic_int_inc (&priv->n_cached);
+  thread_cache_unlock (cache);
+
+  return TRUE;
+}
+
+/* move the buffers of all caches to the shared queue */
+static void
+thread_cache_drain (GstBufferPool * pool)
+{
+  GstBufferPoolCache *cache;
+  guint i;
+
+  for (i = 0; i < THREAD_CACHE_SLOTS; i++) {
+    cache = &pool->priv->caches[i];
+
+    while (!thread_cache_trylock (cache))
+      g_thread_yield ();
+    while (cache->n_buffers) {
+      queue_push (pool, cache->buffers[--cache->n_buffers]);
+      g_atomic_int_add (&pool->priv->n_cached, -1);
+    }
+    thread_cache_unlock (cache);
+  }
+}
+
 /* the default implementation for preallocating the buffers in the pool */
 static gboolean
 default_start (GstBufferPool * pool)
@@ -398,21 +596,13 @@ default_stop (GstBufferPool * pool)
   GstBufferPoolPrivate *priv = pool->priv;
   GstBuffer *buffer;
 
+  if (priv->caches)
+    thread_cache_drain (pool);
+
   /* clear the pool */
-  while ((buffer = gst_atomic_queue_pop (priv->queue))) {
-    while (!gst_poll_read_control (priv->poll)) {
-      if (errno == EWOULDBLOCK) {
-        /* We put the buffer into the queue but did not finish writing control
-         * yet, let's wait a bit and retry */
-        g_thread_yield ();
-        continue;
-      } else {
-        /* Critical error but GstPoll already complained */
-        break;
-      }
-    }
+  while ((buffer = queue_pop (pool)))
     do_free_buffer (pool, buffer);
-  }
+
   return priv->cur_buffers == 0;
 }
 
@@ -618,6 +808,24 @@ default_set_config (GstBufferPool * pool, GstStructure * config)
   priv->max_buffers = max_buffers;
   priv->cur_buffers = 0;
 
+  /* not active and no outstanding buffers, so the caches are empty */
+  if (gst_buffer_pool_config_has_option (config,
+          GST_BUFFER_POOL_OPTION_THREAD_CACHE)) {
+    if (!priv->caches) {
+      priv->caches_mem = g_malloc0 (sizeof (GstBufferPoolCache) *
+          THREAD_CACHE_SLOTS + THREAD_CACHE_ALIGN - 1);
+      priv->caches = (GstBufferPoolCache *)
+          (((guintptr) priv->caches_mem + THREAD_CACHE_ALIGN - 1) &
+          ~(guintptr) (THREAD_CACHE_ALIGN - 1));
+    }
+    priv->n_cached = 0;
+    priv->cache_limit = max_buffers ? max_buffers : min_buffers;
+  } else if (priv->caches) {
+    g_free (priv->caches_mem);
+    priv->caches_mem = NULL;
+    priv->caches = NULL;
+  }
+
   if (priv->allocator)
     gst_object_unref (priv->allocator);
   if ((priv->allocator = allocator))
@@ -1105,25 +1313,18 @@ default_acquire_buffer (GstBufferPool * pool, GstBuffer ** buffer,
 {
   GstFlowReturn result;
   GstBufferPoolPrivate *priv = pool->priv;
+  gboolean waiting = FALSE;
 
   while (TRUE) {
     if (G_UNLIKELY (GST_BUFFER_POOL_IS_FLUSHING (pool)))
       goto flushing;
 
-    /* try to get a buffer from the queue */
-    *buffer = gst_atomic_queue_pop (priv->queue);
+    /* try to get a buffer from the cache or the queue */
+    if (priv->caches && !waiting)
+      *buffer = thread_cache_pop (pool);
+    else
+      *buffer = queue_pop (pool);
     if (G_LIKELY (*buffer)) {
-      while (!gst_poll_read_control (priv->poll)) {
-        if (errno == EWOULDBLOCK) {
-          /* We put the buffer into the queue but did not finish writing control
-           * yet, let's wait a bit and retry */
-          g_thread_yield ();
-          continue;
-        } else {
-          /* Critical error but GstPoll already complained */
-          break;
-        }
-      }
       result = GST_FLOW_OK;
       GST_LOG_OBJECT (pool, "acquired buffer %p", *buffer);
       break;
@@ -1140,6 +1341,16 @@ default_acquire_buffer (GstBufferPool * pool, GstBuffer ** buffer,
       /* something went wrong, return error */
       break;
 
+    /* free buffers might be sitting in the caches of other threads, move
+     * them to the queue and have releases bypass the caches until we got
+     * a buffer, so that we are woken up by them */
+    if (priv->caches && !waiting) {
+      g_atomic_int_inc (&priv->waiters);
+      waiting = TRUE;
+      thread_cache_drain (pool);
+      continue;
+    }
+
     /* check if we need to wait */
     if (params && (params->flags & GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT)) {
       GST_LOG_OBJECT (pool, "no more buffers");
@@ -1177,12 +1388,17 @@ default_acquire_buffer (GstBufferPool * pool, GstBuffer ** buffer,
     }
   }
 
+  if (waiting)
+    g_atomic_int_add (&priv->waiters, -1);
+
   return result;
 
   /* ERRORS */
 flushing:
   {
     GST_DEBUG_OBJECT (pool, "we are flushing");
+    if (waiting)
+      g_atomic_int_add (&priv->waiters, -1);
     return GST_FLOW_FLUSHING;
   }
 }
@@ -1296,9 +1512,11 @@ default_release_buffer (GstBufferPool * pool, GstBuffer * buffer)
   if (G_UNLIKELY (!gst_buffer_is_all_memory_writable (buffer)))
     goto not_writable;
 
-  /* keep it around in our queue */
-  gst_atomic_queue_push (pool->priv->queue, buffer);
-  gst_poll_write_control (pool->priv->poll);
+  /* keep it around in our cache or queue */
+  if (pool->priv->caches && thread_cache_push (pool, buffer))
+    return;
+
+  queue_push (pool, buffer);
 
   return;
 
@@ -96,6 +96,24 @@ struct _GstBufferPoolAcquireParams {
  */
 #define GST_BUFFER_POOL_IS_FLUSHING(pool)  (g_atomic_int_get (&pool->flushing))
 
+/**
+ * GST_BUFFER_POOL_OPTION_THREAD_CACHE:
+ *
+ * An option that can be activated on a #GstBufferPool to keep a small cache
+ * of free buffers per thread in front of the shared queue of the pool. When
+ * several threads acquire and release buffers from the same pool, most of
+ * them are then recycled without touching the shared queue, which is
+ * refilled and drained in batches. Only the default acquire_buffer and
+ * release_buffer implementations use the cache.
+ *
+ * All caches together hold at most the configured maximum number of buffers,
+ * or the minimum number of buffers when the pool has no maximum, so the
+ * cache never makes an unbounded pool allocate more than it would without.
+ *
+ * Since: 1.16
+ */
+#define GST_BUFFER_POOL_OPTION_THREAD_CACHE "GstBufferPoolOptionThreadCache"
+
 /**
  * GstBufferPool:
  *
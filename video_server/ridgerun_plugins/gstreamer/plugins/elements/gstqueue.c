@@ -121,13 +121,23 @@ enum
   PROP_MIN_THRESHOLD_TIME,
   PROP_LEAKY,
   PROP_SILENT,
-  PROP_FLUSH_ON_EOS
+  PROP_FLUSH_ON_EOS,
+  PROP_SPSC
 };
 
 /* default property values */
 #define DEFAULT_MAX_SIZE_BUFFERS  200   /* 200 buffers */
 #define DEFAULT_MAX_SIZE_BYTES    (10 * 1024 * 1024)    /* 10 MB       */
 #define DEFAULT_MAX_SIZE_TIME     GST_SECOND    /* 1 second    */
+#define DEFAULT_SPSC              FALSE
+
+/* size of the ring when max-size-buffers is 0, and the largest ring. More
+ * buffers than fit in the ring go in the locked queue. */
+#define RING_DEFAULT_SIZE 1024
+#define RING_MAX_SIZE     65536
+/* bounds of the adaptive number of ring retries before taking qlock */
+#define RING_SPIN_MIN 16
+#define RING_SPIN_MAX 4096
 
 #define GST_QUEUE_MUTEX_LOCK(q) G_STMT_START {                          \
   g_mutex_lock (&q->qlock);                                              \
@@ -145,8 +155,10 @@ enum
 
 #define GST_QUEUE_WAIT_DEL_CHECK(q, label) G_STMT_START {               \
   STATUS (q, q->sinkpad, "wait for DEL");                               \
-  q->waiting_del = TRUE;                                                \
-  g_cond_wait (&q->item_del, &q->qlock);                                  \
+  g_atomic_int_set (&q->waiting_del, TRUE);                             \
+  /* the src side of the ring only signals when it sees waiting_del */  \
+  if (gst_queue_is_filled (q))                                          \
+    g_cond_wait (&q->item_del, &q->qlock);                              \
   q->waiting_del = FALSE;                                               \
   if (q->srcresult != GST_FLOW_OK) {                                    \
     STATUS (q, q->srcpad, "received DEL wakeup");                       \
@@ -157,8 +169,10 @@ enum
 
 #define GST_QUEUE_WAIT_ADD_CHECK(q, label) G_STMT_START {               \
   STATUS (q, q->srcpad, "wait for ADD");                                \
-  q->waiting_add = TRUE;                                                \
-  g_cond_wait (&q->item_add, &q->qlock);                                  \
+  g_atomic_int_set (&q->waiting_add, TRUE);                             \
+  /* the sink side of the ring only signals when it sees waiting_add */ \
+  if (gst_queue_is_empty (q))                                           \
+    g_cond_wait (&q->item_add, &q->qlock);                              \
   q->waiting_add = FALSE;                                               \
   if (q->srcresult != GST_FLOW_OK) {                                    \
     STATUS (q, q->srcpad, "received ADD wakeup");                       \
@@ -199,6 +213,8 @@ static GstFlowReturn gst_queue_chain (GstPad * pad, GstObject * parent,
 static GstFlowReturn gst_queue_chain_list (GstPad * pad, GstObject * parent,
     GstBufferList * buffer_list);
 static GstFlowReturn gst_queue_push_one (GstQueue * queue);
+static GstFlowReturn gst_queue_push_item (GstQueue * queue,
+    GstMiniObject * data);
 static void gst_queue_loop (GstPad * pad);
 
 static GstFlowReturn gst_queue_handle_sink_event (GstPad * pad,
@@ -403,6 +419,33 @@ gst_queue_class_init (GstQueueClass * klass)
           G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
           G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstQueue:spsc
+   *
+   * Pass buffers from the upstream thread to the streaming thread of the
+   * queue through a lock-free ring instead of the locked queue, with both
+   * sides spinning for a while before they go to sleep. Events, queries and
+   * buffer lists still go through the locked queue, and buffers follow them
+   * there until the streaming thread has caught up.
+   *
+   * This makes small buffers a lot cheaper to pass through the queue. The
+   * ring is only used while the queue is not leaky, #GstQueue:max-size-time
+   * is 0 and no min-threshold is set. Otherwise all buffers take the locked
+   * path as without this property. Note that #GstQueue:max-size-time defaults
+   * to 1 second, so it has to be set to 0 explicitly. Buffers in the ring
+   * count towards the #GstQueue:max-size-buffers and
+   * #GstQueue:max-size-bytes limits.
+   *
+   * Changes take effect the next time the queue goes to PAUSED.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_SPSC,
+      g_param_spec_boolean ("spsc", "SPSC",
+          "Pass buffers without locking between the upstream thread and the "
+          "streaming thread", DEFAULT_SPSC,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gobject_class->finalize = gst_queue_finalize;
 
   gst_element_class_set_static_metadata (gstelement_class,
@@ -474,6 +517,12 @@ gst_queue_init (GstQueue * queue)
 
   queue->newseg_applied_to_src = FALSE;
 
+  queue->spsc = DEFAULT_SPSC;
+  queue->ring = NULL;
+  queue->ring_bytes = 0;
+  queue->locked_items = 0;
+  queue->sink_spin = queue->src_spin = RING_SPIN_MIN;
+
   GST_DEBUG_OBJECT (queue,
       "initialized queue's not_empty & not_full conditions");
 }
@@ -494,6 +543,14 @@ gst_queue_finalize (GObject * object)
   }
   gst_queue_array_free (queue->queue);
 
+  if (queue->ring) {
+    GstBuffer *buffer;
+
+    while ((buffer = gst_atomic_ring_pop (queue->ring)))
+      gst_buffer_unref (buffer);
+    gst_atomic_ring_unref (queue->ring);
+  }
+
   g_mutex_clear (&queue->qlock);
   g_cond_clear (&queue->item_add);
   g_cond_clear (&queue->item_del);
@@ -526,7 +583,9 @@ update_time_level (GstQueue * queue)
 {
   gint64 sink_time, src_time;
 
-  if (queue->sink_tainted) {
+  /* the ring paths move the positions without QUEUE_LOCK, so the tainted
+   * flags can't be trusted then */
+  if (queue->sink_tainted || queue->ring) {
     GST_LOG_OBJECT (queue, "update sink time");
     queue->sinktime =
         my_segment_to_running_time (&queue->sink_segment,
@@ -535,7 +594,7 @@ update_time_level (GstQueue * queue)
   }
   sink_time = queue->sinktime;
 
-  if (queue->src_tainted) {
+  if (queue->src_tainted || queue->ring) {
     GST_LOG_OBJECT (queue, "update src time");
     queue->srctime =
         my_segment_to_running_time (&queue->src_segment,
@@ -611,16 +670,13 @@ apply_gap (GstQueue * queue, GstEvent * event,
 }
 
 
-/* take a buffer and update segment, updating the time level of the queue. */
+/* move the segment position past a buffer with @timestamp and @duration. The
+ * ring paths call this without QUEUE_LOCK, each side only touches its own
+ * segment. */
 static void
-apply_buffer (GstQueue * queue, GstBuffer * buffer, GstSegment * segment,
-    gboolean sink)
+update_segment_position (GstQueue * queue, GstSegment * segment,
+    GstClockTime timestamp, GstClockTime duration, gboolean sink)
 {
-  GstClockTime duration, timestamp;
-
-  timestamp = GST_BUFFER_DTS_OR_PTS (buffer);
-  duration = GST_BUFFER_DURATION (buffer);
-
   /* if no timestamp is set, assume it's continuous with the previous
    * time */
   if (timestamp == GST_CLOCK_TIME_NONE)
@@ -639,7 +695,15 @@ apply_buffer (GstQueue * queue, GstBuffer * buffer, GstSegment * segment,
     queue->sink_tainted = TRUE;
   else
     queue->src_tainted = TRUE;
+}
 
+/* take a buffer and update segment, updating the time level of the queue. */
+static void
+apply_buffer (GstQueue * queue, GstBuffer * buffer, GstSegment * segment,
+    gboolean sink)
+{
+  update_segment_position (queue, segment, GST_BUFFER_DTS_OR_PTS (buffer),
+      GST_BUFFER_DURATION (buffer), sink);
 
   /* calc diff with other end */
   update_time_level (queue);
@@ -694,11 +758,57 @@ apply_buffer_list (GstQueue * queue, GstBufferList * buffer_list,
   update_time_level (queue);
 }
 
+/* take the oldest buffer from the ring, can be called with or without
+ * QUEUE_LOCK */
+static GstBuffer *
+gst_queue_ring_pop (GstQueue * queue)
+{
+  GstBuffer *buffer;
+
+  while (!(buffer = gst_atomic_ring_pop (queue->ring))) {
+    if (gst_atomic_ring_length (queue->ring) == 0)
+      return NULL;
+    /* the sink side claimed a slot but did not fill it yet, it does not
+     * block while doing that */
+    g_thread_yield ();
+  }
+  g_atomic_int_add (&queue->ring_bytes, -(gint) gst_buffer_get_size (buffer));
+
+  return buffer;
+}
+
+/* the ring doesn't keep the time level up to date and bypasses the
+ * min-threshold checks, only use it when none of those are configured */
+static gboolean
+gst_queue_ring_usable (GstQueue * queue)
+{
+  return queue->max_size.time == 0 && queue->min_threshold.buffers == 0 &&
+      queue->min_threshold.bytes == 0 && queue->min_threshold.time == 0;
+}
+
+/* the sink side only uses the ring when queue is empty, so the ring alone
+ * makes the level */
+static gboolean
+gst_queue_ring_is_filled (GstQueue * queue)
+{
+  return (queue->max_size.buffers > 0 &&
+      gst_atomic_ring_length (queue->ring) >= queue->max_size.buffers) ||
+      (queue->max_size.bytes > 0 &&
+      g_atomic_int_get (&queue->ring_bytes) >= (gint) queue->max_size.bytes);
+}
+
 static void
 gst_queue_locked_flush (GstQueue * queue, gboolean full)
 {
   GstQueueItem *qitem;
 
+  if (queue->ring) {
+    GstBuffer *buffer;
+
+    while ((buffer = gst_queue_ring_pop (queue)))
+      gst_buffer_unref (buffer);
+  }
+
   while ((qitem = gst_queue_array_pop_head_struct (queue->queue))) {
     /* Then lose another reference because we are supposed to destroy that
        data when flushing */
@@ -712,6 +822,7 @@ gst_queue_locked_flush (GstQueue * queue, gboolean full)
       gst_mini_object_unref (qitem->item);
     memset (qitem, 0, sizeof (GstQueueItem));
   }
+  g_atomic_int_set (&queue->locked_items, 0);
   queue->last_query = FALSE;
   g_cond_signal (&queue->query_handled);
   GST_QUEUE_CLEAR_LEVEL (queue->cur_level);
@@ -746,6 +857,7 @@ gst_queue_locked_enqueue_buffer (GstQueue * queue, gpointer item)
   qitem.is_query = FALSE;
   qitem.size = bsize;
   gst_queue_array_push_tail_struct (queue->queue, &qitem);
+  g_atomic_int_inc (&queue->locked_items);
   GST_QUEUE_SIGNAL_ADD (queue);
 }
 
@@ -767,6 +879,7 @@ gst_queue_locked_enqueue_buffer_list (GstQueue * queue, gpointer item)
   qitem.is_query = FALSE;
   qitem.size = bsize;
   gst_queue_array_push_tail_struct (queue->queue, &qitem);
+  g_atomic_int_inc (&queue->locked_items);
   GST_QUEUE_SIGNAL_ADD (queue);
 }
 
@@ -811,6 +924,7 @@ gst_queue_locked_enqueue_event (GstQueue * queue, gpointer item)
   qitem.is_query = FALSE;
   qitem.size = 0;
   gst_queue_array_push_tail_struct (queue->queue, &qitem);
+  g_atomic_int_inc (&queue->locked_items);
   GST_QUEUE_SIGNAL_ADD (queue);
 }
 
@@ -822,9 +936,19 @@ gst_queue_locked_dequeue (GstQueue * queue)
   GstMiniObject *item;
   gsize bufsize;
 
+  /* buffers in the ring are older than the items in queue */
+  if (queue->ring && (item = (GstMiniObject *) gst_queue_ring_pop (queue))) {
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+        "retrieved buffer %p from ring", item);
+    apply_buffer (queue, GST_BUFFER_CAST (item), &queue->src_segment, FALSE);
+    GST_QUEUE_SIGNAL_DEL (queue);
+    return item;
+  }
+
   qitem = gst_queue_array_pop_head_struct (queue->queue);
   if (qitem == NULL)
     goto no_item;
+  g_atomic_int_add (&queue->locked_items, -1);
 
   item = qitem->item;
   bufsize = qitem->size;
@@ -1066,6 +1190,7 @@ gst_queue_handle_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
         qitem.is_query = TRUE;
         qitem.size = 0;
         gst_queue_array_push_tail_struct (queue->queue, &qitem);
+        g_atomic_int_inc (&queue->locked_items);
         GST_QUEUE_SIGNAL_ADD (queue);
         while (queue->srcresult == GST_FLOW_OK &&
             queue->last_handled_query != query)
@@ -1096,6 +1221,9 @@ gst_queue_is_empty (GstQueue * queue)
 {
   GstQueueItem *tail;
 
+  if (queue->ring && gst_atomic_ring_length (queue->ring) > 0)
+    return FALSE;
+
   tail = gst_queue_array_peek_tail_struct (queue->queue);
 
   if (tail == NULL)
@@ -1122,10 +1250,19 @@ gst_queue_is_empty (GstQueue * queue)
 static gboolean
 gst_queue_is_filled (GstQueue * queue)
 {
+  guint buffers = queue->cur_level.buffers;
+  guint bytes = queue->cur_level.bytes;
+
+  /* buffers in the ring count as well */
+  if (queue->ring) {
+    buffers += gst_atomic_ring_length (queue->ring);
+    bytes += MAX (g_atomic_int_get (&queue->ring_bytes), 0);
+  }
+
   return (((queue->max_size.buffers > 0 &&
-              queue->cur_level.buffers >= queue->max_size.buffers) ||
+              buffers >= queue->max_size.buffers) ||
           (queue->max_size.bytes > 0 &&
-              queue->cur_level.bytes >= queue->max_size.bytes) ||
+              bytes >= queue->max_size.bytes) ||
           (queue->max_size.time > 0 &&
               queue->cur_level.time >= queue->max_size.time)));
 }
@@ -1174,6 +1311,59 @@ discont_first_buffer (GstBuffer ** buffer, guint i, gpointer user_data)
   return FALSE;
 }
 
+/* put a buffer in the ring without taking QUEUE_LOCK. Returns FALSE when the
+ * buffer has to go through the locked path. */
+static gboolean
+gst_queue_chain_unlocked (GstQueue * queue, GstBuffer * buffer)
+{
+  gint size = gst_buffer_get_size (buffer);
+  GstClockTime timestamp = GST_BUFFER_DTS_OR_PTS (buffer);
+  GstClockTime duration = GST_BUFFER_DURATION (buffer);
+  guint i;
+
+  /* these are racy reads, when any of them needs handling the locked path
+   * takes care of it. Buffers only go in the ring as long as queue is empty
+   * so that they never overtake items in queue. */
+  if (queue->srcresult != GST_FLOW_OK || queue->eos || queue->unexpected
+      || queue->tail_needs_discont || queue->leaky != GST_QUEUE_NO_LEAK
+      || !gst_queue_ring_usable (queue)
+      || g_atomic_int_get (&queue->locked_items) > 0)
+    return FALSE;
+
+  for (i = 0;; i++) {
+    if (!gst_queue_ring_is_filled (queue)) {
+      /* account the bytes first, the src side can take the buffer as soon
+       * as it is in the ring */
+      g_atomic_int_add (&queue->ring_bytes, size);
+      if (gst_atomic_ring_push (queue->ring, buffer))
+        break;
+      g_atomic_int_add (&queue->ring_bytes, -size);
+    }
+
+    /* spin for a while when full, for longer when that worked before */
+    if (i == queue->sink_spin) {
+      queue->sink_spin = MAX (queue->sink_spin / 2, RING_SPIN_MIN);
+      return FALSE;
+    }
+  }
+  if (i > 0)
+    queue->sink_spin = MIN (queue->sink_spin * 2, RING_SPIN_MAX);
+
+  /* the buffer belongs to the src side now, use the values from before */
+  update_segment_position (queue, &queue->sink_segment, timestamp, duration,
+      TRUE);
+
+  GST_CAT_LOG_OBJECT (queue_dataflow, queue, "put buffer %p in ring", buffer);
+
+  if (g_atomic_int_get (&queue->waiting_add)) {
+    GST_QUEUE_MUTEX_LOCK (queue);
+    GST_QUEUE_SIGNAL_ADD (queue);
+    GST_QUEUE_MUTEX_UNLOCK (queue);
+  }
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_queue_chain_buffer_or_list (GstPad * pad, GstObject * parent,
     GstMiniObject * obj, gboolean is_list)
@@ -1182,6 +1372,10 @@ gst_queue_chain_buffer_or_list (GstPad * pad, GstObject * parent,
 
   queue = GST_QUEUE_CAST (parent);
 
+  if (queue->ring && !is_list
+      && gst_queue_chain_unlocked (queue, GST_BUFFER_CAST (obj)))
+    return GST_FLOW_OK;
+
   /* we have to lock the queue since we span threads */
   GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
   /* when we received EOS, we refuse any more data */
@@ -1346,20 +1540,90 @@ gst_queue_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       GST_MINI_OBJECT_CAST (buffer), FALSE);
 }
 
+/* downstream returned EOS for a buffer, with QUEUE_LOCK. Drop everything up
+ * to the next item that can be pushed and push that. */
+static GstFlowReturn
+gst_queue_locked_push_after_eos (GstQueue * queue)
+{
+  GstMiniObject *data;
+
+  GST_CAT_LOG_OBJECT (queue_dataflow, queue, "got EOS from downstream");
+  /* stop pushing buffers, we dequeue all items until we see an item that we
+   * can push again, which is EOS or SEGMENT. If there is nothing in the
+   * queue we can push, we set a flag to make the sinkpad refuse more
+   * buffers with an EOS return value. */
+  while ((data = gst_queue_locked_dequeue (queue))) {
+    if (GST_IS_BUFFER (data)) {
+      GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+          "dropping EOS buffer %p", data);
+      gst_buffer_unref (GST_BUFFER_CAST (data));
+    } else if (GST_IS_BUFFER_LIST (data)) {
+      GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+          "dropping EOS buffer list %p", data);
+      gst_buffer_list_unref (GST_BUFFER_LIST_CAST (data));
+    } else if (GST_IS_EVENT (data)) {
+      GstEvent *event = GST_EVENT_CAST (data);
+      GstEventType type = GST_EVENT_TYPE (event);
+
+      if (type == GST_EVENT_EOS || type == GST_EVENT_SEGMENT
+          || type == GST_EVENT_STREAM_START) {
+        /* we found a pushable item in the queue, push it out */
+        GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+            "pushing pushable event %s after EOS",
+            GST_EVENT_TYPE_NAME (event));
+        return gst_queue_push_item (queue, data);
+      }
+      GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+          "dropping EOS event %p", event);
+      gst_event_unref (event);
+    } else if (GST_IS_QUERY (data)) {
+      GstQuery *query = GST_QUERY_CAST (data);
+
+      GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+          "dropping query %p because of EOS", query);
+      queue->last_query = FALSE;
+      g_cond_signal (&queue->query_handled);
+    }
+  }
+  /* no more items in the queue. Set the unexpected flag so that upstream
+   * make us refuse any more buffers on the sinkpad. Since we will still
+   * accept EOS and SEGMENT we return _FLOW_OK to the caller so that the
+   * task function does not shut down. */
+  queue->unexpected = TRUE;
+
+  return GST_FLOW_OK;
+}
+
 /* dequeue an item from the queue an push it downstream. This functions returns
  * the result of the push. */
 static GstFlowReturn
 gst_queue_push_one (GstQueue * queue)
 {
-  GstFlowReturn result = queue->srcresult;
   GstMiniObject *data;
-  gboolean is_list;
 
   data = gst_queue_locked_dequeue (queue);
   if (data == NULL)
     goto no_item;
 
-next:
+  return gst_queue_push_item (queue, data);
+
+  /* ERRORS */
+no_item:
+  {
+    GST_CAT_ERROR_OBJECT (queue_dataflow, queue,
+        "exit because we have no item in the queue");
+    return GST_FLOW_ERROR;
+  }
+}
+
+/* push an item dequeued with QUEUE_LOCK downstream. This functions returns
+ * the result of the push. */
+static GstFlowReturn
+gst_queue_push_item (GstQueue * queue, GstMiniObject * data)
+{
+  GstFlowReturn result = queue->srcresult;
+  gboolean is_list;
+
   is_list = GST_IS_BUFFER_LIST (data);
 
   if (GST_IS_BUFFER (data) || is_list) {
@@ -1400,52 +1664,8 @@ next:
     /* need to check for srcresult here as well */
     GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
 
-    if (result == GST_FLOW_EOS) {
-      GST_CAT_LOG_OBJECT (queue_dataflow, queue, "got EOS from downstream");
-      /* stop pushing buffers, we dequeue all items until we see an item that we
-       * can push again, which is EOS or SEGMENT. If there is nothing in the
-       * queue we can push, we set a flag to make the sinkpad refuse more
-       * buffers with an EOS return value. */
-      while ((data = gst_queue_locked_dequeue (queue))) {
-        if (GST_IS_BUFFER (data)) {
-          GST_CAT_LOG_OBJECT (queue_dataflow, queue,
-              "dropping EOS buffer %p", data);
-          gst_buffer_unref (GST_BUFFER_CAST (data));
-        } else if (GST_IS_BUFFER_LIST (data)) {
-          GST_CAT_LOG_OBJECT (queue_dataflow, queue,
-              "dropping EOS buffer list %p", data);
-          gst_buffer_list_unref (GST_BUFFER_LIST_CAST (data));
-        } else if (GST_IS_EVENT (data)) {
-          GstEvent *event = GST_EVENT_CAST (data);
-          GstEventType type = GST_EVENT_TYPE (event);
-
-          if (type == GST_EVENT_EOS || type == GST_EVENT_SEGMENT
-              || type == GST_EVENT_STREAM_START) {
-            /* we found a pushable item in the queue, push it out */
-            GST_CAT_LOG_OBJECT (queue_dataflow, queue,
-                "pushing pushable event %s after EOS",
-                GST_EVENT_TYPE_NAME (event));
-            goto next;
-          }
-          GST_CAT_LOG_OBJECT (queue_dataflow, queue,
-              "dropping EOS event %p", event);
-          gst_event_unref (event);
-        } else if (GST_IS_QUERY (data)) {
-          GstQuery *query = GST_QUERY_CAST (data);
-
-          GST_CAT_LOG_OBJECT (queue_dataflow, queue,
-              "dropping query %p because of EOS", query);
-          queue->last_query = FALSE;
-          g_cond_signal (&queue->query_handled);
-        }
-      }
-      /* no more items in the queue. Set the unexpected flag so that upstream
-       * make us refuse any more buffers on the sinkpad. Since we will still
-       * accept EOS and SEGMENT we return _FLOW_OK to the caller so that the
-       * task function does not shut down. */
-      queue->unexpected = TRUE;
-      result = GST_FLOW_OK;
-    }
+    if (result == GST_FLOW_EOS)
+      result = gst_queue_locked_push_after_eos (queue);
   } else if (GST_IS_EVENT (data)) {
     GstEvent *event = GST_EVENT_CAST (data);
     GstEventType type = GST_EVENT_TYPE (event);
@@ -1477,12 +1697,6 @@ next:
   return result;
 
   /* ERRORS */
-no_item:
-  {
-    GST_CAT_ERROR_OBJECT (queue_dataflow, queue,
-        "exit because we have no item in the queue");
-    return GST_FLOW_ERROR;
-  }
 out_flushing:
   {
     GstFlowReturn ret = queue->srcresult;
@@ -1501,6 +1715,51 @@ out_flushing_query:
   }
 }
 
+/* take a buffer from the ring and push it downstream without taking
+ * QUEUE_LOCK. Returns FALSE when the locked path has to be taken, else the
+ * result of the push is stored in @ret. */
+static gboolean
+gst_queue_push_one_unlocked (GstQueue * queue, GstFlowReturn * ret)
+{
+  GstBuffer *buffer;
+  guint i;
+
+  /* racy reads, the locked path takes care of these */
+  if (queue->srcresult != GST_FLOW_OK || queue->head_needs_discont
+      || !gst_queue_ring_usable (queue))
+    return FALSE;
+
+  for (i = 0;; i++) {
+    if ((buffer = gst_queue_ring_pop (queue)))
+      break;
+
+    /* spin for a while when empty, for longer when that worked before. Items
+     * in queue are handled by the locked path right away. */
+    if (i == queue->src_spin || g_atomic_int_get (&queue->locked_items) > 0) {
+      queue->src_spin = MAX (queue->src_spin / 2, RING_SPIN_MIN);
+      return FALSE;
+    }
+  }
+  if (i > 0)
+    queue->src_spin = MIN (queue->src_spin * 2, RING_SPIN_MAX);
+
+  GST_CAT_LOG_OBJECT (queue_dataflow, queue,
+      "retrieved buffer %p from ring", buffer);
+
+  update_segment_position (queue, &queue->src_segment,
+      GST_BUFFER_DTS_OR_PTS (buffer), GST_BUFFER_DURATION (buffer), FALSE);
+
+  if (g_atomic_int_get (&queue->waiting_del)) {
+    GST_QUEUE_MUTEX_LOCK (queue);
+    GST_QUEUE_SIGNAL_DEL (queue);
+    GST_QUEUE_MUTEX_UNLOCK (queue);
+  }
+
+  *ret = gst_pad_push (queue->srcpad, buffer);
+
+  return TRUE;
+}
+
 static void
 gst_queue_loop (GstPad * pad)
 {
@@ -1509,6 +1768,16 @@ gst_queue_loop (GstPad * pad)
 
   queue = (GstQueue *) GST_PAD_PARENT (pad);
 
+  if (queue->ring && gst_queue_push_one_unlocked (queue, &ret)) {
+    if (G_LIKELY (ret == GST_FLOW_OK))
+      return;
+
+    GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
+    if (ret == GST_FLOW_EOS)
+      ret = gst_queue_locked_push_after_eos (queue);
+    goto done;
+  }
+
   /* have to lock for thread-safety */
   GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
 
@@ -1535,6 +1804,8 @@ gst_queue_loop (GstPad * pad)
   }
 
   ret = gst_queue_push_one (queue);
+
+done:
   queue->srcresult = ret;
   if (ret != GST_FLOW_OK)
     goto out_flushing;
@@ -1730,6 +2001,32 @@ gst_queue_sink_activate_mode (GstPad * pad, GstObject * parent, GstPadMode mode,
   return result;
 }
 
+/* create the ring when the spsc property is set, with QUEUE_LOCK and before
+ * the streaming thread starts */
+static void
+gst_queue_locked_setup_ring (GstQueue * queue)
+{
+  guint size;
+
+  if (queue->ring) {
+    GstBuffer *buffer;
+
+    while ((buffer = gst_queue_ring_pop (queue)))
+      gst_buffer_unref (buffer);
+    gst_atomic_ring_unref (queue->ring);
+    queue->ring = NULL;
+  }
+
+  if (!queue->spsc)
+    return;
+
+  size = queue->max_size.buffers > 0 ? queue->max_size.buffers :
+      RING_DEFAULT_SIZE;
+  queue->ring = gst_atomic_ring_new (MIN (size, RING_MAX_SIZE));
+  queue->ring_bytes = 0;
+  queue->sink_spin = queue->src_spin = RING_SPIN_MIN;
+}
+
 static gboolean
 gst_queue_src_activate_mode (GstPad * pad, GstObject * parent, GstPadMode mode,
     gboolean active)
@@ -1746,6 +2043,7 @@ gst_queue_src_activate_mode (GstPad * pad, GstObject * parent, GstPadMode mode,
         queue->srcresult = GST_FLOW_OK;
         queue->eos = FALSE;
         queue->unexpected = FALSE;
+        gst_queue_locked_setup_ring (queue);
         result =
             gst_pad_start_task (pad, (GstTaskFunction) gst_queue_loop, pad,
             NULL);
@@ -1840,6 +2138,9 @@ gst_queue_set_property (GObject * object,
     case PROP_FLUSH_ON_EOS:
       queue->flush_on_eos = g_value_get_boolean (value);
       break;
+    case PROP_SPSC:
+      queue->spsc = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1858,10 +2159,12 @@ gst_queue_get_property (GObject * object,
 
   switch (prop_id) {
     case PROP_CUR_LEVEL_BYTES:
-      g_value_set_uint (value, queue->cur_level.bytes);
+      g_value_set_uint (value, queue->cur_level.bytes + (queue->ring ?
+              MAX (g_atomic_int_get (&queue->ring_bytes), 0) : 0));
       break;
     case PROP_CUR_LEVEL_BUFFERS:
-      g_value_set_uint (value, queue->cur_level.buffers);
+      g_value_set_uint (value, queue->cur_level.buffers + (queue->ring ?
+              gst_atomic_ring_length (queue->ring) : 0));
       break;
     case PROP_CUR_LEVEL_TIME:
       g_value_set_uint64 (value, queue->cur_level.time);
@@ -1893,6 +2196,9 @@ gst_queue_get_property (GObject * object,
     case PROP_FLUSH_ON_EOS:
       g_value_set_boolean (value, queue->flush_on_eos);
       break;
+    case PROP_SPSC:
+      g_value_set_boolean (value, queue->spsc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
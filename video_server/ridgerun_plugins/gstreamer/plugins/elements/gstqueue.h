@@ -138,6 +138,15 @@ struct _GstQueue {
   GstQuery *last_handled_query;
 
   gboolean flush_on_eos; /* flush on EOS */
+
+  /* buffers passed without qlock, see the spsc property */
+  gboolean spsc;
+  GstAtomicRing *ring;
+  volatile gint ring_bytes;
+  /* number of items in queue, buffers only go in the ring when it's 0 */
+  volatile gint locked_items;
+  /* adaptive spin counts of the sink and src side */
+  guint sink_spin, src_spin;
 };
 
 struct _GstQueueClass {
@@ -35,6 +35,17 @@
  * provide separate threads for each branch. Otherwise a blocked dataflow in one
  * branch would stall the other branches.
  *
+ * Alternatively, the #GstTee:parallel property gives every src pad a small
+ * queue and a streaming thread of its own. The size and leaky behaviour of
+ * these queues can be configured per src pad with the "max-size-buffers" and
+ * "leaky" pad properties, and the "dropped", "avg-latency" and "max-latency"
+ * pad properties report how the branch keeps up.
+ *
+ * By default the queues leak on the downstream end, so a branch that blocks
+ * loses its oldest buffers instead of stalling the other branches. Set
+ * "leaky" to "no" on a src pad for a branch that must not lose data; that
+ * branch then holds up the others when its queue is full.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 filesrc location=song.ogg ! decodebin ! tee name=t ! queue ! audioconvert ! audioresample ! autoaudiosink t. ! queue ! audioconvert ! goom ! videoconvert ! autovideosink
@@ -81,12 +92,32 @@ gst_tee_pull_mode_get_type (void)
   return type;
 }
 
+#define GST_TYPE_TEE_LEAKY (gst_tee_leaky_get_type())
+static GType
+gst_tee_leaky_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue data[] = {
+    {GST_TEE_NO_LEAK, "Not Leaky", "no"},
+    {GST_TEE_LEAK_UPSTREAM, "Leaky on upstream (new buffers)", "upstream"},
+    {GST_TEE_LEAK_DOWNSTREAM, "Leaky on downstream (old buffers)",
+        "downstream"},
+    {0, NULL, NULL},
+  };
+
+  if (!type) {
+    type = g_enum_register_static ("GstTeeLeaky", data);
+  }
+  return type;
+}
+
 #define DEFAULT_PROP_NUM_SRC_PADS	0
 #define DEFAULT_PROP_HAS_CHAIN		TRUE
 #define DEFAULT_PROP_SILENT		TRUE
 #define DEFAULT_PROP_LAST_MESSAGE	NULL
 #define DEFAULT_PULL_MODE		GST_TEE_PULL_MODE_NEVER
 #define DEFAULT_PROP_ALLOW_NOT_LINKED	FALSE
+#define DEFAULT_PROP_PARALLEL		FALSE
 
 enum
 {
@@ -98,6 +129,7 @@ enum
   PROP_PULL_MODE,
   PROP_ALLOC_PAD,
   PROP_ALLOW_NOT_LINKED,
+  PROP_PARALLEL,
 };
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src_%u",
@@ -139,6 +171,23 @@ struct _GstTeePad
   gboolean pushed;
   GstFlowReturn result;
   gboolean removed;
+
+  /* parallel mode, protected by lock */
+  gboolean worker;
+  GMutex lock;
+  GCond item_add;
+  GCond item_del;
+  GQueue queue;
+  guint level;
+  gboolean in_flight;
+  GstFlowReturn srcresult;
+
+  guint max_size_buffers;
+  GstTeeLeaky leaky;
+
+  guint64 dropped;
+  GstClockTime avg_latency;
+  GstClockTime max_latency;
 };
 
 struct _GstTeePadClass
@@ -146,11 +195,117 @@ struct _GstTeePadClass
   GstPadClass parent;
 };
 
+/* an item in the queue of a src pad in parallel mode */
+typedef struct
+{
+  GstMiniObject *object;
+  GstClockTime timestamp;
+} GstTeePadItem;
+
+#define DEFAULT_PAD_MAX_SIZE_BUFFERS	16
+#define DEFAULT_PAD_LEAKY		GST_TEE_LEAK_DOWNSTREAM
+
+enum
+{
+  PROP_PAD_0,
+  PROP_PAD_MAX_SIZE_BUFFERS,
+  PROP_PAD_LEAKY,
+  PROP_PAD_CURRENT_LEVEL_BUFFERS,
+  PROP_PAD_DROPPED,
+  PROP_PAD_AVG_LATENCY,
+  PROP_PAD_MAX_LATENCY,
+};
+
 G_DEFINE_TYPE (GstTeePad, gst_tee_pad, GST_TYPE_PAD);
 
+static void gst_tee_pad_finalize (GObject * object);
+static void gst_tee_pad_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_tee_pad_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
 static void
 gst_tee_pad_class_init (GstTeePadClass * klass)
 {
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->finalize = gst_tee_pad_finalize;
+  gobject_class->set_property = gst_tee_pad_set_property;
+  gobject_class->get_property = gst_tee_pad_get_property;
+
+  /**
+   * GstTeePad:max-size-buffers:
+   *
+   * Maximum number of buffers and buffer lists in the queue of this pad when
+   * the tee is in parallel mode.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PAD_MAX_SIZE_BUFFERS,
+      g_param_spec_uint ("max-size-buffers", "Max. size (buffers)",
+          "Max. number of buffers in the queue in parallel mode", 1, G_MAXUINT,
+          DEFAULT_PAD_MAX_SIZE_BUFFERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstTeePad:leaky:
+   *
+   * What to do with a buffer when the queue of this pad is full in parallel
+   * mode. The default drops the oldest buffer so that a blocked branch does
+   * not stall the others. Events are never dropped.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PAD_LEAKY,
+      g_param_spec_enum ("leaky", "Leaky",
+          "Where the queue leaks in parallel mode, if at all",
+          GST_TYPE_TEE_LEAKY, DEFAULT_PAD_LEAKY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstTeePad:current-level-buffers:
+   *
+   * Number of buffers and buffer lists currently in the queue of this pad.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_PAD_CURRENT_LEVEL_BUFFERS,
+      g_param_spec_uint ("current-level-buffers", "Current level (buffers)",
+          "Current number of buffers in the queue", 0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstTeePad:dropped:
+   *
+   * Number of buffers and buffer lists the queue of this pad dropped because
+   * it was full.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PAD_DROPPED,
+      g_param_spec_uint64 ("dropped", "Dropped",
+          "Number of buffers dropped by a leaky queue", 0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstTeePad:avg-latency:
+   *
+   * Running average of the time buffers spend in the queue of this pad.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PAD_AVG_LATENCY,
+      g_param_spec_uint64 ("avg-latency", "Average latency",
+          "Running average of the time buffers spend in the queue (in ns)",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstTeePad:max-latency:
+   *
+   * Maximum time a buffer spent in the queue of this pad.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PAD_MAX_LATENCY,
+      g_param_spec_uint64 ("max-latency", "Maximum latency",
+          "Maximum time a buffer spent in the queue (in ns)",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -165,6 +320,307 @@ static void
 gst_tee_pad_init (GstTeePad * pad)
 {
   gst_tee_pad_reset (pad);
+
+  g_mutex_init (&pad->lock);
+  g_cond_init (&pad->item_add);
+  g_cond_init (&pad->item_del);
+  g_queue_init (&pad->queue);
+  pad->srcresult = GST_FLOW_FLUSHING;
+  pad->max_size_buffers = DEFAULT_PAD_MAX_SIZE_BUFFERS;
+  pad->leaky = DEFAULT_PAD_LEAKY;
+}
+
+/* call with the pad lock */
+static void
+gst_tee_pad_flush_items (GstTeePad * pad, gboolean full)
+{
+  GstTeePadItem *item;
+
+  while ((item = g_queue_pop_head (&pad->queue))) {
+    GstMiniObject *object = item->object;
+
+    /* keep the sticky events, except for SEGMENT and EOS, like queue does */
+    if (!full && GST_IS_EVENT (object) && GST_EVENT_IS_STICKY (object) &&
+        GST_EVENT_TYPE (object) != GST_EVENT_SEGMENT &&
+        GST_EVENT_TYPE (object) != GST_EVENT_EOS)
+      gst_pad_store_sticky_event (GST_PAD_CAST (pad), GST_EVENT_CAST (object));
+
+    gst_mini_object_unref (object);
+    g_slice_free (GstTeePadItem, item);
+  }
+  pad->level = 0;
+  g_cond_broadcast (&pad->item_del);
+}
+
+static void
+gst_tee_pad_finalize (GObject * object)
+{
+  GstTeePad *pad = GST_TEE_PAD_CAST (object);
+
+  gst_tee_pad_flush_items (pad, TRUE);
+  g_mutex_clear (&pad->lock);
+  g_cond_clear (&pad->item_add);
+  g_cond_clear (&pad->item_del);
+
+  G_OBJECT_CLASS (gst_tee_pad_parent_class)->finalize (object);
+}
+
+static void
+gst_tee_pad_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstTeePad *pad = GST_TEE_PAD_CAST (object);
+
+  g_mutex_lock (&pad->lock);
+  switch (prop_id) {
+    case PROP_PAD_MAX_SIZE_BUFFERS:
+      pad->max_size_buffers = g_value_get_uint (value);
+      /* a waiting producer might fit now */
+      g_cond_broadcast (&pad->item_del);
+      break;
+    case PROP_PAD_LEAKY:
+      pad->leaky = g_value_get_enum (value);
+      g_cond_broadcast (&pad->item_del);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  g_mutex_unlock (&pad->lock);
+}
+
+static void
+gst_tee_pad_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstTeePad *pad = GST_TEE_PAD_CAST (object);
+
+  g_mutex_lock (&pad->lock);
+  switch (prop_id) {
+    case PROP_PAD_MAX_SIZE_BUFFERS:
+      g_value_set_uint (value, pad->max_size_buffers);
+      break;
+    case PROP_PAD_LEAKY:
+      g_value_set_enum (value, pad->leaky);
+      break;
+    case PROP_PAD_CURRENT_LEVEL_BUFFERS:
+      g_value_set_uint (value, pad->level);
+      break;
+    case PROP_PAD_DROPPED:
+      g_value_set_uint64 (value, pad->dropped);
+      break;
+    case PROP_PAD_AVG_LATENCY:
+      g_value_set_uint64 (value, pad->avg_latency);
+      break;
+    case PROP_PAD_MAX_LATENCY:
+      g_value_set_uint64 (value, pad->max_latency);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  g_mutex_unlock (&pad->lock);
+}
+
+/* call with the pad lock, drops the oldest buffer in the queue */
+static void
+gst_tee_pad_leak_downstream (GstTeePad * pad)
+{
+  GList *link;
+
+  for (link = pad->queue.head; link; link = link->next) {
+    GstTeePadItem *item = link->data;
+
+    if (GST_IS_EVENT (item->object))
+      continue;
+
+    GST_LOG_OBJECT (pad, "queue is full, leaking item %p on downstream end",
+        item->object);
+    gst_mini_object_unref (item->object);
+    g_slice_free (GstTeePadItem, item);
+    g_queue_delete_link (&pad->queue, link);
+    pad->level--;
+    pad->dropped++;
+    break;
+  }
+}
+
+/* Queues @object for the streaming thread of @pad and returns the result of
+ * the last push on @pad. Buffers and buffer lists wait for space in the queue
+ * unless the pad is leaky, events are always queued. Takes ownership of
+ * @object. */
+static GstFlowReturn
+gst_tee_pad_enqueue (GstTeePad * pad, GstMiniObject * object)
+{
+  GstTeePadItem *item;
+  GstFlowReturn ret;
+  gboolean is_data = !GST_IS_EVENT (object);
+
+  g_mutex_lock (&pad->lock);
+  if (pad->srcresult == GST_FLOW_FLUSHING || pad->srcresult < GST_FLOW_EOS)
+    goto out_flushing;
+
+  while (is_data && pad->level >= pad->max_size_buffers) {
+    if (pad->leaky == GST_TEE_LEAK_UPSTREAM) {
+      GST_LOG_OBJECT (pad, "queue is full, leaking item %p on upstream end",
+          object);
+      pad->dropped++;
+      ret = pad->srcresult;
+      g_mutex_unlock (&pad->lock);
+      gst_mini_object_unref (object);
+      return ret;
+    } else if (pad->leaky == GST_TEE_LEAK_DOWNSTREAM) {
+      gst_tee_pad_leak_downstream (pad);
+    } else {
+      g_cond_wait (&pad->item_del, &pad->lock);
+      if (pad->srcresult == GST_FLOW_FLUSHING || pad->srcresult < GST_FLOW_EOS)
+        goto out_flushing;
+    }
+  }
+
+  item = g_slice_new (GstTeePadItem);
+  item->object = object;
+  item->timestamp = gst_util_get_timestamp ();
+  g_queue_push_tail (&pad->queue, item);
+  if (is_data)
+    pad->level++;
+  g_cond_signal (&pad->item_add);
+
+  ret = pad->srcresult;
+  g_mutex_unlock (&pad->lock);
+
+  return ret;
+
+  /* ERRORS */
+out_flushing:
+  {
+    ret = pad->srcresult;
+    GST_LOG_OBJECT (pad, "not queueing item %p, %s", object,
+        gst_flow_get_name (ret));
+    g_mutex_unlock (&pad->lock);
+    gst_mini_object_unref (object);
+    return ret;
+  }
+}
+
+/* streaming thread of a src pad in parallel mode */
+static void
+gst_tee_pad_loop (GstTeePad * pad)
+{
+  GstTeePadItem *item;
+  GstMiniObject *object;
+  GstClockTime latency;
+  GstFlowReturn ret;
+
+  g_mutex_lock (&pad->lock);
+  while (g_queue_is_empty (&pad->queue)) {
+    if (pad->srcresult == GST_FLOW_FLUSHING || pad->srcresult < GST_FLOW_EOS)
+      goto out_flushing;
+    g_cond_wait (&pad->item_add, &pad->lock);
+  }
+  if (pad->srcresult == GST_FLOW_FLUSHING || pad->srcresult < GST_FLOW_EOS)
+    goto out_flushing;
+
+  item = g_queue_pop_head (&pad->queue);
+  object = item->object;
+  if (!GST_IS_EVENT (object)) {
+    pad->level--;
+
+    latency = gst_util_get_timestamp () - item->timestamp;
+    pad->avg_latency = (15 * pad->avg_latency + latency) / 16;
+    if (latency > pad->max_latency)
+      pad->max_latency = latency;
+  }
+  g_slice_free (GstTeePadItem, item);
+  pad->in_flight = TRUE;
+  g_cond_broadcast (&pad->item_del);
+  g_mutex_unlock (&pad->lock);
+
+  if (GST_IS_BUFFER (object)) {
+    ret = gst_pad_push (GST_PAD_CAST (pad), GST_BUFFER_CAST (object));
+  } else if (GST_IS_BUFFER_LIST (object)) {
+    ret = gst_pad_push_list (GST_PAD_CAST (pad), GST_BUFFER_LIST_CAST (object));
+  } else {
+    gst_pad_push_event (GST_PAD_CAST (pad), GST_EVENT_CAST (object));
+    object = NULL;
+    ret = GST_FLOW_OK;
+  }
+
+  g_mutex_lock (&pad->lock);
+  pad->in_flight = FALSE;
+  /* only buffers update the result, and a flush always wins */
+  if (object && pad->srcresult != GST_FLOW_FLUSHING) {
+    GST_LOG_OBJECT (pad, "pushed item %p, %s", object,
+        gst_flow_get_name (ret));
+    pad->srcresult = ret;
+  }
+  g_cond_broadcast (&pad->item_del);
+  /* keep running on NOT_LINKED and EOS like the sequential tee keeps
+   * pushing, stop on flushing and errors */
+  if (pad->srcresult == GST_FLOW_FLUSHING || pad->srcresult < GST_FLOW_EOS)
+    goto out_flushing;
+  g_mutex_unlock (&pad->lock);
+
+  return;
+
+out_flushing:
+  {
+    GST_DEBUG_OBJECT (pad, "pausing task, reason %s",
+        gst_flow_get_name (pad->srcresult));
+    g_mutex_unlock (&pad->lock);
+    gst_pad_pause_task (GST_PAD_CAST (pad));
+    return;
+  }
+}
+
+static gboolean
+gst_tee_pad_start_worker (GstTeePad * pad)
+{
+  g_mutex_lock (&pad->lock);
+  gst_tee_pad_flush_items (pad, FALSE);
+  pad->worker = TRUE;
+  pad->srcresult = GST_FLOW_OK;
+  g_mutex_unlock (&pad->lock);
+
+  return gst_pad_start_task (GST_PAD_CAST (pad),
+      (GstTaskFunction) gst_tee_pad_loop, pad, NULL);
+}
+
+static void
+gst_tee_pad_set_flushing (GstTeePad * pad)
+{
+  g_mutex_lock (&pad->lock);
+  pad->srcresult = GST_FLOW_FLUSHING;
+  g_cond_signal (&pad->item_add);
+  g_cond_broadcast (&pad->item_del);
+  g_mutex_unlock (&pad->lock);
+}
+
+static gboolean
+gst_tee_pad_stop_worker (GstTeePad * pad)
+{
+  gboolean res;
+
+  gst_tee_pad_set_flushing (pad);
+  res = gst_pad_stop_task (GST_PAD_CAST (pad));
+
+  g_mutex_lock (&pad->lock);
+  gst_tee_pad_flush_items (pad, TRUE);
+  pad->worker = FALSE;
+  g_mutex_unlock (&pad->lock);
+
+  return res;
+}
+
+/* waits until the queue of @pad is pushed out, call without the pad lock */
+static void
+gst_tee_pad_drain (GstTeePad * pad)
+{
+  g_mutex_lock (&pad->lock);
+  while ((!g_queue_is_empty (&pad->queue) || pad->in_flight) &&
+      pad->srcresult != GST_FLOW_FLUSHING && pad->srcresult >= GST_FLOW_EOS)
+    g_cond_wait (&pad->item_del, &pad->lock);
+  g_mutex_unlock (&pad->lock);
 }
 
 static GstPad *gst_tee_request_new_pad (GstElement * element,
@@ -286,6 +742,26 @@ gst_tee_class_init (GstTeeClass * klass)
           "all unlinked", DEFAULT_PROP_ALLOW_NOT_LINKED,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstTee:parallel
+   *
+   * Push on every src pad from a streaming thread of its own, with a small
+   * queue per src pad, instead of pushing on all src pads one after the other
+   * from the upstream thread. A slow branch then doesn't delay the other
+   * branches, and the branches can run on different cores.
+   *
+   * The queues are configured with the properties of the src pads. The
+   * property takes effect when the src pads are activated.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PARALLEL,
+      g_param_spec_boolean ("parallel", "Parallel",
+          "Push on every src pad from its own streaming thread",
+          DEFAULT_PROP_PARALLEL,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (gstelement_class,
       "Tee pipe fitting",
       "Generic",
@@ -320,6 +796,7 @@ gst_tee_init (GstTee * tee)
   tee->pad_indexes = g_hash_table_new (NULL, NULL);
 
   tee->last_message = NULL;
+  tee->parallel = DEFAULT_PROP_PARALLEL;
 }
 
 static void
@@ -351,7 +828,7 @@ gst_tee_request_new_pad (GstElement * element, GstPadTemplate * templ,
   GstPad *srcpad;
   GstTee *tee;
   GstPadMode mode;
-  gboolean res;
+  gboolean res, parallel;
   guint index = 0;
 
   tee = GST_TEE (element);
@@ -389,6 +866,7 @@ gst_tee_request_new_pad (GstElement * element, GstPadTemplate * templ,
   g_free (name);
 
   mode = tee->sink_mode;
+  parallel = tee->parallel;
 
   GST_OBJECT_UNLOCK (tee);
 
@@ -417,6 +895,11 @@ gst_tee_request_new_pad (GstElement * element, GstPadTemplate * templ,
   gst_pad_sticky_events_foreach (tee->sinkpad, forward_sticky_events, srcpad);
   gst_element_add_pad (GST_ELEMENT_CAST (tee), srcpad);
 
+  /* the pad was activated before it had our activate function, start the
+   * streaming thread now */
+  if (parallel && mode != GST_PAD_MODE_NONE)
+    gst_tee_pad_start_worker (GST_TEE_PAD_CAST (srcpad));
+
   return srcpad;
 
   /* ERRORS */
@@ -508,6 +991,9 @@ gst_tee_set_property (GObject * object, guint prop_id, const GValue * value,
     case PROP_ALLOW_NOT_LINKED:
       tee->allow_not_linked = g_value_get_boolean (value);
       break;
+    case PROP_PARALLEL:
+      tee->parallel = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -544,6 +1030,9 @@ gst_tee_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_ALLOW_NOT_LINKED:
       g_value_set_boolean (value, tee->allow_not_linked);
       break;
+    case PROP_PARALLEL:
+      g_value_set_boolean (value, tee->parallel);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -551,11 +1040,90 @@ gst_tee_get_property (GObject * object, guint prop_id, GValue * value,
   GST_OBJECT_UNLOCK (tee);
 }
 
+struct ForwardEventCtx
+{
+  GstEvent *event;
+  gboolean result;
+  gboolean dispatched;
+};
+
+/* forwards an event in parallel mode, serialized events other than caps go
+ * through the queue of the src pad so that they stay in order with the
+ * buffers */
 static gboolean
-gst_tee_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+gst_tee_forward_event (GstPad * pad, gpointer user_data)
 {
+  GstTeePad *tpad = GST_TEE_PAD_CAST (pad);
+  struct ForwardEventCtx *ctx = user_data;
+  GstEvent *event = ctx->event;
+  GstFlowReturn ret;
   gboolean res;
 
+  if (!tpad->worker) {
+    res = gst_pad_push_event (pad, gst_event_ref (event));
+    goto done;
+  }
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      gst_tee_pad_set_flushing (tpad);
+      res = gst_pad_push_event (pad, gst_event_ref (event));
+      /* the streaming thread is unblocked now */
+      gst_pad_pause_task (pad);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      res = gst_pad_push_event (pad, gst_event_ref (event));
+      gst_tee_pad_start_worker (tpad);
+      break;
+    default:
+      if (!GST_EVENT_IS_SERIALIZED (event)) {
+        res = gst_pad_push_event (pad, gst_event_ref (event));
+        break;
+      }
+
+      /* caps are pushed from here once everything before them is out, so
+       * that upstream sees a failed negotiation */
+      if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
+        gst_tee_pad_drain (tpad);
+        res = gst_pad_push_event (pad, gst_event_ref (event));
+        break;
+      }
+
+      ret = gst_tee_pad_enqueue (tpad,
+          GST_MINI_OBJECT_CAST (gst_event_ref (event)));
+      res = ret != GST_FLOW_FLUSHING && ret >= GST_FLOW_EOS;
+      break;
+  }
+
+done:
+  /* the same as gst_pad_event_default(), succeed if any pad took it */
+  ctx->result |= res;
+  ctx->dispatched = TRUE;
+
+  /* continue with the next pad */
+  return FALSE;
+}
+
+static gboolean
+gst_tee_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstTee *tee = GST_TEE (parent);
+  gboolean res, parallel;
+
+  GST_OBJECT_LOCK (tee);
+  parallel = tee->parallel;
+  GST_OBJECT_UNLOCK (tee);
+
+  if (parallel) {
+    struct ForwardEventCtx ctx = { event, FALSE, FALSE };
+
+    gst_pad_forward (pad, gst_tee_forward_event, &ctx);
+    gst_event_unref (event);
+
+    /* without src pads there is nobody to fail */
+    return ctx.dispatched ? ctx.result : TRUE;
+  }
+
   switch (GST_EVENT_TYPE (event)) {
     default:
       res = gst_pad_event_default (pad, parent, event);
@@ -733,11 +1301,29 @@ gst_tee_clear_query_allocation_meta (GstQuery * query)
     gst_query_remove_nth_allocation_meta (query, count - i);
 }
 
+static gboolean
+gst_tee_drain_pad (GstPad * pad, gpointer user_data)
+{
+  if (GST_TEE_PAD_CAST (pad)->worker)
+    gst_tee_pad_drain (GST_TEE_PAD_CAST (pad));
+
+  return FALSE;
+}
+
 static gboolean
 gst_tee_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
 {
   GstTee *tee = GST_TEE (parent);
-  gboolean res;
+  gboolean res, parallel;
+
+  GST_OBJECT_LOCK (tee);
+  parallel = tee->parallel;
+  GST_OBJECT_UNLOCK (tee);
+
+  /* serialized queries, like the allocation query, must see everything
+   * that came before them */
+  if (parallel && GST_QUERY_IS_SERIALIZED (query))
+    gst_pad_forward (pad, gst_tee_drain_pad, NULL);
 
   switch (GST_QUERY_TYPE (query)) {
     case GST_QUERY_ALLOCATION:
@@ -848,6 +1434,10 @@ gst_tee_do_push (GstTee * tee, GstPad * pad, gpointer data, gboolean is_list)
   if (pad == tee->pull_pad) {
     /* don't push on the pad we're pulling from */
     res = GST_FLOW_OK;
+  } else if (GST_TEE_PAD_CAST (pad)->worker) {
+    /* parallel mode, the streaming thread of the pad pushes */
+    res = gst_tee_pad_enqueue (GST_TEE_PAD_CAST (pad),
+        gst_mini_object_ref (GST_MINI_OBJECT_CAST (data)));
   } else if (is_list) {
     res =
         gst_pad_push_list (pad,
@@ -893,6 +1483,9 @@ gst_tee_handle_data (GstTee * tee, gpointer data, gboolean is_list)
 
     if (pad == tee->pull_pad) {
       ret = GST_FLOW_OK;
+    } else if (GST_TEE_PAD_CAST (pad)->worker) {
+      ret = gst_tee_pad_enqueue (GST_TEE_PAD_CAST (pad),
+          GST_MINI_OBJECT_CAST (data));
     } else if (is_list) {
       ret = gst_pad_push_list (pad, GST_BUFFER_LIST_CAST (data));
     } else {
@@ -1085,12 +1678,28 @@ gst_tee_src_activate_mode (GstPad * pad, GstObject * parent, GstPadMode mode,
     gboolean active)
 {
   GstTee *tee;
-  gboolean res;
+  gboolean res, parallel;
   GstPad *sinkpad;
 
+  /* NULL for a pad that was released */
   tee = GST_TEE (parent);
 
   switch (mode) {
+    case GST_PAD_MODE_PUSH:
+    {
+      if (active) {
+        GST_OBJECT_LOCK (tee);
+        parallel = tee->parallel;
+        GST_OBJECT_UNLOCK (tee);
+
+        res = parallel ? gst_tee_pad_start_worker (GST_TEE_PAD_CAST (pad)) :
+            TRUE;
+      } else {
+        /* stop the streaming thread, if there is one */
+        res = gst_tee_pad_stop_worker (GST_TEE_PAD_CAST (pad));
+      }
+      break;
+    }
     case GST_PAD_MODE_PULL:
     {
       GST_OBJECT_LOCK (tee);
@@ -57,6 +57,20 @@ typedef enum {
   GST_TEE_PULL_MODE_SINGLE,
 } GstTeePullMode;
 
+/**
+ * GstTeeLeaky:
+ * @GST_TEE_NO_LEAK: Not Leaky
+ * @GST_TEE_LEAK_UPSTREAM: Leaky on upstream (new buffers)
+ * @GST_TEE_LEAK_DOWNSTREAM: Leaky on downstream (old buffers)
+ *
+ * What a src pad in parallel mode does with a buffer when its queue is full.
+ */
+typedef enum {
+  GST_TEE_NO_LEAK,
+  GST_TEE_LEAK_UPSTREAM,
+  GST_TEE_LEAK_DOWNSTREAM
+} GstTeeLeaky;
+
 /**
  * GstTee:
  *
@@ -81,6 +95,8 @@ struct _GstTee {
   GstPad         *pull_pad;
 
   gboolean        allow_not_linked;
+
+  gboolean        parallel;
 };
 
 struct _GstTeeClass {
@@ -23,9 +23,80 @@
 #include "gst/glib-compat-private.h"
 
 #define MAX_THREADS  1000
+/* number of times the metas are looked up per buffer */
+#define META_LOOKUPS 4
 
 static guint64 nbbuffers;
 static GMutex mutex;
+static gboolean with_metas;
+
+static GstCaps *ref_caps;
+static GstBuffer *parent_buffer;
+
+/* a small meta, like the KLV meta */
+typedef struct
+{
+  GstMeta meta;
+
+  guint8 id;
+  guint16 length;
+} StressMeta;
+
+static GType
+stress_meta_api_get_type (void)
+{
+  static volatile GType type;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("StressMetaAPI", tags);
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+static gboolean
+stress_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  StressMeta *smeta = (StressMeta *) meta;
+
+  smeta->id = 0;
+  smeta->length = 0;
+  return TRUE;
+}
+
+static const GstMetaInfo *
+stress_meta_get_info (void)
+{
+  static const GstMetaInfo *info = NULL;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *mi = gst_meta_register (stress_meta_api_get_type (),
+        "StressMeta", sizeof (StressMeta), stress_meta_init, NULL, NULL);
+    g_once_init_leave (&info, mi);
+  }
+  return info;
+}
+
+/* add a few metas and look them up like elements do on every hop */
+static void
+add_metas (GstBuffer * buf)
+{
+  gint i;
+
+  gst_buffer_add_reference_timestamp_meta (buf, ref_caps, 0,
+      GST_CLOCK_TIME_NONE);
+  gst_buffer_add_parent_buffer_meta (buf, parent_buffer);
+  gst_buffer_add_meta (buf, stress_meta_get_info (), NULL);
+
+  for (i = 0; i < META_LOOKUPS; i++) {
+    if (!gst_buffer_get_reference_timestamp_meta (buf, ref_caps) ||
+        !gst_buffer_get_meta (buf, GST_PARENT_BUFFER_META_API_TYPE) ||
+        !gst_buffer_get_meta (buf, stress_meta_api_get_type ()) ||
+        gst_buffer_get_meta (buf, GST_PROTECTION_META_API_TYPE))
+      g_assert_not_reached ();
+  }
+}
 
 
 static void *
@@ -45,6 +116,8 @@ run_test (void *user_data)
 
   for (nb = nbbuffers; nb; nb--) {
     buf = gst_buffer_new ();
+    if (with_metas)
+      add_metas (buf);
     gst_buffer_unref (buf);
   }
 
@@ -58,39 +131,14 @@ run_test (void *user_data)
   return NULL;
 }
 
-gint
-main (gint argc, gchar * argv[])
+static void
+run_threads (gint num_threads)
 {
   GThread *threads[MAX_THREADS];
-  gint num_threads;
   gint t;
-  GstBuffer *tmp;
   GstClockTime start, end;
 
-  gst_init (&argc, &argv);
-  g_mutex_init (&mutex);
-
-  if (argc != 3) {
-    g_print ("usage: %s <num_threads> <nbbuffers>\n", argv[0]);
-    exit (-1);
-  }
-
-  num_threads = atoi (argv[1]);
-  nbbuffers = atoi (argv[2]);
-
-  if (num_threads <= 0 || num_threads > MAX_THREADS) {
-    g_print ("number of threads must be between 0 and %d\n", MAX_THREADS);
-    exit (-2);
-  }
-
-  if (nbbuffers <= 0) {
-    g_print ("number of buffers must be greater than 0\n");
-    exit (-3);
-  }
-
   g_mutex_lock (&mutex);
-  /* Let's just make sure the GstBufferClass is loaded ... */
-  tmp = gst_buffer_new ();
 
   printf ("main(): Creating %d threads.\n", num_threads);
   for (t = 0; t < num_threads; t++) {
@@ -117,13 +165,55 @@ main (gint argc, gchar * argv[])
 
   end = gst_util_get_timestamp ();
   g_print ("*** total %" GST_TIME_FORMAT " - average %" GST_TIME_FORMAT
-      "  - Done creating %" G_GUINT64_FORMAT " buffers\n",
+      "  - Done creating %" G_GUINT64_FORMAT " buffers%s\n",
       GST_TIME_ARGS (end - start),
       GST_TIME_ARGS ((end - start) / (num_threads * nbbuffers)),
-      num_threads * nbbuffers);
+      num_threads * nbbuffers, with_metas ? " with metas" : "");
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  gint num_threads;
+  GstBuffer *tmp;
+
+  gst_init (&argc, &argv);
+  g_mutex_init (&mutex);
+
+  if (argc != 3) {
+    g_print ("usage: %s <num_threads> <nbbuffers>\n", argv[0]);
+    exit (-1);
+  }
+
+  num_threads = atoi (argv[1]);
+  nbbuffers = atoi (argv[2]);
+
+  if (num_threads <= 0 || num_threads > MAX_THREADS) {
+    g_print ("number of threads must be between 0 and %d\n", MAX_THREADS);
+    exit (-2);
+  }
+
+  if (nbbuffers <= 0) {
+    g_print ("number of buffers must be greater than 0\n");
+    exit (-3);
+  }
+
+  /* Let's just make sure the GstBufferClass is loaded ... */
+  tmp = gst_buffer_new ();
+
+  run_threads (num_threads);
+
+  /* ... and the meta infos */
+  ref_caps = gst_caps_new_empty_simple ("timestamp/x-stress");
+  parent_buffer = gst_buffer_new ();
+  add_metas (tmp);
 
+  with_metas = TRUE;
+  run_threads (num_threads);
 
   gst_buffer_unref (tmp);
+  gst_buffer_unref (parent_buffer);
+  gst_caps_unref (ref_caps);
 
   return 0;
 }
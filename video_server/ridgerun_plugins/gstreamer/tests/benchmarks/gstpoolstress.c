@@ -23,6 +23,136 @@
 #include "gst/glib-compat-private.h"
 
 #define BUFFER_SIZE (1400)
+#define MAX_THREADS (16)
+/* buffers held by the cache of one thread, as in gstbufferpool.c */
+#define THREAD_CACHE_SIZE (16)
+
+typedef struct
+{
+  GstBufferPool *pool;
+  guint64 nbuffers;
+
+  /* when not NULL, count the buffers that come back to the thread that
+   * released them last */
+  GMutex *lock;
+  GHashTable *owners;
+  volatile gint hits;
+} ThreadData;
+
+static gpointer
+run_thread (gpointer user_data)
+{
+  ThreadData *data = user_data;
+  GstBuffer *tmp;
+  guint64 i;
+
+  for (i = 0; i < data->nbuffers; i++) {
+    gst_buffer_pool_acquire_buffer (data->pool, &tmp, NULL);
+    gst_buffer_unref (tmp);
+  }
+  return NULL;
+}
+
+static gpointer
+run_thread_hits (gpointer user_data)
+{
+  ThreadData *data = user_data;
+  GstBuffer *tmp;
+  guint64 i;
+
+  for (i = 0; i < data->nbuffers; i++) {
+    gst_buffer_pool_acquire_buffer (data->pool, &tmp, NULL);
+    g_mutex_lock (data->lock);
+    if (g_hash_table_lookup (data->owners, tmp) == g_thread_self ())
+      g_atomic_int_inc (&data->hits);
+    g_hash_table_insert (data->owners, tmp, g_thread_self ());
+    g_mutex_unlock (data->lock);
+    gst_buffer_unref (tmp);
+  }
+  return NULL;
+}
+
+/* the caches together hold up to min-buffers, enough for all threads to
+ * fill theirs */
+static GstBufferPool *
+make_pool (gboolean thread_cache, gint nthreads)
+{
+  GstBufferPool *pool;
+  GstStructure *conf;
+
+  pool = gst_buffer_pool_new ();
+
+  conf = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (conf, NULL, BUFFER_SIZE,
+      nthreads * THREAD_CACHE_SIZE, 0);
+  if (thread_cache)
+    gst_buffer_pool_config_add_option (conf,
+        GST_BUFFER_POOL_OPTION_THREAD_CACHE);
+  gst_buffer_pool_set_config (pool, conf);
+
+  gst_buffer_pool_set_active (pool, TRUE);
+
+  return pool;
+}
+
+/* acquire and release nbuffers in total from one pool shared by nthreads
+ * threads, returns the duration */
+static GstClockTimeDiff
+run_threads (gboolean thread_cache, gint nthreads, guint64 nbuffers)
+{
+  GThread *threads[MAX_THREADS];
+  ThreadData data = { NULL, };
+  GstBufferPool *pool;
+  GstClockTime start, end;
+  gint t;
+
+  pool = make_pool (thread_cache, nthreads);
+  data.pool = pool;
+  data.nbuffers = nbuffers / nthreads;
+
+  start = gst_util_get_timestamp ();
+  for (t = 0; t < nthreads; t++)
+    threads[t] = g_thread_new ("poolstress", run_thread, &data);
+  for (t = 0; t < nthreads; t++)
+    g_thread_join (threads[t]);
+  end = gst_util_get_timestamp ();
+
+  gst_buffer_pool_set_active (pool, FALSE);
+  gst_object_unref (pool);
+
+  return GST_CLOCK_DIFF (start, end);
+}
+
+/* same as run_threads() without timing, returns the percentage of
+ * buffers that were acquired by the thread that released them last */
+static gdouble
+run_threads_hits (gboolean thread_cache, gint nthreads, guint64 nbuffers)
+{
+  GThread *threads[MAX_THREADS];
+  ThreadData data = { NULL, };
+  GMutex lock;
+  GstBufferPool *pool;
+  gint t;
+
+  g_mutex_init (&lock);
+  pool = make_pool (thread_cache, nthreads);
+  data.pool = pool;
+  data.nbuffers = nbuffers / nthreads;
+  data.lock = &lock;
+  data.owners = g_hash_table_new (NULL, NULL);
+
+  for (t = 0; t < nthreads; t++)
+    threads[t] = g_thread_new ("poolstress", run_thread_hits, &data);
+  for (t = 0; t < nthreads; t++)
+    g_thread_join (threads[t]);
+
+  gst_buffer_pool_set_active (pool, FALSE);
+  gst_object_unref (pool);
+  g_hash_table_unref (data.owners);
+  g_mutex_clear (&lock);
+
+  return 100.0 * data.hits / (data.nbuffers * nthreads);
+}
 
 gint
 main (gint argc, gchar * argv[])
@@ -32,8 +162,9 @@ main (gint argc, gchar * argv[])
   GstBufferPool *pool;
   GstClockTime start, end;
   GstClockTimeDiff dur1, dur2;
+  gdouble hits1, hits2;
   guint64 nbuffers;
-  GstStructure *conf;
+  gint nthreads;
 
   gst_init (&argc, &argv);
 
@@ -53,13 +184,7 @@ main (gint argc, gchar * argv[])
   tmp = gst_buffer_new ();
   gst_buffer_unref (tmp);
 
-  pool = gst_buffer_pool_new ();
-
-  conf = gst_buffer_pool_get_config (pool);
-  gst_buffer_pool_config_set_params (conf, NULL, BUFFER_SIZE, 0, 0);
-  gst_buffer_pool_set_config (pool, conf);
-
-  gst_buffer_pool_set_active (pool, TRUE);
+  pool = make_pool (FALSE, 1);
 
   /* allocate buffers directly */
   start = gst_util_get_timestamp ();
@@ -90,5 +215,19 @@ main (gint argc, gchar * argv[])
   gst_buffer_pool_set_active (pool, FALSE);
   gst_object_unref (pool);
 
+  /* share one pool between threads, with and without thread cache */
+  for (nthreads = 1; nthreads <= MAX_THREADS; nthreads *= 2) {
+    dur1 = run_threads (FALSE, nthreads, nbuffers);
+    dur2 = run_threads (TRUE, nthreads, nbuffers);
+    hits1 = run_threads_hits (FALSE, nthreads, nbuffers);
+    hits2 = run_threads_hits (TRUE, nthreads, nbuffers);
+    g_print ("*** %2d threads - average %" GST_TIME_FORMAT " shared queue, %"
+        GST_TIME_FORMAT " thread cache - speedup %6.4lf\n", nthreads,
+        GST_TIME_ARGS (dur1 / nbuffers), GST_TIME_ARGS (dur2 / nbuffers),
+        ((gdouble) dur1 / (gdouble) dur2));
+    g_print ("*** %2d threads - same thread reuse %5.1lf%% shared queue, "
+        "%5.1lf%% thread cache\n", nthreads, hits1, hits2);
+  }
+
   return 0;
 }
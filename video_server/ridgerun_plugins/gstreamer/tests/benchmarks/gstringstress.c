@@ -0,0 +1,166 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Passes items from N producer threads to N consumer threads through a
+ * GstAtomicQueue and through a GstAtomicRing, for 1, 4 and 16 threads on
+ * each side. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <gst/gst.h>
+#include "gst/glib-compat-private.h"
+
+#define MAX_THREADS (16)
+#define RING_SIZE (1024)
+
+typedef enum
+{
+  MODE_QUEUE,
+  MODE_RING,
+  MODE_RING_WAIT
+} Mode;
+
+static const gchar *mode_names[] = { "atomic queue", "atomic ring",
+  "atomic ring (wait)"
+};
+
+typedef struct
+{
+  Mode mode;
+  GstAtomicQueue *queue;
+  GstAtomicRing *ring;
+  guint64 nitems;
+} ThreadData;
+
+static gpointer
+run_producer (gpointer user_data)
+{
+  ThreadData *data = user_data;
+  gpointer item = GINT_TO_POINTER (1);
+  guint64 i;
+
+  for (i = 0; i < data->nitems; i++) {
+    switch (data->mode) {
+      case MODE_QUEUE:
+        gst_atomic_queue_push (data->queue, item);
+        break;
+      case MODE_RING:
+        while (!gst_atomic_ring_push (data->ring, item))
+          g_thread_yield ();
+        break;
+      case MODE_RING_WAIT:
+        gst_atomic_ring_push_wait (data->ring, item);
+        break;
+    }
+  }
+  return NULL;
+}
+
+static gpointer
+run_consumer (gpointer user_data)
+{
+  ThreadData *data = user_data;
+  guint64 i;
+
+  for (i = 0; i < data->nitems; i++) {
+    switch (data->mode) {
+      case MODE_QUEUE:
+        while (!gst_atomic_queue_pop (data->queue))
+          g_thread_yield ();
+        break;
+      case MODE_RING:
+        while (!gst_atomic_ring_pop (data->ring))
+          g_thread_yield ();
+        break;
+      case MODE_RING_WAIT:
+        gst_atomic_ring_pop_wait (data->ring);
+        break;
+    }
+  }
+  return NULL;
+}
+
+/* pass nitems in total from nthreads producers to nthreads consumers,
+ * returns the duration */
+static GstClockTimeDiff
+run_threads (Mode mode, gint nthreads, guint64 nitems)
+{
+  GThread *producers[MAX_THREADS], *consumers[MAX_THREADS];
+  ThreadData data;
+  GstClockTime start, end;
+  gint t;
+
+  data.mode = mode;
+  data.queue = gst_atomic_queue_new (RING_SIZE);
+  data.ring = gst_atomic_ring_new (RING_SIZE);
+  data.nitems = nitems / nthreads;
+
+  start = gst_util_get_timestamp ();
+  for (t = 0; t < nthreads; t++) {
+    consumers[t] = g_thread_new ("consumer", run_consumer, &data);
+    producers[t] = g_thread_new ("producer", run_producer, &data);
+  }
+  for (t = 0; t < nthreads; t++) {
+    g_thread_join (producers[t]);
+    g_thread_join (consumers[t]);
+  }
+  end = gst_util_get_timestamp ();
+
+  gst_atomic_queue_unref (data.queue);
+  gst_atomic_ring_unref (data.ring);
+
+  return GST_CLOCK_DIFF (start, end);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GstClockTimeDiff dur[G_N_ELEMENTS (mode_names)];
+  guint64 nitems;
+  gint nthreads;
+  guint m;
+
+  gst_init (&argc, &argv);
+
+  if (argc != 2) {
+    g_print ("usage: %s <nitems>\n", argv[0]);
+    exit (-1);
+  }
+
+  nitems = atoi (argv[1]);
+
+  if (nitems < MAX_THREADS) {
+    g_print ("number of items must be at least %d\n", MAX_THREADS);
+    exit (-3);
+  }
+
+  for (nthreads = 1; nthreads <= MAX_THREADS; nthreads *= 4) {
+    for (m = 0; m < G_N_ELEMENTS (mode_names); m++) {
+      dur[m] = run_threads (m, nthreads, nitems);
+      g_print ("*** %2dP%-2dC %-18s - total %" GST_TIME_FORMAT
+          " - average %" GST_TIME_FORMAT "\n", nthreads, nthreads,
+          mode_names[m], GST_TIME_ARGS (dur[m]),
+          GST_TIME_ARGS (dur[m] / nitems));
+    }
+    g_print ("*** %2dP%-2dC speedup %6.4lf, %6.4lf with wait\n", nthreads,
+        nthreads, ((gdouble) dur[MODE_QUEUE] / (gdouble) dur[MODE_RING]),
+        ((gdouble) dur[MODE_QUEUE] / (gdouble) dur[MODE_RING_WAIT]));
+  }
+
+  return 0;
+}
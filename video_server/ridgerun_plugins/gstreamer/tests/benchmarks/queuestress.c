@@ -0,0 +1,116 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures the throughput of small buffers through a chain of queues,
+ * with and without the spsc property.
+ *
+ * Usage: queuestress [buffers] [buffer size] [queues]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define BUFFER_COUNT (1000000)
+#define BUFFER_SIZE (188)
+#define QUEUE_COUNT (4)
+
+static GstClockTimeDiff
+run_pipeline (guint buffers, guint size, guint queues, gboolean spsc)
+{
+  GstElement *pipeline, *src, *sink, *current, *last;
+  GstClockTime start, end;
+  GstMessage *msg;
+  GstBus *bus;
+  guint i;
+
+  pipeline = gst_element_factory_make ("pipeline", NULL);
+  src = gst_element_factory_make ("fakesrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_assert (pipeline && src && sink);
+
+  g_object_set (src, "num-buffers", buffers, "sizetype", 2, "sizemax", size,
+      "silent", TRUE, NULL);
+  g_object_set (sink, "sync", FALSE, "silent", TRUE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+
+  last = src;
+  for (i = 0; i < queues; i++) {
+    current = gst_element_factory_make ("queue", NULL);
+    g_assert (current);
+    /* the ring is only used without a time limit, use the same limits for
+     * both runs */
+    g_object_set (current, "silent", TRUE, "spsc", spsc, "max-size-time",
+        (guint64) 0, NULL);
+    gst_bin_add (GST_BIN (pipeline), current);
+    if (!gst_element_link (last, current))
+      g_assert_not_reached ();
+    last = current;
+  }
+  if (!gst_element_link (last, sink))
+    g_assert_not_reached ();
+
+  bus = gst_element_get_bus (pipeline);
+
+  start = gst_util_get_timestamp ();
+  if (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+    g_assert_not_reached ();
+  msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  end = gst_util_get_timestamp ();
+
+  g_assert (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return GST_CLOCK_DIFF (start, end);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint buffers = BUFFER_COUNT, size = BUFFER_SIZE, queues = QUEUE_COUNT;
+  GstClockTimeDiff dur1, dur2;
+  guint n;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    buffers = atoi (argv[1]);
+  if (argc > 2)
+    size = atoi (argv[2]);
+  if (argc > 3)
+    queues = atoi (argv[3]);
+
+  g_print ("*** benchmarking fakesrc num-buffers=%u sizemax=%u ! "
+      "n * queue ! fakesink\n", buffers, size);
+
+  for (n = 1; n <= queues; n *= 2) {
+    dur1 = run_pipeline (buffers, size, n, FALSE);
+    dur2 = run_pipeline (buffers, size, n, TRUE);
+    g_print ("*** %u queues - average %" GST_TIME_FORMAT " locked, %"
+        GST_TIME_FORMAT " spsc - %.0f vs %.0f buffers/s - speedup %6.4lf\n",
+        n, GST_TIME_ARGS (dur1 / buffers), GST_TIME_ARGS (dur2 / buffers),
+        buffers * (gdouble) GST_SECOND / dur1,
+        buffers * (gdouble) GST_SECOND / dur2, (gdouble) dur1 / dur2);
+  }
+
+  return 0;
+}
@@ -1181,6 +1181,77 @@ GST_START_TEST (test_initial_events_nodelay)
 
 GST_END_TEST;
 
+static gint order_buffers;
+static gint order_errors;
+
+static GstFlowReturn
+order_chain_func (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  g_mutex_lock (&events_lock);
+  /* the offset is the number of events pushed before the buffer */
+  if (GST_BUFFER_OFFSET (buffer) != events_count)
+    order_errors++;
+  order_buffers++;
+  g_cond_broadcast (&events_cond);
+  g_mutex_unlock (&events_lock);
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+GST_START_TEST (test_spsc_order)
+{
+  GstSegment segment;
+  GstBuffer *buffer;
+  guint i, n_events;
+
+  order_buffers = 0;
+  order_errors = 0;
+
+  /* a small queue makes the buffers go through both the ring and the
+   * locked queue */
+  g_object_set (G_OBJECT (queue), "spsc", TRUE, "max-size-buffers", 4,
+      "max-size-time", (guint64) 0, NULL);
+  mysinkpad = gst_check_setup_sink_pad (queue, &sinktemplate);
+  gst_pad_set_chain_function (mysinkpad, order_chain_func);
+  gst_pad_set_event_function (mysinkpad, event_func);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (queue,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment));
+  n_events = 2;
+
+  for (i = 0; i < 1000; i++) {
+    if (i % 10 == 0) {
+      gst_pad_push_event (mysrcpad,
+          gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM,
+              gst_structure_new_empty ("test")));
+      n_events++;
+    }
+    buffer = gst_buffer_new ();
+    GST_BUFFER_OFFSET (buffer) = n_events;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+  }
+
+  g_mutex_lock (&events_lock);
+  while (order_buffers < 1000)
+    g_cond_wait (&events_cond, &events_lock);
+  g_mutex_unlock (&events_lock);
+
+  fail_unless_equals_int (events_count, n_events);
+  fail_unless_equals_int (order_errors, 0);
+
+  gst_element_set_state (queue, GST_STATE_NULL);
+}
+
+GST_END_TEST;
+
 static Suite *
 queue_suite (void)
 {
@@ -1204,6 +1275,7 @@ queue_suite (void)
   tcase_add_test (tc_chain, test_sticky_not_linked);
   tcase_add_test (tc_chain, test_time_level_buffer_list);
   tcase_add_test (tc_chain, test_initial_events_nodelay);
+  tcase_add_test (tc_chain, test_spsc_order);
 
   return s;
 }
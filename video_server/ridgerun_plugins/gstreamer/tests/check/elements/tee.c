@@ -940,6 +940,259 @@ GST_START_TEST (test_allocation_query_empty)
 GST_END_TEST;
 
 
+/* construct fakesrc num-buffers=100 ! tee parallel=true and link the src
+ * pads to fakesinks without queues. Each fakesink should exactly receive 100
+ * buffers. */
+GST_START_TEST (test_parallel)
+{
+#define NUM_PARALLEL_SINKS 4
+#define NUM_PARALLEL_BUFFERS 100
+  GstElement *pipeline, *src, *tee;
+  GstElement *sinks[NUM_PARALLEL_SINKS];
+  GstPad *req_pads[NUM_PARALLEL_SINKS];
+  guint counts[NUM_PARALLEL_SINKS];
+  GstBus *bus;
+  GstMessage *msg;
+  gint i;
+
+  pipeline = gst_pipeline_new ("pipeline");
+  src = gst_check_setup_element ("fakesrc");
+  g_object_set (src, "num-buffers", NUM_PARALLEL_BUFFERS, NULL);
+  tee = gst_check_setup_element ("tee");
+  g_object_set (tee, "parallel", TRUE, NULL);
+  fail_unless (gst_bin_add (GST_BIN (pipeline), src));
+  fail_unless (gst_bin_add (GST_BIN (pipeline), tee));
+  fail_unless (gst_element_link (src, tee));
+
+  for (i = 0; i < NUM_PARALLEL_SINKS; ++i) {
+    GstPad *sinkpad;
+
+    counts[i] = 0;
+
+    sinks[i] = gst_check_setup_element ("fakesink");
+    fail_unless (gst_bin_add (GST_BIN (pipeline), sinks[i]));
+    g_object_set (sinks[i], "signal-handoffs", TRUE, NULL);
+    g_signal_connect (sinks[i], "handoff", (GCallback) handoff, &counts[i]);
+
+    req_pads[i] = gst_element_get_request_pad (tee, "src_%u");
+    fail_unless (req_pads[i] != NULL);
+    /* every sink must get every buffer */
+    g_object_set (req_pads[i], "leaky", 0 /* no */ , NULL);
+
+    sinkpad = gst_element_get_static_pad (sinks[i], "sink");
+    fail_unless_equals_int (gst_pad_link (req_pads[i], sinkpad),
+        GST_PAD_LINK_OK);
+    gst_object_unref (sinkpad);
+  }
+
+  bus = gst_element_get_bus (pipeline);
+  fail_if (bus == NULL);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  fail_if (GST_MESSAGE_TYPE (msg) != GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  for (i = 0; i < NUM_PARALLEL_SINKS; ++i) {
+    fail_unless_equals_int (counts[i], NUM_PARALLEL_BUFFERS);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+
+  for (i = 0; i < NUM_PARALLEL_SINKS; ++i) {
+    gst_element_release_request_pad (tee, req_pads[i]);
+    gst_object_unref (req_pads[i]);
+  }
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static void
+atomic_handoff (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gint * count)
+{
+  g_atomic_int_inc (count);
+}
+
+static GstPadProbeReturn
+block_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  return GST_PAD_PROBE_OK;
+}
+
+/* in parallel mode, a blocked branch with a leaky queue must not stall the
+ * other branch */
+GST_START_TEST (test_parallel_leaky)
+{
+  GstElement *pipeline, *src, *tee, *sink0, *sink1;
+  GstPad *req_pad0, *req_pad1, *sinkpad;
+  gint count = 0;
+  guint64 dropped;
+  gulong probe;
+
+  pipeline = gst_pipeline_new ("pipeline");
+  src = gst_check_setup_element ("fakesrc");
+  g_object_set (src, "num-buffers", NUM_PARALLEL_BUFFERS, NULL);
+  tee = gst_check_setup_element ("tee");
+  g_object_set (tee, "parallel", TRUE, NULL);
+  sink0 = gst_check_setup_element ("fakesink");
+  sink1 = gst_check_setup_element ("fakesink");
+  /* the blocked sink can't preroll */
+  g_object_set (sink0, "async", FALSE, "sync", FALSE, NULL);
+  g_object_set (sink1, "async", FALSE, "sync", FALSE, "signal-handoffs",
+      TRUE, NULL);
+  g_signal_connect (sink1, "handoff", (GCallback) atomic_handoff, &count);
+  gst_bin_add_many (GST_BIN (pipeline), src, tee, sink0, sink1, NULL);
+  fail_unless (gst_element_link (src, tee));
+
+  req_pad0 = gst_element_get_request_pad (tee, "src_%u");
+  /* leaky downstream is the default */
+  g_object_set (req_pad0, "max-size-buffers", 2, NULL);
+  sinkpad = gst_element_get_static_pad (sink0, "sink");
+  fail_unless_equals_int (gst_pad_link (req_pad0, sinkpad), GST_PAD_LINK_OK);
+  probe = gst_pad_add_probe (sinkpad,
+      GST_PAD_PROBE_TYPE_BLOCK | GST_PAD_PROBE_TYPE_BUFFER, block_probe, NULL,
+      NULL);
+  gst_object_unref (sinkpad);
+
+  req_pad1 = gst_element_get_request_pad (tee, "src_%u");
+  sinkpad = gst_element_get_static_pad (sink1, "sink");
+  fail_unless_equals_int (gst_pad_link (req_pad1, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  while (g_atomic_int_get (&count) < NUM_PARALLEL_BUFFERS)
+    g_usleep (G_USEC_PER_SEC / 100);
+
+  /* one buffer is blocked in the probe and at most two are queued */
+  g_object_get (req_pad0, "dropped", &dropped, NULL);
+  fail_unless (dropped >= NUM_PARALLEL_BUFFERS - 3);
+
+  sinkpad = gst_element_get_static_pad (sink0, "sink");
+  gst_pad_remove_probe (sinkpad, probe);
+  gst_object_unref (sinkpad);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  gst_element_release_request_pad (tee, req_pad0);
+  gst_object_unref (req_pad0);
+  gst_element_release_request_pad (tee, req_pad1);
+  gst_object_unref (req_pad1);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static gboolean refuse_caps;
+static gboolean segment_before_allocation;
+
+static gboolean
+fixed_caps_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS && refuse_caps) {
+    gst_event_unref (event);
+    return FALSE;
+  }
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static gboolean
+fixed_caps_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  GstEvent *segment;
+
+  if (GST_QUERY_TYPE (query) != GST_QUERY_ALLOCATION)
+    return gst_pad_query_default (pad, parent, query);
+
+  segment = gst_pad_get_sticky_event (pad, GST_EVENT_SEGMENT, 0);
+  segment_before_allocation = segment != NULL;
+  if (segment)
+    gst_event_unref (segment);
+
+  gst_query_add_allocation_pool (query, NULL, 128, 2, 0);
+
+  return TRUE;
+}
+
+/* in parallel mode, the allocation query must come after the events queued
+ * before it and a refused caps event must fail upstream */
+GST_START_TEST (test_parallel_caps_and_allocation)
+{
+  static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+      GST_PAD_SRC,
+      GST_PAD_ALWAYS,
+      GST_STATIC_CAPS_ANY);
+  static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+      GST_PAD_SINK,
+      GST_PAD_ALWAYS,
+      GST_STATIC_CAPS ("test/fixed, width=(int)320"));
+  GstElement *tee;
+  GstPad *mysrcpad, *mysinkpad;
+  GstCaps *caps;
+  GstQuery *query;
+  GstSegment segment;
+  guint size, min, max;
+
+  refuse_caps = FALSE;
+  segment_before_allocation = FALSE;
+
+  tee = gst_check_setup_element ("tee");
+  g_object_set (tee, "parallel", TRUE, NULL);
+  mysrcpad = gst_check_setup_src_pad (tee, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad_by_name (tee, &sinktemplate, "src_%u");
+  gst_pad_set_event_function (mysinkpad, fixed_caps_event);
+  gst_pad_set_query_function (mysinkpad, fixed_caps_query);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (tee, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_event_new_stream_start ("test")));
+
+  /* caps that are not a subset of the template are refused by the
+   * accept-caps query already */
+  caps = gst_caps_from_string ("test/fixed, width=(int)640");
+  fail_if (gst_pad_push_event (mysrcpad, gst_event_new_caps (caps)));
+  gst_caps_unref (caps);
+
+  /* caps refused by the event handler */
+  caps = gst_caps_from_string ("test/fixed, width=(int)320");
+  refuse_caps = TRUE;
+  fail_if (gst_pad_push_event (mysrcpad, gst_event_new_caps (gst_caps_ref
+              (caps))));
+  refuse_caps = FALSE;
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_event_new_caps (gst_caps_ref (caps))));
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+
+  query = gst_query_new_allocation (caps, TRUE);
+  fail_unless (gst_pad_peer_query (mysrcpad, query));
+  fail_unless (segment_before_allocation);
+  fail_unless_equals_int (gst_query_get_n_allocation_pools (query), 1);
+  gst_query_parse_nth_allocation_pool (query, 0, NULL, &size, &min, &max);
+  fail_unless_equals_int (size, 128);
+  fail_unless_equals_int (min, 2);
+  gst_query_unref (query);
+  gst_caps_unref (caps);
+
+  gst_element_set_state (tee, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_pad_by_name (tee, "src_0");
+  gst_check_teardown_src_pad (tee);
+  gst_check_teardown_element (tee);
+}
+
+GST_END_TEST;
+
 static Suite *
 tee_suite (void)
 {
@@ -962,6 +1215,9 @@ tee_suite (void)
   tcase_add_test (tc_chain, test_allocation_query_allow_not_linked);
   tcase_add_test (tc_chain, test_allocation_query_failure);
   tcase_add_test (tc_chain, test_allocation_query_empty);
+  tcase_add_test (tc_chain, test_parallel);
+  tcase_add_test (tc_chain, test_parallel_leaky);
+  tcase_add_test (tc_chain, test_parallel_caps_and_allocation);
 
   return s;
 }
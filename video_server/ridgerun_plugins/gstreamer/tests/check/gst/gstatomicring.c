@@ -0,0 +1,151 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/gstatomicring.h>
+#include <gst/gst.h>
+
+GST_START_TEST (test_create_free)
+{
+  GstAtomicRing *ring;
+
+  ring = gst_atomic_ring_new (20);
+  fail_unless_equals_int (gst_atomic_ring_get_size (ring), 32);
+  fail_unless_equals_int (gst_atomic_ring_length (ring), 0);
+  gst_atomic_ring_unref (ring);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_push_pop)
+{
+  GstAtomicRing *ring;
+  guint i, round;
+
+  ring = gst_atomic_ring_new (4);
+
+  /* go around the ring a few times */
+  for (round = 0; round < 3; round++) {
+    for (i = 1; i <= 4; i++)
+      fail_unless (gst_atomic_ring_push (ring, GUINT_TO_POINTER (i)));
+    fail_unless_equals_int (gst_atomic_ring_length (ring), 4);
+    fail_if (gst_atomic_ring_push (ring, GUINT_TO_POINTER (5)));
+
+    for (i = 1; i <= 4; i++)
+      fail_unless_equals_int (GPOINTER_TO_UINT (gst_atomic_ring_pop (ring)),
+          i);
+    fail_unless (gst_atomic_ring_pop (ring) == NULL);
+    fail_unless_equals_int (gst_atomic_ring_length (ring), 0);
+  }
+
+  gst_atomic_ring_unref (ring);
+}
+
+GST_END_TEST;
+
+#define N_ITEMS 100000
+
+static gpointer
+push_items (gpointer data)
+{
+  GstAtomicRing *ring = data;
+  guint i;
+
+  for (i = 1; i <= N_ITEMS; i++)
+    fail_unless (gst_atomic_ring_push_wait (ring, GUINT_TO_POINTER (i)));
+
+  return NULL;
+}
+
+GST_START_TEST (test_wait)
+{
+  GstAtomicRing *ring;
+  GThread *thread;
+  guint i;
+
+  /* a small ring makes both sides wait */
+  ring = gst_atomic_ring_new (2);
+  thread = g_thread_new ("push", push_items, ring);
+
+  /* items come out in order */
+  for (i = 1; i <= N_ITEMS; i++)
+    fail_unless_equals_int (GPOINTER_TO_UINT (gst_atomic_ring_pop_wait
+            (ring)), i);
+
+  g_thread_join (thread);
+  fail_unless (gst_atomic_ring_pop (ring) == NULL);
+
+  gst_atomic_ring_unref (ring);
+}
+
+GST_END_TEST;
+
+static gpointer
+pop_wait (gpointer data)
+{
+  return gst_atomic_ring_pop_wait (data);
+}
+
+GST_START_TEST (test_flushing)
+{
+  GstAtomicRing *ring;
+  GThread *thread;
+
+  ring = gst_atomic_ring_new (1);
+
+  /* unblock a waiting consumer */
+  thread = g_thread_new ("pop", pop_wait, ring);
+  g_usleep (G_USEC_PER_SEC / 20);
+  gst_atomic_ring_set_flushing (ring, TRUE);
+  fail_unless (g_thread_join (thread) == NULL);
+
+  fail_unless (gst_atomic_ring_pop_wait (ring) == NULL);
+  fail_if (gst_atomic_ring_push_wait (ring, GUINT_TO_POINTER (1)));
+
+  /* the non waiting functions keep working */
+  fail_unless (gst_atomic_ring_push (ring, GUINT_TO_POINTER (1)));
+  fail_unless (gst_atomic_ring_pop (ring) == GUINT_TO_POINTER (1));
+
+  gst_atomic_ring_set_flushing (ring, FALSE);
+  fail_unless (gst_atomic_ring_push_wait (ring, GUINT_TO_POINTER (2)));
+  fail_unless (gst_atomic_ring_pop_wait (ring) == GUINT_TO_POINTER (2));
+
+  gst_atomic_ring_unref (ring);
+}
+
+GST_END_TEST;
+
+static Suite *
+gst_atomic_ring_suite (void)
+{
+  Suite *s = suite_create ("GstAtomicRing");
+  TCase *tc_chain = tcase_create ("GstAtomicRing tests");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_create_free);
+  tcase_add_test (tc_chain, test_push_pop);
+  tcase_add_test (tc_chain, test_wait);
+  tcase_add_test (tc_chain, test_flushing);
+
+  return s;
+}
+
+GST_CHECK_MAIN (gst_atomic_ring);
@@ -303,6 +303,58 @@ GST_START_TEST (test_flushing_pool_returns_flushing)
 
 GST_END_TEST;
 
+static gpointer
+unref_buffer_thread (gpointer buf)
+{
+  g_usleep (G_USEC_PER_SEC / 20);
+  gst_buffer_unref (buf);
+  return NULL;
+}
+
+/* buffers released into the cache of one thread must be found by another
+ * thread that runs out of buffers, both when not waiting and when waiting */
+GST_START_TEST (test_thread_cache_cross_thread_release)
+{
+  GstBufferPool *pool = gst_buffer_pool_new ();
+  GstStructure *conf = gst_buffer_pool_get_config (pool);
+  GstBufferPoolAcquireParams params = { 0, };
+  GstBuffer *buf1, *buf2, *buf = NULL;
+  GstFlowReturn ret;
+  GThread *thread;
+
+  gst_buffer_pool_config_set_params (conf, NULL, 10, 0, 2);
+  gst_buffer_pool_config_add_option (conf,
+      GST_BUFFER_POOL_OPTION_THREAD_CACHE);
+  fail_unless (gst_buffer_pool_set_config (pool, conf));
+  gst_buffer_pool_set_active (pool, TRUE);
+
+  gst_buffer_pool_acquire_buffer (pool, &buf1, NULL);
+  gst_buffer_pool_acquire_buffer (pool, &buf2, NULL);
+
+  /* released into the cache of the other thread, which is drained when
+   * the pool runs out of buffers */
+  thread = g_thread_new ("release", unref_buffer_thread, buf1);
+  g_thread_join (thread);
+
+  params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+  ret = gst_buffer_pool_acquire_buffer (pool, &buf, &params);
+  ck_assert_int_eq (ret, GST_FLOW_OK);
+  fail_unless (buf == buf1);
+
+  /* released while we wait for it */
+  thread = g_thread_new ("release", unref_buffer_thread, buf2);
+  ret = gst_buffer_pool_acquire_buffer (pool, &buf2, NULL);
+  ck_assert_int_eq (ret, GST_FLOW_OK);
+  g_thread_join (thread);
+
+  gst_buffer_unref (buf);
+  gst_buffer_unref (buf2);
+  gst_buffer_pool_set_active (pool, FALSE);
+  gst_object_unref (pool);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_buffer_pool_suite (void)
 {
@@ -321,6 +373,7 @@ gst_buffer_pool_suite (void)
   tcase_add_test (tc_chain, test_pool_activation_and_config);
   tcase_add_test (tc_chain, test_pool_config_validate);
   tcase_add_test (tc_chain, test_flushing_pool_returns_flushing);
+  tcase_add_test (tc_chain, test_thread_cache_cross_thread_release);
 
   return s;
 }
@@ -463,6 +463,89 @@ GST_START_TEST (test_meta_iterate)
 
 GST_END_TEST;
 
+GST_START_TEST (test_meta_many)
+{
+  GstBuffer *buffer;
+  GstMeta *metas[12];
+  gint i;
+
+  buffer = gst_buffer_new_and_alloc (4);
+
+  /* more metas than fit in the buffer itself, and than are indexed */
+  for (i = 0; i < 12; i++) {
+    if (i % 2)
+      metas[i] = (GstMeta *) GST_META_FOO_ADD (buffer);
+    else
+      metas[i] = (GstMeta *) GST_META_TEST_ADD (buffer);
+    fail_unless (metas[i] != NULL);
+
+    /* the most recently added one is returned */
+    if (i % 2)
+      fail_unless (gst_buffer_get_meta (buffer, GST_META_FOO_API_TYPE) ==
+          metas[i]);
+    else
+      fail_unless (gst_buffer_get_meta (buffer, GST_META_TEST_API_TYPE) ==
+          metas[i]);
+  }
+  fail_unless_equals_int (count_buffer_meta (buffer), 12);
+  fail_unless_equals_int (gst_buffer_get_n_meta (buffer,
+          GST_META_FOO_API_TYPE), 6);
+
+  /* remove from the end, the previous ones must be found again */
+  for (i = 11; i >= 2; i--) {
+    fail_unless (gst_buffer_remove_meta (buffer, metas[i]));
+    if (i % 2)
+      fail_unless (gst_buffer_get_meta (buffer, GST_META_FOO_API_TYPE) ==
+          metas[i - 2]);
+    else
+      fail_unless (gst_buffer_get_meta (buffer, GST_META_TEST_API_TYPE) ==
+          metas[i - 2]);
+  }
+  fail_unless_equals_int (count_buffer_meta (buffer), 2);
+
+  /* remove the first one and add again */
+  fail_unless (gst_buffer_remove_meta (buffer, metas[0]));
+  fail_unless (gst_buffer_get_meta (buffer, GST_META_TEST_API_TYPE) == NULL);
+  fail_unless (gst_buffer_get_meta (buffer, GST_META_FOO_API_TYPE) ==
+      metas[1]);
+  metas[0] = (GstMeta *) GST_META_TEST_ADD (buffer);
+  fail_unless (gst_buffer_get_meta (buffer, GST_META_TEST_API_TYPE) ==
+      metas[0]);
+  fail_unless_equals_int (count_buffer_meta (buffer), 2);
+
+  gst_buffer_unref (buffer);
+
+  /* remove metas out of order while there are more than fit in the index */
+  buffer = gst_buffer_new_and_alloc (4);
+  for (i = 0; i < 6; i++) {
+    if (i == 5)
+      metas[i] = (GstMeta *) GST_META_FOO_ADD (buffer);
+    else
+      metas[i] = (GstMeta *) GST_META_TEST_ADD (buffer);
+  }
+  fail_unless (gst_buffer_remove_meta (buffer, metas[0]));
+  fail_unless (gst_buffer_get_meta (buffer, GST_META_TEST_API_TYPE) ==
+      metas[4]);
+  fail_unless (gst_buffer_get_meta (buffer, GST_META_FOO_API_TYPE) ==
+      metas[5]);
+  fail_unless (gst_buffer_remove_meta (buffer, metas[2]));
+  fail_unless (gst_buffer_remove_meta (buffer, metas[4]));
+  fail_unless (gst_buffer_get_meta (buffer, GST_META_TEST_API_TYPE) ==
+      metas[3]);
+  fail_unless (gst_buffer_get_meta (buffer, GST_META_FOO_API_TYPE) ==
+      metas[5]);
+  fail_unless_equals_int (gst_buffer_get_n_meta (buffer,
+          GST_META_TEST_API_TYPE), 2);
+  fail_unless_equals_int (gst_buffer_get_n_meta (buffer,
+          GST_META_FOO_API_TYPE), 1);
+  fail_unless (gst_buffer_remove_meta (buffer, metas[5]));
+  fail_unless (gst_buffer_get_meta (buffer, GST_META_FOO_API_TYPE) == NULL);
+  fail_unless_equals_int (count_buffer_meta (buffer), 2);
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_buffermeta_suite (void)
 {
@@ -474,6 +557,7 @@ gst_buffermeta_suite (void)
   tcase_add_test (tc_chain, test_meta_locked);
   tcase_add_test (tc_chain, test_meta_foreach_remove_one);
   tcase_add_test (tc_chain, test_meta_iterate);
+  tcase_add_test (tc_chain, test_meta_many);
 
   return s;
 }